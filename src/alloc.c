@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Allocate memory with functions the caller can set.
+ *
+ * All memory the library allocates comes through g2c_malloc(),
+ * g2c_calloc(), g2c_realloc() and g2c_free(), which call the
+ * functions set with g2c_set_allocator(), or the C library if none
+ * are set.
+ */
+
+#include <stdlib.h>
+#include "grib2_int.h"
+
+/** The functions set with g2c_set_allocator(). All NULL to use the C
+ * library. */
+static struct
+{
+    g2c_malloc_func mallocf;   /**< Like malloc(). */
+    g2c_calloc_func callocf;   /**< Like calloc(). */
+    g2c_realloc_func reallocf; /**< Like realloc(). */
+    g2c_free_func freef;       /**< Like free(). */
+    void *ctx;                 /**< Passed to each function. */
+} g2c_allocator;
+
+/**
+ * Set the functions the library uses to allocate and free memory.
+ *
+ * Every allocation in the library, including the arrays of a
+ * gribfield, the section arrays from g2_unpack1() to g2_unpack7(),
+ * the templates, the work arrays of the packing and unpacking code,
+ * and the row pointers given to libpng, goes through these
+ * functions. Memory the library allocates with libpng's own
+ * structures also goes through them. Memory allocated inside the
+ * JPEG2000 libraries does not.
+ *
+ * Memory the library returns to the caller, such as a gribfield or
+ * the array from g2_unpack7(), comes from these functions. Free it
+ * with the free function, or with g2_free() for a gribfield. With
+ * the default functions, free() may be used as before.
+ *
+ * Call this before using the library, and not while other threads
+ * are using it. Memory allocated with one set of functions must not
+ * be freed after changing to another set.
+ *
+ * @param mallocf Function like malloc().
+ * @param callocf Function like calloc().
+ * @param reallocf Function like realloc().
+ * @param freef Function like free().
+ * @param ctx Pointer passed as the last argument to each function.
+ *
+ * Pass NULL for all four functions to go back to the C library.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Some, but not all, of the functions are NULL.
+ */
+int
+g2c_set_allocator(g2c_malloc_func mallocf, g2c_calloc_func callocf,
+                  g2c_realloc_func reallocf, g2c_free_func freef, void *ctx)
+{
+    int nset = !!mallocf + !!callocf + !!reallocf + !!freef;
+
+    if (nset != 0 && nset != 4)
+        return G2C_EINVAL;
+
+    g2c_allocator.mallocf = mallocf;
+    g2c_allocator.callocf = callocf;
+    g2c_allocator.reallocf = reallocf;
+    g2c_allocator.freef = freef;
+    g2c_allocator.ctx = nset ? ctx : NULL;
+
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Allocate memory, like malloc().
+ *
+ * @param size Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL if it can't be allocated.
+ */
+void *
+g2c_malloc(size_t size)
+{
+    if (g2c_allocator.mallocf)
+        return g2c_allocator.mallocf(size, g2c_allocator.ctx);
+    return malloc(size);
+}
+
+/**
+ * Allocate zeroed memory, like calloc().
+ *
+ * @param nmemb Number of elements.
+ * @param size Size of each element.
+ *
+ * @return Pointer to the memory, or NULL if it can't be allocated.
+ */
+void *
+g2c_calloc(size_t nmemb, size_t size)
+{
+    if (g2c_allocator.callocf)
+        return g2c_allocator.callocf(nmemb, size, g2c_allocator.ctx);
+    return calloc(nmemb, size);
+}
+
+/**
+ * Change the size of memory, like realloc().
+ *
+ * @param ptr The memory, or NULL.
+ * @param size New size in bytes.
+ *
+ * @return Pointer to the memory, or NULL if it can't be allocated.
+ */
+void *
+g2c_realloc(void *ptr, size_t size)
+{
+    if (g2c_allocator.reallocf)
+        return g2c_allocator.reallocf(ptr, size, g2c_allocator.ctx);
+    return realloc(ptr, size);
+}
+
+/**
+ * Free memory, like free().
+ *
+ * @param ptr The memory, or NULL.
+ */
+void
+g2c_free(void *ptr)
+{
+    if (g2c_allocator.freef)
+        g2c_allocator.freef(ptr, g2c_allocator.ctx);
+    else
+        free(ptr);
+}
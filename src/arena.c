@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief A simple arena, so that a gribfield and all its arrays can
+ * be allocated in one block, and freed with one call.
+ *
+ * Memory is handed out from the block in order, and is never freed on
+ * its own. Functions that take an arena allocate from the heap when
+ * it is NULL, so the same code serves both.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/** Round a size up to the arena alignment. */
+#define ARENA_ROUND(s) (((s) + G2C_ARENA_ALIGN - 1) & ~(size_t)(G2C_ARENA_ALIGN - 1))
+
+/**
+ * Allocate zeroed memory from an arena, or from the heap.
+ *
+ * @param arena The arena, or NULL to use calloc().
+ * @param size Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL if there is not enough.
+ */
+void *
+g2c_arena_alloc(g2c_arena *arena, size_t size)
+{
+    void *p;
+
+    if (!arena)
+        return g2c_calloc(size ? size : 1, 1);
+    if (ARENA_ROUND(size) > arena->size - arena->used)
+        return NULL;
+    p = arena->base + arena->used;
+    arena->used += ARENA_ROUND(size);
+    return p;
+}
+
+/**
+ * Change the size of memory from g2c_arena_alloc(), like
+ * realloc(). The last memory allocated from an arena grows in place,
+ * otherwise new memory is allocated and the contents copied.
+ *
+ * @param arena The arena, or NULL to use realloc().
+ * @param p The memory, or NULL.
+ * @param old Size of the memory.
+ * @param size New size.
+ *
+ * @return Pointer to the memory, or NULL if there is not enough.
+ */
+void *
+g2c_arena_realloc(g2c_arena *arena, void *p, size_t old, size_t size)
+{
+    unsigned char *newp;
+
+    if (!arena)
+        return g2c_realloc(p, size);
+    if (size <= old)
+        return p;
+    if (p && (unsigned char *)p + ARENA_ROUND(old) == arena->base + arena->used)
+    {
+        if (ARENA_ROUND(size) - ARENA_ROUND(old) > arena->size - arena->used)
+            return NULL;
+        arena->used += ARENA_ROUND(size) - ARENA_ROUND(old);
+        return p;
+    }
+    if (!(newp = g2c_arena_alloc(arena, size)))
+        return NULL;
+    if (p)
+        memcpy(newp, p, old);
+    return newp;
+}
+
+/**
+ * Free memory from g2c_arena_alloc(). Memory in an arena is only
+ * freed with the whole block.
+ *
+ * @param arena The arena, or NULL if the memory came from the heap.
+ * @param p The memory.
+ */
+void
+g2c_arena_free(g2c_arena *arena, void *p)
+{
+    if (!arena)
+        g2c_free(p);
+}
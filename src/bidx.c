@@ -0,0 +1,770 @@
+/**
+ * @file
+ * @brief Write and read binary index files, which hold the locations
+ * of the sections and the key metadata of every field of a GRIB2
+ * file.
+ *
+ * A binary index file is a header followed by an array of
+ * ::g2c_bidx_rec, one per field, in file order. It is mapped into
+ * memory when opened, so opening an index does not depend on its
+ * size, and the data of any field can be read and decoded with one
+ * read of its section 7 (and one of its bitmap, if it has one).
+ *
+ * A catalog, written by g2c_write_catalog(), is a binary index of
+ * several GRIB2 files. The records of each file follow those of the
+ * file before it, and the names of the files follow the records.
+ *
+ * The index of a file that is still being written is kept up to date
+ * with g2c_update_bidx(), which appends the records of new messages,
+ * then updates the number of records in the header. Records past
+ * that number are ignored, so a reader never sees a record that is
+ * only partly written.
+ *
+ * Records are in the byte order of the machine that wrote them. An
+ * index written on a machine of the other byte order is rejected.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/** Magic number at the start of a binary index file. */
+#define BIDX_MAGIC "G2CBIDX"
+
+/** Written to the header, to check the byte order of the index. */
+#define BIDX_BYTE_ORDER 0x01020304
+
+/** FNV-1a offset basis. */
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+
+/** FNV-1a prime. */
+#define FNV_PRIME 0x100000001b3ULL
+
+/**
+ * Header of a binary index file.
+ */
+struct bidx_header
+{
+    char magic[8];       /**< ::BIDX_MAGIC. */
+    uint32_t version;    /**< ::G2C_BIDX_VERSION. */
+    uint32_t rec_size;   /**< Size of each record. */
+    uint32_t byte_order; /**< ::BIDX_BYTE_ORDER. */
+    uint32_t nfiles;     /**< Number of GRIB files in a catalog, 0 for the index of one file. */
+    uint64_t nrecs;      /**< Number of records. */
+    uint64_t grib_size;  /**< Size of the GRIB file that was indexed, or how far it was
+                          * scanned by g2c_update_bidx(), 0 for a catalog. */
+};
+
+/**
+ * Open binary index.
+ */
+struct g2c_bidx
+{
+    g2c_file *file;      /**< The mapped index file. */
+    size_t nrecs;        /**< Number of records. */
+    g2c_bidx_rec *recs;  /**< Records, in the mapped file. */
+    int nfiles;          /**< Number of GRIB files in a catalog. */
+    const char **paths;  /**< Names of the GRIB files, in the mapped file. */
+};
+
+/**
+ * Add bytes to an FNV-1a hash.
+ *
+ * @param hash The hash so far.
+ * @param p The bytes.
+ * @param len Number of bytes.
+ *
+ * @return The new hash.
+ */
+static uint64_t
+fnv1a(uint64_t hash, unsigned char *p, g2int len)
+{
+    g2int i;
+
+    for (i = 0; i < len; i++)
+        hash = (hash ^ p[i]) * FNV_PRIME;
+    return hash;
+}
+
+/**
+ * Fill in a binary index record from the sections of a field.
+ *
+ * @param msg Section table of the message.
+ * @param fs Sections of the field.
+ * @param rec The record, which gets the locations and metadata.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EMSG Error unpacking a section, or the field is missing a
+ * section.
+ */
+static int
+describe(g2c_msg *msg, g2c_fldsecs *fs, g2c_bidx_rec *rec)
+{
+    unsigned char *cgrib = msg->cgrib;
+    g2int iofst, *idsect = NULL, idsectlen, ipdtnum, *ipdtmpl = NULL, ipdtlen;
+    g2int *igds = NULL, *igdtmpl = NULL, igdtlen, *ideflist = NULL, idefnum;
+    g2int ndpts, idrtnum, *idrtmpl = NULL, idrtlen, numcoord, len, i;
+    g2float *coord_list = NULL;
+    uint64_t hash = FNV_OFFSET;
+    int s, ret = G2C_EMSG;
+
+    if (!fs->sec[1] || !fs->sec[3] || !fs->sec[5] || !fs->sec[6] || !fs->sec[7])
+        return G2C_EMSG;
+
+    /* Where the sections are, and the hash of the field. */
+    for (s = 1; s <= 7; s++)
+    {
+        if (!fs->sec[s])
+            continue;
+        gbit(cgrib, &len, fs->sec[s] * 8, 32);
+        rec->sec_offset[s] = fs->sec[s] - msg->istart;
+        rec->sec_len[s] = len;
+        if (s >= 3)
+            hash = fnv1a(hash, cgrib + fs->sec[s], len);
+    }
+    rec->hash = hash;
+    if (fs->bmap6)
+    {
+        rec->bmap_offset = fs->bmap6 - msg->istart;
+        gbit(cgrib, &rec->bmap_len, fs->bmap6 * 8, 32);
+    }
+    gbit(cgrib, &len, fs->sec[6] * 8 + 40, 8);
+    rec->ibmap = len;
+
+    /* Key values of sections 1, 3, 4 and 5. */
+    iofst = fs->sec[1] * 8;
+    if (g2_unpack1(cgrib, &iofst, &idsect, &idsectlen))
+        goto exit;
+    iofst = fs->sec[3] * 8;
+    if (g2_unpack3(cgrib, &iofst, &igds, &igdtmpl, &igdtlen, &ideflist, &idefnum))
+        goto exit;
+    iofst = fs->sec[4] * 8;
+    if (g2_unpack4(cgrib, &iofst, &ipdtnum, &ipdtmpl, &ipdtlen, &coord_list, &numcoord))
+        goto exit;
+    iofst = fs->sec[5] * 8;
+    if (g2_unpack5(cgrib, &iofst, &ndpts, &idrtnum, &idrtmpl, &idrtlen))
+        goto exit;
+    if (idrtlen > G2C_BIDX_MAX_DRT || ipdtlen < 2)
+        goto exit;
+
+    rec->discipline = msg->discipline;
+    rec->center = idsect[0];
+    rec->subcenter = idsect[1];
+    rec->master_table = idsect[2];
+    rec->signif_reftime = idsect[4];
+    rec->refyear = idsect[5];
+    rec->refmonth = idsect[6];
+    rec->refday = idsect[7];
+    rec->refhour = idsect[8];
+    rec->refminute = idsect[9];
+    rec->refsecond = idsect[10];
+
+    rec->ngrdpts = igds[1];
+    rec->igdtnum = igds[4];
+    for (i = 0; i < 3 && i < igdtlen; i++)
+        rec->igdtmpl[i] = igdtmpl[i];
+
+    /* Every template starts with the category and number. Templates
+     * 4.0 to 4.15 share the layout of the time and level values, and
+     * the ensemble templates 4.1 and 4.11 add the member after
+     * them. Other templates, such as the satellite template 4.31,
+     * leave those values 0. */
+    rec->ipdtnum = ipdtnum;
+    rec->category = ipdtmpl[0];
+    rec->number = ipdtmpl[1];
+    rec->ens_type = rec->ens_member = -1;
+    if (ipdtnum <= 15 && ipdtlen >= 15)
+    {
+        rec->time_unit = ipdtmpl[7];
+        rec->fcst_time = ipdtmpl[8];
+        rec->level_type1 = ipdtmpl[9];
+        rec->level_scale1 = ipdtmpl[10];
+        rec->level_value1 = ipdtmpl[11];
+        rec->level_type2 = ipdtmpl[12];
+        rec->level_scale2 = ipdtmpl[13];
+        rec->level_value2 = ipdtmpl[14];
+        if ((ipdtnum == 1 || ipdtnum == 11) && ipdtlen >= 18)
+        {
+            rec->ens_type = ipdtmpl[15];
+            rec->ens_member = ipdtmpl[16];
+        }
+    }
+
+    rec->ndpts = ndpts;
+    rec->idrtnum = idrtnum;
+    rec->idrtlen = idrtlen;
+    for (i = 0; i < idrtlen; i++)
+        rec->idrtmpl[i] = idrtmpl[i];
+    ret = G2C_NO_ERROR;
+
+exit:
+    g2c_free(idsect);
+    g2c_free(igds);
+    g2c_free(igdtmpl);
+    g2c_free(ideflist);
+    g2c_free(ipdtmpl);
+    g2c_free(coord_list);
+    g2c_free(idrtmpl);
+    return ret;
+}
+
+/**
+ * Add the records of the fields of a message to a growing array.
+ * The message number of the records is left 0.
+ *
+ * @param cgrib The message.
+ * @param loc Location of the message in its file.
+ * @param recs Pointer to the array, which may be reallocated.
+ * @param nrecs Pointer to the number of records in the array.
+ * @param nalloc Pointer to the allocated size of the array.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EMSG Malformed message, or a Data Representation Template
+ * with more than ::G2C_BIDX_MAX_DRT values.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_bidx_msg_recs(unsigned char *cgrib, g2c_msgloc *loc, g2c_bidx_rec **recs,
+                  size_t *nrecs, size_t *nalloc)
+{
+    g2c_bidx_rec *r;
+    g2c_msg msg = {0};
+    size_t need;
+    int32_t f;
+    int ret;
+
+    if ((ret = g2c_msg_walk(cgrib, 0, 0, &msg)))
+        return ret == G2C_ENOMEM ? G2C_ENOMEM : G2C_EMSG;
+    if ((need = *nrecs + msg.numfields) > *nalloc)
+    {
+        *nalloc = need > 2 * *nalloc ? need : 2 * *nalloc;
+        if (!(r = g2c_realloc(*recs, *nalloc * sizeof(g2c_bidx_rec))))
+        {
+            g2c_free(msg.fld);
+            return G2C_ENOMEM;
+        }
+        *recs = r;
+    }
+    for (f = 0; f < msg.numfields; f++)
+    {
+        r = &(*recs)[*nrecs];
+        memset(r, 0, sizeof(g2c_bidx_rec));
+        r->msg_offset = loc->offset;
+        r->msg_len = loc->bytes;
+        r->fldnum = f + 1;
+        if ((ret = describe(&msg, &msg.fld[f], r)))
+            break;
+        (*nrecs)++;
+    }
+    g2c_free(msg.fld);
+    return ret;
+}
+
+/**
+ * Write the header of a binary index or catalog, at the current
+ * position of the file.
+ *
+ * @param out The index file.
+ * @param grib_size Size of the indexed GRIB file, 0 for a catalog.
+ * @param nrecs Number of records.
+ * @param nfiles Number of GRIB files in a catalog, 0 for the index of
+ * one file.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EFILE Error writing the file.
+ */
+int
+g2c_write_bidx_header(FILE *out, g2int grib_size, size_t nrecs, int nfiles)
+{
+    struct bidx_header hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BIDX_MAGIC, sizeof(BIDX_MAGIC));
+    hdr.version = G2C_BIDX_VERSION;
+    hdr.rec_size = sizeof(g2c_bidx_rec);
+    hdr.byte_order = BIDX_BYTE_ORDER;
+    hdr.nfiles = nfiles;
+    hdr.nrecs = nrecs;
+    hdr.grib_size = grib_size;
+    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1)
+        return G2C_EFILE;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Write a binary index of a GRIB2 file, in one pass over the file.
+ *
+ * For each field, the index holds the location and length of the
+ * message and of each section the field uses, including the section 6
+ * holding its bitmap, and the key values of sections 1, 3, 4 and
+ * 5. GRIB1 messages are skipped, and not counted.
+ *
+ * To index many files, or large files, with several threads, use
+ * g2c_write_bidxs().
+ *
+ * @param path Name of the GRIB2 file.
+ * @param idxpath Name of the index file to write.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading or writing a file.
+ * - ::G2C_EMSG Malformed message, or a Data Representation Template
+ * with more than ::G2C_BIDX_MAX_DRT values.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_write_bidx(const char *path, const char *idxpath)
+{
+    g2c_bidx_rec *recs = NULL;
+    g2c_file *file;
+    g2c_msgloc loc;
+    unsigned char *cgrib;
+    size_t pos = 0, nrecs, nalloc = 0, total = 0, r;
+    int32_t msgnum = 0;
+    FILE *out;
+    int ret;
+
+    if (!path || !idxpath)
+        return G2C_EINVAL;
+    if ((ret = g2c_open_file(path, G2C_ACCESS_SEQUENTIAL, &file)))
+        return ret;
+    if (!(out = fopen(idxpath, "wb")))
+    {
+        g2c_close_file(file);
+        return G2C_EFILE;
+    }
+
+    /* The header is written again at the end, when the number of
+     * records is known. */
+    ret = g2c_write_bidx_header(out, file->len, 0, 0);
+
+    while (!ret && !(ret = g2c_next_msg(file, &pos, &loc, &cgrib)))
+    {
+        if (loc.edition != 2)
+            continue;
+        msgnum++;
+        nrecs = 0;
+        if ((ret = g2c_bidx_msg_recs(cgrib, &loc, &recs, &nrecs, &nalloc)))
+            break;
+        for (r = 0; r < nrecs; r++)
+            recs[r].msgnum = msgnum;
+        if (fwrite(recs, sizeof(g2c_bidx_rec), nrecs, out) != nrecs)
+            ret = G2C_EFILE;
+        total += nrecs;
+    }
+    g2c_free(recs);
+
+    if (ret == G2C_ENOMSG)
+    {
+        ret = G2C_NO_ERROR;
+        if (fseek(out, 0, SEEK_SET))
+            ret = G2C_EFILE;
+        else
+            ret = g2c_write_bidx_header(out, file->len, total, 0);
+    }
+    g2c_close_file(file);
+    if (fclose(out) && !ret)
+        ret = G2C_EFILE;
+    if (ret)
+        remove(idxpath);
+    return ret;
+}
+
+/**
+ * Check the header of a binary index.
+ *
+ * @param hdr The header.
+ *
+ * @return 1 if it is the header of an index of this version and byte
+ * order, 0 otherwise.
+ */
+static int
+header_ok(struct bidx_header *hdr)
+{
+    return !memcmp(hdr->magic, BIDX_MAGIC, sizeof(BIDX_MAGIC)) &&
+        hdr->version == G2C_BIDX_VERSION && hdr->rec_size == sizeof(g2c_bidx_rec) &&
+        hdr->byte_order == BIDX_BYTE_ORDER;
+}
+
+/**
+ * Bring the binary index of a GRIB2 file that is still being written
+ * up to date, by adding the records of the messages written since
+ * the index was last updated. If the index does not exist, it is
+ * written, with the complete messages written so far.
+ *
+ * The scan for new messages starts at the end of the last message in
+ * the index, and stops at a message whose '7777' is not yet in the
+ * file, with g2c_scan_tail(), so a message is only indexed once it is
+ * complete. The new messages are read with pread(), so the file may
+ * be growing while it is read, as long as it is only appended to.
+ *
+ * The records are appended before the header is updated, so the index
+ * may be read with g2c_open_bidx() while it is updated.
+ *
+ * @param path Name of the GRIB2 file.
+ * @param idxpath Name of the index file.
+ * @param nnew Pointer that gets the number of records added. May be
+ * NULL.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading or writing a file.
+ * - ::G2C_EBADIDX The index is not a binary index of one file of this
+ * version and byte order.
+ * - ::G2C_EMSG Malformed message, or a Data Representation Template
+ * with more than ::G2C_BIDX_MAX_DRT values.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_update_bidx(const char *path, const char *idxpath, size_t *nnew)
+{
+    struct bidx_header hdr;
+    g2c_bidx_rec last, *recs = NULL;
+    g2c_msgloc *msgs = NULL;
+    unsigned char *cgrib;
+    g2int offset = 0, lengrib;
+    size_t nmsgs = 0, nrecs, nalloc = 0, total, m, r;
+    int32_t msgnum = 0;
+    FILE *f, *out;
+    int ret = G2C_NO_ERROR;
+
+    if (!path || !idxpath)
+        return G2C_EINVAL;
+    if (nnew)
+        *nnew = 0;
+    if (!(f = fopen(path, "rb")))
+        return G2C_EFILE;
+
+    /* Start after the last message in the index, or write a new
+     * index. */
+    if ((out = fopen(idxpath, "r+b")))
+    {
+        if (fread(&hdr, sizeof(hdr), 1, out) != 1 || !header_ok(&hdr) || hdr.nfiles)
+            ret = G2C_EBADIDX;
+        else if (hdr.nrecs)
+        {
+            if (fseek(out, sizeof(hdr) + (hdr.nrecs - 1) * sizeof(g2c_bidx_rec), SEEK_SET) ||
+                fread(&last, sizeof(last), 1, out) != 1)
+                ret = G2C_EBADIDX;
+            offset = last.msg_offset + last.msg_len;
+            msgnum = last.msgnum;
+        }
+    }
+    else if ((out = fopen(idxpath, "w+b")))
+    {
+        memset(&hdr, 0, sizeof(hdr));
+        ret = g2c_write_bidx_header(out, 0, 0, 0);
+    }
+    else
+        ret = G2C_EFILE;
+    total = ret ? 0 : hdr.nrecs;
+
+    if (!ret)
+        ret = g2c_scan_tail(f, &offset, &msgs, &nmsgs);
+    if (!ret && fseek(out, sizeof(hdr) + total * sizeof(g2c_bidx_rec), SEEK_SET))
+        ret = G2C_EFILE;
+    for (m = 0; m < nmsgs && !ret; m++)
+    {
+        if (msgs[m].edition != 2)
+            continue;
+        if ((ret = g2c_read_msg(f, msgs[m].offset, &cgrib, &lengrib)))
+            break;
+        msgnum++;
+        nrecs = 0;
+        ret = g2c_bidx_msg_recs(cgrib, &msgs[m], &recs, &nrecs, &nalloc);
+        g2c_free(cgrib);
+        if (ret)
+            break;
+        for (r = 0; r < nrecs; r++)
+            recs[r].msgnum = msgnum;
+        if (fwrite(recs, sizeof(g2c_bidx_rec), nrecs, out) != nrecs)
+            ret = G2C_EFILE;
+        total += nrecs;
+    }
+    g2c_free(recs);
+    g2c_free(msgs);
+    fclose(f);
+
+    /* The records must be in the file before the header counts them. */
+    if (!ret && (fflush(out) || fseek(out, 0, SEEK_SET)))
+        ret = G2C_EFILE;
+    if (!ret)
+        ret = g2c_write_bidx_header(out, offset, total, 0);
+    if (!ret && nnew)
+        *nnew = total - hdr.nrecs;
+    if (out && fclose(out) && !ret)
+        ret = G2C_EFILE;
+    return ret;
+}
+
+/**
+ * Find the names of the GRIB files of a catalog, which follow its
+ * records. The index of one file has nothing after its records, but
+ * records that are being appended by g2c_update_bidx().
+ *
+ * @param b The index, with its file open.
+ * @param hdr The header of the index.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EBADIDX The names are not all there.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+read_names(g2c_bidx *b, struct bidx_header *hdr)
+{
+    char *p, *end, *nul;
+    uint32_t i;
+
+    p = (char *)b->file->data + sizeof(*hdr) + hdr->nrecs * sizeof(g2c_bidx_rec);
+    end = (char *)b->file->data + b->file->len;
+    if (!hdr->nfiles)
+        return G2C_NO_ERROR;
+    if (!(b->paths = g2c_malloc(hdr->nfiles * sizeof(char *))))
+        return G2C_ENOMEM;
+    for (i = 0; i < hdr->nfiles; i++)
+    {
+        if (!(nul = memchr(p, 0, end - p)))
+            break;
+        b->paths[i] = p;
+        p = nul + 1;
+    }
+    if (i < hdr->nfiles || p != end)
+    {
+        g2c_free(b->paths);
+        b->paths = NULL;
+        return G2C_EBADIDX;
+    }
+    b->nfiles = hdr->nfiles;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Open a binary index written by g2c_write_bidx(). The index is
+ * mapped into memory, and its records are not copied.
+ *
+ * @param idxpath Name of the index file.
+ * @param bidx Pointer that gets the open index. Close it with
+ * g2c_close_bidx().
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error opening the file.
+ * - ::G2C_EBADIDX Not a binary index of this version and byte order.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_open_bidx(const char *idxpath, g2c_bidx **bidx)
+{
+    struct bidx_header hdr;
+    g2c_bidx *b;
+    int ret;
+
+    if (!idxpath || !bidx)
+        return G2C_EINVAL;
+    if (!(b = g2c_calloc(1, sizeof(g2c_bidx))))
+        return G2C_ENOMEM;
+    if ((ret = g2c_open_file(idxpath, G2C_ACCESS_RANDOM, &b->file)))
+    {
+        g2c_free(b);
+        return ret;
+    }
+
+    /* Check the header, and that the file holds all the records. */
+    ret = G2C_EBADIDX;
+    if (b->file->len >= sizeof(hdr))
+    {
+        memcpy(&hdr, b->file->data, sizeof(hdr));
+        if (header_ok(&hdr) &&
+            hdr.nrecs <= (b->file->len - sizeof(hdr)) / sizeof(g2c_bidx_rec))
+            ret = read_names(b, &hdr);
+    }
+    if (ret)
+    {
+        g2c_close_file(b->file);
+        g2c_free(b);
+        return ret;
+    }
+
+    b->nrecs = hdr.nrecs;
+    b->recs = (g2c_bidx_rec *)(b->file->data + sizeof(hdr));
+    *bidx = b;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Close a binary index opened with g2c_open_bidx(). Pointers to its
+ * records are no longer valid after this.
+ *
+ * @param bidx The open index.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error unmapping the file.
+ */
+int
+g2c_close_bidx(g2c_bidx *bidx)
+{
+    int ret;
+
+    if (!bidx)
+        return G2C_EINVAL;
+    ret = g2c_close_file(bidx->file);
+    g2c_free(bidx->paths);
+    g2c_free(bidx);
+    return ret;
+}
+
+/**
+ * Get the records of an open binary index.
+ *
+ * @param bidx The open index.
+ * @param nrecs Pointer that gets the number of records. May be NULL.
+ * @param recs Pointer that gets the array of records, which is
+ * read-only, and valid until the index is closed. May be NULL.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ */
+int
+g2c_bidx_recs(g2c_bidx *bidx, size_t *nrecs, const g2c_bidx_rec **recs)
+{
+    if (!bidx)
+        return G2C_EINVAL;
+    if (nrecs)
+        *nrecs = bidx->nrecs;
+    if (recs)
+        *recs = bidx->recs;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Get the names of the GRIB files of a catalog, written by
+ * g2c_write_catalog(). The filenum of each record is the index of its
+ * file in this array. The names are as they were given to
+ * g2c_write_catalog().
+ *
+ * @param bidx The open catalog.
+ * @param nfiles Pointer that gets the number of files, 0 if this is
+ * the index of one file. May be NULL.
+ * @param paths Pointer that gets the array of names, which is valid
+ * until the catalog is closed, or NULL if this is the index of one
+ * file. May be NULL.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ */
+int
+g2c_bidx_files(g2c_bidx *bidx, int *nfiles, const char ***paths)
+{
+    if (!bidx)
+        return G2C_EINVAL;
+    if (nfiles)
+        *nfiles = bidx->nfiles;
+    if (paths)
+        *paths = bidx->paths;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Read and decode the data of a field, using the metadata in a
+ * binary index. Only section 7 of the field is read from the GRIB
+ * file, and its section 6 if the data is to be expanded with a
+ * bitmap.
+ *
+ * The GRIB file must be the one that was indexed.
+ *
+ * @param bidx The open index.
+ * @param i Index of the record of the field.
+ * @param f The GRIB file, opened for reading in binary mode.
+ * @param expand If 1, and the field has a bitmap in the message,
+ * expand the data to the grid, with 0 at points that are bitmapped
+ * out, as g2_getfld() does.
+ * @param fld Pointer that gets the data. Free it with free().
+ * @param nfld Pointer that gets the number of values in fld: the
+ * number of grid points if the data was expanded, otherwise the
+ * number of data points.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading the GRIB file.
+ * - ::G2C_EMSG Error unpacking the data.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_bidx_getdata(g2c_bidx *bidx, size_t i, FILE *f, g2int expand, g2float **fld,
+                 g2int *nfld)
+{
+    g2c_bidx_rec *rec;
+    unsigned char *sec7 = NULL, *sec6 = NULL;
+    g2int igdtmpl[3], idrtmpl[G2C_BIDX_MAX_DRT], iofst, ibmap, k;
+    g2c_grid grid, *gridp = NULL;
+    void *bmap = NULL;
+    int ret = G2C_NO_ERROR;
+
+    if (!bidx || i >= bidx->nrecs || !f || !fld || !nfld)
+        return G2C_EINVAL;
+    rec = &bidx->recs[i];
+    *fld = NULL;
+
+    /* Read the bitmap, if the data is to be expanded with it. */
+    if (expand == 1 && rec->ibmap != 255 && rec->bmap_offset && rec->ndpts <= rec->ngrdpts)
+    {
+        if (!(sec6 = g2c_malloc(rec->bmap_len)))
+            return G2C_ENOMEM;
+        if (g2c_pread(f, rec->msg_offset + rec->bmap_offset, sec6, rec->bmap_len) !=
+            rec->bmap_len)
+            ret = G2C_EFILE;
+        else
+        {
+            iofst = 0;
+            if (g2c_unpack6(sec6, &iofst, rec->ngrdpts, &ibmap, G2C_BMAP_BITS, &bmap, NULL))
+                ret = G2C_EMSG;
+        }
+        g2c_free(sec6);
+        if (ret)
+            return ret;
+        grid.fmt = G2C_BMAP_BITS;
+        grid.bmap = bmap;
+        grid.npts = rec->ngrdpts;
+        grid.fill = 0;
+        gridp = &grid;
+    }
+
+    /* Read and unpack the data. */
+    if (!(sec7 = g2c_malloc(rec->sec_len[7])))
+        ret = G2C_ENOMEM;
+    else if (g2c_pread(f, rec->msg_offset + rec->sec_offset[7], sec7, rec->sec_len[7]) !=
+             rec->sec_len[7])
+        ret = G2C_EFILE;
+    else
+    {
+        for (k = 0; k < 3; k++)
+            igdtmpl[k] = rec->igdtmpl[k];
+        for (k = 0; k < rec->idrtlen; k++)
+            idrtmpl[k] = rec->idrtmpl[k];
+        iofst = 0;
+        if (g2c_unpack7(sec7, &iofst, rec->igdtnum, igdtmpl, rec->idrtnum, idrtmpl,
+                        rec->ndpts, gridp, fld, NULL))
+        {
+            g2c_free(*fld);
+            *fld = NULL;
+            ret = G2C_EMSG;
+        }
+        else
+            *nfld = gridp ? rec->ngrdpts : rec->ndpts;
+    }
+    g2c_free(sec7);
+    g2c_free(bmap);
+    return ret;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @brief Read the bitmap of a gribfield, in any of its formats.
+ */
+
+#include <string.h>
+#include "grib2_int.h"
+
+/**
+ * Return one point of the bitmap of a field. This works for a bitmap
+ * in any of the formats that g2c_getfld() can return.
+ *
+ * @param gfld Pointer to the gribfield.
+ * @param i Index of the grid point, starting at 0.
+ *
+ * @return 1 if there is data at the point, 0 if not. If the field
+ * has no decoded bitmap, every point has data, and 1 is returned.
+ */
+int
+g2c_bmap_get(gribfield *gfld, g2int i)
+{
+    if (gfld->cbmap)
+    {
+        if (gfld->bmap_fmt == G2C_BMAP_BITS)
+            return (gfld->cbmap[i / 8] >> (7 - i % 8)) & 1;
+        return gfld->cbmap[i] != 0;
+    }
+    if (gfld->bmap)
+        return gfld->bmap[i] != 0;
+    return 1;
+}
+
+/**
+ * Count the points of a field that have data, according to its
+ * bitmap. This works for a bitmap in any of the formats that
+ * g2c_getfld() can return.
+ *
+ * @param gfld Pointer to the gribfield.
+ *
+ * @return The number of points with data. If the field has no
+ * decoded bitmap, this is ngrdpts.
+ */
+g2int
+g2c_bmap_count(gribfield *gfld)
+{
+    g2int i, count = 0;
+
+#ifdef __GNUC__
+    if (gfld->cbmap && gfld->bmap_fmt == G2C_BMAP_BITS)
+    {
+        /* Unused bits of the last byte are always 0. */
+        for (i = 0; i < (gfld->ngrdpts + 7) / 8; i++)
+            count += __builtin_popcount(gfld->cbmap[i]);
+        return count;
+    }
+#endif
+    if (gfld->cbmap || gfld->bmap)
+    {
+        for (i = 0; i < gfld->ngrdpts; i++)
+            count += g2c_bmap_get(gfld, i);
+    }
+    else
+        count = gfld->ngrdpts;
+
+    return count;
+}
+
+/**
+ * Expand the data points of a field to its grid, using its bitmap,
+ * which may be in any of the formats that g2c_getfld() can return.
+ * Grid points that are bitmapped out get the fill value. This is
+ * useful with a field returned by g2_getfld() or g2c_getfld() with
+ * expand set to 0, when a fill value other than 0 is wanted.
+ *
+ * The expansion may be done in place, with out equal to fld, if the
+ * buffer holds ngrdpts values.
+ *
+ * @param gfld Pointer to the gribfield.
+ * @param fld The ndpts data points.
+ * @param fill Value for grid points that are bitmapped out.
+ * @param out Gets the ngrdpts grid points. If the field has no
+ * decoded bitmap, the data points are copied.
+ */
+void
+g2c_bmap_expand(gribfield *gfld, g2float *fld, g2float fill, g2float *out)
+{
+    g2int nin = gfld->ndpts < gfld->ngrdpts ? gfld->ndpts : gfld->ngrdpts;
+
+    if (gfld->cbmap)
+        g2c_expand(gfld->bmap_fmt, gfld->cbmap, gfld->ngrdpts, fld, nin, fill, out);
+    else if (gfld->bmap)
+        g2c_expand(G2C_BMAP_G2INT, gfld->bmap, gfld->ngrdpts, fld, nin, fill, out);
+    else if (out != fld)
+        memmove(out, fld, nin * sizeof(g2float));
+}
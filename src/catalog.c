@@ -0,0 +1,559 @@
+/**
+ * @file
+ * @brief Write binary indexes of many GRIB2 files, or one catalog of
+ * them, with several threads.
+ *
+ * The files are cut into chunks, which are handed out to the threads
+ * in turn. A file smaller than a chunk is one chunk, so many small
+ * files are indexed side by side, and a large file is indexed by
+ * several threads at once.
+ *
+ * A thread finds the messages that start in its chunk, and builds
+ * their records, without knowing where the last message of the chunk
+ * before it ends. So it may start in the middle of a message, and
+ * take something in the data of that message for a message. When all
+ * the chunks of a file are done, their messages are joined up,
+ * starting each chunk where the last message before it ended. A
+ * chunk that found a message running over that point was out of
+ * step, and is scanned again from there. The records are then the
+ * same as those written by g2c_write_bidx().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "grib2_int.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/** Size of the chunks that files are cut into. */
+#define CHUNK_SIZE (64 * 1024 * 1024)
+
+/**
+ * A message found in a chunk.
+ */
+struct chunk_msg
+{
+    g2c_msgloc loc; /**< Location of the message in the file. */
+    size_t rec;     /**< Index of its first record in the chunk. */
+    size_t nrecs;   /**< Number of records, 0 for GRIB1. */
+    int ret;        /**< Error building the records. */
+};
+
+/**
+ * Part of a file, indexed by one thread.
+ */
+struct chunk
+{
+    size_t filenum;         /**< Index of the file. */
+    size_t start;           /**< Offset of the start of the chunk. */
+    size_t end;             /**< Offset of the end of the chunk. */
+    struct chunk_msg *msgs; /**< Messages that start in the chunk. */
+    size_t nmsgs;           /**< Number of messages. */
+    size_t msgs_alloc;      /**< Allocated size of msgs. */
+    g2c_bidx_rec *recs;     /**< Records of the messages. */
+    size_t nrecs;           /**< Number of records. */
+    size_t recs_alloc;      /**< Allocated size of recs. */
+};
+
+/**
+ * A file being indexed.
+ */
+struct gfile
+{
+    const char *path;     /**< Name of the file. */
+    g2c_file *file;       /**< The file, open while it is indexed. */
+    struct chunk *chunks; /**< Chunks of the file. */
+    size_t nchunks;       /**< Number of chunks. */
+    size_t left;          /**< Number of chunks not yet indexed. */
+    int ret;              /**< Error opening the file. */
+    g2c_bidx_rec *recs;   /**< Records of a file in a catalog. */
+    size_t nrecs;         /**< Number of records. */
+};
+
+/**
+ * Work shared by the threads.
+ */
+struct builder
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t mutex; /**< Protects next, ret and each file. */
+#endif
+    struct gfile *files;   /**< The files. */
+    size_t nfiles;         /**< Number of files. */
+    struct chunk *chunks;  /**< The chunks of all the files, in order. */
+    size_t nchunks;        /**< Number of chunks. */
+    size_t next;           /**< Next chunk to index. */
+    const char **idxpaths; /**< Names of the index files, NULL for a catalog. */
+    int ret;               /**< First error. */
+};
+
+/**
+ * Lock the shared state of a build.
+ *
+ * @param b The build.
+ */
+static void
+lock(struct builder *b)
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&b->mutex);
+#endif
+}
+
+/**
+ * Unlock the shared state of a build.
+ *
+ * @param b The build.
+ */
+static void
+unlock(struct builder *b)
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&b->mutex);
+#endif
+}
+
+/**
+ * Find the messages that start in a chunk, and build their
+ * records. An error in a message is kept with the message, since the
+ * message may turn out not to be one.
+ *
+ * @param file The open file.
+ * @param c The chunk, which gets the messages and records.
+ * @param from Offset to start looking for messages.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+scan_chunk(g2c_file *file, struct chunk *c, size_t from)
+{
+    struct chunk_msg *m;
+    g2c_msgloc loc;
+    size_t pos = from;
+
+    c->nmsgs = c->nrecs = 0;
+    while (g2c_find_msg_before(file->data, file->len, pos, c->end, &loc))
+    {
+        if (c->nmsgs == c->msgs_alloc)
+        {
+            c->msgs_alloc = c->msgs_alloc ? 2 * c->msgs_alloc : 64;
+            if (!(m = g2c_realloc(c->msgs, c->msgs_alloc * sizeof(struct chunk_msg))))
+                return G2C_ENOMEM;
+            c->msgs = m;
+        }
+        m = &c->msgs[c->nmsgs++];
+        m->loc = loc;
+        m->rec = c->nrecs;
+        m->ret = G2C_NO_ERROR;
+        if (loc.edition == 2)
+            m->ret = g2c_bidx_msg_recs(file->data + loc.offset, &loc, &c->recs, &c->nrecs,
+                                       &c->recs_alloc);
+        if (m->ret == G2C_ENOMEM)
+            return G2C_ENOMEM;
+        m->nrecs = c->nrecs - m->rec;
+        pos = loc.offset + loc.bytes;
+    }
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Write a binary index of one file.
+ *
+ * @param idxpath Name of the index file.
+ * @param grib_size Size of the GRIB file.
+ * @param recs The records.
+ * @param nrecs Number of records.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EFILE Error writing the file.
+ */
+static int
+write_index(const char *idxpath, g2int grib_size, g2c_bidx_rec *recs, size_t nrecs)
+{
+    FILE *out;
+    int ret;
+
+    if (!(out = fopen(idxpath, "wb")))
+        return G2C_EFILE;
+    if (!(ret = g2c_write_bidx_header(out, grib_size, nrecs, 0)) &&
+        fwrite(recs, sizeof(g2c_bidx_rec), nrecs, out) != nrecs)
+        ret = G2C_EFILE;
+    if (fclose(out) && !ret)
+        ret = G2C_EFILE;
+    if (ret)
+        remove(idxpath);
+    return ret;
+}
+
+/**
+ * Join up the messages of the chunks of a file, once they are all
+ * indexed, and number them. Then write the index of the file, or keep
+ * its records for the catalog.
+ *
+ * @param b The build.
+ * @param filenum Index of the file.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EFILE Error writing the index.
+ * - ::G2C_EMSG Malformed message.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+finish_file(struct builder *b, size_t filenum)
+{
+    struct gfile *gf = &b->files[filenum];
+    struct chunk *c;
+    struct chunk_msg *m;
+    g2c_bidx_rec *recs = NULL, *r;
+    size_t pos = 0, nrecs = 0, nalloc = 0, k, i, j;
+    int32_t msgnum = 0;
+    int ret = G2C_NO_ERROR;
+
+    for (k = 0; k < gf->nchunks && !ret; k++)
+    {
+        c = &gf->chunks[k];
+        if (pos >= c->end)
+            continue;
+
+        /* The chunk is out of step if it found a message running over
+         * the end of the last real message. */
+        for (i = 0; i < c->nmsgs; i++)
+            if ((size_t)c->msgs[i].loc.offset < pos &&
+                (size_t)(c->msgs[i].loc.offset + c->msgs[i].loc.bytes) > pos)
+                break;
+        if (i < c->nmsgs && (ret = scan_chunk(gf->file, c, pos)))
+            break;
+
+        for (i = 0; i < c->nmsgs; i++)
+        {
+            m = &c->msgs[i];
+            if ((size_t)m->loc.offset < pos)
+                continue;
+            if ((ret = m->ret))
+                break;
+            pos = m->loc.offset + m->loc.bytes;
+            if (m->loc.edition != 2)
+                continue;
+            msgnum++;
+            if (nrecs + m->nrecs > nalloc)
+            {
+                nalloc = nrecs + m->nrecs > 2 * nalloc ? nrecs + m->nrecs : 2 * nalloc;
+                if (!(r = g2c_realloc(recs, nalloc * sizeof(g2c_bidx_rec))))
+                {
+                    ret = G2C_ENOMEM;
+                    break;
+                }
+                recs = r;
+            }
+            for (j = 0; j < m->nrecs; j++)
+            {
+                r = &recs[nrecs++];
+                *r = c->recs[m->rec + j];
+                r->msgnum = msgnum;
+                r->filenum = b->idxpaths ? 0 : filenum;
+            }
+        }
+    }
+
+    /* The chunks are not needed any more. */
+    for (k = 0; k < gf->nchunks; k++)
+    {
+        c = &gf->chunks[k];
+        g2c_free(c->msgs);
+        g2c_free(c->recs);
+        c->msgs = NULL;
+        c->recs = NULL;
+    }
+
+    if (!ret && b->idxpaths)
+        ret = write_index(b->idxpaths[filenum], gf->file->len, recs, nrecs);
+    if (ret || b->idxpaths)
+    {
+        g2c_free(recs);
+        return ret;
+    }
+    gf->recs = recs;
+    gf->nrecs = nrecs;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Index chunks until there are none left, or there is an error. The
+ * thread that indexes the last chunk of a file finishes the file.
+ *
+ * @param arg The build.
+ *
+ * @return NULL.
+ */
+static void *
+worker(void *arg)
+{
+    struct builder *b = arg;
+    struct chunk *c;
+    struct gfile *gf;
+    int ret, last;
+
+    for (;;)
+    {
+        lock(b);
+        if (b->ret || b->next == b->nchunks)
+        {
+            unlock(b);
+            break;
+        }
+        c = &b->chunks[b->next++];
+        gf = &b->files[c->filenum];
+        if (!gf->file && !gf->ret)
+            gf->ret = g2c_open_file(gf->path, G2C_ACCESS_SEQUENTIAL, &gf->file);
+        ret = gf->ret;
+        unlock(b);
+
+        if (!ret)
+            ret = scan_chunk(gf->file, c, c->start);
+
+        lock(b);
+        last = !--gf->left;
+        unlock(b);
+        if (last && gf->file)
+        {
+            if (!ret)
+                ret = finish_file(b, c->filenum);
+            g2c_close_file(gf->file);
+            gf->file = NULL;
+        }
+
+        if (ret)
+        {
+            lock(b);
+            if (!b->ret)
+                b->ret = ret;
+            unlock(b);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Write a catalog of the records of all the files.
+ *
+ * @param b The build, with the records of every file.
+ * @param catpath Name of the catalog file.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EFILE Error writing the file.
+ */
+static int
+write_catalog(struct builder *b, const char *catpath)
+{
+    FILE *out;
+    size_t nrecs = 0, f, len;
+    int ret;
+
+    for (f = 0; f < b->nfiles; f++)
+        nrecs += b->files[f].nrecs;
+    if (!(out = fopen(catpath, "wb")))
+        return G2C_EFILE;
+    ret = g2c_write_bidx_header(out, 0, nrecs, b->nfiles);
+    for (f = 0; f < b->nfiles && !ret; f++)
+        if (fwrite(b->files[f].recs, sizeof(g2c_bidx_rec), b->files[f].nrecs, out) !=
+            b->files[f].nrecs)
+            ret = G2C_EFILE;
+    for (f = 0; f < b->nfiles && !ret; f++)
+    {
+        len = strlen(b->files[f].path) + 1;
+        if (fwrite(b->files[f].path, 1, len, out) != len)
+            ret = G2C_EFILE;
+    }
+    if (fclose(out) && !ret)
+        ret = G2C_EFILE;
+    if (ret)
+        remove(catpath);
+    return ret;
+}
+
+/**
+ * Write binary indexes of GRIB2 files, or a catalog of them, with
+ * several threads.
+ *
+ * @param nfiles Number of GRIB2 files.
+ * @param paths Names of the GRIB2 files.
+ * @param idxpaths Names of the index files to write, one for each
+ * GRIB2 file, or NULL to write a catalog.
+ * @param catpath Name of the catalog to write, if idxpaths is NULL.
+ * @param nthreads Number of threads, or 0 for one per processor.
+ * @param chunk_size Size of the chunks that files are cut into.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading or writing a file.
+ * - ::G2C_EMSG Malformed message.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_build_bidx(int nfiles, const char **paths, const char **idxpaths, const char *catpath,
+               int nthreads, size_t chunk_size)
+{
+    struct builder b;
+    struct stat st;
+    struct chunk *c;
+    size_t f, k;
+#ifdef HAVE_PTHREAD
+    pthread_t *threads = NULL;
+    int t, nstarted = 0;
+#endif
+
+    if (nfiles < 0 || (nfiles && !paths) || (!idxpaths && !catpath) || nthreads < 0 ||
+        !chunk_size)
+        return G2C_EINVAL;
+    for (f = 0; f < (size_t)nfiles; f++)
+        if (!paths[f] || (idxpaths && !idxpaths[f]))
+            return G2C_EINVAL;
+
+    memset(&b, 0, sizeof(b));
+    b.nfiles = nfiles;
+    b.idxpaths = idxpaths;
+    if (nfiles && !(b.files = g2c_calloc(nfiles, sizeof(struct gfile))))
+        return G2C_ENOMEM;
+
+    /* Cut the files into chunks. */
+    for (f = 0; f < b.nfiles && !b.ret; f++)
+    {
+        b.files[f].path = paths[f];
+        if (stat(paths[f], &st))
+            b.ret = G2C_EFILE;
+        else
+            b.files[f].nchunks = st.st_size ? (st.st_size + chunk_size - 1) / chunk_size : 1;
+        b.files[f].left = b.files[f].nchunks;
+        b.nchunks += b.files[f].nchunks;
+    }
+    if (!b.ret && b.nchunks && !(b.chunks = g2c_calloc(b.nchunks, sizeof(struct chunk))))
+        b.ret = G2C_ENOMEM;
+    for (f = 0, c = b.chunks; f < b.nfiles && !b.ret; f++)
+    {
+        b.files[f].chunks = c;
+        for (k = 0; k < b.files[f].nchunks; k++, c++)
+        {
+            c->filenum = f;
+            c->start = k * chunk_size;
+            c->end = c->start + chunk_size;
+        }
+
+        /* The file may have grown since it was looked at. */
+        c[-1].end = (size_t)-1;
+    }
+
+    if (!b.ret)
+    {
+#ifdef HAVE_PTHREAD
+        if (!nthreads)
+            nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (nthreads < 1)
+            nthreads = 1;
+        if (nthreads > 1 && (size_t)nthreads > b.nchunks)
+            nthreads = b.nchunks;
+
+        /* This thread is one of the workers. */
+        pthread_mutex_init(&b.mutex, NULL);
+        if (nthreads > 1 && (threads = g2c_malloc((nthreads - 1) * sizeof(pthread_t))))
+            for (t = 0; t < nthreads - 1; t++, nstarted++)
+                if (pthread_create(&threads[t], NULL, worker, &b))
+                    break;
+        worker(&b);
+        for (t = 0; t < nstarted; t++)
+            pthread_join(threads[t], NULL);
+        g2c_free(threads);
+        pthread_mutex_destroy(&b.mutex);
+#else
+        worker(&b);
+#endif
+    }
+
+    if (!b.ret && !idxpaths)
+        b.ret = write_catalog(&b, catpath);
+
+    for (f = 0; f < b.nfiles; f++)
+    {
+        if (b.files[f].file)
+            g2c_close_file(b.files[f].file);
+        g2c_free(b.files[f].recs);
+    }
+    for (k = 0; b.chunks && k < b.nchunks; k++)
+    {
+        g2c_free(b.chunks[k].msgs);
+        g2c_free(b.chunks[k].recs);
+    }
+    g2c_free(b.chunks);
+    g2c_free(b.files);
+    return b.ret;
+}
+
+/**
+ * Write a binary index of each of a list of GRIB2 files, with several
+ * threads. Each index is the same as the one written by
+ * g2c_write_bidx().
+ *
+ * Files are indexed side by side, and files larger than 64 MB are
+ * cut at message boundaries and indexed by several threads at
+ * once. Where threads are not available, the files are indexed one
+ * after another.
+ *
+ * @param nfiles Number of GRIB2 files.
+ * @param paths Names of the GRIB2 files.
+ * @param idxpaths Names of the index files to write, one for each
+ * GRIB2 file.
+ * @param nthreads Number of threads, or 0 for one per processor.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading or writing a file.
+ * - ::G2C_EMSG Malformed message, or a Data Representation Template
+ * with more than ::G2C_BIDX_MAX_DRT values.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_write_bidxs(int nfiles, const char **paths, const char **idxpaths, int nthreads)
+{
+    if (!idxpaths)
+        return G2C_EINVAL;
+    return g2c_build_bidx(nfiles, paths, idxpaths, NULL, nthreads, CHUNK_SIZE);
+}
+
+/**
+ * Write a catalog of a list of GRIB2 files, with several threads. A
+ * catalog is a binary index of all the files, which is opened with
+ * g2c_open_bidx(). The filenum of each record is the index of its file
+ * in the list, and the names of the files are kept in the catalog, as
+ * given here. Get them with g2c_bidx_files().
+ *
+ * The files are indexed as by g2c_write_bidxs().
+ *
+ * @param nfiles Number of GRIB2 files.
+ * @param paths Names of the GRIB2 files.
+ * @param catpath Name of the catalog file to write.
+ * @param nthreads Number of threads, or 0 for one per processor.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading or writing a file.
+ * - ::G2C_EMSG Malformed message, or a Data Representation Template
+ * with more than ::G2C_BIDX_MAX_DRT values.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_write_catalog(int nfiles, const char **paths, const char *catpath, int nthreads)
+{
+    if (!catpath)
+        return G2C_EINVAL;
+    return g2c_build_bidx(nfiles, paths, NULL, catpath, nthreads, CHUNK_SIZE);
+}
@@ -42,7 +42,7 @@ cmplxpack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         misspack(fld, ndpts, idrsnum, idrstmpl, cpack, lcpack);
     else
     {
-        printf("cmplxpack: Don:t recognize Missing value option.");
+        g2c_log_stdout("cmplxpack: Don:t recognize Missing value option.");
         *lcpack = -1;
     }
 
@@ -43,7 +43,6 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         unsigned char *cpack, g2int *lcpack)
 {
 
-    static g2int zero = 0;
     g2int *ifld, *gref, *glen, *gwidth;
     g2int *jmin,  *jmax,  *lbit;
     g2int i, j, n, imin, imax, left;
@@ -54,9 +53,9 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
     g2int glength, grpwidth, nbitsglen = 0;
     g2int kfildo,  minpk,  inc,  maxgrps,  ibit, jbit, kbit, novref, lbitref;
     g2int missopt, miss1, miss2, ier;
+    g2c_bitwriter bw;
     g2float bscale, dscale, rmax, rmin, temp;
     static g2float alog2 = ALOG2;       /*  ln(2.0) */
-    static g2int one = 1;
 
     bscale = int_power(2.0, -idrstmpl[1]);
     dscale = int_power(10.0, idrstmpl[2]);
@@ -76,10 +75,11 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
     if (rmin != rmax)
     {
         iofst = 0;
-        ifld = calloc(ndpts, sizeof(g2int));
-        gref = calloc(ndpts, sizeof(g2int));
-        gwidth = calloc(ndpts, sizeof(g2int));
-        glen = calloc(ndpts, sizeof(g2int));
+        g2c_bw_init(&bw, cpack, 0);
+        ifld = g2c_calloc(ndpts, sizeof(g2int));
+        gref = g2c_calloc(ndpts, sizeof(g2int));
+        gwidth = g2c_calloc(ndpts, sizeof(g2int));
+        glen = g2c_calloc(ndpts, sizeof(g2int));
 
         /* Scale original data. */
         if (idrstmpl[1] == 0)
@@ -155,15 +155,15 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
                 /* pack first original value */
                 if (ival1 >= 0)
                 {
-                    sbit(cpack, &ival1, iofst, nbitsd);
+                    g2c_bw_put(&bw, ival1, nbitsd);
                     iofst = iofst+nbitsd;
                 }
                 else
                 {
-                    sbit(cpack, &one, iofst, 1);
+                    g2c_bw_put(&bw, 1, 1);
                     iofst = iofst + 1;
                     itemp = abs(ival1);
-                    sbit(cpack, &itemp, iofst, nbitsd-1);
+                    g2c_bw_put(&bw, itemp, nbitsd-1);
                     iofst = iofst + nbitsd - 1;
                 }
                 if (idrstmpl[16] == 2)
@@ -171,15 +171,15 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
                     /*  pack second original value */
                     if (ival2 >= 0)
                     {
-                        sbit(cpack, &ival2, iofst, nbitsd);
+                        g2c_bw_put(&bw, ival2, nbitsd);
                         iofst = iofst + nbitsd;
                     }
                     else
                     {
-                        sbit(cpack, &one, iofst, 1);
+                        g2c_bw_put(&bw, 1, 1);
                         iofst = iofst + 1;
                         itemp = abs(ival2);
-                        sbit(cpack, &itemp, iofst, nbitsd - 1);
+                        g2c_bw_put(&bw, itemp, nbitsd - 1);
                         iofst = iofst + nbitsd - 1;
                     }
                 }
@@ -187,15 +187,15 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
                 /*  pack overall min of spatial differences */
                 if (minsd >= 0)
                 {
-                    sbit(cpack, &minsd, iofst, nbitsd);
+                    g2c_bw_put(&bw, minsd, nbitsd);
                     iofst = iofst + nbitsd;
                 }
                 else
                 {
-                    sbit(cpack, &one, iofst, 1);
+                    g2c_bw_put(&bw, 1, 1);
                     iofst = iofst + 1;
                     itemp = abs(minsd);
-                    sbit(cpack, &itemp, iofst, nbitsd - 1);
+                    g2c_bw_put(&bw, itemp, nbitsd - 1);
                     iofst = iofst + nbitsd - 1;
                 }
             }
@@ -206,18 +206,18 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         minpk = 10;
         inc = 1;
         maxgrps = (ndpts / minpk) + 1;
-        jmin = calloc(maxgrps, sizeof(g2int));
-        jmax = calloc(maxgrps, sizeof(g2int));
-        lbit = calloc(maxgrps, sizeof(g2int));
+        jmin = g2c_calloc(maxgrps, sizeof(g2int));
+        jmax = g2c_calloc(maxgrps, sizeof(g2int));
+        lbit = g2c_calloc(maxgrps, sizeof(g2int));
         missopt = 0;
         pack_gp(&kfildo, ifld, &ndpts, &missopt, &minpk, &inc, &miss1, &miss2, 
                 jmin, jmax, lbit, glen, &maxgrps, &ngroups, &ibit, &jbit, 
                 &kbit, &novref, &lbitref, &ier);
         for (ng = 0; ng<ngroups; ng++)
             glen[ng] = glen[ng] + novref;
-        free(jmin);
-        free(jmax);
-        free(lbit);
+        g2c_free(jmin);
+        g2c_free(jmax);
+        g2c_free(lbit);
 
         /* For each group, find the group's reference value and the
          * number of bits needed to hold the remaining values. */
@@ -267,14 +267,14 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         {
             temp = log((double)(igmax + 1)) / alog2;
             nbitsgref = (g2int)ceil(temp);
-            sbits(cpack, gref, iofst, nbitsgref, 0, ngroups);
+            g2c_bw_put_n(&bw, gref, nbitsgref, ngroups);
             itemp = nbitsgref * ngroups;
             iofst = iofst + itemp;
             /* Pad last octet with Zeros, if necessary. */
             if ((itemp % 8) != 0)
             {
                 left = 8 - (itemp % 8);
-                sbit(cpack, &zero, iofst, left);
+                g2c_bw_put(&bw, 0, left);
                 iofst = iofst + left;
             }
         }
@@ -299,14 +299,14 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
             nbitsgwidth = (g2int)ceil(temp);
             for (i = 0; i < ngroups; i++)
                 gwidth[i] = gwidth[i] - ngwidthref;
-            sbits(cpack, gwidth, iofst, nbitsgwidth, 0, ngroups);
+            g2c_bw_put_n(&bw, gwidth, nbitsgwidth, ngroups);
             itemp = nbitsgwidth * ngroups;
             iofst = iofst + itemp;
             /* Pad last octet with Zeros, if necessary. */
             if ((itemp % 8) != 0)
             {
                 left = 8 - (itemp % 8);
-                sbit(cpack, &zero, iofst, left);
+                g2c_bw_put(&bw, 0, left);
                 iofst = iofst + left;
             }
         }
@@ -336,14 +336,14 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
             nbitsglen = (g2int)ceil(temp);
             for (i = 0; i < ngroups - 1; i++)
                 glen[i] = glen[i] - nglenref;
-            sbits(cpack, glen, iofst, nbitsglen, 0, ngroups);
+            g2c_bw_put_n(&bw, glen, nbitsglen, ngroups);
             itemp = nbitsglen * ngroups;
             iofst = iofst + itemp;
             /*         Pad last octet with Zeros, if necessary, */
             if ((itemp % 8) != 0)
             {
                 left = 8 - (itemp % 8);
-                sbit(cpack, &zero, iofst, left);
+                g2c_bw_put(&bw, 0, left);
                 iofst = iofst + left;
             }
         }
@@ -364,7 +364,7 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
             grpwidth = gwidth[ng] + ngwidthref;
             if (grpwidth != 0)
             {
-                sbits(cpack, ifld + n, iofst, grpwidth, 0, glength);
+                g2c_bw_put_n(&bw, ifld + n, grpwidth, glength);
                 iofst = iofst + (grpwidth * glength);
             }
             n = n + glength;
@@ -373,19 +373,20 @@ compack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         if ((iofst % 8) != 0)
         {
             left = 8 - (iofst % 8);
-            sbit(cpack, &zero, iofst, left);
+            g2c_bw_put(&bw, 0, left);
             iofst = iofst + left;
         }
+        g2c_bw_flush(&bw);
         *lcpack = iofst / 8;
 
         if (ifld)
-            free(ifld);
+            g2c_free(ifld);
         if (gref)
-            free(gref);
+            g2c_free(gref);
         if (gwidth)
-            free(gwidth);
+            g2c_free(gwidth);
         if (glen)
-            free(glen);
+            g2c_free(glen);
     }
     else
     { /*   Constant field (max = min) */
@@ -41,15 +41,51 @@
 int
 comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
           g2int *idrstmpl, g2int ndpts, g2float *fld)
+{
+    return g2c_comunpack(cpack, lensec, idrsnum, idrstmpl, ndpts, NULL, fld, NULL);
+}
+
+/**
+ * Unpack a data field that was packed using complex packing, like
+ * comunpack(), optionally placing each value on its grid point. Data
+ * without missing value management are scaled straight to their grid
+ * points. Otherwise the data values are unpacked into the end of the
+ * grid array, and expanded from there in the same array.
+ *
+ * @param cpack pointer to the packed data field.
+ * @param lensec length of section 7 (used for error checking).
+ * @param idrsnum Data Representation Template number. Must equal 2
+ * or 3.
+ * @param idrstmpl pointer to the array of values for Data
+ * Representation Template 5.2 or 5.3
+ * @param ndpts The number of data values to unpack
+ * @param grid NULL to unpack ndpts values to fld, or pointer to the
+ * grid and bitmap to unpack to. ndpts must not be more than
+ * grid->npts.
+ * @param fld Contains the unpacked data values, or the grid points
+ * if grid is not NULL.
+ * @param dec Decoder whose scratch arrays are used, or NULL to
+ * allocate them for this call.
+ *
+ * @return 0 for success, error code otherwise.
+ */
+int
+g2c_comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
+              g2int *idrstmpl, g2int ndpts, g2c_grid *grid, g2float *fld,
+              g2c_decoder *dec)
 {
     g2int nbitsd=0, isign;
     g2int j, iofst, ival1, ival2, minsd, itemp, l, k, n, non=0;
-    g2int *ifld, *ifldmiss=0;
-    g2int *gref, *gwidth, *glen;
+    g2int *ifld = NULL, *ifldmiss = NULL;
+    g2int *gref = NULL, *gwidth = NULL, *glen = NULL;
+    uint32_t *gval = NULL;
+    g2int maxglen;
     g2int itype, ngroups, nbitsgref, nbitsgwidth, nbitsglen;
     g2int msng1, msng2;
     g2float ref, bscale, dscale, rmiss1, rmiss2;
+    g2float *dfld;
     g2int totBit,  totLen;
+    int ret = 1;
 
     rdieee(idrstmpl, &ref, 1);
     bscale = (g2float)int_power(2.0, idrstmpl[1]);
@@ -65,15 +101,22 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
     /*   Constant field */
     if (ngroups == 0)
     {
-        for (j = 0; j < ndpts; j++)
-            fld[j] = ref;
+        if (grid)
+            g2c_unpack_scale_grid(NULL, 0, 0, ndpts, ref, bscale, dscale, grid, fld);
+        else
+            for (j = 0; j < ndpts; j++)
+                fld[j] = ref;
         return(0);
     }
 
     iofst = 0;
-    ifld = (g2int *)calloc(ndpts, sizeof(g2int));
-    gref = (g2int *)calloc(ngroups, sizeof(g2int));
-    gwidth = (g2int *)calloc(ngroups, sizeof(g2int));
+    /* Every value of these arrays is set before it is used. */
+    ifld = g2c_scratch_alloc(dec, G2C_SCRATCH_IFLD, ndpts * sizeof(g2int));
+    gref = g2c_scratch_alloc(dec, G2C_SCRATCH_GREF, ngroups * sizeof(g2int));
+    gwidth = g2c_scratch_alloc(dec, G2C_SCRATCH_GWIDTH, ngroups * sizeof(g2int));
+    glen = g2c_scratch_alloc(dec, G2C_SCRATCH_GLEN, ngroups * sizeof(g2int));
+    if (!ifld || !gref || !gwidth || !glen)
+        goto done;
 
     /*  Get missing values, if supplied */
     if (idrstmpl[6] == 1)
@@ -156,7 +199,6 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
         gwidth[j] = gwidth[j] + idrstmpl[10];
 
     /*  Extract Each Group's length (number of values in each group) */
-    glen = calloc(ngroups, sizeof(g2int));
     if (nbitsglen != 0)
     {
         gbits(cpack, glen, iofst, nbitsglen, 0, ngroups);
@@ -178,15 +220,24 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
      *  with number of values, and length of section 7. */
     totBit = 0;
     totLen = 0;
+    maxglen = 0;
     for (j = 0; j < ngroups; j++)
     {
         totBit += (gwidth[j] * glen[j]);
         totLen += glen[j];
+        if (glen[j] > maxglen)
+            maxglen = glen[j];
     }
     if (totLen != ndpts)
-        return 1;
+        goto done;
     if (totBit / 8. > lensec)
-        return 1;
+        goto done;
+
+    /* Groups of values up to 32 bits wide are unpacked by the SIMD
+     * kernels into this buffer, then widened as the group reference
+     * is added. */
+    if (!(gval = g2c_scratch_alloc(dec, G2C_SCRATCH_GVAL, maxglen * sizeof(uint32_t))))
+        goto done;
 
     /*  For each group, unpack data values */
     if (idrstmpl[6] == 0)
@@ -194,7 +245,16 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
         n = 0;
         for (j = 0; j < ngroups; j++)
         {
-            if (gwidth[j] != 0)
+            if (gwidth[j] != 0 && gwidth[j] <= 32)
+            {
+                g2c_unpack32(cpack, gval, iofst, gwidth[j], glen[j]);
+                for (k = 0; k < glen[j]; k++)
+                {
+                    ifld[n] = gval[k] + gref[j];
+                    n = n + 1;
+                }
+            }
+            else if (gwidth[j] != 0)
             {
                 gbits(cpack, ifld + n, iofst, gwidth[j], 0, glen[j]);
                 for (k = 0; k < glen[j]; k++)
@@ -215,7 +275,9 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
     else if (idrstmpl[6] == 1 || idrstmpl[6] == 2)
     {
         /* missing values included */
-        ifldmiss = malloc(ndpts * sizeof(g2int));
+        if (!(ifldmiss = g2c_scratch_alloc(dec, G2C_SCRATCH_IFLDMISS,
+                                           ndpts * sizeof(g2int))))
+            goto done;
         for (j = 0; j < ndpts; j++)
             ifldmiss[j] = 0;
         n = 0;
@@ -226,7 +288,14 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
             {
                 msng1 = (g2int)int_power(2.0, gwidth[j]) - 1;
                 msng2 = msng1 - 1;
-                gbits(cpack, ifld + n, iofst, gwidth[j], 0, glen[j]);
+                if (gwidth[j] <= 32)
+                {
+                    g2c_unpack32(cpack, gval, iofst, gwidth[j], glen[j]);
+                    for (k = 0; k < glen[j]; k++)
+                        ifld[n + k] = gval[k];
+                }
+                else
+                    gbits(cpack, ifld + n, iofst, gwidth[j], 0, glen[j]);
                 iofst = iofst + (gwidth[j] * glen[j]);
                 for (k = 0; k < glen[j]; k++)
                 {
@@ -268,13 +337,6 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
         }
     }
 
-    if (gref)
-        free(gref);
-    if (gwidth)
-        free(gwidth);
-    if (glen)
-        free(glen);
-
     /*  If using spatial differences, add overall min value, and sum up recursively */
     if (idrsnum == 3)
     {         /* spatial differencing */
@@ -310,32 +372,43 @@ comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
     /*  Scale data back to original form */
     if (idrstmpl[6] == 0)
     {        /* no missing values */
-        for (n = 0; n <ndpts; n++)
-        {
-            fld[n] = (((g2float)ifld[n] * bscale) + ref) * dscale;
-        }
+        if (grid)
+            g2c_scale_grid(ifld, ndpts, ref, bscale, dscale, grid, fld);
+        else
+            for (n = 0; n <ndpts; n++)
+            {
+                fld[n] = (((g2float)ifld[n] * bscale) + ref) * dscale;
+            }
     }
     else if (idrstmpl[6] == 1 || idrstmpl[6] == 2)
     {
-        /* missing values included */
+        /* missing values included, unpacked to the end of the grid
+         * array, if there is one */
+        dfld = grid ? fld + grid->npts - ndpts : fld;
         non = 0;
         for (n = 0; n < ndpts; n++)
         {
             if (ifldmiss[n] == 0)
             {
-                fld[n] = (((g2float)ifld[non++] * bscale) + ref) * dscale;
+                dfld[n] = (((g2float)ifld[non++] * bscale) + ref) * dscale;
             }
             else if (ifldmiss[n] == 1)
-                fld[n] = rmiss1;
+                dfld[n] = rmiss1;
             else if (ifldmiss[n] == 2)
-                fld[n] = rmiss2;
+                dfld[n] = rmiss2;
         }
-        if (ifldmiss)
-            free(ifldmiss);
+        if (grid)
+            g2c_expand_tail(grid, ndpts, fld);
     }
+    ret = 0;
 
-    if (ifld)
-        free(ifld);
+done:
+    g2c_scratch_free(dec, gref);
+    g2c_scratch_free(dec, gwidth);
+    g2c_scratch_free(dec, glen);
+    g2c_scratch_free(dec, gval);
+    g2c_scratch_free(dec, ifldmiss);
+    g2c_scratch_free(dec, ifld);
 
-    return 0;
+    return ret;
 }
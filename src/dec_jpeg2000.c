@@ -10,15 +10,18 @@
 #include "jasper/jasper.h"
 
 /**
- * This Function decodes a JPEG2000 code stream specified in the
- * JPEG2000 Part-1 standard (i.e., ISO/IEC 15444-1) using JasPer
- * Software written by the University of British Columbia and Image
- * Power Inc, and others. JasPer is available at
- * http://www.ece.uvic.ca/~mdadams/jasper/.
+ * Decode a JPEG2000 code stream with JasPer, and copy the grayscale
+ * image values either to an integer array, or scaled straight to a
+ * floating point array.
  *
  * @param injpc Input JPEG2000 code stream.
  * @param bufsize Length (in bytes) of the input JPEG2000 code stream.
- * @param outfld Output matrix of grayscale image values.
+ * @param outfld If not NULL, gets the grayscale image values.
+ * @param ndpts Number of values in fld.
+ * @param ref Reference value.
+ * @param bscale Binary scale factor.
+ * @param dscale Decimal scale factor.
+ * @param fld If outfld is NULL, gets the scaled image values.
  *
  * @return
  * - 0 Successful decode
@@ -28,8 +31,9 @@
  *
  * @author Stephen Gilbert @date 2002-12-02
  */
-int
-dec_jpeg2000(char *injpc, g2int bufsize, g2int *outfld)
+static int
+dec_jpeg2000_core(char *injpc, g2int bufsize, g2int *outfld, g2int ndpts,
+                  g2float ref, g2float bscale, g2float dscale, g2float *fld)
 {
     g2int i, j, k;
     jas_image_t *image = NULL;
@@ -45,7 +49,7 @@ dec_jpeg2000(char *injpc, g2int bufsize, g2int *outfld)
     /* Decode JPEG200 codestream into jas_image_t structure. */
     if (!(image = jpc_decode(jpcstream, opts)))
     {
-        printf(" jpc_decode return\n");
+        g2c_log_stdout(" jpc_decode return\n");
         return -3;
     }
 
@@ -76,7 +80,7 @@ dec_jpeg2000(char *injpc, g2int bufsize, g2int *outfld)
     /* Expecting jpeg2000 image to be grayscale only. No color components. */
     if (image->numcmpts_ != 1)
     {
-        printf("dec_jpeg2000: Found color image.  Grayscale expected.\n");
+        g2c_log_stdout("dec_jpeg2000: Found color image.  Grayscale expected.\n");
         return -5;
     }
 
@@ -86,11 +90,23 @@ dec_jpeg2000(char *injpc, g2int bufsize, g2int *outfld)
     jas_image_readcmpt(image, 0, 0, 0, jas_image_width(image),
                        jas_image_height(image), data);
 
-    /* Copy data matrix to output integer array. */
+    /* Copy data matrix to output integer array, or scale it straight
+     * into the output field. */
     k = 0;
-    for (i = 0; i < pcmpt->height_; i++)
-        for (j = 0; j < pcmpt->width_; j++)
-            outfld[k++] = data->rows_[i][j];
+    if (outfld)
+    {
+        for (i = 0; i < pcmpt->height_; i++)
+            for (j = 0; j < pcmpt->width_; j++)
+                outfld[k++] = data->rows_[i][j];
+    }
+    else
+    {
+        for (i = 0; i < pcmpt->height_ && k < ndpts; i++)
+            for (j = 0; j < pcmpt->width_ && k < ndpts; j++)
+                fld[k++] = (((g2float)data->rows_[i][j] * bscale) + ref) * dscale;
+        for (; k < ndpts; k++)
+            fld[k] = ref * dscale;
+    }
 
     /* Clean up JasPer work structures. */
     jas_matrix_destroy(data);
@@ -99,3 +115,54 @@ dec_jpeg2000(char *injpc, g2int bufsize, g2int *outfld)
 
     return 0;
 }
+/**
+ * This Function decodes a JPEG2000 code stream specified in the
+ * JPEG2000 Part-1 standard (i.e., ISO/IEC 15444-1) using JasPer
+ * Software written by the University of British Columbia and Image
+ * Power Inc, and others. JasPer is available at
+ * http://www.ece.uvic.ca/~mdadams/jasper/.
+ *
+ * @param injpc Input JPEG2000 code stream.
+ * @param bufsize Length (in bytes) of the input JPEG2000 code stream.
+ * @param outfld Output matrix of grayscale image values.
+ *
+ * @return
+ * - 0 Successful decode
+ * - -3 Error decode jpeg2000 code stream.
+ * - -5 decoded image had multiple color components. Only grayscale is
+ *     expected.
+ *
+ * @author Stephen Gilbert @date 2002-12-02
+ */
+int
+dec_jpeg2000(char *injpc, g2int bufsize, g2int *outfld)
+{
+    return dec_jpeg2000_core(injpc, bufsize, outfld, 0, 0, 0, 0, NULL);
+}
+
+/**
+ * Decode a JPEG2000 code stream, scaling the grayscale image values
+ * straight into the output field as ((value * bscale) + ref) *
+ * dscale, without an intermediate integer array.
+ *
+ * @param injpc Input JPEG2000 code stream.
+ * @param bufsize Length (in bytes) of the input JPEG2000 code stream.
+ * @param ndpts Number of values in fld. Points beyond the end of the
+ * image get the scaled reference value.
+ * @param ref Reference value.
+ * @param bscale Binary scale factor, 2^E.
+ * @param dscale Decimal scale factor, 10^-D.
+ * @param fld Gets the ndpts scaled values.
+ *
+ * @return
+ * - 0 Successful decode
+ * - -3 Error decode jpeg2000 code stream.
+ * - -5 decoded image had multiple color components. Only grayscale is
+ *     expected.
+ */
+int
+dec_jpeg2000_scale(char *injpc, g2int bufsize, g2int ndpts, g2float ref,
+                   g2float bscale, g2float dscale, g2float *fld)
+{
+    return dec_jpeg2000_core(injpc, bufsize, NULL, ndpts, ref, bscale, dscale, fld);
+}
@@ -45,6 +45,34 @@ user_read_data(png_structp png_ptr, png_bytep data, png_uint_32 length)
     mem->stream_len += length;
 }
 
+/**
+ * Allocate memory for libpng, with g2c_malloc().
+ *
+ * @param png_ptr Pointer to PNG.
+ * @param size Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL.
+ */
+static png_voidp
+png_malloc_cb(png_structp png_ptr, png_alloc_size_t size)
+{
+    (void)png_ptr;
+    return g2c_malloc(size);
+}
+
+/**
+ * Free memory for libpng, with g2c_free().
+ *
+ * @param png_ptr Pointer to PNG.
+ * @param ptr The memory.
+ */
+static void
+png_free_cb(png_structp png_ptr, png_voidp ptr)
+{
+    (void)png_ptr;
+    g2c_free(ptr);
+}
+
 /**
  * Decode PNG.
  *
@@ -74,8 +102,9 @@ dec_png(unsigned char *pngbuf, g2int *width, g2int *height,
         return -3;
 
     /* Create and initialize png_structs. */
-    if (!(png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL,
-                                           NULL, NULL)))
+    if (!(png_ptr = png_create_read_struct_2(PNG_LIBPNG_VER_STRING, (png_voidp)NULL,
+                                             NULL, NULL, NULL, png_malloc_cb,
+                                             png_free_cb)))
         return -1;
 
     if (!(info_ptr = png_create_info_struct(png_ptr)))
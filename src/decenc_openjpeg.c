@@ -37,7 +37,7 @@
 static void openjpeg_warning(const char *msg, void *client_data)
 {
     (void)client_data;
-    fprintf(stderr,"openjpeg: %s",msg);
+    g2c_log("openjpeg: %s",msg);
 }
 
 /**
@@ -51,7 +51,7 @@ static void openjpeg_warning(const char *msg, void *client_data)
 static void openjpeg_error(const char *msg, void *client_data)
 {
     (void)client_data;
-    fprintf(stderr,"openjpeg: %s",msg);
+    g2c_log("openjpeg: %s",msg);
 }
 
 /**
@@ -229,27 +229,27 @@ static opj_stream_t* opj_stream_create_default_memory_stream(opj_memory_stream*
 }
 
 /**
- * This Function decodes a JPEG2000 code stream specified in the
- * JPEG2000 Part-1 standard (i.e., ISO/IEC 15444-1) using OpenJPEG.
- *
- * PROGRAM HISTORY LOG:
- * - 2002-12-02  Gilbert
- * - 2016-06-08  Jovic
+ * Decode a JPEG2000 code stream with OpenJPEG, and copy the grayscale
+ * image values either to an integer array, or scaled straight to a
+ * floating point array.
  *
  * @param injpc Input JPEG2000 code stream.
  * @param bufsize Length (in bytes) of the input JPEG2000 code stream.
- * @param outfld Output matrix of grayscale image values.
+ * @param outfld If not NULL, gets the grayscale image values.
+ * @param ndpts Number of values in fld.
+ * @param ref Reference value.
+ * @param bscale Binary scale factor.
+ * @param dscale Decimal scale factor.
+ * @param fld If outfld is NULL, gets the scaled image values.
  *
  * @return
  * - 0 Successful decode
  * - -3 Error decode jpeg2000 code stream.
- * - -5 decoded image had multiple color components. Only grayscale is expected.
- *
- * @note Requires OpenJPEG Version 2.
  *
  * @author Stephen Gilbert, Jovic
  */
-int dec_jpeg2000(char *injpc,g2int bufsize,g2int *outfld)
+static int dec_jpeg2000_core(char *injpc, g2int bufsize, g2int *outfld, g2int ndpts,
+                             g2float ref, g2float bscale, g2float dscale, g2float *fld)
 {
     int iret = 0;
     OPJ_INT32 mask;
@@ -281,17 +281,17 @@ int dec_jpeg2000(char *injpc,g2int bufsize,g2int *outfld)
 
     /* setup the decoder decoding parameters using user parameters */
     if (!opj_setup_decoder(codec, &parameters)) {
-        fprintf(stderr,"openjpeg: failed to setup decoder");
+        g2c_log("openjpeg: failed to setup decoder");
         iret = -3;
         goto cleanup;
     }
     if  (!opj_read_header(stream, codec, &image)) {
-        fprintf(stderr,"openjpeg: failed to read the header");
+        g2c_log("openjpeg: failed to read the header");
         iret = -3;
         goto cleanup;
     }
     if (!opj_decode(codec, stream, image)) {
-        fprintf(stderr,"openjpeg: failed to decode");
+        g2c_log("openjpeg: failed to decode");
         iret = -3;
         goto cleanup;
     }
@@ -306,11 +306,26 @@ int dec_jpeg2000(char *injpc,g2int bufsize,g2int *outfld)
 
     mask = (1 << image->comps[0].prec) - 1;
 
-    for(unsigned int i = 0; i < image->comps[0].w * image->comps[0].h ; i++)
-        outfld[i] = (g2int) (image->comps[0].data[i] & mask);
+    if (outfld)
+    {
+        for(unsigned int i = 0; i < image->comps[0].w * image->comps[0].h ; i++)
+            outfld[i] = (g2int) (image->comps[0].data[i] & mask);
+    }
+    else
+    {
+        g2int npix = (g2int)image->comps[0].w * image->comps[0].h;
+        g2int i;
+
+        if (npix > ndpts)
+            npix = ndpts;
+        for (i = 0; i < npix; i++)
+            fld[i] = (((g2float)(image->comps[0].data[i] & mask) * bscale) + ref) * dscale;
+        for (; i < ndpts; i++)
+            fld[i] = ref * dscale;
+    }
 
     if (!opj_end_decompress(codec, stream)) {
-        fprintf(stderr,"openjpeg: failed in opj_end_decompress");
+        g2c_log("openjpeg: failed in opj_end_decompress");
         iret = -3;
     }
 
@@ -323,6 +338,56 @@ cleanup:
     return iret;
 }
 
+/**
+ * This Function decodes a JPEG2000 code stream specified in the
+ * JPEG2000 Part-1 standard (i.e., ISO/IEC 15444-1) using OpenJPEG.
+ *
+ * PROGRAM HISTORY LOG:
+ * - 2002-12-02  Gilbert
+ * - 2016-06-08  Jovic
+ *
+ * @param injpc Input JPEG2000 code stream.
+ * @param bufsize Length (in bytes) of the input JPEG2000 code stream.
+ * @param outfld Output matrix of grayscale image values.
+ *
+ * @return
+ * - 0 Successful decode
+ * - -3 Error decode jpeg2000 code stream.
+ * - -5 decoded image had multiple color components. Only grayscale is expected.
+ *
+ * @note Requires OpenJPEG Version 2.
+ *
+ * @author Stephen Gilbert, Jovic
+ */
+int dec_jpeg2000(char *injpc,g2int bufsize,g2int *outfld)
+{
+    return dec_jpeg2000_core(injpc, bufsize, outfld, 0, 0, 0, 0, NULL);
+}
+
+/**
+ * Decode a JPEG2000 code stream, scaling the grayscale image values
+ * straight into the output field as ((value * bscale) + ref) *
+ * dscale, without an intermediate integer array.
+ *
+ * @param injpc Input JPEG2000 code stream.
+ * @param bufsize Length (in bytes) of the input JPEG2000 code stream.
+ * @param ndpts Number of values in fld. Points beyond the end of the
+ * image get the scaled reference value.
+ * @param ref Reference value.
+ * @param bscale Binary scale factor, 2^E.
+ * @param dscale Decimal scale factor, 10^-D.
+ * @param fld Gets the ndpts scaled values.
+ *
+ * @return
+ * - 0 Successful decode
+ * - -3 Error decode jpeg2000 code stream.
+ */
+int dec_jpeg2000_scale(char *injpc, g2int bufsize, g2int ndpts, g2float ref,
+                       g2float bscale, g2float dscale, g2float *fld)
+{
+    return dec_jpeg2000_core(injpc, bufsize, NULL, ndpts, ref, bscale, dscale, fld);
+}
+
 /**
  * This Function encodes a grayscale image into a JPEG2000 code stream
  * specified in the JPEG2000 Part-1 standard (i.e., ISO/IEC 15444-1)
@@ -427,7 +492,7 @@ int enc_jpeg2000(unsigned char *cin, g2int width, g2int height, g2int nbits,
     /* setup the encoder parameters using the current image and user parameters */
     if (!opj_setup_encoder(codec, &parameters, image))
     {
-        fprintf(stderr,"openjpeg: failed to setup encoder");
+        g2c_log("openjpeg: failed to setup encoder");
         iret = -3;
         goto cleanup;
     }
@@ -440,14 +505,14 @@ int enc_jpeg2000(unsigned char *cin, g2int width, g2int height, g2int nbits,
     stream = opj_stream_create_default_memory_stream(&mstream, OPJ_STREAM_WRITE);
     if (!stream)
     {
-        fprintf(stderr,"openjpeg: failed create default memory stream");
+        g2c_log("openjpeg: failed create default memory stream");
         iret = -3;
         goto cleanup;
     }
 
     if (!opj_start_compress(codec, image, stream))
     {
-        fprintf(stderr,"openjpeg: failed to setup encoder");
+        g2c_log("openjpeg: failed to setup encoder");
         iret = -3;
         goto cleanup;
     }
@@ -455,14 +520,14 @@ int enc_jpeg2000(unsigned char *cin, g2int width, g2int height, g2int nbits,
     /* encode image */
     if (!opj_encode(codec, stream))
     {
-        fprintf(stderr,"openjpeg: opj_encode failed");
+        g2c_log("openjpeg: opj_encode failed");
         iret = -3;
         goto cleanup;
     }
 
     if (!opj_end_compress(codec, stream))
     {
-        fprintf(stderr,"openjpeg: opj_end_compress failed");
+        g2c_log("openjpeg: opj_end_compress failed");
         iret = -3;
         goto cleanup;
     }
@@ -0,0 +1,162 @@
+/**
+ * @file
+ * @brief A decoder, which keeps its section table and the scratch
+ * arrays of the unpackers from one field to the next.
+ *
+ * The unpackers take their scratch arrays from a decoder, growing
+ * them as needed, so after the first few fields decoding one needs no
+ * allocation for them. Functions that take a decoder allocate from
+ * the heap when it is NULL, so the same code serves both.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/**
+ * Get a scratch array from a decoder, or from the heap.
+ *
+ * The contents of the array are not kept or cleared. An array from a
+ * decoder is only valid until the slot is used again.
+ *
+ * @param dec The decoder, or NULL to use g2c_malloc().
+ * @param slot Which array, one of the G2C_SCRATCH_ values.
+ * @param size Number of bytes needed.
+ *
+ * @return Pointer to the array, or NULL if it can't be allocated.
+ */
+void *
+g2c_scratch_alloc(g2c_decoder *dec, int slot, size_t size)
+{
+    size_t newsize;
+    void *p;
+
+    if (!size)
+        size = 1;
+    if (!dec)
+        return g2c_malloc(size);
+    if (size > dec->size[slot])
+    {
+        /* The old contents are not needed, so don't copy them. */
+        newsize = size > 2 * dec->size[slot] ? size : 2 * dec->size[slot];
+        if (!(p = g2c_malloc(newsize)))
+            return NULL;
+        g2c_free(dec->buf[slot]);
+        dec->buf[slot] = p;
+        dec->size[slot] = newsize;
+    }
+    return dec->buf[slot];
+}
+
+/**
+ * Give back a scratch array from g2c_scratch_alloc(). Arrays from a
+ * decoder are kept for the next field.
+ *
+ * @param dec The decoder, or NULL if the array came from the heap.
+ * @param p The array.
+ */
+void
+g2c_scratch_free(g2c_decoder *dec, void *p)
+{
+    if (!dec)
+        g2c_free(p);
+}
+
+/**
+ * Open a decoder. Use it with g2c_decoder_getfld() to decode fields
+ * without allocating the scratch arrays of the unpackers for each
+ * one. The arrays grow to fit the largest field decoded, and are
+ * freed by g2c_close_decoder().
+ *
+ * A decoder must only be used by one thread at a time. Use one
+ * decoder for each thread.
+ *
+ * @param dec Pointer that gets the decoder.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL dec is NULL.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_open_decoder(g2c_decoder **dec)
+{
+    if (!dec)
+        return G2C_EINVAL;
+    if (!(*dec = g2c_calloc(1, sizeof(g2c_decoder))))
+        return G2C_ENOMEM;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Close a decoder, freeing its arrays.
+ *
+ * @param dec The decoder.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL dec is NULL.
+ */
+int
+g2c_close_decoder(g2c_decoder *dec)
+{
+    int i;
+
+    if (!dec)
+        return G2C_EINVAL;
+    for (i = 0; i < G2C_SCRATCH_NUM; i++)
+        g2c_free(dec->buf[i]);
+    g2c_free(dec->msg.fld);
+    g2c_free(dec);
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Decode a field of a message, like g2c_getfld(), using the section
+ * table and scratch arrays of a decoder, which are kept for the next
+ * call.
+ *
+ * If fld is NULL, the data is returned in gfld->fld, as from
+ * g2c_getfld(). Otherwise it is written to fld, as by
+ * g2c_getfld_into(), and gfld->fld is NULL. With fld, and
+ * ::G2C_GFLD_ARENA in flags, decoding a field allocates one block
+ * for the gribfield, and nothing else once the decoder has seen a
+ * field as large.
+ *
+ * @param dec The decoder.
+ * @param cgrib Character pointer to the GRIB2 message.
+ * @param ifldnum Specifies which field in the GRIB2 message to
+ * return. The first field is number 1, Fortran style.
+ * @param unpack Boolean value indicating whether to unpack
+ * bitmap/data field. Must be set if fld is not NULL.
+ * @param expand Boolean value indicating whether the data points
+ * should be expanded to the correspond grid, if a bit-map is present.
+ * @param flags 0, or ::G2C_BMAP_UINT8 or ::G2C_BMAP_BITS to choose
+ * the bitmap format, and ::G2C_GFLD_ARENA to put the gribfield and its
+ * arrays in one block.
+ * @param fld NULL, or an array that gets the data. Use
+ * g2c_getfld_size() to find how long it must be.
+ * @param fldlen Number of values fld has room for.
+ * @param gfld pointer to structure gribfield containing the decoded
+ * field. Free it with g2_free().
+ *
+ * @return As for g2_getfld(), and
+ * - ::G2C_ESIZE fld is too short.
+ */
+g2int
+g2c_decoder_getfld(g2c_decoder *dec, unsigned char *cgrib, g2int ifldnum,
+                   g2int unpack, g2int expand, int flags, g2float *fld,
+                   g2int fldlen, gribfield **gfld)
+{
+    g2int ret;
+
+    *gfld = NULL;
+    if (!dec || ifldnum <= 0 || (fld && !unpack))
+        return G2_GETFLD_INVAL;
+
+    /* The section table from the last call is reused. */
+    if ((ret = g2c_msg_walk(cgrib, ifldnum, 1, &dec->msg)))
+        return ret;
+    return g2c_msg_field(&dec->msg, ifldnum, unpack, expand, flags, fld, fldlen,
+                         dec, gfld);
+}
@@ -147,6 +147,35 @@ getdrsindex(g2int number)
     return(getdrsindex);
 }
 
+/**
+ * Fill in the template struct of a Data Representation Template, like
+ * getdrstemplate(), without allocating it.
+ *
+ * @param number The number of the Data Representation Template.
+ * @param tmpl The struct to fill in.
+ *
+ * @return 0 for success, -1 if the template is not defined.
+ */
+int
+g2c_drstemplate(g2int number, gtemplate *tmpl)
+{
+    g2int index;
+
+    if ((index = getdrsindex(number)) == -1)
+    {
+        g2c_log_stdout("getdrstemplate: DRS Template 5.%d not defined.\n", (int)number);
+        return -1;
+    }
+    tmpl->type = 5;
+    tmpl->num = templatesdrs[index].template_num;
+    tmpl->maplen = templatesdrs[index].mapdrslen;
+    tmpl->needext = templatesdrs[index].needext;
+    tmpl->map = (g2int *)templatesdrs[index].mapdrs;
+    tmpl->extlen = 0;
+    tmpl->ext = NULL;
+    return 0;
+}
+
 /**
  * This subroutine returns DRS template information for a specified
  * Data Representation Template. The number of entries in the
@@ -165,30 +194,14 @@ getdrsindex(g2int number)
 gtemplate *
 getdrstemplate(g2int number)
 {
-    g2int index;
-    gtemplate *new;
-
-    index = getdrsindex(number);
+    gtemplate tmpl, *new;
 
-    if (index != -1)
-    {
-        new = malloc(sizeof(gtemplate));
-        new->type = 5;
-        new->num = templatesdrs[index].template_num;
-        new->maplen = templatesdrs[index].mapdrslen;
-        new->needext = templatesdrs[index].needext;
-        new->map = (g2int *)templatesdrs[index].mapdrs;
-        new->extlen = 0;
-        new->ext = NULL;
-        return(new);
-    }
-    else
-    {
-        printf("getdrstemplate: DRS Template 5.%d not defined.\n", (int)number);
-        return(NULL);
-    }
-
-    return(NULL);
+    if (g2c_drstemplate(number, &tmpl))
+        return NULL;
+    if (!(new = g2c_malloc(sizeof(gtemplate))))
+        return NULL;
+    *new = tmpl;
+    return new;
 }
 
 /**
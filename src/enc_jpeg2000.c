@@ -103,7 +103,7 @@ enc_jpeg2000(unsigned char *cin, g2int width, g2int height, g2int nbits,
     /* Encode image. */
     if ((ier = jpc_encode(&image, jpcstream, opts)))
     {
-        printf(" jpc_encode return = %d \n",ier);
+        g2c_log_stdout(" jpc_encode return = %d \n",ier);
         return -3;
     }
 
@@ -58,6 +58,34 @@ void user_flush_data(png_structp png_ptr)
 {
 }
 
+/**
+ * Allocate memory for libpng, with g2c_malloc().
+ *
+ * @param png_ptr Pointer to PNG.
+ * @param size Number of bytes.
+ *
+ * @return Pointer to the memory, or NULL.
+ */
+static png_voidp
+png_malloc_cb(png_structp png_ptr, png_alloc_size_t size)
+{
+    (void)png_ptr;
+    return g2c_malloc(size);
+}
+
+/**
+ * Free memory for libpng, with g2c_free().
+ *
+ * @param png_ptr Pointer to PNG.
+ * @param ptr The memory.
+ */
+static void
+png_free_cb(png_structp png_ptr, png_voidp ptr)
+{
+    (void)png_ptr;
+    g2c_free(ptr);
+}
+
 /**
  * Encode PNG.
  *
@@ -83,7 +111,8 @@ enc_png(unsigned char *data, g2int width, g2int height, g2int nbits,
     png_stream write_io_ptr;
 
     /* Create and initialize png_structs. */
-    if (!(png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL)))
+    if (!(png_ptr = png_create_write_struct_2(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL,
+                                              NULL, png_malloc_cb, png_free_cb)))
         return -1;
 
     if (!(info_ptr = png_create_info_struct(png_ptr)))
@@ -126,7 +155,7 @@ enc_png(unsigned char *data, g2int width, g2int height, g2int nbits,
 
     /* Put image data into the PNG info structure. */
     bytes = nbits / 8;
-    row_pointers = malloc(height * sizeof(png_bytep));
+    row_pointers = g2c_malloc(height * sizeof(png_bytep));
     for (j = 0; j < height; j++)
         row_pointers[j] = (png_bytep *)(data + (j * width * bytes));
     png_set_rows(png_ptr, info_ptr, (png_bytepp)row_pointers);
@@ -136,7 +165,7 @@ enc_png(unsigned char *data, g2int width, g2int height, g2int nbits,
 
     /* Clean up. */
     png_destroy_write_struct(&png_ptr, &info_ptr);
-    free(row_pointers);
+    g2c_free(row_pointers);
     pnglen = write_io_ptr.stream_len;
     return pnglen;
 }
@@ -0,0 +1,262 @@
+/**
+ * @file
+ * @brief Open a GRIB file in memory, and iterate over its messages
+ * without copying them.
+ */
+
+#include <stdlib.h>
+#include "grib2_int.h"
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef HAVE_MMAP
+/**
+ * Tell the kernel how the mapping will be read.
+ *
+ * @param file The open file.
+ * @param access ::G2C_ACCESS_SEQUENTIAL or ::G2C_ACCESS_RANDOM.
+ */
+static void
+advise(g2c_file *file, int access)
+{
+    /* The advice is only a hint, so failure does not matter. */
+    if (file->mapped)
+        madvise(file->data, file->len,
+                access == G2C_ACCESS_RANDOM ? MADV_RANDOM : MADV_SEQUENTIAL);
+}
+
+/**
+ * Map a file into memory.
+ *
+ * @param path Name of the file.
+ * @param file The file, which gets the mapping.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EFILE Error opening or mapping the file.
+ */
+static int
+load(const char *path, g2c_file *file)
+{
+    struct stat st;
+    void *data;
+    int fd, ret = G2C_NO_ERROR;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return G2C_EFILE;
+    if (fstat(fd, &st))
+        ret = G2C_EFILE;
+    else if ((file->len = st.st_size))
+    {
+        /* The mapping stays valid after the file is closed. */
+        data = mmap(NULL, file->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+            ret = G2C_EFILE;
+        else
+        {
+            file->data = data;
+            file->mapped = 1;
+        }
+    }
+    close(fd);
+    return ret;
+}
+#else
+/**
+ * Read a whole file into memory.
+ *
+ * @param path Name of the file.
+ * @param file The file, which gets the contents.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EFILE Error reading the file.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+load(const char *path, g2c_file *file)
+{
+    FILE *f;
+    long len;
+    int ret = G2C_NO_ERROR;
+
+    if (!(f = fopen(path, "rb")))
+        return G2C_EFILE;
+    if (fseek(f, 0, SEEK_END) || (len = ftell(f)) < 0)
+        ret = G2C_EFILE;
+    else if ((file->len = len))
+    {
+        rewind(f);
+        if (!(file->data = g2c_malloc(file->len)))
+            ret = G2C_ENOMEM;
+        else if (fread(file->data, 1, file->len, f) != file->len)
+            ret = G2C_EFILE;
+    }
+    fclose(f);
+    if (ret)
+        g2c_free(file->data);
+    return ret;
+}
+#endif
+
+/**
+ * Open a GRIB file for reading. The file is mapped into memory, so
+ * messages can be decoded where they are, with no copy, and pages of
+ * the file are shared with other processes reading it.
+ *
+ * Where mmap() is not available, the whole file is read into memory
+ * instead.
+ *
+ * @param path Name of the file.
+ * @param access How the messages will be read, ::G2C_ACCESS_SEQUENTIAL
+ * or ::G2C_ACCESS_RANDOM. This is passed on to the kernel with
+ * madvise(), to tune read-ahead.
+ * @param file Pointer that gets the open file. Close it with
+ * g2c_close_file().
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid access.
+ * - ::G2C_EFILE Error opening or reading the file.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_open_file(const char *path, int access, g2c_file **file)
+{
+    g2c_file *f;
+    int ret;
+
+    if (!path || !file)
+        return G2C_EINVAL;
+    if (access != G2C_ACCESS_SEQUENTIAL && access != G2C_ACCESS_RANDOM)
+        return G2C_EINVAL;
+    if (!(f = g2c_calloc(1, sizeof(g2c_file))))
+        return G2C_ENOMEM;
+    if ((ret = load(path, f)))
+    {
+        g2c_free(f);
+        return ret;
+    }
+#ifdef HAVE_MMAP
+    advise(f, access);
+#endif
+    *file = f;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Close a GRIB file opened with g2c_open_file(). Pointers to its
+ * messages are no longer valid after this.
+ *
+ * @param file The open file.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid file.
+ * - ::G2C_EFILE Error unmapping the file.
+ */
+int
+g2c_close_file(g2c_file *file)
+{
+    int ret = G2C_NO_ERROR;
+
+    if (!file)
+        return G2C_EINVAL;
+#ifdef HAVE_MMAP
+    if (file->mapped && munmap(file->data, file->len))
+        ret = G2C_EFILE;
+#endif
+    if (!file->mapped)
+        g2c_free(file->data);
+    g2c_free(file);
+    return ret;
+}
+
+/**
+ * Change the expected access pattern of an open file.
+ *
+ * @param file The open file.
+ * @param access ::G2C_ACCESS_SEQUENTIAL or ::G2C_ACCESS_RANDOM.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid file or access.
+ */
+int
+g2c_file_advise(g2c_file *file, int access)
+{
+    if (!file)
+        return G2C_EINVAL;
+    if (access != G2C_ACCESS_SEQUENTIAL && access != G2C_ACCESS_RANDOM)
+        return G2C_EINVAL;
+#ifdef HAVE_MMAP
+    advise(file, access);
+#endif
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Find the next GRIB message in an open file.
+ *
+ * The position of the iterator is kept by the caller, so one open file
+ * may be read by many iterators at once, in different threads.
+ *
+ * @param file The open file.
+ * @param pos Pointer to the position of the iterator. Set it to 0 to
+ * start at the beginning of the file. It is moved past the message
+ * found.
+ * @param loc Pointer that gets the location of the message in the
+ * file. May be NULL.
+ * @param cgrib Pointer that gets a pointer to the message, which can
+ * be passed to g2_info() and g2_getfld(). The message is read-only,
+ * and is valid until the file is closed.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_ENOMSG No more messages in the file.
+ */
+int
+g2c_next_msg(g2c_file *file, size_t *pos, g2c_msgloc *loc, unsigned char **cgrib)
+{
+    g2c_msgloc l;
+
+    if (!file || !pos || !cgrib)
+        return G2C_EINVAL;
+    if (*pos >= file->len || !g2c_find_msg(file->data, file->len, *pos, &l))
+        return G2C_ENOMSG;
+    *pos = l.offset + l.bytes;
+    *cgrib = file->data + l.offset;
+    if (loc)
+        *loc = l;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Get a pointer to a GRIB message in an open file, at a location
+ * found earlier, for example by g2c_next_msg() or g2c_scan_file().
+ *
+ * @param file The open file.
+ * @param loc Location of the message.
+ * @param cgrib Pointer that gets a pointer to the message. The message
+ * is read-only, and is valid until the file is closed.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input, or the location is not in the file.
+ */
+int
+g2c_file_msg(g2c_file *file, g2c_msgloc *loc, unsigned char **cgrib)
+{
+    if (!file || !loc || !cgrib)
+        return G2C_EINVAL;
+    if (loc->offset < 0 || loc->bytes <= 0 || (size_t)loc->offset > file->len ||
+        (size_t)loc->bytes > file->len - loc->offset)
+        return G2C_EINVAL;
+    *cgrib = file->data + loc->offset;
+    return G2C_NO_ERROR;
+}
@@ -105,9 +105,54 @@ g2int
 g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
             g2float *coordlist, g2int numcoord, g2int idrsnum, g2int *idrstmpl,
             g2float *fld, g2int ngrdpts, g2int ibmap, g2int *bmap)
+{
+    return g2c_addfield(cgrib, ipdsnum, ipdstmpl, coordlist, numcoord, idrsnum,
+                        idrstmpl, fld, ngrdpts, ibmap, bmap, G2C_BMAP_G2INT, NULL);
+}
+
+/**
+ * Pack up Sections 4 through 7 for a given field and add them to a
+ * GRIB2 message, like g2_addfield(), with the bitmap in any format,
+ * and optional scratch space for the data.
+ *
+ * When a bitmap applies (ibmap 0 or 254), the data at the grid
+ * points that are bitmapped out are removed before packing. By
+ * default this is done in a new array that is freed before
+ * returning. A caller that encodes many fields can pass scratch space
+ * of ngrdpts values instead, or pass fld itself as scratch, if fld may
+ * be overwritten.
+ *
+ * @param cgrib Char array that contains the GRIB2 message.
+ * @param ipdsnum Product Definition Template Number.
+ * @param ipdstmpl Contains the data values for the Product Definition
+ * Template specified by ipdsnum.
+ * @param coordlist Array of vertical coordinate values.
+ * @param numcoord number of values in array coordlist.
+ * @param idrsnum Data Representation Template Number.
+ * @param idrstmpl The data values for the Data Representation
+ * Template specified by idrsnum.
+ * @param fld Array of data points to pack.
+ * @param ngrdpts Number of data points in grid. i.e.  size of fld and bmap.
+ * @param ibmap Bitmap indicator.
+ * @param bmap Bitmap of ngrdpts points (if ibmap = 0 or 254), in the
+ * format given by bmap_fmt.
+ * @param bmap_fmt Format of bmap, one of ::G2C_BMAP_G2INT (array of
+ * g2int, 0 or 1), ::G2C_BMAP_UINT8 (array of unsigned char, 0 or 1),
+ * or ::G2C_BMAP_BITS (one bit per point, first point in the high bit
+ * of the first byte).
+ * @param scratch NULL, or space for ngrdpts values to hold the data
+ * with the bitmapped out points removed. May be fld.
+ *
+ * @return As for g2_addfield().
+ */
+g2int
+g2c_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
+             g2float *coordlist, g2int numcoord, g2int idrsnum, g2int *idrstmpl,
+             g2float *fld, g2int ngrdpts, g2int ibmap, void *bmap, int bmap_fmt,
+             g2float *scratch)
 {
     unsigned char *cpack;
-    static g2int zero = 0, one = 1, four = 4, five = 5, six = 6, seven = 7;
+    static g2int four = 4, five = 5, six = 6, seven = 7;
     const g2int minsize = 50000;
     g2int iofst, ibeg, lencurr, len, nsize;
     g2int ilen, isecnum, i, nbits, temp, left;
@@ -115,6 +160,7 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     g2int lensec4, lensec5, lensec6, lensec7;
     g2int issec3 = 0, isprevbmap = 0, lpos3 = 0, JJ, KK, MM;
     g2int *coordieee;
+    g2c_bitwriter bw;
     g2float *pfld;
     gtemplate *mappds, *mapdrs;
 #if defined USE_PNG || defined USE_JPEG2000 || defined USE_OPENJPEG
@@ -169,9 +215,9 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
         /* total length, then there is a problem. */
         if (len > lencurr)
         {
-            printf("g2_addfield: Section byte counts don''t add to total.\n");
-            printf("g2_addfield: Sum of section byte counts = %ld\n", len);
-            printf("g2_addfield: Total byte count in Section 0 = %ld\n", lencurr);
+            g2c_log_stdout("g2_addfield: Section byte counts don''t add to total.\n");
+            g2c_log_stdout("g2_addfield: Sum of section byte counts = %ld\n", len);
+            g2c_log_stdout("g2_addfield: Total byte count in Section 0 = %ld\n", lencurr);
             return G2_BAD_SEC_COUNTS;
         }
     }
@@ -179,28 +225,29 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     /* Sections 4 through 7 can only be added after section 3 or 7. */
     if (isecnum != 3 && isecnum != 7)
     {
-        printf("g2_addfield: Sections 4-7 can only be added after Section 3 or 7.\n");
-        printf("g2_addfield: Section %ld was the last found in given GRIB message.\n",
-               isecnum);
+        g2c_log_stdout("g2_addfield: Sections 4-7 can only be added after Section 3 or 7.\n");
+        g2c_log_stdout("g2_addfield: Section %ld was the last found in given GRIB message.\n",
+                       isecnum);
         return G2_BAD_SEC;
     }
     else if (!issec3)
     {
         /* Sections 4 through 7 can only be added if section 3 was previously defined. */
-        printf("g2_addfield: Sections 4-7 can only be added if Section 3 was previously included.\n");
-        printf("g2_addfield: Section 3 was not found in given GRIB message.\n");
-        printf("g2_addfield: Call to routine addgrid required to specify Grid definition.\n");
+        g2c_log_stdout("g2_addfield: Sections 4-7 can only be added if Section 3 was previously included.\n");
+        g2c_log_stdout("g2_addfield: Section 3 was not found in given GRIB message.\n");
+        g2c_log_stdout("g2_addfield: Call to routine addgrid required to specify Grid definition.\n");
         return G2_ADDFIELD_BAD_GDS;
     }
 
     /* Add Section 4  - Product Definition Section. */
     ibeg = lencurr * 8;        /* Calculate offset for beginning of section 4 */
     iofst = ibeg + 32;         /* leave space for length of section */
-    sbit(cgrib, &four, iofst, 8);     /* Store section number (4) */
+    g2c_bw_init(&bw, cgrib, iofst);
+    g2c_bw_put(&bw, four, 8);     /* Store section number (4) */
     iofst = iofst + 8;
-    sbit(cgrib, &numcoord, iofst, 16);   /* Store num of coordinate values */
+    g2c_bw_put(&bw, numcoord, 16);   /* Store num of coordinate values */
     iofst = iofst + 16;
-    sbit(cgrib, &ipdsnum, iofst, 16);    /* Store Prod Def Template num. */
+    g2c_bw_put(&bw, ipdsnum, 16);    /* Store Prod Def Template num. */
     iofst = iofst + 16;
 
     /* Get Product Definition Template. */
@@ -212,7 +259,7 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     /* data specified in the "static" part of the template. */
     if (mappds->needext)
     {
-        free(mappds);
+        g2c_free(mappds);
         mappds = extpdstemplate(ipdsnum, ipdstmpl);
     }
 
@@ -223,12 +270,12 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     {
         nbits = abs(mappds->map[i]) * 8;
         if ((mappds->map[i] >= 0) || (ipdstmpl[i] >= 0))
-            sbit(cgrib, ipdstmpl + i, iofst, nbits);
+            g2c_bw_put(&bw, ipdstmpl[i], nbits);
         else
         {
-            sbit(cgrib, &one, iofst, 1);
+            g2c_bw_put(&bw, 1, 1);
             temp = abs(ipdstmpl[i]);
-            sbit(cgrib, &temp, iofst + 1, nbits-1);
+            g2c_bw_put(&bw, temp, nbits-1);
         }
         iofst = iofst + nbits;
     }
@@ -241,35 +288,36 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
         {
             nbits = abs(mappds->ext[i]) * 8;
             if (mappds->ext[i] >= 0 || ipdstmpl[j] >= 0)
-                sbit(cgrib, ipdstmpl + j, iofst, nbits);
+                g2c_bw_put(&bw, ipdstmpl[j], nbits);
             else
             {
-                sbit(cgrib, &one, iofst, 1);
+                g2c_bw_put(&bw, 1, 1);
                 temp = abs(ipdstmpl[j]);
-                sbit(cgrib, &temp, iofst + 1, nbits - 1);
+                g2c_bw_put(&bw, temp, nbits - 1);
             }
             iofst = iofst + nbits;
             j++;
         }
     }
     if (mappds->ext)
-        free(mappds->ext);
-    free(mappds);
+        g2c_free(mappds->ext);
+    g2c_free(mappds);
 
     /* Add Optional list of vertical coordinate values after the */
     /* Product Definition Template, if necessary. */
     if (numcoord != 0)
     {
-        coordieee = calloc(numcoord, sizeof(g2int));
+        coordieee = g2c_calloc(numcoord, sizeof(g2int));
         mkieee(coordlist, coordieee, numcoord);
-        sbits(cgrib, coordieee, iofst, 32, 0, numcoord);
+        g2c_bw_put_n(&bw, coordieee, 32, numcoord);
         iofst = iofst + (32 * numcoord);
-        free(coordieee);
+        g2c_free(coordieee);
     }
 
     /* Calculate length of section 4 and store it in octets 1-4 of */
     /* section 4. */
     lensec4 = (iofst - ibeg) / 8;
+    g2c_bw_flush(&bw);
     sbit(cgrib, &lensec4, ibeg, 32);
 
     /* Pack Data using appropriate algorithm Get Data Representation */
@@ -281,13 +329,11 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     /* bit-map is provided with field. */
     if (ibmap == 0 || ibmap == 254)
     {
-        pfld = malloc(ngrdpts * sizeof(g2float));
-        ndpts = 0;
-        for (j = 0; j < ngrdpts; j++)
-        {
-            if (bmap[j] == 1)
-                pfld[ndpts++] = fld[j];
-        }
+        if (scratch)
+            pfld = scratch;
+        else
+            pfld = g2c_malloc(ngrdpts * sizeof(g2float));
+        ndpts = g2c_contract(bmap_fmt, bmap, ngrdpts, fld, pfld);
     }
     else
     {
@@ -299,7 +345,7 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     nsize = ndpts * 4;
     if (nsize < minsize)
         nsize = minsize;
-    cpack = malloc(nsize);
+    cpack = g2c_malloc(nsize);
 
     /* Call packing function based on idrsnum. */
     if (idrsnum == 0)           /*  Simple Packing */
@@ -318,7 +364,7 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
             specpack(pfld, ndpts, JJ, KK, MM, idrstmpl, cpack, &lcpack);
         else
         {
-            printf("g2_addfield: Cannot pack DRT 5.51.\n");
+            g2c_log_stdout("g2_addfield: Cannot pack DRT 5.51.\n");
             return G2_ADDFIELD_BAD_GDT;
         }
     }
@@ -387,15 +433,15 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
 #endif  /* USE_PNG */
     else
     {
-        printf("g2_addfield: Data Representation Template 5.%ld not yet implemented.\n", idrsnum);
+        g2c_log_stdout("g2_addfield: Data Representation Template 5.%ld not yet implemented.\n", idrsnum);
         return G2_ADDFIELD_BAD_DRT;
     }
 
     /* Free temp space. */    
     if (ibmap == 0 || ibmap == 254)
     {
-        if (fld != pfld)
-            free(pfld);
+        if (pfld != scratch)
+            g2c_free(pfld);
     }
 
     /* The packing functions return an lcpack of -1 if there was an
@@ -403,18 +449,19 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     if (lcpack < 0)
     {
         if (cpack)
-            free(cpack);
+            g2c_free(cpack);
         return G2_ADDFIELD_ERR;
     }
 
     /*  Add Section 5  - Data Representation Section */
     ibeg = iofst;            /*   Calculate offset for beginning of section 5 */
     iofst = ibeg + 32;         /*   leave space for length of section */
-    sbit(cgrib, &five, iofst, 8);     /* Store section number (5) */
+    g2c_bw_init(&bw, cgrib, iofst);
+    g2c_bw_put(&bw, five, 8);     /* Store section number (5) */
     iofst = iofst + 8;
-    sbit(cgrib, &ndpts, iofst, 32);    /* Store num of actual data points */
+    g2c_bw_put(&bw, ndpts, 32);    /* Store num of actual data points */
     iofst = iofst + 32;
-    sbit(cgrib, &idrsnum, iofst, 16);    /* Store Data Repr. Template num. */
+    g2c_bw_put(&bw, idrsnum, 16);    /* Store Data Repr. Template num. */
     iofst = iofst + 16;
 
     /*   Pack up each input value in array idrstmpl into the */
@@ -424,34 +471,36 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     {
         nbits = abs(mapdrs->map[i]) * 8;
         if (mapdrs->map[i] >= 0 || idrstmpl[i] >= 0)
-            sbit(cgrib, idrstmpl + i, iofst, nbits);
+            g2c_bw_put(&bw, idrstmpl[i], nbits);
         else
         {
-            sbit(cgrib, &one, iofst, 1);
+            g2c_bw_put(&bw, 1, 1);
             temp = abs(idrstmpl[i]);
-            sbit(cgrib, &temp, iofst + 1, nbits - 1);
+            g2c_bw_put(&bw, temp, nbits - 1);
         }
         iofst = iofst + nbits;
     }
-    free(mapdrs);
+    g2c_free(mapdrs);
 
     /* Calculate length of section 5 and store it in octets */
     /* 1-4 of section 5. */
     lensec5 = (iofst - ibeg) / 8;
+    g2c_bw_flush(&bw);
     sbit(cgrib, &lensec5, ibeg, 32);
 
     /* Add Section 6  - Bit-Map Section */
     ibeg = iofst;            /*   Calculate offset for beginning of section 6 */
     iofst = ibeg + 32;         /*   leave space for length of section */
-    sbit(cgrib, &six, iofst, 8);     /* Store section number (6) */
+    g2c_bw_init(&bw, cgrib, iofst);
+    g2c_bw_put(&bw, six, 8);     /* Store section number (6) */
     iofst = iofst + 8;
-    sbit(cgrib, &ibmap, iofst, 8);    /* Store Bit Map indicator */
+    g2c_bw_put(&bw, ibmap, 8);    /* Store Bit Map indicator */
     iofst = iofst + 8;
 
     /*  Store bitmap, if supplied */
     if (ibmap == 0)
     {
-        sbits(cgrib, bmap, iofst, 1, 0, ngrdpts);    /* Store BitMap */
+        g2c_bw_put_bitmap(&bw, bmap_fmt, bmap, ngrdpts);    /* Store BitMap */
         iofst = iofst + ngrdpts;
     }
 
@@ -459,8 +508,8 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     /*  one already exists in the current GRIB message. */
     if (ibmap == 254 && !isprevbmap)
     {
-        printf("g2_addfield: Requested previously defined bitmap,");
-        printf(" but one does not exist in the current GRIB message.\n");
+        g2c_log_stdout("g2_addfield: Requested previously defined bitmap,");
+        g2c_log_stdout(" but one does not exist in the current GRIB message.\n");
         return G2_ADDFIELD_BAD_BITMAP;
     }
 
@@ -469,10 +518,11 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     left = 8 - (iofst % 8);
     if (left != 8)
     {
-        sbit(cgrib, &zero, iofst, left);     /* Pad with zeros to fill Octet */
+        g2c_bw_put(&bw, 0, left);     /* Pad with zeros to fill Octet */
         iofst = iofst + left;
     }
     lensec6 = (iofst - ibeg) / 8;
+    g2c_bw_flush(&bw);
     sbit(cgrib, &lensec6, ibeg, 32);
 
     /* Add Section 7  - Data Section */
@@ -497,7 +547,7 @@ g2_addfield(unsigned char *cgrib, g2int ipdsnum, g2int *ipdstmpl,
     sbit(cgrib, &lensec7, ibeg, 32);
 
     if (cpack)
-        free(cpack);
+        g2c_free(cpack);
 
     /*  Update current byte total of message in Section 0 */
     newlen = lencurr + lensec4 + lensec5 + lensec6 + lensec7;
@@ -106,9 +106,9 @@ g2_addgrid(unsigned char *cgrib, g2int *igds, g2int *igdstmpl, g2int *ideflist,
          * length, then there is a problem. */
         if (len > lencurr)
         {
-            printf("g2_addgrid: Section byte counts don''t add to total.\n");
-            printf("g2_addgrid: Sum of section byte counts = %ld\n", len);
-            printf("g2_addgrid: Total byte count in Section 0 = %ld\n", lencurr);
+            g2c_log_stdout("g2_addgrid: Section byte counts don''t add to total.\n");
+            g2c_log_stdout("g2_addgrid: Sum of section byte counts = %ld\n", len);
+            g2c_log_stdout("g2_addgrid: Total byte count in Section 0 = %ld\n", lencurr);
             return G2_BAD_SEC_COUNTS;
         }
     }
@@ -116,8 +116,8 @@ g2_addgrid(unsigned char *cgrib, g2int *igds, g2int *igdstmpl, g2int *ideflist,
     /* Section 3 can only be added after sections 1, 2 and 7. */
     if (isecnum != 1 && isecnum != 2 && isecnum != 7)
     {
-        printf("g2_addgrid: Section 3 can only be added after Section 1, 2 or 7.\n");
-        printf("g2_addgrid: Section ',isecnum,' was the last found in given GRIB message.\n");
+        g2c_log_stdout("g2_addgrid: Section 3 can only be added after Section 1, 2 or 7.\n");
+        g2c_log_stdout("g2_addgrid: Section ',isecnum,' was the last found in given GRIB message.\n");
         return G2_BAD_SEC;
     }
 
@@ -154,7 +154,7 @@ g2_addgrid(unsigned char *cgrib, g2int *igds, g2int *igdstmpl, g2int *ideflist,
          *  on data specified in the "static" part of the template. */
         if (mapgrid->needext)
         {
-            free(mapgrid);
+            g2c_free(mapgrid);
             mapgrid = extgridtemplate(igds[4], igdstmpl);
         }
     }
@@ -196,8 +196,8 @@ g2_addgrid(unsigned char *cgrib, g2int *igds, g2int *igdstmpl, g2int *ideflist,
         }
     }
     if (mapgrid->ext)
-        free(mapgrid->ext);
-    free(mapgrid);
+        g2c_free(mapgrid->ext);
+    g2c_free(mapgrid);
 
     /* If requested, insert optional list of numbers defining number
      * of points in each row or column. This is used for non regular
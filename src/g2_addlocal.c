@@ -74,9 +74,9 @@ g2_addlocal(unsigned char *cgrib, unsigned char *csec2, g2int lcsec2)
          * length, then there is a problem. */
         if (len > lencurr)
         {
-            printf("g2_addlocal: Section byte counts don't add to total.\n");
-            printf("g2_addlocal: Sum of section byte counts = %ld\n", len);
-            printf("g2_addlocal: Total byte count in Section 0 = %ld\n", lencurr);
+            g2c_log_stdout("g2_addlocal: Section byte counts don't add to total.\n");
+            g2c_log_stdout("g2_addlocal: Sum of section byte counts = %ld\n", len);
+            g2c_log_stdout("g2_addlocal: Total byte count in Section 0 = %ld\n", lencurr);
             return G2_BAD_SEC_COUNTS;
         }
     }
@@ -84,8 +84,8 @@ g2_addlocal(unsigned char *cgrib, unsigned char *csec2, g2int lcsec2)
     /* Section 2 can only be added after sections 1 and 7. */
     if (isecnum != 1 && isecnum != 7)
     {
-        printf("g2_addlocal: Section 2 can only be added after Section 1 or Section 7.\n");
-        printf("g2_addlocal: Section %ld was the last found in given GRIB message.\n", isecnum);
+        g2c_log_stdout("g2_addlocal: Section 2 can only be added after Section 1 or Section 7.\n");
+        g2c_log_stdout("g2_addlocal: Section %ld was the last found in given GRIB message.\n", isecnum);
         return G2_BAD_SEC;
     }
 
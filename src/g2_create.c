@@ -81,7 +81,7 @@ g2_create(unsigned char *cgrib, g2int *listsec0, g2int *listsec1)
     /* Only GRIB Edition 2 is acceptable. */
     if (listsec0[1] != 2)
     {
-        printf("g2_create: can only code GRIB edition 2.");
+        g2c_log_stdout("g2_create: can only code GRIB edition 2.");
         return G2_CREATE_GRIB_VERSION;
     }
 
@@ -23,25 +23,34 @@
 void
 g2_free(gribfield *gfld)
 {
+    /* The arrays of a field in an arena go with the struct. */
+    if (gfld->arena)
+    {
+        g2c_free(gfld);
+        return;
+    }
+
     if (gfld->idsect)
-        free(gfld->idsect);
+        g2c_free(gfld->idsect);
     if (gfld->local)
-        free(gfld->local);
+        g2c_free(gfld->local);
     if (gfld->list_opt)
-        free(gfld->list_opt);
+        g2c_free(gfld->list_opt);
     if (gfld->igdtmpl)
-        free(gfld->igdtmpl);
+        g2c_free(gfld->igdtmpl);
     if (gfld->ipdtmpl)
-        free(gfld->ipdtmpl);
+        g2c_free(gfld->ipdtmpl);
     if (gfld->coord_list)
-        free(gfld->coord_list);
+        g2c_free(gfld->coord_list);
     if (gfld->idrtmpl)
-        free(gfld->idrtmpl);
+        g2c_free(gfld->idrtmpl);
     if (gfld->bmap)
-        free(gfld->bmap);
+        g2c_free(gfld->bmap);
+    if (gfld->cbmap)
+        g2c_free(gfld->cbmap);
     if (gfld->fld)
-        free(gfld->fld);
-    free(gfld);
+        g2c_free(gfld->fld);
+    g2c_free(gfld);
 
     return;
 }
@@ -60,6 +60,7 @@
  * - ::G2_GETFLD_BAD_SEC6 Error unpacking Section 6.
  * - ::G2_GETFLD_BAD_SEC7 Error unpacking Section 7.
  * - ::G2_GETFLD_NO_BITMAP Previous bitmap specified, yet none exists.
+ * - ::G2C_ENOMEM Out of memory.
  *
  * @note Struct gribfield is allocated by this routine and it also
  * contains pointers to many arrays of data that were allocated during
@@ -91,300 +92,435 @@ g2int
 g2_getfld(unsigned char *cgrib, g2int ifldnum, g2int unpack, g2int expand,
           gribfield **gfld)
 {
+    return g2c_getfld(cgrib, ifldnum, unpack, expand, 0, gfld);
+}
 
-    g2int have3 = 0, have4 = 0, have5 = 0, have6 = 0, have7 = 0;
-    g2int numfld = 0, j, n, istart, iofst, ipos;
-    g2int disc, ver, lensec0, lengrib, lensec, isecnum;
-    g2int *igds;
-    g2int *bmpsave;
-    g2float *newfld;
-    gribfield *lgfld;
-    g2int jerr;
+/**
+ * Return all the metadata, template values, bit-map (if applicable),
+ * and the unpacked data for a given data field, like g2_getfld(),
+ * with flags that control the form of the results.
+ *
+ * By default the bitmap is returned in gfld->bmap, one g2int per grid
+ * point. A field on a large grid with a bitmap then carries a bitmap
+ * that is 8 times the size of the data (4 times with 32-bit
+ * g2int). With ::G2C_BMAP_UINT8 in flags the bitmap is returned in
+ * gfld->cbmap instead, one byte per grid point. With ::G2C_BMAP_BITS
+ * it is returned in gfld->cbmap as stored in the message, one bit
+ * per grid point. If both are set, ::G2C_BMAP_BITS is used. The
+ * format is recorded in gfld->bmap_fmt. Use g2c_bmap_get() and
+ * g2c_bmap_count() to read a bitmap in any format.
+ *
+ * @param cgrib Character pointer to the GRIB2 message.
+ * @param ifldnum Specifies which field in the GRIB2 message to
+ * return. The first field is number 1, Fortran style.
+ * @param unpack Boolean value indicating whether to unpack
+ * bitmap/data field.
+ * @param expand Boolean value indicating whether the data points
+ * should be expanded to the correspond grid, if a bit-map is present.
+ * @param flags 0, or ::G2C_BMAP_UINT8 or ::G2C_BMAP_BITS to choose
+ * the bitmap format, and ::G2C_GFLD_ARENA to put the gribfield and its
+ * arrays in one block.
+ * @param gfld pointer to structure gribfield containing all decoded
+ * data for the data field. Free it with g2_free().
+ *
+ * @return As for g2_getfld().
+ */
+g2int
+g2c_getfld(unsigned char *cgrib, g2int ifldnum, g2int unpack, g2int expand,
+           int flags, gribfield **gfld)
+{
+    g2c_msg msg = {0};
+    g2int ret;
 
-    /* Allocate storage for the field struct. The caller must free
-     * this memory. */
-    lgfld = calloc(1, sizeof(gribfield));
-    *gfld = lgfld;
+    *gfld = NULL;
 
     /* Check for valid request number. */
     if (ifldnum <= 0)
     {
-        printf("g2_getfld: Request for field number must be positive.\n");
-        free(lgfld);
+        g2c_log_stdout("g2_getfld: Request for field number must be positive.\n");
+        return G2_GETFLD_INVAL;
+    }
+
+    /* Find the sections of the requested field, without unpacking
+     * the sections of the fields before it. */
+    if ((ret = g2c_msg_walk(cgrib, ifldnum, 1, &msg)))
+        return ret;
+
+    ret = g2c_msg_field(&msg, ifldnum, unpack, expand, flags, NULL, 0, NULL, gfld);
+    g2c_free(msg.fld);
+    return ret;
+}
+
+/**
+ * Find the number of values g2c_getfld_into() writes for a field: the
+ * number of grid points if the data is to be expanded with a bitmap,
+ * otherwise the number of data points. Only the section headers are
+ * read, so a caller can size a buffer before decoding anything.
+ *
+ * @param cgrib Character pointer to the GRIB2 message.
+ * @param ifldnum Specifies which field in the GRIB2 message to
+ * return. The first field is number 1, Fortran style.
+ * @param expand Boolean value indicating whether the data points
+ * should be expanded to the correspond grid, if a bit-map is present.
+ * @param nfld Pointer that gets the number of values.
+ *
+ * @return As for g2_getfld().
+ */
+g2int
+g2c_getfld_size(unsigned char *cgrib, g2int ifldnum, g2int expand, g2int *nfld)
+{
+    g2c_msg msg = {0};
+    g2c_fldsecs *fs;
+    g2int ndpts, ngrdpts, ibmap;
+    g2int ret;
+
+    if (ifldnum <= 0 || !nfld)
         return G2_GETFLD_INVAL;
+    if ((ret = g2c_msg_walk(cgrib, ifldnum, 1, &msg)))
+        return ret;
+    fs = ifldnum <= msg.numfields ? &msg.fld[ifldnum - 1] : NULL;
+    if (!fs || !fs->sec[3] || !fs->sec[5] || !fs->sec[6] || !fs->sec[7])
+        ret = G2_GETFLD_WRONG_NFLDS;
+    else
+    {
+        /* The expansion is done as in g2c_msg_field(). */
+        gbit(msg.cgrib, &ngrdpts, fs->sec[3] * 8 + 48, 32);
+        gbit(msg.cgrib, &ndpts, fs->sec[5] * 8 + 40, 32);
+        gbit(msg.cgrib, &ibmap, fs->sec[6] * 8 + 40, 8);
+        if (expand == 1 && ibmap != 255 && fs->bmap6 && ndpts <= ngrdpts)
+            *nfld = ngrdpts;
+        else
+            *nfld = ndpts;
     }
+    g2c_free(msg.fld);
+    return ret;
+}
+
+/**
+ * Decode a field of a message like g2c_getfld(), with unpack set, but
+ * write the data to an array supplied by the caller, instead of
+ * allocating one. The same array can be used for every field of the
+ * same shape. Use g2c_getfld_size() to find how long it must be.
+ *
+ * The data is not in gfld->fld, which is NULL. The metadata and
+ * bitmap are in gfld, as from g2c_getfld(), and gfld->expanded tells
+ * whether the data was expanded to the grid.
+ *
+ * @param cgrib Character pointer to the GRIB2 message.
+ * @param ifldnum Specifies which field in the GRIB2 message to
+ * return. The first field is number 1, Fortran style.
+ * @param expand Boolean value indicating whether the data points
+ * should be expanded to the correspond grid, if a bit-map is present.
+ * @param flags 0, or ::G2C_BMAP_UINT8 or ::G2C_BMAP_BITS to choose
+ * the bitmap format, and ::G2C_GFLD_ARENA to put the gribfield and its
+ * arrays in one block.
+ * @param fld Array that gets the data.
+ * @param fldlen Number of values fld has room for.
+ * @param gfld pointer to structure gribfield containing the decoded
+ * metadata and bitmap of the field. Free it with g2_free().
+ *
+ * @return As for g2_getfld(), and
+ * - ::G2C_ESIZE fld is too short.
+ */
+g2int
+g2c_getfld_into(unsigned char *cgrib, g2int ifldnum, g2int expand, int flags,
+                g2float *fld, g2int fldlen, gribfield **gfld)
+{
+    g2c_msg msg = {0};
+    g2int ret;
 
-    /*  Check for beginning of GRIB message in the first 100 bytes. */
-    istart = -1;
-    for (j = 0; j < 100; j++)
+    *gfld = NULL;
+    if (ifldnum <= 0 || !fld)
+        return G2_GETFLD_INVAL;
+    if ((ret = g2c_msg_walk(cgrib, ifldnum, 1, &msg)))
+        return ret;
+    ret = g2c_msg_field(&msg, ifldnum, 1, expand, flags, fld, fldlen, NULL, gfld);
+    g2c_free(msg.fld);
+    return ret;
+}
+
+/**
+ * Find the size of a block big enough for a gribfield and all its
+ * arrays, from the lengths of its sections. Each value of a template
+ * takes at least one octet of its section, so the section lengths
+ * bound the number of values. Extending a template may copy it, so
+ * room is left for two copies.
+ *
+ * @param msg The section table.
+ * @param fs Sections of the field.
+ * @param unpack Non-zero if the bitmap and data are unpacked.
+ * @param fmt Bitmap format.
+ * @param into Non-zero if the data goes to the caller's array.
+ *
+ * @return The size in bytes.
+ */
+static size_t
+arena_size(g2c_msg *msg, g2c_fldsecs *fs, g2int unpack, int fmt, int into)
+{
+    g2int len[8] = {0}, ndpts, ngrdpts, ngpts = 0;
+    size_t size, n;
+    int i;
+
+    for (i = 1; i <= 7; i++)
+        if (fs->sec[i])
+            gbit(msg->cgrib, &len[i], fs->sec[i] * 8, 32);
+
+    /* The struct, and up to 16 arrays rounded up to the alignment. */
+    size = sizeof(gribfield) + 16 * G2C_ARENA_ALIGN;
+    size += 13 * sizeof(g2int) + len[2];
+    size += (5 + 3 * len[3] + 2 * len[4] + 2 * len[5]) * sizeof(g2int);
+    size += len[4] / 4 * sizeof(g2float);
+    if (unpack)
     {
-        if (cgrib[j] == 'G' && cgrib[j + 1] == 'R' &&cgrib[j + 2] == 'I' &&
-            cgrib[j + 3] == 'B')
+        if (fs->bmap6 && fs->bmap3)
+            gbit(msg->cgrib, &ngpts, fs->bmap3 * 8 + 48, 32);
+        if (fmt == G2C_BMAP_BITS)
+            size += (ngpts + 7) / 8;
+        else if (fmt == G2C_BMAP_UINT8)
+            size += ngpts;
+        else
+            size += ngpts * sizeof(g2int);
+        if (!into)
         {
-            istart = j;
-            break;
+            gbit(msg->cgrib, &ngrdpts, fs->sec[3] * 8 + 48, 32);
+            gbit(msg->cgrib, &ndpts, fs->sec[5] * 8 + 40, 32);
+            n = ngrdpts > ndpts ? ngrdpts : ndpts;
+            size += n * sizeof(g2float);
         }
     }
-    if (istart == -1)
+    return size;
+}
+
+/**
+ * Decode a field of a message, whose sections have been found with
+ * g2c_msg_walk().
+ *
+ * @param msg The section table.
+ * @param ifldnum Specifies which field in the GRIB2 message to
+ * return. The first field is number 1, Fortran style.
+ * @param unpack Boolean value indicating whether to unpack
+ * bitmap/data field.
+ * @param expand Boolean value indicating whether the data points
+ * should be expanded to the correspond grid, if a bit-map is present.
+ * @param flags 0, or ::G2C_BMAP_UINT8 or ::G2C_BMAP_BITS to choose
+ * the bitmap format, and ::G2C_GFLD_ARENA to put the gribfield and its
+ * arrays in one block.
+ * @param fld NULL to allocate gfld->fld for the data, or an array of
+ * fldlen values for it.
+ * @param fldlen Number of values fld has room for.
+ * @param dec Decoder with scratch arrays for unpacking, or NULL.
+ * @param gfld pointer to structure gribfield containing all decoded
+ * data for the data field. Free it with g2_free().
+ *
+ * @return As for g2_getfld(), and ::G2C_ESIZE if fld is too short.
+ */
+g2int
+g2c_msg_field(g2c_msg *msg, g2int ifldnum, g2int unpack, g2int expand,
+              int flags, g2float *fld, g2int fldlen, g2c_decoder *dec,
+              gribfield **gfld)
+{
+    unsigned char *cgrib = msg->cgrib;
+    g2c_fldsecs *fs;
+    g2int iofst, ngpts, ibmap;
+    g2int *igds;
+    void *newbmap;
+    g2c_grid grid, *gridp;
+    gribfield *lgfld;
+    g2c_arena block, *arena = NULL;
+    g2int jerr, nout;
+    int fmt;
+
+    *gfld = NULL;
+
+    /* The field must have all the sections needed. */
+    fs = ifldnum <= msg->numfields ? &msg->fld[ifldnum - 1] : NULL;
+    if (!fs || !fs->sec[3] || !fs->sec[5] || !fs->sec[6] || (unpack && !fs->sec[7]))
     {
-        printf("g2_getfld:  Beginning characters GRIB not found.\n");
-        free(lgfld);
-        return G2_GETFLD_NO_GRIB;
+        g2c_log_stdout("g2_getfld: GRIB message contained %ld different fields.\n",
+                       msg->numfields);
+        g2c_log_stdout("g2_getfld: The request was for field %ld.\n", ifldnum);
+        return G2_GETFLD_WRONG_NFLDS;
     }
 
-    /*  Unpack Section 0 - Indicator Section. */
-    iofst = 8 * (istart + 6);
-    gbit(cgrib, &disc, iofst, 8);     /* Discipline */
-    iofst = iofst + 8;
-    gbit(cgrib, &ver, iofst, 8);     /* GRIB edition number */
-    iofst = iofst + 8;
-    iofst = iofst + 32;
-    gbit(cgrib, &lengrib, iofst, 32);        /* Length of GRIB message */
-    iofst = iofst + 32;
-    lensec0 = 16;
-    ipos = istart + lensec0;
+    /* Bitmap format. */
+    if (flags & G2C_BMAP_BITS)
+        fmt = G2C_BMAP_BITS;
+    else if (flags & G2C_BMAP_UINT8)
+        fmt = G2C_BMAP_UINT8;
+    else
+        fmt = G2C_BMAP_G2INT;
 
-    /*  Currently handles only GRIB Edition 2. */
-    if (ver != 2)
+    /* Allocate storage for the field struct. The caller must free
+     * this memory. In an arena, the arrays go in the same block. */
+    if (flags & G2C_GFLD_ARENA)
     {
-        printf("g2_getfld: can only decode GRIB edition 2.\n");
-        free(lgfld);
-        return G2_GETFLD_GRIB_VERSION;
+        block.size = arena_size(msg, fs, unpack, fmt, fld != NULL);
+        block.used = 0;
+        if (!(block.base = g2c_calloc(1, block.size)))
+            return G2C_ENOMEM;
+        arena = &block;
     }
+    if (!(lgfld = g2c_arena_alloc(arena, sizeof(gribfield))))
+    {
+        if (arena)
+            g2c_free(block.base);
+        return G2C_ENOMEM;
+    }
+    lgfld->arena = arena ? 1 : 0;
 
-    /*  Loop through the remaining sections keeping track of the
-     *  length of each.  Also keep the latest Grid Definition Section
-     *  info. Unpack the requested field number. */
-    for (;;)
+    /* Decode elements in Identification Section. */
+    if (fs->sec[1])
     {
-        /*    Check to see if we are at end of GRIB message */
-        if (cgrib[ipos] == '7' && cgrib[ipos + 1] == '7' && cgrib[ipos + 2] == '7' &&
-            cgrib[ipos + 3] == '7')
+        iofst = fs->sec[1] * 8;
+        if (g2c_unpack1(cgrib, &iofst, &lgfld->idsect, &lgfld->idsectlen, arena))
         {
-            ipos = ipos + 4;
-
-            /*    If end of GRIB message not where expected, issue
-             *    error. */
-            if (ipos != istart + lengrib)
-            {
-                printf("g2_getfld: '7777' found, but not where expected.\n");
-                free(lgfld);
-                return G2_GETFLD_WRONG_END;
-            }
-            break;
+            g2_free(lgfld);
+            return G2_GETFLD_BAD_SEC1;
         }
+    }
 
-        /* Get length of Section and Section number. */
-        iofst = ipos * 8;
-        gbit(cgrib, &lensec, iofst, 32);        /* Get Length of Section */
-        iofst = iofst + 32;
-        gbit(cgrib, &isecnum, iofst, 8);         /* Get Section number */
-        iofst = iofst + 8;
-
-        /* Check to see if section number is valid. */
-        if (isecnum < 1 || isecnum > 7)
+    /* Grab the latest local section before the field. */
+    if (fs->sec[2])
+    {
+        iofst = fs->sec[2] * 8;
+        if (g2c_unpack2(cgrib, &iofst, &lgfld->locallen, &lgfld->local, arena))
         {
-            printf("g2_getfld: Unrecognized Section Encountered=%ld\n", isecnum);
-            free(lgfld);
-            return G2_GETFLD_INVAL_SEC;
+            g2_free(lgfld);
+            return G2_GETFLD_BAD_SEC2;
         }
+    }
 
-        /*   If found Section 1, decode elements in Identification Section. */
-        if (isecnum == 1)
-        {
-            iofst = iofst - 40;       /* reset offset to beginning of section */
-            if (g2_unpack1(cgrib, &iofst, &lgfld->idsect, &lgfld->idsectlen))
-            {
-                g2_free(lgfld);
-                return G2_GETFLD_BAD_SEC1;
-            }
-        }
+    /* Unpack the latest GDS info before the field, using the
+     * appropriate template. */
+    iofst = fs->sec[3] * 8;
+    if (g2c_unpack3(cgrib, &iofst, &igds, &lgfld->igdtmpl,
+                    &lgfld->igdtlen, &lgfld->list_opt, &lgfld->num_opt, arena))
+    {
+        g2c_arena_free(arena, igds);
+        g2_free(lgfld);
+        return G2_GETFLD_BAD_SEC3;
+    }
+    lgfld->griddef = igds[0];
+    lgfld->ngrdpts = igds[1];
+    lgfld->numoct_opt = igds[2];
+    lgfld->interp_opt = igds[3];
+    lgfld->igdtnum = igds[4];
+    g2c_arena_free(arena, igds);
 
-        /*   If found Section 2, Grab local section. Save in case this
-         *   is the latest one before the requested field. */
-        if (isecnum == 2)
-        {
-            iofst = iofst - 40;       /* reset offset to beginning of section */
-            if (lgfld->local)
-                free(lgfld->local);
-            if (g2_unpack2(cgrib, &iofst, &lgfld->locallen, &lgfld->local))
-            {
-                g2_free(lgfld);
-                return G2_GETFLD_BAD_SEC2;
-            }
-        }
+    /* Unpack the Product Definition Section of the field. */
+    lgfld->discipline = msg->discipline;
+    lgfld->version = msg->version;
+    lgfld->ifldnum = ifldnum;
+    lgfld->unpacked = unpack;
+    lgfld->expanded = 0;
+    iofst = fs->sec[4] * 8;
+    if (g2c_unpack4(cgrib, &iofst, &lgfld->ipdtnum, &lgfld->ipdtmpl,
+                    &lgfld->ipdtlen, &lgfld->coord_list, &lgfld->num_coord, arena))
+    {
+        g2_free(lgfld);
+        return G2_GETFLD_BAD_SEC4;
+    }
 
-        /* If found Section 3, unpack the GDS info using the
-         * appropriate template.  Save in case this is the latest grid
-         * before the requested field. */
-        if (isecnum == 3)
+    /* Unpack the Data Representation Section of the field. */
+    iofst = fs->sec[5] * 8;
+    if (g2c_unpack5(cgrib, &iofst, &lgfld->ndpts, &lgfld->idrtnum,
+                    &lgfld->idrtmpl, &lgfld->idrtlen, arena))
+    {
+        g2_free(lgfld);
+        return G2_GETFLD_BAD_SEC5;
+    }
+
+    /* Get the bitmap indicator of the field, and unpack the bitmap
+     * in effect, which may be from an earlier section 6 if the
+     * indicator is 254. */
+    gbit(cgrib, &lgfld->ibmap, fs->sec[6] * 8 + 40, 8);
+    if (unpack)
+    {
+        if (fs->bmap6)
         {
-            iofst = iofst - 40;       /* reset offset to beginning of section */
-            if (lgfld->igdtmpl)
-                free(lgfld->igdtmpl);
-            if (lgfld->list_opt)
-                free(lgfld->list_opt);
-            if (g2_unpack3(cgrib, &iofst, &igds, &lgfld->igdtmpl,
-                           &lgfld->igdtlen, &lgfld->list_opt, &lgfld->num_opt))
+            /* The bitmap has a point for each point of the grid in
+             * effect when it was defined. */
+            ngpts = 0;
+            if (fs->bmap3)
+                gbit(cgrib, &ngpts, fs->bmap3 * 8 + 48, 32);
+            iofst = fs->bmap6 * 8;
+            if (g2c_unpack6(cgrib, &iofst, ngpts, &ibmap, fmt, &newbmap, arena))
             {
                 g2_free(lgfld);
-                return G2_GETFLD_BAD_SEC3;
+                return G2_GETFLD_BAD_SEC6;
             }
-
-            have3 = 1;
-            lgfld->griddef = igds[0];
-            lgfld->ngrdpts = igds[1];
-            lgfld->numoct_opt = igds[2];
-            lgfld->interp_opt = igds[3];
-            lgfld->igdtnum = igds[4];
-            free(igds);
+            if (fmt == G2C_BMAP_G2INT)
+                lgfld->bmap = newbmap;
+            else
+                lgfld->cbmap = newbmap;
         }
-
-        /* If found Section 4, check to see if this field is the one
-         * requested. */
-        if (isecnum == 4)
+        else if (lgfld->ibmap == 254)
         {
-            numfld = numfld + 1;
-            if (numfld == ifldnum)
-            {
-                lgfld->discipline = disc;
-                lgfld->version = ver;
-                lgfld->ifldnum = ifldnum;
-                lgfld->unpacked = unpack;
-                lgfld->expanded = 0;
-                iofst = iofst - 40;       /* reset offset to beginning of section */
-                if (g2_unpack4(cgrib, &iofst, &lgfld->ipdtnum, &lgfld->ipdtmpl,
-                               &lgfld->ipdtlen, &lgfld->coord_list, &lgfld->num_coord))
-                {
-                    g2_free(lgfld);
-                    return G2_GETFLD_BAD_SEC4;
-                }
-
-                have4 = 1;
-            }
+            g2c_log_stdout("g2_getfld: Prev bit-map specified, but none exist.\n");
+            g2_free(lgfld);
+            return G2_GETFLD_NO_BITMAP;
         }
+        lgfld->bmap_fmt = fmt;
+    }
 
-        /*   If found Section 5, check to see if this field is the one
-         *   requested. */
-        if (isecnum == 5 && numfld == ifldnum)
+    /* Unpack the data of the field. */
+    if (unpack)
+    {
+        /* If the field is to be expanded to the grid, unpack each
+         * value straight to its grid point. */
+        gridp = NULL;
+        if (expand == 1 && lgfld->ibmap != 255 && (lgfld->bmap || lgfld->cbmap) &&
+            lgfld->ndpts <= lgfld->ngrdpts)
         {
-            iofst = iofst - 40;       /* reset offset to beginning of section */
-            if (g2_unpack5(cgrib, &iofst, &lgfld->ndpts, &lgfld->idrtnum,
-                           &lgfld->idrtmpl, &lgfld->idrtlen))
-            {
-                g2_free(lgfld);
-                return G2_GETFLD_BAD_SEC5;
-            }
-
-            have5 = 1;
+            grid.fmt = lgfld->cbmap ? lgfld->bmap_fmt : G2C_BMAP_G2INT;
+            grid.bmap = lgfld->cbmap ? (void *)lgfld->cbmap : (void *)lgfld->bmap;
+            grid.npts = lgfld->ngrdpts;
+            grid.fill = 0;
+            gridp = &grid;
         }
 
-        /*   If found Section 6, Unpack bitmap. Save in case this is
-         *   the latest bitmap before the requested field. */
-        if (isecnum == 6)
+        /* Unpack to the caller's array, if there is room, or to the
+         * arena. */
+        nout = gridp ? lgfld->ngrdpts : lgfld->ndpts;
+        if (fld && nout > fldlen)
         {
-            if (unpack)
-            {   /* unpack bitmap */
-                iofst = iofst - 40;           /* reset offset to beginning of section */
-                bmpsave = lgfld->bmap;      /* save pointer to previous bitmap */
-                if (g2_unpack6(cgrib, &iofst, lgfld->ngrdpts, &lgfld->ibmap,
-                               &lgfld->bmap))
-                {
-                    g2_free(lgfld);
-                    return G2_GETFLD_BAD_SEC6;
-                }
-
-                have6 = 1;
-                if (lgfld->ibmap == 254)     /* use previously specified bitmap */
-                {
-                    if (bmpsave)
-                        lgfld->bmap = bmpsave;
-                    else
-                    {
-                        printf("g2_getfld: Prev bit-map specified, but none exist.\n");
-                        return G2_GETFLD_NO_BITMAP;
-                    }
-                }
-                else                         /* get rid of it */
-                    if (bmpsave)
-                        free(bmpsave);
-            }
-            else
-            {    /* do not unpack bitmap */
-                gbit(cgrib, &lgfld->ibmap, iofst, 8);      /* Get BitMap Indicator */
-                have6 = 1;
-            }
+            g2_free(lgfld);
+            return G2C_ESIZE;
         }
-
-        /*   If found Section 7, check to see if this field is the one
-         *   requested. */
-        if (isecnum == 7 && numfld == ifldnum && unpack)
+        if (!fld && arena)
         {
-            iofst = iofst - 40;       /* reset offset to beginning of section */
-            if ((jerr = g2_unpack7(cgrib, &iofst, lgfld->igdtnum, lgfld->igdtmpl,
-                                   lgfld->idrtnum, lgfld->idrtmpl, lgfld->ndpts,
-                                   &lgfld->fld)))
+            if (!(lgfld->fld = g2c_arena_alloc(arena, nout * sizeof(g2float))))
             {
-                printf("g2_getfld: return from g2_unpack7 = %d \n", (int)jerr);
                 g2_free(lgfld);
-                return G2_GETFLD_BAD_SEC7;
-            }
-
-            have7 = 1;
-
-            /*  If bitmap is used with this field,  expand data field */
-            /*  to grid, if possible. */
-            if (lgfld->ibmap != 255 && lgfld->bmap != 0)
-            {
-                if (expand == 1)
-                {
-                    n = 0;
-                    newfld = calloc(lgfld->ngrdpts, sizeof(g2float));
-                    for (j = 0; j < lgfld->ngrdpts; j++)
-                    {
-                        if (lgfld->bmap[j] == 1)
-                            newfld[j] = lgfld->fld[n++];
-                    }
-                    free(lgfld->fld);
-                    lgfld->fld = newfld;
-                    lgfld->expanded = 1;
-                }
-                else
-                {
-                    lgfld->expanded = 0;
-                }
-            }
-            else
-            {
-                lgfld->expanded = 1;
+                return G2C_ENOMEM;
             }
+            fld = lgfld->fld;
         }
 
-        /* Check to see if we read pass the end of the GRIB message
-         * and missed the terminator string '7777'. */
-        ipos = ipos + lensec;                /* Update beginning of section pointer */
-        if (ipos > istart + lengrib)
+        iofst = fs->sec[7] * 8;
+        if (fld)
+            jerr = g2c_unpack7_into(cgrib, &iofst, lgfld->igdtnum, lgfld->igdtmpl,
+                                    lgfld->idrtnum, lgfld->idrtmpl, lgfld->ndpts,
+                                    gridp, fld, dec);
+        else
+            jerr = g2c_unpack7(cgrib, &iofst, lgfld->igdtnum, lgfld->igdtmpl,
+                               lgfld->idrtnum, lgfld->idrtmpl, lgfld->ndpts,
+                               gridp, &lgfld->fld, dec);
+        if (jerr)
         {
-            printf("g2_getfld: '7777'  not found at end of GRIB message.\n");
+            g2c_log_stdout("g2_getfld: return from g2_unpack7 = %d \n", (int)jerr);
             g2_free(lgfld);
-            return G2_GETFLD_BAD_END;
+            return G2_GETFLD_BAD_SEC7;
         }
 
-        /*  If unpacking requested, return when all sections have been
-         *  processed. */
-        if (unpack && have3 && have4 && have5 && have6 && have7)
-            return G2_NO_ERROR;
-
-        /*  If unpacking is not requested, return when sections 3
-         *  through 6 have been processed. */
-        if (!unpack && have3 && have4 && have5 && have6)
-            return G2_NO_ERROR;
+        /*  If bitmap is used with this field, the data field */
+        /*  was expanded to the grid, if possible. */
+        if (lgfld->ibmap != 255 && (lgfld->bmap || lgfld->cbmap))
+            lgfld->expanded = gridp ? 1 : 0;
+        else
+            lgfld->expanded = 1;
     }
 
-    /*  If exited from above loop, the end of the GRIB message was
-     *  reached before the requested field was found. */
-    printf("g2_getfld: GRIB message contained %ld different fields.\n", numfld);
-    printf("g2_getfld: The request was for field %ld.\n", ifldnum);
-    g2_free(lgfld);
-    return G2_GETFLD_WRONG_NFLDS;
+    *gfld = lgfld;
+    return G2_NO_ERROR;
 }
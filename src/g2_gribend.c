@@ -71,9 +71,9 @@ g2int g2_gribend(unsigned char *cgrib)
          *    total length, then there is a problem. */
         if (len > lencurr)
         {
-            printf("g2_gribend: Section byte counts don''t add to total.\n");
-            printf("g2_gribend: Sum of section byte counts  =  %d\n", (int)len);
-            printf("g2_gribend: Total byte count in Section 0 = %d\n", (int)lencurr);
+            g2c_log_stdout("g2_gribend: Section byte counts don''t add to total.\n");
+            g2c_log_stdout("g2_gribend: Sum of section byte counts  =  %d\n", (int)len);
+            g2c_log_stdout("g2_gribend: Total byte count in Section 0 = %d\n", (int)lencurr);
             return G2_BAD_SEC_COUNTS;
         }
     }
@@ -81,8 +81,8 @@ g2int g2_gribend(unsigned char *cgrib)
     /* Can only add End Section (Section 8) after Section 7. */
     if (isecnum != 7 )
     {
-        printf("g2_gribend: Section 8 can only be added after Section 7.\n");
-        printf("g2_gribend: Section %ld was the last found in given GRIB message.\n", isecnum);
+        g2c_log_stdout("g2_gribend: Section 8 can only be added after Section 7.\n");
+        g2c_log_stdout("g2_gribend: Section %ld was the last found in given GRIB message.\n", isecnum);
         return G2_BAD_SEC;
     }
 
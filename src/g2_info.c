@@ -88,7 +88,7 @@ g2_info(unsigned char *cgrib, g2int *listsec0, g2int *listsec1,
     }
     if (istart == -1)
     {
-        printf("g2_info:  Beginning characters GRIB not found.");
+        g2c_log_stdout("g2_info:  Beginning characters GRIB not found.");
         return G2_INFO_NO_GRIB;
     }
 
@@ -108,7 +108,7 @@ g2_info(unsigned char *cgrib, g2int *listsec0, g2int *listsec1,
     /*  Currently handles only GRIB Edition 2. */
     if (listsec0[1] != 2)
     {
-        printf("g2_info: can only decode GRIB edition 2.");
+        g2c_log_stdout("g2_info: can only decode GRIB edition 2.");
         return G2_INFO_GRIB_VERSION;
     }
 
@@ -119,7 +119,7 @@ g2_info(unsigned char *cgrib, g2int *listsec0, g2int *listsec1,
     iofst = iofst + 8;
     if (isecnum != 1)
     {
-        printf("g2_info: Could not find section 1.");
+        g2c_log_stdout("g2_info: Could not find section 1.");
         return G2_INFO_NO_SEC1;
     }
 
@@ -145,7 +145,7 @@ g2_info(unsigned char *cgrib, g2int *listsec0, g2int *listsec1,
             ipos = ipos + 4;
             if (ipos != (istart + lengrib))
             {
-                printf("g2_info: '7777' found, but not where expected.\n");
+                g2c_log_stdout("g2_info: '7777' found, but not where expected.\n");
                 return G2_INFO_WRONG_END;
             }
             break;
@@ -159,7 +159,7 @@ g2_info(unsigned char *cgrib, g2int *listsec0, g2int *listsec1,
         ipos = ipos + lensec;                 /* Update beginning of section pointer */
         if (ipos > (istart + lengrib))
         {
-            printf("g2_info: '7777'  not found at end of GRIB message.\n");
+            g2c_log_stdout("g2_info: '7777'  not found at end of GRIB message.\n");
             return G2_INFO_BAD_END;
         }
         if (isecnum >= 2 && isecnum <= 7)
@@ -173,7 +173,7 @@ g2_info(unsigned char *cgrib, g2int *listsec0, g2int *listsec1,
         }
         else
         {
-            printf("g2_info: Invalid section number found in GRIB message: %ld\n", isecnum);
+            g2c_log_stdout("g2_info: Invalid section number found in GRIB message: %ld\n", isecnum);
             return G2_INFO_INVAL_SEC;
         }
     }
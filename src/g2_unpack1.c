@@ -53,6 +53,25 @@
  */
 g2int
 g2_unpack1(unsigned char *cgrib, g2int *iofst, g2int **ids, g2int *idslen)
+{
+    return g2c_unpack1(cgrib, iofst, ids, idslen, NULL);
+}
+
+/**
+ * Unpack Section 1 like g2_unpack1(), with the arrays allocated from
+ * an arena.
+ *
+ * @param cgrib char array containing Section 1 of the GRIB2 message.
+ * @param iofst Bit offset for the beginning of Section 1 in cgrib.
+ * @param ids Pointer that gets the array of values from Section 1.
+ * @param idslen Number of elements in ids.
+ * @param arena The arena, or NULL to allocate from the heap.
+ *
+ * @return As for g2_unpack1().
+ */
+g2int
+g2c_unpack1(unsigned char *cgrib, g2int *iofst, g2int **ids, g2int *idslen,
+            g2c_arena *arena)
 {
 
     g2int i, lensec, nbits, isecnum;
@@ -70,14 +89,14 @@ g2_unpack1(unsigned char *cgrib, g2int *iofst, g2int **ids, g2int *idslen)
     if (isecnum != 1)
     {
         *idslen = 13;
-        fprintf(stderr, "g2_unpack1: Not Section 1 data.\n");
+        g2c_log("g2_unpack1: Not Section 1 data.\n");
         return G2_UNPACK_BAD_SEC;
     }
 
     /* Unpack each value into array ids from the appropriate number of
      * octets, which are specified in` corresponding entries in array
      * mapid. */
-    if (!(*ids = calloc(*idslen, sizeof(g2int))))
+    if (!(*ids = g2c_arena_alloc(arena, *idslen * sizeof(g2int))))
         return G2_UNPACK_NO_MEM;
 
     for (i = 0; i < *idslen; i++)
@@ -37,6 +37,26 @@
 g2int
 g2_unpack2(unsigned char *cgrib, g2int *iofst, g2int *lencsec2,
            unsigned char **csec2)
+{
+    return g2c_unpack2(cgrib, iofst, lencsec2, csec2, NULL);
+}
+
+/**
+ * Unpack Section 2 like g2_unpack2(), with the arrays allocated from
+ * an arena.
+ *
+ * @param cgrib char array containing Section 2 of the GRIB2 message.
+ * @param iofst Pointer that contains the bit offset for the beginning
+ * of Section 2 in cgrib. The modified version will be returned.
+ * @param lencsec2 Length (in octets) of Local Use data.
+ * @param csec2 Pointer that gets the local use data.
+ * @param arena The arena, or NULL to allocate from the heap.
+ *
+ * @return As for g2_unpack2().
+ */
+g2int
+g2c_unpack2(unsigned char *cgrib, g2int *iofst, g2int *lencsec2,
+            unsigned char **csec2, g2c_arena *arena)
 {
     g2int isecnum;
     g2int lensec, ipos, j;
@@ -57,7 +77,7 @@ g2_unpack2(unsigned char *cgrib, g2int *iofst, g2int *lencsec2,
     if (isecnum != 2)
     {
         *lencsec2 = 0;
-        fprintf(stderr, "g2_unpack2: Not Section 2 data.\n");
+        g2c_log("g2_unpack2: Not Section 2 data.\n");
         return G2_UNPACK_BAD_SEC;
     }
 
@@ -65,7 +85,7 @@ g2_unpack2(unsigned char *cgrib, g2int *iofst, g2int *lencsec2,
     if (*lencsec2 == 0)
         return G2_NO_ERROR;
 
-    if (!(*csec2 = malloc(*lencsec2)))
+    if (!(*csec2 = g2c_arena_alloc(arena, *lencsec2)))
     {
         *lencsec2 = 0;
         return G2_UNPACK_NO_MEM;
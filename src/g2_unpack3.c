@@ -56,11 +56,37 @@
 g2int
 g2_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
            g2int *mapgridlen, g2int **ideflist, g2int *idefnum)
+{
+    return g2c_unpack3(cgrib, iofst, igds, igdstmpl, mapgridlen, ideflist, idefnum,
+                       NULL);
+}
+
+/**
+ * Unpack Section 3 like g2_unpack3(), with the arrays allocated from
+ * an arena.
+ *
+ * @param cgrib Char array ontaining Section 3 of the GRIB2 message.
+ * @param iofst Bit offset for the beginning of Section 3 in cgrib.
+ * @param igds Pointer that gets the array of 5 values from the start
+ * of Section 3.
+ * @param igdstmpl Pointer that gets the Grid Definition Template
+ * values.
+ * @param mapgridlen Number of elements in igdstmpl.
+ * @param ideflist Pointer that gets the optional list of numbers of
+ * points, if igds[2] is not 0.
+ * @param idefnum Number of elements in ideflist.
+ * @param arena The arena, or NULL to allocate from the heap.
+ *
+ * @return As for g2_unpack3().
+ */
+g2int
+g2c_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
+            g2int *mapgridlen, g2int **ideflist, g2int *idefnum, g2c_arena *arena)
 {
     g2int i, j, nbits, isecnum;
     g2int lensec, ibyttem = 0, isign, newlen;
     g2int *ligds, *ligdstmpl = NULL, *lideflist = NULL;
-    gtemplate *mapgrid;
+    gtemplate tmpl, *mapgrid = &tmpl;
 
     *igds = NULL;
     *igdstmpl = NULL;
@@ -78,7 +104,8 @@ g2_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
         return G2_UNPACK_BAD_SEC;
     }
 
-    ligds = calloc(5, sizeof(g2int));
+    if (!(ligds = g2c_arena_alloc(arena, 5 * sizeof(g2int))))
+        return G2_UNPACK_NO_MEM;
     *igds = ligds;
 
     gbit(cgrib, &ligds[0], *iofst, 8);     /* Get source of Grid def. */
@@ -95,9 +122,10 @@ g2_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
     if (ligds[4] != 65535)
     {
         /*   Get Grid Definition Template */
-        if (!(mapgrid = getgridtemplate(ligds[4])))
+        if (g2c_gridtemplate(ligds[4], &tmpl))
         {         /* undefined template */
-            free(ligds);
+            g2c_arena_free(arena, ligds);
+            *igds = NULL;
             return G2_UNPACK3_BAD_GDT;
         }
         *mapgridlen = mapgrid->maplen;
@@ -107,12 +135,10 @@ g2_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
          *   corresponding entries in array mapgrid. */
         if (*mapgridlen > 0)
         {
-            if (!(ligdstmpl = calloc(*mapgridlen, sizeof(g2int))))
+            if (!(ligdstmpl = g2c_arena_alloc(arena, *mapgridlen * sizeof(g2int))))
             {
                 *mapgridlen = 0;
                 *igdstmpl = NULL;
-                if (mapgrid)
-                    free(mapgrid);
                 return G2_UNPACK_NO_MEM;
             }
             *igdstmpl = ligdstmpl;
@@ -142,11 +168,11 @@ g2_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
          *   the gtemplate. */
         if (mapgrid->needext == 1)
         {
-            free(mapgrid);
             mapgrid = extgridtemplate(ligds[4], ligdstmpl);
             /*   Unpack the rest of the Grid Definition Template */
             newlen = mapgrid->maplen + mapgrid->extlen;
-            ligdstmpl = realloc(ligdstmpl, newlen * sizeof(g2int));
+            ligdstmpl = g2c_arena_realloc(arena, ligdstmpl, *mapgridlen * sizeof(g2int),
+                                          newlen * sizeof(g2int));
             *igdstmpl = ligdstmpl;
             j = 0;
             for (i = *mapgridlen; i < newlen; i++)
@@ -169,10 +195,11 @@ g2_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
             }
             *mapgridlen = newlen;
         }
-        if (mapgrid->ext)
-            free(mapgrid->ext);
-        if (mapgrid)
-            free(mapgrid);
+        if (mapgrid != &tmpl)
+        {
+            g2c_free(mapgrid->ext);
+            g2c_free(mapgrid);
+        }
     }
     else
     {              /* No Grid Definition Template */
@@ -188,7 +215,7 @@ g2_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
         nbits = ligds[2] * 8;
         *idefnum = (lensec - 14 - ibyttem) / ligds[2];
         if (*idefnum > 0)
-            lideflist = calloc(*idefnum, sizeof(g2int));
+            lideflist = g2c_arena_alloc(arena, *idefnum * sizeof(g2int));
         if (!lideflist)
         {
             *idefnum = 0;
@@ -46,13 +46,39 @@ g2int
 g2_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
            g2int *mappdslen, g2float **coordlist, g2int *numcoord)
 {
+    return g2c_unpack4(cgrib, iofst, ipdsnum, ipdstmpl, mappdslen, coordlist, numcoord,
+                       NULL);
+}
+
+/**
+ * Unpack Section 4 like g2_unpack4(), with the arrays allocated from
+ * an arena. The temporary array of coordinate values
+ * still comes from the heap.
+ *
+ * @param cgrib Array containing Section 4 of the GRIB2 message.
+ * @param iofst Bit offset of the beginning of Section 4 in
+ * cgrib. Returned with updated bit offset.
+ * @param ipdsnum Product Definition Template Number.
+ * @param ipdstmpl Pointer that gets the Product Definition Template
+ * values.
+ * @param mappdslen Number of elements in ipdstmpl.
+ * @param coordlist Pointer that gets the vertical coordinate values.
+ * @param numcoord number of values in array coordlist.
+ * @param arena The arena, or NULL to allocate from the heap.
+ *
+ * @return As for g2_unpack4().
+ */
+g2int
+g2c_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
+            g2int *mappdslen, g2float **coordlist, g2int *numcoord, g2c_arena *arena)
+{
 
     g2int needext, i, j, nbits, isecnum;
     g2int lensec, isign, newlen;
     g2int *coordieee;
     g2int *lipdstmpl = 0;
     g2float *lcoordlist;
-    gtemplate *mappds;
+    gtemplate tmpl, *mappds = &tmpl;
 
     *ipdstmpl = NULL;
     *coordlist = NULL;
@@ -75,7 +101,7 @@ g2_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
     *iofst = *iofst + 16;
 
     /* Get Product Definition Template */
-    if (!(mappds = getpdstemplate(*ipdsnum)))
+    if (g2c_pdstemplate(*ipdsnum, &tmpl))
     {
         *mappdslen = 0;
         return G2_UNPACK4_BAD_PDT;
@@ -87,13 +113,11 @@ g2_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
      * appropriate number of octets, which are specified in
      * corresponding entries in array mappds. */
     if (*mappdslen > 0)
-        lipdstmpl = calloc(*mappdslen, sizeof(g2int));
+        lipdstmpl = g2c_arena_alloc(arena, *mappdslen * sizeof(g2int));
     if (!lipdstmpl)
     {
         *mappdslen = 0;
         *ipdstmpl = NULL;
-        if (mappds)
-            free(mappds);
         return G2_UNPACK_NO_MEM;
     }
     *ipdstmpl = lipdstmpl;
@@ -120,10 +144,10 @@ g2_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
      * gtemplate. */
     if (needext == 1)
     {
-        free(mappds);
         mappds = extpdstemplate(*ipdsnum, lipdstmpl);
         newlen = mappds->maplen+mappds->extlen;
-        lipdstmpl = realloc(lipdstmpl, newlen * sizeof(g2int));
+        lipdstmpl = g2c_arena_realloc(arena, lipdstmpl, *mappdslen * sizeof(g2int),
+                                      newlen * sizeof(g2int));
         *ipdstmpl = lipdstmpl;
         /*   Unpack the rest of the Product Definition Template */
         j = 0;
@@ -146,26 +170,27 @@ g2_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
         }
         *mappdslen = newlen;
     }
-    if (mappds->ext)
-        free(mappds->ext);
-    if (mappds)
-        free(mappds);
+    if (mappds != &tmpl)
+    {
+        g2c_free(mappds->ext);
+        g2c_free(mappds);
+    }
 
     /* Get Optional list of vertical coordinate values after the
      * Product Definition Template, if necessary. */
     *coordlist = NULL;
     if (*numcoord != 0)
     {
-        coordieee = calloc(*numcoord, sizeof(g2int));
-        lcoordlist = calloc(*numcoord, sizeof(g2float));
+        coordieee = g2c_calloc(*numcoord, sizeof(g2int));
+        lcoordlist = g2c_arena_alloc(arena, *numcoord * sizeof(g2float));
         if (coordieee == 0 || lcoordlist == 0)
         {
             *numcoord = 0;
             *coordlist = NULL;
             if (coordieee)
-                free(coordieee);
+                g2c_free(coordieee);
             if (lcoordlist)
-                free(lcoordlist);
+                g2c_arena_free(arena, lcoordlist);
             return G2_UNPACK_NO_MEM;
         }
         else
@@ -174,7 +199,7 @@ g2_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
         }
         gbits(cgrib, coordieee, *iofst, 32, 0, *numcoord);
         rdieee(coordieee, *coordlist, *numcoord);
-        free(coordieee);
+        g2c_free(coordieee);
         *iofst = *iofst + (32 * (*numcoord));
     }
 
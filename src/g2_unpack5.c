@@ -41,11 +41,34 @@
 g2int
 g2_unpack5(unsigned char *cgrib, g2int *iofst, g2int *ndpts, g2int *idrsnum,
            g2int **idrstmpl, g2int *mapdrslen)
+{
+    return g2c_unpack5(cgrib, iofst, ndpts, idrsnum, idrstmpl, mapdrslen, NULL);
+}
+
+/**
+ * Unpack Section 5 like g2_unpack5(), with the arrays allocated from
+ * an arena.
+ *
+ * @param cgrib char array containing Section 5 of the GRIB2 message.
+ * @param iofst Bit offset for the beginning of Section 5 in
+ * cgrib. Returned with bit offset at the end of Section 5.
+ * @param ndpts Number of data points unpacked and returned.
+ * @param idrsnum Data Representation Template Number.
+ * @param idrstmpl Pointer that gets the Data Representation Template
+ * values.
+ * @param mapdrslen Number of elements in idrstmpl.
+ * @param arena The arena, or NULL to allocate from the heap.
+ *
+ * @return As for g2_unpack5().
+ */
+g2int
+g2c_unpack5(unsigned char *cgrib, g2int *iofst, g2int *ndpts, g2int *idrsnum,
+            g2int **idrstmpl, g2int *mapdrslen, g2c_arena *arena)
 {
     g2int needext, i, j, nbits, isecnum;
     g2int lensec, isign, newlen;
     g2int *lidrstmpl = 0;
-    gtemplate *mapdrs;
+    gtemplate tmpl, *mapdrs = &tmpl;
 
     *idrstmpl = 0;       /* NULL*/
 
@@ -67,7 +90,7 @@ g2_unpack5(unsigned char *cgrib, g2int *iofst, g2int *ndpts, g2int *idrsnum,
     *iofst = *iofst + 16;
 
     /*   Gen Data Representation Template */
-    if (!(mapdrs = getdrstemplate(*idrsnum)))
+    if (g2c_drstemplate(*idrsnum, &tmpl))
     {
         *mapdrslen = 0;
         return G2_UNPACK5_BAD_DRT;
@@ -79,13 +102,11 @@ g2_unpack5(unsigned char *cgrib, g2int *iofst, g2int *ndpts, g2int *idrsnum,
      * number of octets, which are specified in corresponding
      * entries in array mapdrs. */
     if (*mapdrslen > 0)
-        lidrstmpl = calloc(*mapdrslen, sizeof(g2int));
+        lidrstmpl = g2c_arena_alloc(arena, *mapdrslen * sizeof(g2int));
     if (!lidrstmpl)
     {
         *mapdrslen = 0;
         *idrstmpl = NULL;
-        if (mapdrs)
-            free(mapdrs);
         return G2_UNPACK_NO_MEM;
     }
     else
@@ -115,10 +136,10 @@ g2_unpack5(unsigned char *cgrib, g2int *iofst, g2int *ndpts, g2int *idrsnum,
      * gtemplate. */
     if (needext == 1)
     {
-        free(mapdrs);
         mapdrs = extdrstemplate(*idrsnum, lidrstmpl);
         newlen = mapdrs->maplen + mapdrs->extlen;
-        lidrstmpl = realloc(lidrstmpl, newlen * sizeof(g2int));
+        lidrstmpl = g2c_arena_realloc(arena, lidrstmpl, *mapdrslen * sizeof(g2int),
+                                      newlen * sizeof(g2int));
         *idrstmpl = lidrstmpl;
 
         /*   Unpack the rest of the Data Representation Template */
@@ -142,10 +163,11 @@ g2_unpack5(unsigned char *cgrib, g2int *iofst, g2int *ndpts, g2int *idrsnum,
         }
         *mapdrslen = newlen;
     }
-    if (mapdrs->ext)
-        free(mapdrs->ext);
-    if (mapdrs)
-        free(mapdrs);
+    if (mapdrs != &tmpl)
+    {
+        g2c_free(mapdrs->ext);
+        g2c_free(mapdrs);
+    }
 
     return G2_NO_ERROR;
 }
@@ -33,9 +33,43 @@ g2int
 g2_unpack6(unsigned char *cgrib, g2int *iofst, g2int ngpts, g2int *ibmap,
            g2int **bmap)
 {
-    g2int j, isecnum;
-    g2int *lbmap = 0;
-    g2int *intbmap;
+    void *lbmap;
+    g2int ret;
+
+    ret = g2c_unpack6(cgrib, iofst, ngpts, ibmap, G2C_BMAP_G2INT, &lbmap, NULL);
+    *bmap = lbmap;
+    return ret;
+}
+
+/**
+ * Unpack Section 6 (Bit-Map Section), keeping the bitmap in the
+ * requested format.
+ *
+ * @param cgrib char array containing Section 6 of the GRIB2 message.
+ * @param iofst Bit offset of the beginning of Section 6 in cgrib.
+ * @param ngpts Number of grid points specified in the bit-map
+ * @param ibmap Bitmap indicator (see Code Table 6.0).
+ * @param fmt Bitmap format, one of ::G2C_BMAP_G2INT (array of
+ * g2int), ::G2C_BMAP_UINT8 (array of unsigned char, 0 or 1) or
+ * ::G2C_BMAP_BITS (the bits as stored in Section 6, with unused bits
+ * of the last byte set to 0).
+ * @param bmap Pointer that gets the decoded bitmap, if ibmap=0,
+ * otherwise NULL. Free it when done.
+ * @param arena The arena to allocate the bitmap from, or NULL to
+ * allocate it from the heap.
+ *
+ * @return
+ * - ::G2_NO_ERROR No error.
+ * - ::G2_UNPACK_BAD_SEC Array passed had incorrect section number.
+ * - ::G2_UNPACK_NO_MEM Memory allocation error.
+ */
+g2int
+g2c_unpack6(unsigned char *cgrib, g2int *iofst, g2int ngpts, g2int *ibmap,
+            int fmt, void **bmap, g2c_arena *arena)
+{
+    g2int isecnum;
+    size_t size;
+    void *lbmap = NULL;
 
     *bmap = NULL;
 
@@ -45,7 +79,7 @@ g2_unpack6(unsigned char *cgrib, g2int *iofst, g2int ngpts, g2int *ibmap,
 
     if (isecnum != 6)
     {
-        fprintf(stderr, "g2_unpack6: Not Section 6 data.\n");
+        g2c_log("g2_unpack6: Not Section 6 data.\n");
         return G2_UNPACK_BAD_SEC;
     }
 
@@ -54,18 +88,25 @@ g2_unpack6(unsigned char *cgrib, g2int *iofst, g2int ngpts, g2int *ibmap,
 
     if (*ibmap == 0)
     {               /* Unpack bitmap */
+        if (fmt == G2C_BMAP_BITS)
+            size = (ngpts + 7) / 8;
+        else if (fmt == G2C_BMAP_UINT8)
+            size = ngpts;
+        else
+            size = ngpts * sizeof(g2int);
         if (ngpts > 0)
-            lbmap = calloc(ngpts, sizeof(g2int));
+            lbmap = g2c_arena_alloc(arena, size);
         if (!lbmap)
             return G2_UNPACK_NO_MEM;
 
         *bmap = lbmap;
-        intbmap = calloc(ngpts, sizeof(g2int));
-        gbits(cgrib, intbmap, *iofst, 1, 0, ngpts);
+        if (fmt == G2C_BMAP_BITS)
+            g2c_bitmap_copy(cgrib, *iofst, ngpts, lbmap);
+        else if (fmt == G2C_BMAP_UINT8)
+            g2c_bitmap_expand8(cgrib, *iofst, ngpts, lbmap);
+        else
+            g2c_bitmap_expand(cgrib, *iofst, ngpts, lbmap);
         *iofst = *iofst + ngpts;
-        for (j = 0; j < ngpts; j++)
-            lbmap[j] = (g2int)intbmap[j];
-        free(intbmap);
     }
 
     return G2_NO_ERROR;
@@ -55,11 +55,95 @@ g2int
 g2_unpack7(unsigned char *cgrib, g2int *iofst, g2int igdsnum, g2int *igdstmpl,
            g2int idrsnum, g2int *idrstmpl, g2int ndpts, g2float **fld)
 {
-    g2int isecnum;
-    g2int ipos, lensec;
+    return g2c_unpack7(cgrib, iofst, igdsnum, igdstmpl, idrsnum, idrstmpl,
+                       ndpts, NULL, fld, NULL);
+}
+
+/**
+ * Unpack Section 7 (Data Section), like g2_unpack7(), optionally
+ * writing the data values straight to their grid points, using a
+ * bitmap. This saves allocating a separate array of the data values
+ * and expanding it to the grid afterwards.
+ *
+ * @param cgrib char array containing Section 7 of the GRIB2 message
+ * @param iofst Bit offset of the beginning of Section 7 in cgrib.
+ * @param igdsnum Grid Definition Template Number (Only used for DRS
+ * Template 5.51)
+ * @param igdstmpl Pointer to an integer array containing the data
+ * values for the specified Grid Definition Template (Only used for
+ * DRS Template 5.51).
+ * @param idrsnum Data Representation Template Number.
+ * @param idrstmpl Pointer to an integer array containing the data
+ * values for the specified Data Representation Template.
+ * @param ndpts Number of data points unpacked.
+ * @param grid NULL, or pointer to the grid and bitmap to unpack
+ * to. ndpts must not be more than grid->npts.
+ * @param fld Pointer that gets an array of the ndpts data values, or
+ * of the grid->npts grid points if grid is not NULL.
+ * @param dec Decoder whose scratch arrays are used for unpacking, or
+ * NULL to allocate them for this call.
+ *
+ * @return
+ * - ::G2_NO_ERROR No error.
+ * - ::G2_UNPACK_BAD_SEC Not section 7.
+ * - ::G2_UNPACK_NO_MEM Memory allocation error.
+ * - ::G2_UNPACK7_CORRUPT_SEC Corrupt section 7.
+ * - ::G2_UNPACK7_WRONG_GDT Need one of GDT 3.50 through 3.53 to decode DRS 5.51.
+ * - ::G2_UNPACK7_BAD_DRT Unsupported DRS template.
+ */
+g2int
+g2c_unpack7(unsigned char *cgrib, g2int *iofst, g2int igdsnum, g2int *igdstmpl,
+            g2int idrsnum, g2int *idrstmpl, g2int ndpts, g2c_grid *grid,
+            g2float **fld, g2c_decoder *dec)
+{
+    g2int nalloc, ret;
     g2float *lfld;
 
     *fld = NULL;
+    nalloc = grid ? grid->npts : ndpts;
+    if (!(lfld = g2c_calloc(nalloc ? nalloc : 1, sizeof(g2float))))
+        return G2_UNPACK_NO_MEM;
+    if ((ret = g2c_unpack7_into(cgrib, iofst, igdsnum, igdstmpl, idrsnum, idrstmpl,
+                                ndpts, grid, lfld, dec)))
+    {
+        g2c_free(lfld);
+        return ret;
+    }
+    *fld = lfld;
+    return G2_NO_ERROR;
+}
+
+/**
+ * Unpack Section 7 (Data Section) into an array supplied by the
+ * caller, like g2c_unpack7(), without allocating the array.
+ *
+ * @param cgrib char array containing Section 7 of the GRIB2 message
+ * @param iofst Bit offset of the beginning of Section 7 in cgrib.
+ * @param igdsnum Grid Definition Template Number (Only used for DRS
+ * Template 5.51)
+ * @param igdstmpl Pointer to an integer array containing the data
+ * values for the specified Grid Definition Template (Only used for
+ * DRS Template 5.51).
+ * @param idrsnum Data Representation Template Number.
+ * @param idrstmpl Pointer to an integer array containing the data
+ * values for the specified Data Representation Template.
+ * @param ndpts Number of data points unpacked.
+ * @param grid NULL, or pointer to the grid and bitmap to unpack
+ * to. ndpts must not be more than grid->npts.
+ * @param fld Array that gets the ndpts data values, or the
+ * grid->npts grid points if grid is not NULL.
+ * @param dec Decoder whose scratch arrays are used for unpacking, or
+ * NULL to allocate them for this call.
+ *
+ * @return As for g2c_unpack7().
+ */
+g2int
+g2c_unpack7_into(unsigned char *cgrib, g2int *iofst, g2int igdsnum, g2int *igdstmpl,
+                 g2int idrsnum, g2int *idrstmpl, g2int ndpts, g2c_grid *grid,
+                 g2float *fld, g2c_decoder *dec)
+{
+    g2int isecnum;
+    g2int ipos, lensec, nalloc;
 
     gbit(cgrib, &lensec, *iofst, 32);        /* Get Length of Section */
     *iofst = *iofst + 32;
@@ -70,57 +154,59 @@ g2_unpack7(unsigned char *cgrib, g2int *iofst, g2int igdsnum, g2int *igdstmpl,
         return G2_UNPACK_BAD_SEC;
 
     ipos = *iofst / 8;
-    if (!(lfld = calloc(ndpts ? ndpts : 1, sizeof(g2float))))
-        return G2_UNPACK_NO_MEM;
-
-    *fld = lfld;
+    nalloc = grid ? grid->npts : ndpts;
 
     if (idrsnum == 0)
-        simunpack(cgrib + ipos, idrstmpl, ndpts, lfld);
+        g2c_simunpack(cgrib + ipos, idrstmpl, ndpts, grid, fld);
     else if (idrsnum == 2 || idrsnum == 3)
     {
-        if (comunpack(cgrib+ipos, lensec, idrsnum, idrstmpl, ndpts, lfld))
+        if (g2c_comunpack(cgrib+ipos, lensec, idrsnum, idrstmpl, ndpts, grid, fld, dec))
             return G2_UNPACK7_CORRUPT_SEC;
     }
     else if (idrsnum == 50)
     {            /* Spectral Simple */
-        simunpack(cgrib + ipos, idrstmpl, ndpts - 1, lfld + 1);
-        rdieee(idrstmpl + 4, lfld, 1);
+        simunpack(cgrib + ipos, idrstmpl, ndpts - 1, fld + nalloc - ndpts + 1);
+        rdieee(idrstmpl + 4, fld + nalloc - ndpts, 1);
+        if (grid)
+            g2c_expand_tail(grid, ndpts, fld);
     }
     else if (idrsnum == 51)              /* Spectral complex */
     {
         if (igdsnum >= 50 && igdsnum <= 53)
+        {
             specunpack(cgrib + ipos, idrstmpl, ndpts, igdstmpl[0], igdstmpl[2],
-                       igdstmpl[2], lfld);
+                       igdstmpl[2], fld + nalloc - ndpts);
+            if (grid)
+                g2c_expand_tail(grid, ndpts, fld);
+        }
         else
         {
-            fprintf(stderr, "g2_unpack7: Cannot use GDT 3.%d to unpack Data Section 5.51.\n",
+            g2c_log("g2_unpack7: Cannot use GDT 3.%d to unpack Data Section 5.51.\n",
                     (int)igdsnum);
-            if (lfld)
-                free(lfld);
-            *fld = NULL;
             return G2_UNPACK7_WRONG_GDT;
         }
     }
 #if defined USE_JPEG2000 || defined USE_OPENJPEG
     else if (idrsnum == 40 || idrsnum == 40000)
     {
-        jpcunpack(cgrib + ipos, lensec - 5, idrstmpl, ndpts, lfld);
+        if (g2c_jpcunpack(cgrib + ipos, lensec - 5, idrstmpl, ndpts, grid, fld))
+            return G2_UNPACK7_CORRUPT_SEC;
     }
 #endif  /* USE_JPEG2000 */
 #ifdef USE_PNG
     else if (idrsnum == 41 || idrsnum == 40010)
     {
-        pngunpack(cgrib + ipos, lensec - 5, idrstmpl, ndpts, lfld);
+        g2int ret;
+
+        if ((ret = g2c_pngunpack(cgrib + ipos, lensec - 5, idrstmpl, ndpts, grid,
+                                 fld, dec)))
+            return ret == G2_JPCUNPACK_MEM ? G2_UNPACK_NO_MEM : G2_UNPACK7_CORRUPT_SEC;
     }
 #endif  /* USE_PNG */
     else
     {
-        fprintf(stderr, "g2_unpack7: Data Representation Template 5.%d not yet "
+        g2c_log("g2_unpack7: Data Representation Template 5.%d not yet "
                 "implemented.\n", (int)idrsnum);
-        if (lfld)
-            free(lfld);
-        *fld = NULL;
         return G2_UNPACK7_BAD_DRT;
     }
 
@@ -5,6 +5,242 @@
  */
 #include "grib2_int.h"
 
+/** Number of values narrowed to 32 bits at a time by
+ * g2c_bw_put_n(). */
+#define PACK_BLOCK 512
+
+/**
+ * Load 8 bytes from a byte array as a big-endian 64-bit word.
+ *
+ * @param p Pointer to the first of the 8 bytes.
+ *
+ * @return The 64-bit word, first byte in the most significant position.
+ */
+static inline uint64_t
+load_be64(const unsigned char *p)
+{
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+        ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+        ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+        ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+}
+
+/**
+ * Fetch the next word of a bit string into a 64-bit accumulator. A
+ * whole big-endian word is loaded when at least 8 bytes remain before
+ * end, otherwise the remaining bytes are loaded and the word is
+ * padded with zeros, so that no byte at or beyond end is ever read.
+ *
+ * @param pp Pointer to the read position, advanced past the bytes
+ * loaded.
+ * @param end One past the last byte that may be read.
+ * @param nb Gets the number of valid bits in the returned word.
+ *
+ * @return The word, left justified.
+ */
+static inline uint64_t
+fetch_word(const unsigned char **pp, const unsigned char *end, int *nb)
+{
+    const unsigned char *p = *pp;
+    uint64_t w = 0;
+    int k;
+
+    if (end - p >= 8)
+    {
+        *pp = p + 8;
+        *nb = 64;
+        return load_be64(p);
+    }
+    for (k = 0; p < end; k++)
+        w |= (uint64_t)*p++ << (56 - 8 * k);
+    *pp = p;
+    *nb = 8 * k;
+    return w;
+}
+
+/** Reader of fixed-width values from a packed bit string. */
+struct bitreader
+{
+    const unsigned char *p;   /**< Next byte to be loaded. */
+    const unsigned char *end; /**< One past the last byte that may be read. */
+    uint64_t acc;             /**< Bits loaded but not yet taken, left-justified. */
+    int nacc;                 /**< Number of bits in acc. */
+};
+
+/**
+ * Start reading n values of nbits bits each from a packed bit string.
+ *
+ * @param br Pointer to the bit reader.
+ * @param in Pointer to character array input.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value, 1 to 32.
+ * @param n Number of values.
+ */
+static inline void
+br_init(struct bitreader *br, const unsigned char *in, g2int iskip, int nbits,
+        g2int n)
+{
+    int nw, skip;
+    uint64_t w;
+
+    br->p = in + iskip / 8;
+    br->end = in + (iskip + nbits * n + 7) / 8;
+    br->acc = 0;
+    br->nacc = 0;
+
+    /* Drop the bits skipped in the first byte. */
+    if ((skip = iskip % 8))
+    {
+        w = fetch_word(&br->p, br->end, &nw);
+        br->acc = w << skip;
+        br->nacc = nw - skip;
+    }
+}
+
+/**
+ * Take the next value from a bit reader. The bit string is consumed a
+ * 64-bit big-endian word at a time through the accumulator, so each
+ * value costs a shift and a mask, plus one word load every 64 bits.
+ *
+ * @param br Pointer to the bit reader.
+ * @param nbits Number of bits in the value, 1 to 32.
+ *
+ * @return The value, right justified.
+ */
+static inline uint64_t
+br_get(struct bitreader *br, int nbits)
+{
+    uint64_t v, w;
+    int nw, need;
+
+    if (br->nacc >= nbits)
+    {
+        v = br->acc >> (64 - nbits);
+        br->acc <<= nbits;
+        br->nacc -= nbits;
+        return v;
+    }
+
+    /* Join the bits left in the accumulator with the top of the next
+     * word. nacc < nbits <= 32, so shifts are in range. */
+    w = fetch_word(&br->p, br->end, &nw);
+    need = nbits - br->nacc;
+    v = (br->acc | (w >> br->nacc)) >> (64 - nbits);
+    br->acc = w << need;
+    br->nacc = nw - need;
+    return v;
+}
+
+/**
+ * Extract n contiguous values of nbits (1 to 32) bits each from a
+ * packed bit string, with a bit reader.
+ *
+ * @param in Pointer to character array input.
+ * @param iout Pointer to unpacked array output.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value, 1 to 32.
+ * @param n Number of values.
+ */
+static void
+gbits_words(const unsigned char *in, g2int *iout, g2int iskip, int nbits,
+            g2int n)
+{
+    struct bitreader br;
+    g2int i;
+
+    br_init(&br, in, iskip, nbits, n);
+    for (i = 0; i < n; i++)
+        iout[i] = (g2int)br_get(&br, nbits);
+}
+
+/**
+ * Extract n contiguous values of 0 to 32 bits each from a packed bit
+ * string into an array of 32-bit unsigned integers. This is the
+ * portable reference kernel for g2c_unpack32(), and handles the tails
+ * the SIMD kernels leave over. It uses the same bit reader as
+ * gbits().
+ *
+ * @param in Pointer to character array input.
+ * @param iout Pointer to unpacked array output.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value, 0 to 32.
+ * @param n Number of values.
+ */
+void
+g2c_gbits32(unsigned char *in, uint32_t *iout, g2int iskip, g2int nbits,
+            g2int n)
+{
+    struct bitreader br;
+    const unsigned char *p;
+    g2int i;
+
+    assert(nbits >= 0 && nbits <= 32);
+    if (n <= 0)
+        return;
+
+    if (nbits == 0)
+    {
+        for (i = 0; i < n; i++)
+            iout[i] = 0;
+        return;
+    }
+
+    p = in + iskip / 8;
+    if (iskip % 8 == 0 && nbits == 8)
+    {
+        for (i = 0; i < n; i++)
+            iout[i] = p[i];
+        return;
+    }
+    if (iskip % 8 == 0 && nbits == 16)
+    {
+        for (i = 0; i < n; i++, p += 2)
+            iout[i] = ((uint32_t)p[0] << 8) | p[1];
+        return;
+    }
+
+    br_init(&br, in, iskip, (int)nbits, n);
+    for (i = 0; i < n; i++)
+        iout[i] = (uint32_t)br_get(&br, (int)nbits);
+}
+
+/**
+ * Extract n byte-aligned values of 8, 16, 24 or 32 bits each. These
+ * widths need no shifting across byte boundaries, so each has its own
+ * straight-line loop.
+ *
+ * @param p Pointer to the first byte of the first value.
+ * @param iout Pointer to unpacked array output.
+ * @param nbits Number of bits in each value: 8, 16, 24 or 32.
+ * @param n Number of values.
+ */
+static void
+gbits_bytes(const unsigned char *p, g2int *iout, int nbits, g2int n)
+{
+    g2int i;
+
+    switch (nbits)
+    {
+    case 8:
+        for (i = 0; i < n; i++)
+            iout[i] = p[i];
+        break;
+    case 16:
+        for (i = 0; i < n; i++, p += 2)
+            iout[i] = ((g2int)p[0] << 8) | p[1];
+        break;
+    case 24:
+        for (i = 0; i < n; i++, p += 3)
+            iout[i] = ((g2int)p[0] << 16) | ((g2int)p[1] << 8) | p[2];
+        break;
+    case 32:
+        for (i = 0; i < n; i++, p += 4)
+            iout[i] = ((g2int)p[0] << 24) | ((g2int)p[1] << 16) |
+                ((g2int)p[2] << 8) | p[3];
+        break;
+    }
+}
+
 /**
  * Get bits - unpack bits: Extract arbitrary size values from a packed
  * bit string, right justifying each value in the unpacked iout array.
@@ -22,6 +258,219 @@ gbit(unsigned char *in, g2int *iout, g2int iskip, g2int nbits)
     gbits(in, iout, iskip, nbits, (g2int)0, (g2int)1);
 }
 
+/**
+ * Store 8 bytes to a byte array as a big-endian 64-bit word.
+ *
+ * @param p Pointer to the first of the 8 bytes.
+ * @param w The word to store, most significant byte first.
+ */
+static inline void
+store_be64(unsigned char *p, uint64_t w)
+{
+    p[0] = (unsigned char)(w >> 56);
+    p[1] = (unsigned char)(w >> 48);
+    p[2] = (unsigned char)(w >> 40);
+    p[3] = (unsigned char)(w >> 32);
+    p[4] = (unsigned char)(w >> 24);
+    p[5] = (unsigned char)(w >> 16);
+    p[6] = (unsigned char)(w >> 8);
+    p[7] = (unsigned char)w;
+}
+
+/**
+ * Add a value of 1 to 64 bits to a bit writer. When the accumulator
+ * fills, it is written out as one 64-bit word.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param v The value, which must fit in nbits bits.
+ * @param nbits Number of bits, 1 to 64.
+ *
+ * Loops should call this on a local copy of the writer, and copy it
+ * back when done. The byte stores could otherwise alias the writer,
+ * which would keep the compiler from holding it in registers.
+ */
+static inline void
+bw_put(g2c_bitwriter *bw, uint64_t v, int nbits)
+{
+    int room = 64 - bw->nacc;
+    int rest;
+
+    if (nbits < room)
+    {
+        bw->acc |= v << (room - nbits);
+        bw->nacc += nbits;
+        return;
+    }
+    rest = nbits - room;
+    bw->acc |= v >> rest;
+    store_be64(bw->out, bw->acc);
+    bw->out += 8;
+    bw->acc = rest ? v << (64 - rest) : 0;
+    bw->nacc = rest;
+}
+
+/**
+ * Start writing bits into a packed bit string. Bits before iskip in
+ * the first byte are left as they are.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param out Pointer to packed array output.
+ * @param iskip Number of bits to skip before the first value.
+ */
+void
+g2c_bw_init(g2c_bitwriter *bw, unsigned char *out, g2int iskip)
+{
+    int r = (int)(iskip % 8);
+
+    bw->out = out + iskip / 8;
+    bw->nacc = r;
+    bw->acc = r ? (uint64_t)(*bw->out & ~(0xff >> r)) << 56 : 0;
+}
+
+/**
+ * Add one value to a bit writer, taking the low order nbits bits of
+ * val.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param val The value.
+ * @param nbits Number of bits to store. Nothing is stored if 0.
+ */
+void
+g2c_bw_put(g2c_bitwriter *bw, g2int val, g2int nbits)
+{
+    uint64_t v = (uint64_t)val;
+
+    if (nbits <= 0)
+        return;
+    /* Values wider than 64 bits are padded on the left with zeros. */
+    while (nbits > 64)
+    {
+        int pad = nbits - 64 < 32 ? (int)(nbits - 64) : 32;
+
+        bw_put(bw, 0, pad);
+        nbits -= pad;
+    }
+    if (nbits < 64)
+        v &= ((uint64_t)1 << nbits) - 1;
+    bw_put(bw, v, (int)nbits);
+}
+
+/**
+ * Add n contiguous values to a bit writer, taking the low order nbits
+ * bits of each value. Values of up to 32 bits are handed to the pack
+ * kernel for this CPU a block at a time, and 1-bit values to the
+ * bitmap kernel.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param in Pointer to unpacked array input.
+ * @param nbits Number of bits to store for each value.
+ * @param n Number of values.
+ */
+void
+g2c_bw_put_n(g2c_bitwriter *bw, g2int *in, g2int nbits, g2int n)
+{
+    uint32_t blk[PACK_BLOCK];
+    g2c_bitwriter w;
+    uint64_t mask;
+    g2int i, j, nblk;
+
+    if (nbits == 1)
+    {
+        g2c_bitmap_compress(bw, in, n);
+        return;
+    }
+    if (nbits > 1 && nbits <= 32)
+    {
+        for (i = 0; i < n; i += nblk)
+        {
+            nblk = n - i < PACK_BLOCK ? n - i : PACK_BLOCK;
+            for (j = 0; j < nblk; j++)
+                blk[j] = (uint32_t)in[i + j];
+            g2c_pack32(bw, blk, nbits, nblk);
+        }
+        return;
+    }
+    if (nbits <= 0 || nbits > 64)
+    {
+        for (i = 0; i < n; i++)
+            g2c_bw_put(bw, in[i], nbits);
+        return;
+    }
+    mask = nbits < 64 ? ((uint64_t)1 << nbits) - 1 : ~(uint64_t)0;
+    w = *bw;
+    for (i = 0; i < n; i++)
+        bw_put(&w, (uint64_t)in[i] & mask, (int)nbits);
+    *bw = w;
+}
+
+/**
+ * Add n contiguous 32-bit values to a bit writer, taking the low order
+ * nbits bits of each value. This is the portable pack kernel, which
+ * the SIMD kernels must match.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param in Pointer to unpacked array input.
+ * @param nbits Number of bits to store for each value, 0 to 32.
+ * @param n Number of values.
+ */
+void
+g2c_bw_put_n32(g2c_bitwriter *bw, uint32_t *in, g2int nbits, g2int n)
+{
+    g2c_bitwriter w;
+    uint32_t mask;
+    g2int i;
+
+    assert(nbits >= 0 && nbits <= 32);
+    if (nbits == 0)
+        return;
+    mask = nbits < 32 ? ((uint32_t)1 << nbits) - 1 : 0xffffffff;
+    w = *bw;
+    for (i = 0; i < n; i++)
+        bw_put(&w, in[i] & mask, (int)nbits);
+    *bw = w;
+}
+
+/**
+ * Add n contiguous values of 1 to 64 bits to a bit writer. The values
+ * must already fit in nbits bits. The SIMD pack kernels merge runs of
+ * values into wide chunks and store them with this.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param in Pointer to values.
+ * @param nbits Number of bits in each value, 1 to 64.
+ * @param n Number of values.
+ */
+void
+g2c_bw_put_n64(g2c_bitwriter *bw, uint64_t *in, g2int nbits, g2int n)
+{
+    g2c_bitwriter w = *bw;
+    g2int i;
+
+    for (i = 0; i < n; i++)
+        bw_put(&w, in[i], (int)nbits);
+    *bw = w;
+}
+
+/**
+ * Write any pending bits of a bit writer to the output. Bits after the
+ * last value in the final byte are left as they are. The writer may
+ * be used again after flushing.
+ *
+ * @param bw Pointer to the bit writer.
+ */
+void
+g2c_bw_flush(g2c_bitwriter *bw)
+{
+    while (bw->nacc >= 8)
+    {
+        *bw->out++ = (unsigned char)(bw->acc >> 56);
+        bw->acc <<= 8;
+        bw->nacc -= 8;
+    }
+    if (bw->nacc)
+        *bw->out = (unsigned char)(bw->acc >> 56) | (*bw->out & (0xff >> bw->nacc));
+}
+
 /**
  * Store bits - put arbitrary size values into a packed bit string,
  * taking the low order bits from each value in the unpacked array.
@@ -61,6 +510,18 @@ gbits(unsigned char *in, g2int *iout, g2int iskip, g2int nbits,
     g2int nbit, index;
     static g2int ones[]={1, 3, 7, 15, 31, 63, 127, 255};
 
+    /* Contiguous values of up to 32 bits go through the word-at-a-time
+     * reader, with dedicated loops for byte-aligned whole-byte
+     * widths. Anything else takes the byte-by-byte loop below. */
+    if (nskip == 0 && nbits > 0 && nbits <= 32 && n > 0)
+    {
+        if (iskip % 8 == 0 && nbits % 8 == 0)
+            gbits_bytes(in + iskip / 8, iout, (int)nbits, n);
+        else
+            gbits_words(in, iout, iskip, (int)nbits, n);
+        return;
+    }
+
     /*     nbit is the start position of the field in bits */
     nbit = iskip;
     for (i = 0; i < n; i++)
@@ -118,6 +579,22 @@ sbits(unsigned char *out, g2int *in, g2int iskip, g2int nbits,
     g2int nbit, index;
     static g2int ones[]={1, 3, 7, 15, 31, 63, 127, 255};
 
+    /* Contiguous values go through the bit writer, which touches each
+     * output byte once. Only a stride between values needs the
+     * read-modify-write loop below. */
+    if (nskip == 0)
+    {
+        g2c_bitwriter bw;
+
+        if (nbits > 0 && n > 0)
+        {
+            g2c_bw_init(&bw, out, iskip);
+            g2c_bw_put_n(&bw, in, nbits, n);
+            g2c_bw_flush(&bw);
+        }
+        return;
+    }
+
     /* number bits from zero to ... nbit is the last bit of the field
      * to be filled. */
     nbit = iskip + nbits - 1;
@@ -134,7 +611,7 @@ sbits(unsigned char *out, g2int *in, g2int iskip, g2int nbits,
         {
             tbit = (bitcnt < (ibit+1)) ? bitcnt : ibit + 1;  /* find min */
             imask = ones[tbit - 1] << (7 - ibit);
-            itmp2 = (itmp << (7 - ibit)) & imask;
+            itmp2 = (itmp & ones[tbit - 1]) << (7 - ibit);
             itmp3 = (int)*(out + index) & (255 - imask);
             out[index] = (unsigned char)(itmp2 | itmp3);
             bitcnt = bitcnt - tbit;
@@ -109,11 +109,11 @@ getdim(unsigned char *csec3, g2int *width, g2int *height, g2int *iscan)
     }
 
     if (igds)
-        free(igds);
+        g2c_free(igds);
     if (igdstmpl)
-        free(igdstmpl);
+        g2c_free(igdstmpl);
     if (list_opt)
-        free(list_opt);
+        g2c_free(list_opt);
 
     return 0;
 }
@@ -77,11 +77,11 @@ getpoly(unsigned char *csec3, g2int *jj, g2int *kk, g2int *mm)
     }
 
     if (igds)
-	free(igds);
+	g2c_free(igds);
     if (igdstmpl)
-	free(igdstmpl);
+	g2c_free(igdstmpl);
     if (list_opt)
-	free(list_opt);
+	g2c_free(list_opt);
 
     return 0;
 }
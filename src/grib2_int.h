@@ -20,6 +20,50 @@
 
 #define ALOG2 (0.69314718) /**< ln(2.0) */
 
+/**
+ * Open GRIB file. The whole file is mapped into memory if mmap() is
+ * available, otherwise it is read into memory.
+ */
+struct g2c_file
+{
+    unsigned char *data; /**< Contents of the file. */
+    size_t len;          /**< Length of the file, in bytes. */
+    int mapped;          /**< 1 if data is mapped, 0 if allocated. */
+};
+
+/**
+ * Sections of a GRIB message used by one of its fields. Each is the
+ * offset of the section from the start of the buffer holding the
+ * message, or 0 if there is none.
+ */
+struct g2c_fldsecs
+{
+    /** Offset of section N in sec[N], for the sections 1 to 7 in
+     * effect for the field. sec[0] is not used. */
+    g2int sec[8];
+    g2int bmap6; /**< Section 6 holding the bitmap in effect for the field. */
+    g2int bmap3; /**< Section 3 in effect when that bitmap was defined. */
+};
+
+typedef struct g2c_fldsecs g2c_fldsecs; /**< Sections of a field. */
+
+/**
+ * Table of the sections of a GRIB message, built in one pass, so
+ * that any field can be decoded without walking the message again.
+ */
+struct g2c_msg
+{
+    unsigned char *cgrib; /**< Buffer holding the message. */
+    g2int istart;         /**< Offset of the message in the buffer. */
+    g2int lengrib;        /**< Length of the message, in bytes. */
+    g2int discipline;     /**< Discipline from section 0. */
+    g2int version;        /**< GRIB edition from section 0. */
+    g2int numlocal;       /**< Number of local use sections. */
+    g2int numfields;      /**< Number of fields. */
+    g2int nalloc;         /**< Allocated length of fld. */
+    g2c_fldsecs *fld;     /**< Sections of each field. */
+};
+
 /**
  * Struct for GRIB template.
  */
@@ -53,6 +97,15 @@ struct gtemplate
 
 typedef struct gtemplate gtemplate; /**< Struct for GRIB template. */
 
+/* Print an error message to stderr or stdout, if messages are on. */
+#ifdef __GNUC__
+void g2c_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void g2c_log_stdout(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+#else
+void g2c_log(const char *fmt, ...);
+void g2c_log_stdout(const char *fmt, ...);
+#endif
+
 /* Legacy support functions. */
 double int_power(double x, g2int y);
 void mkieee(g2float *a, g2int *rieee, g2int num);
@@ -65,6 +118,9 @@ gtemplate *getpdstemplate(g2int number);
 gtemplate *extpdstemplate(g2int number, g2int *list);
 gtemplate *getgridtemplate(g2int number);
 gtemplate *extgridtemplate(g2int number, g2int *list);
+int g2c_drstemplate(g2int number, gtemplate *tmpl);
+int g2c_pdstemplate(g2int number, gtemplate *tmpl);
+int g2c_gridtemplate(g2int number, gtemplate *tmpl);
 
 /* Packing and unpacking data. */
 void simpack(g2float *fld, g2int ndpts, g2int *idrstmpl, 
@@ -98,6 +154,8 @@ int enc_jpeg2000(unsigned char *cin, g2int width, g2int height, g2int nbits,
                  g2int ltype, g2int ratio, g2int retry, char *outjpc,
                  g2int jpclen);
 int dec_jpeg2000(char *injpc, g2int bufsize, g2int *outfld);
+int dec_jpeg2000_scale(char *injpc, g2int bufsize, g2int ndpts, g2float ref,
+                       g2float bscale, g2float dscale, g2float *fld);
 void jpcpack(g2float *fld, g2int width, g2int height, g2int *idrstmpl,
              unsigned char *cpack, g2int *lcpack);
 g2int jpcunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
@@ -110,6 +168,199 @@ void gbits(unsigned char *in, g2int *iout, g2int iskip, g2int nbits,
            g2int nskip, g2int n);
 void sbits(unsigned char *out, g2int *in, g2int iskip, g2int nbits,
            g2int nskip, g2int n);
+void g2c_gbits32(unsigned char *in, uint32_t *iout, g2int iskip, g2int nbits,
+                 g2int n);
+
+/** Forward-only bit writer. Values are collected in a 64-bit
+ * accumulator, which is written to the output a whole word at a
+ * time. */
+struct g2c_bitwriter
+{
+    unsigned char *out; /**< Next byte of output to be written. */
+    uint64_t acc;       /**< Pending bits, left-justified. */
+    int nacc;           /**< Number of pending bits in acc. */
+};
+
+typedef struct g2c_bitwriter g2c_bitwriter; /**< Bit writer. */
+
+void g2c_bw_init(g2c_bitwriter *bw, unsigned char *out, g2int iskip);
+void g2c_bw_put(g2c_bitwriter *bw, g2int val, g2int nbits);
+void g2c_bw_put_n(g2c_bitwriter *bw, g2int *in, g2int nbits, g2int n);
+void g2c_bw_put_n32(g2c_bitwriter *bw, uint32_t *in, g2int nbits, g2int n);
+void g2c_bw_put_n64(g2c_bitwriter *bw, uint64_t *in, g2int nbits, g2int n);
+void g2c_bw_flush(g2c_bitwriter *bw);
+
+/* SIMD levels for the bit packing and unpacking kernels. */
+#define G2C_SIMD_SCALAR 0 /**< Portable C kernels. */
+#define G2C_SIMD_SSE41 1  /**< SSE4.1 kernels. */
+#define G2C_SIMD_AVX2 2   /**< AVX2 kernels. */
+#define G2C_SIMD_AVX512 3 /**< AVX-512 (F and BW) kernels. */
+
+/** Kernel that unpacks fixed-width values into 32-bit integers. */
+typedef void (*g2c_unpack32_func)(unsigned char *in, uint32_t *iout,
+                                  g2int iskip, g2int nbits, g2int n);
+
+/* Unpack bits with the best kernel for this CPU. */
+void g2c_unpack32(unsigned char *in, uint32_t *iout, g2int iskip, g2int nbits,
+                  g2int n);
+g2c_unpack32_func g2c_unpack32_kernel(int level);
+int g2c_simd_level(void);
+void g2c_unpack_scale(unsigned char *in, g2int iskip, g2int nbits, g2int n,
+                      g2float ref, g2float bscale, g2float dscale, g2float *fld);
+
+/** Kernel that packs 32-bit integers into a bit writer. */
+typedef void (*g2c_pack32_func)(g2c_bitwriter *bw, uint32_t *in, g2int nbits,
+                                g2int n);
+
+/* Pack bits with the best kernel for this CPU. */
+void g2c_pack32(g2c_bitwriter *bw, uint32_t *in, g2int nbits, g2int n);
+g2c_pack32_func g2c_pack32_kernel(int level);
+
+/** Kernel that expands bitmap bytes into one integer per bit. */
+typedef void (*g2c_bitmap_expand_func)(unsigned char *in, g2int nbytes,
+                                       g2int *bmap);
+
+/** Kernel that compresses one integer per bit into bitmap bytes. */
+typedef void (*g2c_bitmap_compress_func)(g2int *bmap, g2int nbytes,
+                                         unsigned char *out);
+
+/* Bitmaps, with the best kernels for this CPU. */
+void g2c_bitmap_expand(unsigned char *in, g2int iskip, g2int n, g2int *bmap);
+void g2c_bitmap_compress(g2c_bitwriter *bw, g2int *bmap, g2int n);
+void g2c_bitmap_expand8(unsigned char *in, g2int iskip, g2int n,
+                        unsigned char *bmap);
+void g2c_bitmap_copy(unsigned char *in, g2int iskip, g2int n,
+                     unsigned char *out);
+g2c_bitmap_expand_func g2c_bitmap_expand_kernel(int level);
+g2c_bitmap_compress_func g2c_bitmap_compress_kernel(int level);
+
+/** Kernel that expands data values to grid points with bitmap bytes. */
+typedef g2int (*g2c_expand_func)(unsigned char *mask, g2int nbytes, g2float *in,
+                                 g2float fill, g2float *out);
+
+/* Expand data to the grid, with the best kernel for this CPU. */
+void g2c_expand(int fmt, void *bmap, g2int npts, g2float *in, g2int nin,
+                g2float fill, g2float *out);
+g2c_expand_func g2c_expand_kernel(int level);
+
+/** A grid with a bitmap, that unpacked data values go straight
+ * to. Points whose bitmap value is set get the data values in order,
+ * the others get the fill value. */
+struct g2c_grid
+{
+    int fmt;      /**< Bitmap format, one of the G2C_BMAP_ values. */
+    void *bmap;   /**< Bitmap. */
+    g2int npts;   /**< Number of grid points. */
+    g2float fill; /**< Value for points that are bitmapped out. */
+};
+
+typedef struct g2c_grid g2c_grid; /**< Grid with a bitmap. */
+
+void g2c_unpack_scale_grid(unsigned char *in, g2int iskip, g2int nbits, g2int n,
+                           g2float ref, g2float bscale, g2float dscale,
+                           g2c_grid *grid, g2float *fld);
+void g2c_scale_grid(g2int *ifld, g2int n, g2float ref, g2float bscale,
+                    g2float dscale, g2c_grid *grid, g2float *fld);
+void g2c_expand_tail(g2c_grid *grid, g2int n, g2float *fld);
+
+/** @name Scratch arrays of a decoder.
+ * Each unpacker uses its own slots, so one field's scratch arrays
+ * can't be handed out twice. */
+/**@{*/
+#define G2C_SCRATCH_IFLD 0     /**< Integer data values. */
+#define G2C_SCRATCH_GREF 1     /**< Group reference values. */
+#define G2C_SCRATCH_GWIDTH 2   /**< Group widths. */
+#define G2C_SCRATCH_GLEN 3     /**< Group lengths. */
+#define G2C_SCRATCH_IFLDMISS 4 /**< Missing value flags. */
+#define G2C_SCRATCH_GVAL 5     /**< Values of one group. */
+#define G2C_SCRATCH_CTEMP 6    /**< Decoded image. */
+#define G2C_SCRATCH_NUM 7      /**< Number of scratch arrays. */
+/**@}*/
+
+/**
+ * Decoder, which keeps the section table and the scratch arrays of
+ * the unpackers from one field to the next, growing them as needed.
+ */
+struct g2c_decoder
+{
+    g2c_msg msg;                         /**< Section table. */
+    void *buf[G2C_SCRATCH_NUM];          /**< Scratch arrays. */
+    size_t size[G2C_SCRATCH_NUM];        /**< Size of each, in bytes. */
+};
+
+void *g2c_scratch_alloc(g2c_decoder *dec, int slot, size_t size);
+void g2c_scratch_free(g2c_decoder *dec, void *p);
+
+/* Unpack data, optionally straight to the grid, with scratch arrays
+ * from a decoder, or the heap if it is NULL. */
+g2int g2c_simunpack(unsigned char *cpack, g2int *idrstmpl, g2int ndpts,
+                    g2c_grid *grid, g2float *fld);
+int g2c_comunpack(unsigned char *cpack, g2int lensec, g2int idrsnum,
+                  g2int *idrstmpl, g2int ndpts, g2c_grid *grid, g2float *fld,
+                  g2c_decoder *dec);
+g2int g2c_pngunpack(unsigned char *cpack, g2int len, g2int *idrstmpl,
+                    g2int ndpts, g2c_grid *grid, g2float *fld, g2c_decoder *dec);
+g2int g2c_jpcunpack(unsigned char *cpack, g2int len, g2int *idrstmpl,
+                    g2int ndpts, g2c_grid *grid, g2float *fld);
+g2int g2c_unpack7(unsigned char *cgrib, g2int *iofst, g2int igdsnum,
+                  g2int *igdstmpl, g2int idrsnum, g2int *idrstmpl, g2int ndpts,
+                  g2c_grid *grid, g2float **fld, g2c_decoder *dec);
+g2int g2c_unpack7_into(unsigned char *cgrib, g2int *iofst, g2int igdsnum,
+                       g2int *igdstmpl, g2int idrsnum, g2int *idrstmpl, g2int ndpts,
+                       g2c_grid *grid, g2float *fld, g2c_decoder *dec);
+
+/** Kernel that contracts grid points to data values with bitmap bytes. */
+typedef g2int (*g2c_contract_func)(unsigned char *mask, g2int nbytes,
+                                   g2float *in, g2float *out);
+
+/* Contract grid points to data, with the best kernel for this CPU. */
+g2int g2c_contract(int fmt, void *bmap, g2int npts, g2float *in, g2float *out);
+g2c_contract_func g2c_contract_kernel(int level);
+void g2c_bw_put_bitmap(g2c_bitwriter *bw, int fmt, void *bmap, g2int n);
+
+/* Allocate memory with the functions set by g2c_set_allocator(). */
+void *g2c_malloc(size_t size);
+void *g2c_calloc(size_t nmemb, size_t size);
+void *g2c_realloc(void *ptr, size_t size);
+void g2c_free(void *ptr);
+
+/** Alignment of memory from an arena. */
+#define G2C_ARENA_ALIGN 16
+
+/**
+ * Block of memory handed out in order, so that a gribfield and its
+ * arrays can be freed with one call.
+ */
+struct g2c_arena
+{
+    unsigned char *base; /**< The block. */
+    size_t size;         /**< Size of the block. */
+    size_t used;         /**< Bytes handed out. */
+};
+
+typedef struct g2c_arena g2c_arena; /**< Arena. */
+
+void *g2c_arena_alloc(g2c_arena *arena, size_t size);
+void *g2c_arena_realloc(g2c_arena *arena, void *p, size_t old, size_t size);
+void g2c_arena_free(g2c_arena *arena, void *p);
+
+/* Unpack sections, with the arrays from an arena, or the heap if it
+ * is NULL. */
+g2int g2c_unpack1(unsigned char *cgrib, g2int *iofst, g2int **ids, g2int *idslen,
+                  g2c_arena *arena);
+g2int g2c_unpack2(unsigned char *cgrib, g2int *iofst, g2int *lencsec2,
+                  unsigned char **csec2, g2c_arena *arena);
+g2int g2c_unpack3(unsigned char *cgrib, g2int *iofst, g2int **igds, g2int **igdstmpl,
+                  g2int *mapgridlen, g2int **ideflist, g2int *idefnum, g2c_arena *arena);
+g2int g2c_unpack4(unsigned char *cgrib, g2int *iofst, g2int *ipdsnum, g2int **ipdstmpl,
+                  g2int *mappdslen, g2float **coordlist, g2int *numcoord,
+                  g2c_arena *arena);
+g2int g2c_unpack5(unsigned char *cgrib, g2int *iofst, g2int *ndpts, g2int *idrsnum,
+                  g2int **idrstmpl, g2int *mapdrslen, g2c_arena *arena);
+
+/* Unpack Section 6 with the bitmap in any format. */
+g2int g2c_unpack6(unsigned char *cgrib, g2int *iofst, g2int ngpts, g2int *ibmap,
+                  int fmt, void **bmap, g2c_arena *arena);
 
 /* Deal with grib groups. */
 int pack_gp(g2int *kfildo, g2int *ic, g2int *nxy,
@@ -118,7 +369,35 @@ int pack_gp(g2int *kfildo, g2int *ic, g2int *nxy,
             g2int *ndg, g2int *lx, g2int *ibit, g2int *jbit, g2int *kbit,
             g2int *novref, g2int *lbitref, g2int *ier);
 
+/* Value of a scaled value and scale factor. */
+double g2c_scaled_value(g2int scale, g2int value);
+
 /* Check the message header and check for message termination. */
 int g2c_check_msg(unsigned char *cgrib, g2int *lencurr, int verbose);
 
+/* Build the section table of a message. */
+int g2c_msg_walk(unsigned char *cgrib, g2int stopfld, int verbose, g2c_msg *msg);
+g2int g2c_msg_field(g2c_msg *msg, g2int ifldnum, g2int unpack, g2int expand,
+                    int flags, g2float *fld, g2int fldlen, g2c_decoder *dec,
+                    gribfield **gfld);
+
+/** Bytes of a message header needed to find the message length. */
+#define G2C_MSG_HEADER_LEN 16
+
+/* Find the next message in a buffer. */
+int g2c_msg_header(unsigned char *p, g2int *bytes, int *edition);
+int g2c_find_msg(unsigned char *buf, size_t len, size_t start, g2c_msgloc *loc);
+int g2c_find_msg_before(unsigned char *buf, size_t len, size_t start, size_t stop,
+                        g2c_msgloc *loc);
+
+/* Read part of a file, at an offset. */
+long g2c_pread(FILE *f, g2int offset, void *buf, size_t len);
+
+/* Build and write binary index records. */
+int g2c_bidx_msg_recs(unsigned char *cgrib, g2c_msgloc *loc, g2c_bidx_rec **recs,
+                      size_t *nrecs, size_t *nalloc);
+int g2c_write_bidx_header(FILE *out, g2int grib_size, size_t nrecs, int nfiles);
+int g2c_build_bidx(int nfiles, const char **paths, const char **idxpaths, const char *catpath,
+                   int nthreads, size_t chunk_size);
+
 #endif  /*  _grib2_int_H  */
@@ -155,6 +155,35 @@ getgridindex(g2int number)
     return(getgridindex);
 }
 
+/**
+ * Fill in the template struct of a Grid Definition Template, like
+ * getgridtemplate(), without allocating it.
+ *
+ * @param number The number of the Grid Definition Template.
+ * @param tmpl The struct to fill in.
+ *
+ * @return 0 for success, -1 if the template is not defined.
+ */
+int
+g2c_gridtemplate(g2int number, gtemplate *tmpl)
+{
+    g2int index;
+
+    if ((index = getgridindex(number)) == -1)
+    {
+        g2c_log_stdout("getgridtemplate: GDT Template 3.%d not defined.\n", (int)number);
+        return -1;
+    }
+    tmpl->type = 3;
+    tmpl->num = templatesgrid[index].template_num;
+    tmpl->maplen = templatesgrid[index].mapgridlen;
+    tmpl->needext = templatesgrid[index].needext;
+    tmpl->map = (g2int *)templatesgrid[index].mapgrid;
+    tmpl->extlen = 0;
+    tmpl->ext = NULL;
+    return 0;
+}
+
 /**
  * This subroutine returns grid template information for a specified
  * Grid Definition Template for [Section 3 - the Grid Definition
@@ -179,30 +208,14 @@ getgridindex(g2int number)
 gtemplate *
 getgridtemplate(g2int number)
 {
-    g2int index;
-    gtemplate *new;
-
-    index = getgridindex(number);
-
-    if (index != -1)
-    {
-        new = malloc(sizeof(gtemplate));
-        new->type = 3;
-        new->num = templatesgrid[index].template_num;
-        new->maplen = templatesgrid[index].mapgridlen;
-        new->needext = templatesgrid[index].needext;
-        new->map = (g2int *)templatesgrid[index].mapgrid;
-        new->extlen = 0;
-        new->ext = NULL;
-        return(new);
-    }
-    else
-    {
-        printf("getgridtemplate: GDT Template 3.%d not defined.\n", (int)number);
-        return(NULL);
-    }
+    gtemplate tmpl, *new;
 
-    return(NULL);
+    if (g2c_gridtemplate(number, &tmpl))
+        return NULL;
+    if (!(new = g2c_malloc(sizeof(gtemplate))))
+        return NULL;
+    *new = tmpl;
+    return new;
 }
 
 /**
@@ -243,7 +256,7 @@ extgridtemplate(g2int number, g2int *list)
     if (number == 120)
     {
         new->extlen = list[1] * 2;
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             if (i % 2 == 0)
@@ -255,13 +268,13 @@ extgridtemplate(g2int number, g2int *list)
     else if (number == 4)
     {
         new->extlen = list[7];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 4;
         }
         new->extlen = list[8];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = -4;
@@ -270,13 +283,13 @@ extgridtemplate(g2int number, g2int *list)
     else if (number == 5)
     {
         new->extlen = list[7];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 4;
         }
         new->extlen = list[8];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = -4;
@@ -285,7 +298,7 @@ extgridtemplate(g2int number, g2int *list)
     else if (number == 1000)
     {
         new->extlen = list[19];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 4;
@@ -294,7 +307,7 @@ extgridtemplate(g2int number, g2int *list)
     else if (number == 1200)
     {
         new->extlen = list[15];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 4;
@@ -0,0 +1,633 @@
+/**
+ * @file
+ * @brief Make, write, read and search inventories of GRIB2 files, in
+ * the .idx format of wgrib2.
+ *
+ * Each line of a .idx file describes one field:
+ * @code
+ * 1:0:d=2021113000:WIND:surface:anl:
+ * @endcode
+ * The fields are the message number (with the field number after a
+ * '.' if the message has more than one field), the offset of the
+ * message in the file, the reference time, the variable name, the
+ * level and the forecast time.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/** Length of the longest .idx line that can be read. */
+#define MAX_LINE_LEN 1024
+
+/** Name of a parameter. */
+struct param
+{
+    unsigned char discipline; /**< Discipline, from section 0. */
+    unsigned char category;   /**< Parameter category. */
+    unsigned char number;     /**< Parameter number. */
+    const char *name;         /**< Abbreviation used by wgrib2. */
+};
+
+/** Names of parameters of the WMO tables 4.2. Others are shown by
+ * number, as wgrib2 does. */
+static const struct param params[] = {
+    {0, 0, 0, "TMP"}, {0, 0, 1, "VTMP"}, {0, 0, 2, "POT"}, {0, 0, 3, "EPOT"},
+    {0, 0, 4, "TMAX"}, {0, 0, 5, "TMIN"}, {0, 0, 6, "DPT"}, {0, 0, 7, "DEPR"},
+    {0, 0, 8, "LAPR"}, {0, 0, 10, "LHTFL"}, {0, 0, 11, "SHTFL"},
+    {0, 1, 0, "SPFH"}, {0, 1, 1, "RH"}, {0, 1, 2, "MIXR"}, {0, 1, 3, "PWAT"},
+    {0, 1, 7, "PRATE"}, {0, 1, 8, "APCP"}, {0, 1, 10, "ACPCP"}, {0, 1, 11, "SNOD"},
+    {0, 1, 13, "WEASD"}, {0, 1, 22, "CLWMR"},
+    {0, 2, 0, "WDIR"}, {0, 2, 1, "WIND"}, {0, 2, 2, "UGRD"}, {0, 2, 3, "VGRD"},
+    {0, 2, 4, "STRM"}, {0, 2, 5, "VPOT"}, {0, 2, 8, "VVEL"}, {0, 2, 9, "DZDT"},
+    {0, 2, 10, "ABSV"}, {0, 2, 22, "GUST"},
+    {0, 3, 0, "PRES"}, {0, 3, 1, "PRMSL"}, {0, 3, 5, "HGT"},
+    {0, 4, 7, "DSWRF"}, {0, 5, 3, "DLWRF"},
+    {0, 6, 1, "TCDC"}, {0, 7, 6, "CAPE"}, {0, 7, 7, "CIN"}, {0, 19, 0, "VIS"},
+    {2, 0, 0, "LAND"},
+    {10, 0, 0, "WVSP1"}, {10, 0, 1, "WVSP2"}, {10, 0, 2, "WVSP3"}, {10, 0, 3, "HTSGW"},
+    {10, 0, 4, "WVDIR"}, {10, 0, 5, "WVHGT"}, {10, 0, 6, "WVPER"}, {10, 0, 7, "SWDIR"},
+    {10, 0, 8, "SWELL"}, {10, 0, 9, "SWPER"}, {10, 0, 10, "DIRPW"}, {10, 0, 11, "PERPW"},
+    {10, 0, 12, "DIRSW"}, {10, 0, 13, "PERSW"},
+    {10, 1, 2, "UOGRD"}, {10, 1, 3, "VOGRD"}, {10, 2, 0, "ICEC"}, {10, 3, 0, "WTMP"},
+};
+
+/**
+ * Get the name of a parameter.
+ *
+ * @param discipline Discipline, from section 0.
+ * @param idsect Identification section, from g2_unpack1().
+ * @param ipdtmpl Product definition template, from g2_unpack4(), with
+ * at least the parameter category and number.
+ * @param name Gets the name.
+ * @param len Size of name.
+ */
+static void
+param_name(g2int discipline, g2int *idsect, g2int *ipdtmpl, char *name, size_t len)
+{
+    size_t p;
+
+    /* Local parameters are only known to the center's tables. */
+    if (ipdtmpl[0] < 192 && ipdtmpl[1] < 192)
+        for (p = 0; p < sizeof(params) / sizeof(params[0]); p++)
+            if (params[p].discipline == discipline && params[p].category == ipdtmpl[0] &&
+                params[p].number == ipdtmpl[1])
+            {
+                snprintf(name, len, "%s", params[p].name);
+                return;
+            }
+    snprintf(name, len, "var discipline=%ld master_table=%ld parmcat=%ld parm=%ld",
+             discipline, idsect[2], ipdtmpl[0], ipdtmpl[1]);
+}
+
+/**
+ * Get the description of the level of a field, from its first and
+ * second fixed surfaces (code table 4.5).
+ *
+ * @param ipdtmpl Product definition template, from g2_unpack4(), of a
+ * template 4.0 to 4.15.
+ * @param level Gets the description.
+ * @param len Size of level.
+ */
+static void
+level_name(g2int *ipdtmpl, char *level, size_t len)
+{
+    g2int type1 = ipdtmpl[9], type2 = ipdtmpl[12];
+    double v1, v2, div = 1;
+    const char *units;
+
+    switch (type1)
+    {
+    case 1:
+        snprintf(level, len, "surface");
+        return;
+    case 2:
+        snprintf(level, len, "cloud base");
+        return;
+    case 3:
+        snprintf(level, len, "cloud top");
+        return;
+    case 4:
+        snprintf(level, len, "0C isotherm");
+        return;
+    case 6:
+        snprintf(level, len, "max wind");
+        return;
+    case 7:
+        snprintf(level, len, "tropopause");
+        return;
+    case 8:
+        snprintf(level, len, "nominal top of the atmosphere");
+        return;
+    case 10:
+        snprintf(level, len, "entire atmosphere");
+        return;
+    case 101:
+        snprintf(level, len, "mean sea level");
+        return;
+    case 200:
+        snprintf(level, len, "entire atmosphere (considered as a single layer)");
+        return;
+    case 100:
+        units = "mb";
+        div = 100;
+        break;
+    case 102:
+        units = "m above mean sea level";
+        break;
+    case 103:
+        units = "m above ground";
+        break;
+    case 104:
+        units = "sigma level";
+        break;
+    case 105:
+        units = "hybrid level";
+        break;
+    case 106:
+        units = "m below ground";
+        break;
+    case 241:
+        units = "in sequence";
+        break;
+    default:
+        snprintf(level, len, "level type %ld", type1);
+        return;
+    }
+
+    v1 = g2c_scaled_value(ipdtmpl[10], ipdtmpl[11]) / div;
+    if (type2 == type1)
+    {
+        v2 = g2c_scaled_value(ipdtmpl[13], ipdtmpl[14]) / div;
+        snprintf(level, len, "%g-%g %s", v1, v2, units);
+    }
+    else
+        snprintf(level, len, "%g %s", v1, units);
+}
+
+/**
+ * Format a time as a number of hours, days or minutes.
+ *
+ * @param unit Unit of time (code table 4.4).
+ * @param value The time.
+ * @param buf Gets the time, like "6 hour".
+ * @param len Size of buf.
+ */
+static void
+time_units(g2int unit, g2int value, char *buf, size_t len)
+{
+    switch (unit)
+    {
+    case 0:
+        snprintf(buf, len, "%ld min", value);
+        break;
+    case 1:
+        snprintf(buf, len, "%ld hour", value);
+        break;
+    case 2:
+        snprintf(buf, len, "%ld day", value);
+        break;
+    case 3:
+        snprintf(buf, len, "%ld month", value);
+        break;
+    case 4:
+        snprintf(buf, len, "%ld year", value);
+        break;
+    case 10:
+        snprintf(buf, len, "%ld hour", 3 * value);
+        break;
+    case 11:
+        snprintf(buf, len, "%ld hour", 6 * value);
+        break;
+    case 12:
+        snprintf(buf, len, "%ld hour", 12 * value);
+        break;
+    case 13:
+        snprintf(buf, len, "%ld sec", value);
+        break;
+    default:
+        snprintf(buf, len, "%ld (unit %ld)", value, unit);
+    }
+}
+
+/**
+ * Get the description of the forecast time of a field. Statistically
+ * processed fields (templates 4.8, 4.11 and 4.12) are described by
+ * their time range and process, like "0-6 hour acc fcst".
+ *
+ * @param ipdtnum Product definition template number.
+ * @param ipdtmpl Product definition template, from g2_unpack4().
+ * @param ipdtlen Length of the template.
+ * @param fcst Gets the description.
+ * @param len Size of fcst.
+ */
+static void
+fcst_name(g2int ipdtnum, g2int *ipdtmpl, g2int ipdtlen, char *fcst, size_t len)
+{
+    static const char *stats[] = {"ave", "acc", "max", "min"};
+    char range[64];
+    int base;
+
+    /* Where the statistical processing starts in the template. */
+    if (ipdtnum == 8)
+        base = 15;
+    else if (ipdtnum == 11)
+        base = 18;
+    else if (ipdtnum == 12)
+        base = 17;
+    else
+        base = 0;
+
+    /* After the end of the time range (6 entries) and the number of
+     * time ranges and missing values, comes the first time range:
+     * the process, type of increment, unit and length. */
+    if (base && ipdtlen >= base + 12)
+    {
+        time_units(ipdtmpl[base + 10], ipdtmpl[8] + ipdtmpl[base + 11], range,
+                   sizeof(range));
+        if (ipdtmpl[base + 8] >= 0 && ipdtmpl[base + 8] < 4)
+            snprintf(fcst, len, "%ld-%s %s fcst", ipdtmpl[8], range,
+                     stats[ipdtmpl[base + 8]]);
+        else
+            snprintf(fcst, len, "%ld-%s fcst", ipdtmpl[8], range);
+    }
+    else if (ipdtmpl[8] == 0)
+        snprintf(fcst, len, "anl");
+    else
+    {
+        time_units(ipdtmpl[7], ipdtmpl[8], range, sizeof(range));
+        snprintf(fcst, len, "%s fcst", range);
+    }
+}
+
+/**
+ * Fill in an inventory record from the sections of a field.
+ *
+ * @param msg Section table of the message.
+ * @param fs Sections of the field.
+ * @param rec Gets the description of the field.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EMSG Error unpacking section 1 or 4, or a product template
+ * too short to hold the parameter.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+describe(g2c_msg *msg, g2c_fldsecs *fs, g2c_idx_rec *rec)
+{
+    g2int iofst, *idsect = NULL, idsectlen, ipdtnum, *ipdtmpl = NULL, ipdtlen;
+    g2int numcoord, err = 0;
+    g2float *coord_list = NULL;
+    int ret = G2C_EMSG;
+
+    iofst = fs->sec[1] * 8;
+    if (!fs->sec[1] || (err = g2_unpack1(msg->cgrib, &iofst, &idsect, &idsectlen)))
+        goto exit;
+    iofst = fs->sec[4] * 8;
+    if ((err = g2_unpack4(msg->cgrib, &iofst, &ipdtnum, &ipdtmpl, &ipdtlen, &coord_list,
+                          &numcoord)))
+        goto exit;
+    if (ipdtlen < 2)
+        goto exit;
+
+    snprintf(rec->date, sizeof(rec->date), "%04ld%02ld%02ld%02ld", idsect[5],
+             idsect[6], idsect[7], idsect[8]);
+    param_name(msg->discipline, idsect, ipdtmpl, rec->var, sizeof(rec->var));
+
+    /* Templates 4.0 to 4.15 share the same layout of the category,
+     * forecast time and surfaces. */
+    if (ipdtnum <= 15 && ipdtlen >= 15)
+    {
+        level_name(ipdtmpl, rec->level, sizeof(rec->level));
+        fcst_name(ipdtnum, ipdtmpl, ipdtlen, rec->fcst, sizeof(rec->fcst));
+    }
+    else
+    {
+        snprintf(rec->level, sizeof(rec->level), "pdt %ld", ipdtnum);
+        snprintf(rec->fcst, sizeof(rec->fcst), "pdt %ld", ipdtnum);
+    }
+    ret = G2C_NO_ERROR;
+
+exit:
+    if (err == G2_UNPACK_NO_MEM)
+        ret = G2C_ENOMEM;
+    g2c_free(idsect);
+    g2c_free(ipdtmpl);
+    g2c_free(coord_list);
+    return ret;
+}
+
+/**
+ * Add a record to an inventory.
+ *
+ * @param idx The inventory.
+ * @param nalloc Pointer to the allocated number of records.
+ *
+ * @return Pointer to the new record, or NULL if out of memory.
+ */
+static g2c_idx_rec *
+add_rec(g2c_idx *idx, size_t *nalloc)
+{
+    g2c_idx_rec *r;
+
+    if (idx->nrecs == *nalloc)
+    {
+        *nalloc = *nalloc ? 2 * *nalloc : 64;
+        if (!(r = g2c_realloc(idx->recs, *nalloc * sizeof(g2c_idx_rec))))
+            return NULL;
+        idx->recs = r;
+    }
+    r = &idx->recs[idx->nrecs++];
+    memset(r, 0, sizeof(g2c_idx_rec));
+    return r;
+}
+
+/**
+ * Make an inventory of a GRIB2 file, like the one wgrib2 writes to a
+ * .idx file, in one pass over the file.
+ *
+ * Only sections 1 and 4 of each field are unpacked, so making the
+ * inventory does not depend on the packing of the data. GRIB1
+ * messages are skipped, and not counted.
+ *
+ * A message that can't be walked, or a field whose sections 1 and 4
+ * can't be unpacked, is left out of the inventory and counted in
+ * nbad, and the rest of the file is still indexed. Messages keep their
+ * numbers, so the records after a bad one still match wgrib2.
+ *
+ * @param path Name of the GRIB2 file.
+ * @param idx Pointer that gets the inventory. Free it with
+ * g2c_free_idx().
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading the file.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_make_idx(const char *path, g2c_idx **idx)
+{
+    g2c_file *file;
+    g2c_msgloc loc;
+    g2c_msg msg = {0};
+    g2c_idx *lidx;
+    g2c_idx_rec *rec;
+    unsigned char *cgrib;
+    size_t pos = 0, nalloc = 0;
+    g2int msgnum = 0, f;
+    int ret;
+
+    if (!path || !idx)
+        return G2C_EINVAL;
+    if ((ret = g2c_open_file(path, G2C_ACCESS_SEQUENTIAL, &file)))
+        return ret;
+    if (!(lidx = g2c_calloc(1, sizeof(g2c_idx))))
+    {
+        g2c_close_file(file);
+        return G2C_ENOMEM;
+    }
+
+    while (!(ret = g2c_next_msg(file, &pos, &loc, &cgrib)))
+    {
+        if (loc.edition != 2)
+            continue;
+        msgnum++;
+        if ((ret = g2c_msg_walk(cgrib, 0, 0, &msg)))
+        {
+            if (ret == G2C_ENOMEM)
+                break;
+            lidx->nbad++;
+            continue;
+        }
+        for (f = 0; f < msg.numfields; f++)
+        {
+            if (!(rec = add_rec(lidx, &nalloc)))
+            {
+                ret = G2C_ENOMEM;
+                break;
+            }
+            rec->msgnum = msgnum;
+            rec->fldnum = f + 1;
+            rec->offset = loc.offset;
+            if ((ret = describe(&msg, &msg.fld[f], rec)) == G2C_ENOMEM)
+                break;
+            if (ret)
+            {
+                lidx->nrecs--;
+                lidx->nbad++;
+            }
+        }
+        if (ret == G2C_ENOMEM)
+            break;
+    }
+    g2c_free(msg.fld);
+    g2c_close_file(file);
+
+    if (ret != G2C_ENOMSG)
+    {
+        g2c_free_idx(lidx);
+        return ret;
+    }
+    *idx = lidx;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Write an inventory in the .idx format of wgrib2.
+ *
+ * The number of fields in each message is needed to choose between
+ * "n" and "n.m" numbering, so the records of each message must be
+ * together, as g2c_make_idx() and g2c_read_idx() leave them.
+ *
+ * @param idx The inventory.
+ * @param out File to write to.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error writing the file.
+ */
+int
+g2c_write_idx(g2c_idx *idx, FILE *out)
+{
+    g2c_idx_rec *r;
+    size_t i;
+    int multi;
+
+    if (!idx || !out)
+        return G2C_EINVAL;
+    for (i = 0; i < idx->nrecs; i++)
+    {
+        r = &idx->recs[i];
+
+        /* A message with more than one field has its fields
+         * numbered. */
+        multi = r->fldnum > 1 ||
+            (i + 1 < idx->nrecs && idx->recs[i + 1].msgnum == r->msgnum);
+        if (multi)
+            fprintf(out, "%ld.%ld", r->msgnum, r->fldnum);
+        else
+            fprintf(out, "%ld", r->msgnum);
+        if (fprintf(out, ":%ld:d=%s:%s:%s:%s:\n", r->offset, r->date, r->var,
+                    r->level, r->fcst) < 0)
+            return G2C_EFILE;
+    }
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Copy one ':' separated field of an .idx line.
+ *
+ * @param p Pointer to the start of the field. Moved past the ':' after
+ * it.
+ * @param buf Gets the field.
+ * @param len Size of buf.
+ *
+ * @return 0 if the field was copied, -1 if there is no ':' after it,
+ * or it is too long.
+ */
+static int
+next_field(char **p, char *buf, size_t len)
+{
+    char *colon;
+
+    if (!(colon = strchr(*p, ':')) || (size_t)(colon - *p) >= len)
+        return -1;
+    memcpy(buf, *p, colon - *p);
+    buf[colon - *p] = 0;
+    *p = colon + 1;
+    return 0;
+}
+
+/**
+ * Read an inventory in the .idx format of wgrib2. Fields after the
+ * forecast time, which wgrib2 writes for some products, are ignored.
+ *
+ * @param in File to read.
+ * @param idx Pointer that gets the inventory. Free it with
+ * g2c_free_idx().
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EBADIDX Line of the file could not be parsed.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_read_idx(FILE *in, g2c_idx **idx)
+{
+    char line[MAX_LINE_LEN], *p;
+    g2c_idx *lidx;
+    g2c_idx_rec *rec;
+    size_t nalloc = 0;
+    long msgnum, fldnum, offset;
+    int n, ret = G2C_NO_ERROR;
+
+    if (!in || !idx)
+        return G2C_EINVAL;
+    if (!(lidx = g2c_calloc(1, sizeof(g2c_idx))))
+        return G2C_ENOMEM;
+
+    while (fgets(line, MAX_LINE_LEN, in))
+    {
+        if (line[0] == '\n' || !line[0])
+            continue;
+
+        /* The message and field numbers, and the offset. */
+        fldnum = 1;
+        if (sscanf(line, "%ld.%ld:%ld:%n", &msgnum, &fldnum, &offset, &n) != 3 &&
+            sscanf(line, "%ld:%ld:%n", &msgnum, &offset, &n) != 2)
+        {
+            ret = G2C_EBADIDX;
+            break;
+        }
+        if (!(rec = add_rec(lidx, &nalloc)))
+        {
+            ret = G2C_ENOMEM;
+            break;
+        }
+        rec->msgnum = msgnum;
+        rec->fldnum = fldnum;
+        rec->offset = offset;
+
+        p = line + n;
+        if (strncmp(p, "d=", 2) || (p += 2, next_field(&p, rec->date, sizeof(rec->date))) ||
+            next_field(&p, rec->var, sizeof(rec->var)) ||
+            next_field(&p, rec->level, sizeof(rec->level)) ||
+            next_field(&p, rec->fcst, sizeof(rec->fcst)))
+        {
+            ret = G2C_EBADIDX;
+            break;
+        }
+    }
+
+    if (ret)
+    {
+        g2c_free_idx(lidx);
+        return ret;
+    }
+    *idx = lidx;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Find a field in an inventory, by its variable, level and forecast
+ * time. The offset of the record can then be passed to g2c_read_msg()
+ * or g2c_file_msg(), to go straight to the message.
+ *
+ * @param idx The inventory.
+ * @param start Index of the record to start searching at. To find all
+ * matches, start each search after the last match.
+ * @param var Variable name, or NULL to match any.
+ * @param level Level, or NULL to match any.
+ * @param fcst Forecast time, or NULL to match any.
+ * @param rec Pointer that gets the first matching record at or after
+ * start.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_ENOTFOUND No match.
+ */
+int
+g2c_idx_find(g2c_idx *idx, size_t start, const char *var, const char *level,
+             const char *fcst, g2c_idx_rec **rec)
+{
+    g2c_idx_rec *r;
+    size_t i;
+
+    if (!idx || !rec)
+        return G2C_EINVAL;
+    for (i = start; i < idx->nrecs; i++)
+    {
+        r = &idx->recs[i];
+        if ((!var || !strcmp(var, r->var)) && (!level || !strcmp(level, r->level)) &&
+            (!fcst || !strcmp(fcst, r->fcst)))
+        {
+            *rec = r;
+            return G2C_NO_ERROR;
+        }
+    }
+    return G2C_ENOTFOUND;
+}
+
+/**
+ * Free an inventory.
+ *
+ * @param idx The inventory.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ */
+int
+g2c_free_idx(g2c_idx *idx)
+{
+    if (!idx)
+        return G2C_EINVAL;
+    g2c_free(idx->recs);
+    g2c_free(idx);
+    return G2C_NO_ERROR;
+}
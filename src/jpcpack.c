@@ -81,7 +81,7 @@ jpcpack(g2float *fld, g2int width, g2int height, g2int *idrstmpl,
      * is the value for each point in the field and set nbits to 0. */
     if (rmin != rmax && maxdif != 0)
     {
-        ifld = malloc(ndpts * sizeof(g2int));
+        ifld = g2c_malloc(ndpts * sizeof(g2int));
 
         /* Determine which algorithm to use based on user-supplied
          * binary scale factor and number of bits. */
@@ -118,23 +118,23 @@ jpcpack(g2float *fld, g2int width, g2int height, g2int *idrstmpl,
         retry = 0;
         nbytes = (nbits + 7) / 8;
         nsize = *lcpack;          /* needed for input to enc_jpeg2000 */
-        ctemp = calloc(ndpts, nbytes);
+        ctemp = g2c_calloc(ndpts, nbytes);
         sbits(ctemp, ifld, 0, nbytes * 8, 0, ndpts);
         if ((*lcpack = (g2int)enc_jpeg2000(ctemp, width, height, nbits, idrstmpl[5],
                                            idrstmpl[6], retry, (char *)cpack, nsize)) <= 0)
         {
-            printf("jpcpack: ERROR Packing JPC = %d\n", (int)*lcpack);
+            g2c_log_stdout("jpcpack: ERROR Packing JPC = %d\n", (int)*lcpack);
             if (*lcpack == -3)
             {
                 retry = 1;
                 if ((*lcpack = (g2int)enc_jpeg2000(ctemp, width, height, nbits, idrstmpl[5],
                                                    idrstmpl[6], retry, (char *)cpack, nsize)) <= 0)
-                    printf("jpcpack: Retry Failed.\n");
+                    g2c_log_stdout("jpcpack: Retry Failed.\n");
                 else
-                    printf("jpcpack: Retry Successful.\n");
+                    g2c_log_stdout("jpcpack: Retry Successful.\n");
             }
         }
-        free(ctemp);
+        g2c_free(ctemp);
     }
     else
     {
@@ -149,5 +149,5 @@ jpcpack(g2float *fld, g2int width, g2int height, g2int *idrstmpl,
     if (idrstmpl[5] == 0)
         idrstmpl[6] = 255;       /* lossy not used */
     if (ifld)
-        free(ifld);
+        g2c_free(ifld);
 }
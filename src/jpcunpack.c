@@ -21,7 +21,9 @@
  * @param ndpts The number of data values to unpack.
  * @param fld Contains the unpacked data values.
  *
- * @return 0 for success, 1 for memory allocation error.
+ * @return 0 for success, or the error from dec_jpeg2000() if the
+ * code stream can't be decoded, in which case each value is the
+ * scaled reference value.
  *
  * @author Stephem Gilbert @date 2003-08-27
  */
@@ -29,8 +31,37 @@ g2int
 jpcunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
           g2float *fld)
 {
-    g2int *ifld;
-    g2int j, nbits;
+    return g2c_jpcunpack(cpack, len, idrstmpl, ndpts, NULL, fld);
+}
+
+/**
+ * Unpack a data field that was packed into a JPEG2000 code stream,
+ * like jpcunpack(), optionally placing each value on its grid point.
+ * The decoder produces the whole image at once, so the data values
+ * are decoded into the end of the grid array, and expanded from there
+ * in the same array.
+ *
+ * @param cpack The packed data field.
+ * @param len length of packed field cpack.
+ * @param idrstmpl Pointer to array of values for Data Representation
+ * Template 5.40.
+ * @param ndpts The number of data values to unpack.
+ * @param grid NULL to unpack ndpts values to fld, or pointer to the
+ * grid and bitmap to unpack to. ndpts must not be more than
+ * grid->npts.
+ * @param fld Contains the unpacked data values, or the grid points
+ * if grid is not NULL.
+ *
+ * @return 0 for success, or the error from dec_jpeg2000() if the
+ * code stream can't be decoded, in which case each value is the
+ * scaled reference value.
+ */
+g2int
+g2c_jpcunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
+              g2c_grid *grid, g2float *fld)
+{
+    g2float *dfld = grid ? fld + grid->npts - ndpts : fld;
+    g2int j, nbits, ret = 0;
     g2float ref, bscale, dscale;
 
     rdieee(idrstmpl, &ref, 1);
@@ -39,24 +70,23 @@ jpcunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
     nbits = idrstmpl[3];
 
     /* If nbits equals 0, we have a constant field where the reference
-     * value is the data value at each gridpoint. */
+     * value is the data value at each gridpoint. Otherwise the decoded
+     * image values are scaled straight into fld. */
     if (nbits != 0)
     {
-        if (!(ifld = calloc(ndpts, sizeof(g2int))))
-        {
-            fprintf(stderr, "Could not allocate space in jpcunpack.\n  Data field NOT upacked.\n");
-            return G2_JPCUNPACK_MEM;
-        }
-        dec_jpeg2000((char *)cpack, len, ifld);
-        for (j = 0; j < ndpts; j++)
-            fld[j] = (((g2float)ifld[j] * bscale) + ref) * dscale;
-        free(ifld);
+        /* The decoders may stop before writing any values. */
+        if ((ret = dec_jpeg2000_scale((char *)cpack, len, ndpts, ref, bscale,
+                                      dscale, dfld)))
+            for (j = 0; j < ndpts; j++)
+                dfld[j] = ref * dscale;
     }
     else
     {
         for (j = 0; j < ndpts; j++)
-            fld[j] = ref;
+            dfld[j] = ref;
     }
+    if (grid)
+        g2c_expand_tail(grid, ndpts, fld);
 
-    return(0);
+    return ret;
 }
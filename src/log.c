@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @brief Error messages from the library.
+ *
+ * All messages go through g2c_log() or g2c_log_stdout(), which write
+ * each one with a single call, so messages from different threads
+ * are not mixed together, and which can be turned off with
+ * g2c_set_log_level().
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "grib2_int.h"
+
+/** Longest message, including the null. Longer ones are cut off. */
+#define G2C_LOG_LEN 512
+
+/** Level set by g2c_set_log_level(). */
+static int g2c_log_level = 1;
+
+/**
+ * Set whether the library prints error messages. Error codes are
+ * returned either way.
+ *
+ * Call this before using the library, and not while other threads
+ * are using it.
+ *
+ * @param level 0 for no messages, 1 (the default) for error
+ * messages.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL level is negative.
+ */
+int
+g2c_set_log_level(int level)
+{
+    if (level < 0)
+        return G2C_EINVAL;
+    g2c_log_level = level;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Format a message, then write it to a stream with one call, if
+ * messages are on.
+ *
+ * @param stream Where the message goes.
+ * @param fmt Format, as for printf().
+ * @param ap Values for the format.
+ */
+static void
+vlog(FILE *stream, const char *fmt, va_list ap)
+{
+    char buf[G2C_LOG_LEN];
+
+    if (!g2c_log_level)
+        return;
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    fputs(buf, stream);
+}
+
+/**
+ * Print an error message to stderr, if messages are on.
+ *
+ * @param fmt Format, as for printf().
+ * @param ... Values for the format.
+ */
+void
+g2c_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vlog(stderr, fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * Print an error message to stdout, if messages are on. The encoding
+ * functions, g2_info() and g2_getfld() have always printed their
+ * messages to stdout, and still do.
+ *
+ * @param fmt Format, as for printf().
+ * @param ... Values for the format.
+ */
+void
+g2c_log_stdout(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vlog(stdout, fmt, ap);
+    va_end(ap);
+}
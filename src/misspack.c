@@ -44,7 +44,6 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
 {
     g2int *ifld, *ifldmiss, *jfld;
     g2int *jmin, *jmax, *lbit;
-    static g2int zero = 0;
     g2int *gref, *gwidth, *glen;
     g2int glength, grpwidth;
     g2int i, n, iofst, imin, ival1, ival2, isd, minsd, nbitsd = 0;
@@ -54,16 +53,16 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
     g2int ngroups, ng, num0, num1, num2;
     g2int imax, lg, mtemp, ier, igmax;
     g2int kfildo, minpk, inc, maxgrps, ibit, jbit, kbit, novref, lbitref;
+    g2c_bitwriter bw;
     g2float rmissp, rmisss, bscale, dscale, rmin, temp;
     static g2float alog2 = ALOG2;       /*  ln(2.0) */
-    static g2int one = 1;
 
     bscale = int_power(2.0, -idrstmpl[1]);
     dscale = int_power(10.0, idrstmpl[2]);
     missopt = idrstmpl[6];
     if (missopt != 1 && missopt != 2)
     {
-        printf("misspack: Unrecognized option.\n");
+        g2c_log_stdout("misspack: Unrecognized option.\n");
         *lcpack = -1;
         return;
     }
@@ -76,7 +75,7 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
 
     /* Find min value of non-missing values in the data, AND set up
      * missing value mapping of the field. */
-    ifldmiss = calloc(ndpts, sizeof(g2int));
+    ifldmiss = g2c_calloc(ndpts, sizeof(g2int));
     rmin = 1E+37;
     if (missopt ==  1)
     {        /* Primary missing value only */
@@ -121,11 +120,12 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
      * (0). -jfld[j],j = 0,nonmiss-1 is a subarray of just the
      * non-missing values from the original field. */
     iofst = 0;
-    ifld = calloc(ndpts, sizeof(g2int));
-    jfld = calloc(ndpts, sizeof(g2int));
-    gref = calloc(ndpts, sizeof(g2int));
-    gwidth = calloc(ndpts, sizeof(g2int));
-    glen = calloc(ndpts, sizeof(g2int));
+    g2c_bw_init(&bw, cpack, 0);
+    ifld = g2c_calloc(ndpts, sizeof(g2int));
+    jfld = g2c_calloc(ndpts, sizeof(g2int));
+    gref = g2c_calloc(ndpts, sizeof(g2int));
+    gwidth = g2c_calloc(ndpts, sizeof(g2int));
+    glen = g2c_calloc(ndpts, sizeof(g2int));
 
     /* Scale original data. */
     nonmiss = 0;
@@ -211,15 +211,15 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         {
             /*   pack first original value */
             if (ival1 >= 0) {
-                sbit(cpack, &ival1, iofst, nbitsd);
+                g2c_bw_put(&bw, ival1, nbitsd);
                 iofst = iofst + nbitsd;
             }
             else
             {
-                sbit(cpack, &one, iofst, 1);
+                g2c_bw_put(&bw, 1, 1);
                 iofst = iofst + 1;
                 itemp = abs(ival1);
-                sbit(cpack, &itemp, iofst, nbitsd-1);
+                g2c_bw_put(&bw, itemp, nbitsd-1);
                 iofst = iofst + nbitsd - 1;
             }
             if (idrstmpl[16] == 2)
@@ -227,30 +227,30 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
                 /*  pack second original value */
                 if (ival2 >= 0)
                 {
-                    sbit(cpack, &ival2, iofst, nbitsd);
+                    g2c_bw_put(&bw, ival2, nbitsd);
                     iofst = iofst + nbitsd;
                 }
                 else
                 {
-                    sbit(cpack, &one, iofst, 1);
+                    g2c_bw_put(&bw, 1, 1);
                     iofst = iofst + 1;
                     itemp = abs(ival2);
-                    sbit(cpack, &itemp, iofst, nbitsd-1);
+                    g2c_bw_put(&bw, itemp, nbitsd-1);
                     iofst = iofst + nbitsd - 1;
                 }
             }
             /*  pack overall min of spatial differences */
             if (minsd >= 0)
             {
-                sbit(cpack, &minsd, iofst, nbitsd);
+                g2c_bw_put(&bw, minsd, nbitsd);
                 iofst = iofst + nbitsd;
             }
             else
             {
-                sbit(cpack, &one, iofst, 1);
+                g2c_bw_put(&bw, 1, 1);
                 iofst = iofst + 1;
                 itemp = abs(minsd);
-                sbit(cpack, &itemp, iofst, nbitsd-1);
+                g2c_bw_put(&bw, itemp, nbitsd-1);
                 iofst = iofst + nbitsd - 1;
             }
         }
@@ -287,17 +287,17 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
     minpk = 10;
     inc = 1;
     maxgrps = (ndpts / minpk) + 1;
-    jmin = calloc(maxgrps, sizeof(g2int));
-    jmax = calloc(maxgrps, sizeof(g2int));
-    lbit = calloc(maxgrps, sizeof(g2int));
+    jmin = g2c_calloc(maxgrps, sizeof(g2int));
+    jmax = g2c_calloc(maxgrps, sizeof(g2int));
+    lbit = g2c_calloc(maxgrps, sizeof(g2int));
     pack_gp(&kfildo, ifld, &ndpts, &missopt, &minpk, &inc, &miss1, &miss2, 
             jmin, jmax, lbit, glen, &maxgrps, &ngroups, &ibit, &jbit, 
             &kbit, &novref, &lbitref, &ier);
     for (ng = 0; ng < ngroups; ng++)
         glen[ng] = glen[ng] + novref;
-    free(jmin);
-    free(jmax);
-    free(lbit);
+    g2c_free(jmin);
+    g2c_free(jmax);
+    g2c_free(lbit);
 
     /* For each group, find the group's reference value (min) and the
      * number of bits needed to hold the remaining values. */
@@ -406,14 +406,14 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
             if (gref[j] == -2)
                 gref[j] = mtemp-2;
         }
-        sbits(cpack, gref, iofst, nbitsgref, 0, ngroups);
+        g2c_bw_put_n(&bw, gref, nbitsgref, ngroups);
         itemp = nbitsgref * ngroups;
         iofst = iofst + itemp;
         /* Pad last octet with Zeros, if necessary. */
         if ((itemp % 8) != 0)
         {
             left = 8 - (itemp % 8);
-            sbit(cpack, &zero, iofst, left);
+            g2c_bw_put(&bw, 0, left);
             iofst = iofst + left;
         }
     }
@@ -440,14 +440,14 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         nbitsgwidth = (g2int)ceil(temp);
         for (i = 0; i<ngroups; i++)
             gwidth[i] = gwidth[i]-ngwidthref;
-        sbits(cpack, gwidth, iofst, nbitsgwidth, 0, ngroups);
+        g2c_bw_put_n(&bw, gwidth, nbitsgwidth, ngroups);
         itemp = nbitsgwidth * ngroups;
         iofst = iofst + itemp;
         /* Pad last octet with Zeros, if necessary. */
         if ((itemp %8) != 0)
         {
             left = 8 - (itemp % 8);
-            sbit(cpack, &zero, iofst, left);
+            g2c_bw_put(&bw, 0, left);
             iofst = iofst + left;
         }
     }
@@ -477,14 +477,14 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         nbitsglen = (g2int)ceil(temp);
         for (i = 0; i < ngroups - 1; i++)
             glen[i] = glen[i] - nglenref;
-        sbits(cpack, glen, iofst, nbitsglen, 0, ngroups);
+        g2c_bw_put_n(&bw, glen, nbitsglen, ngroups);
         itemp = nbitsglen * ngroups;
         iofst = iofst + itemp;
         /* Pad last octet with Zeros, if necessary. */
         if ((itemp % 8) != 0)
         {
             left = 8 - (itemp % 8);
-            sbit(cpack, &zero, iofst, left);
+            g2c_bw_put(&bw, 0, left);
             iofst = iofst + left;
         }
     }
@@ -505,7 +505,7 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
         grpwidth = gwidth[ng] + ngwidthref;
         if (grpwidth != 0)
         {
-            sbits(cpack, ifld + n, iofst, grpwidth, 0, glength);
+            g2c_bw_put_n(&bw, ifld + n, grpwidth, glength);
             iofst = iofst + (grpwidth * glength);
         }
         n = n + glength;
@@ -515,23 +515,24 @@ misspack(g2float *fld, g2int ndpts, g2int idrsnum, g2int *idrstmpl,
     if ((iofst % 8) != 0)
     {
         left = 8 - (iofst % 8);
-        sbit(cpack, &zero, iofst, left);
+        g2c_bw_put(&bw, 0, left);
         iofst = iofst + left;
     }
+    g2c_bw_flush(&bw);
     *lcpack = iofst / 8;
 
     if (ifld)
-        free(ifld);
+        g2c_free(ifld);
     if (jfld)
-        free(jfld);
+        g2c_free(jfld);
     if (ifldmiss)
-        free(ifldmiss);
+        g2c_free(ifldmiss);
     if (gref)
-        free(gref);
+        g2c_free(gref);
     if (gwidth)
-        free(gwidth);
+        g2c_free(gwidth);
     if (glen)
-        free(glen);
+        g2c_free(glen);
 
     /* Fill in ref value and number of bits in Template 5.2. */
     mkieee(&rmin, idrstmpl, 1); /* ensure reference value is IEEE format */
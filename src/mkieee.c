@@ -23,15 +23,8 @@ mkieee(g2float *a, g2int *rieee, g2int num)
 {
     g2int j,n,ieee,iexp,imant;
     double atemp;
-    static double two23, two126;
-    static g2int test = 0;
-
-    if (test == 0)
-    {
-        two23 = (double)int_power(2.0, 23);
-        two126 = (double)int_power(2.0, 126);
-        test = 1;
-    }
+    const double two23 = 0x1p23;   /* 2**23 */
+    const double two126 = 0x1p126; /* 2**126 */
 
     for (j = 0; j < num; j++)
     {
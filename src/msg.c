@@ -0,0 +1,311 @@
+/**
+ * @file
+ * @brief Build a table of the sections of a GRIB message in one pass,
+ * so that its fields can be decoded in any order without walking the
+ * message again.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/**
+ * Walk the sections of a GRIB2 message, and record the sections used
+ * by each field. The walk stops after section 7 of field stopfld, or
+ * at the end of the message.
+ *
+ * For each field this records the latest sections 1, 2 and 3 before
+ * it, its own sections 4 to 7, and the section 6 holding the bitmap
+ * in effect for it. A section 6 with bitmap indicator 0 defines a
+ * bitmap, 254 keeps the one in effect, and any other value means
+ * there is none.
+ *
+ * @param cgrib Buffer holding the message, which must start in the
+ * first 100 bytes.
+ * @param stopfld Field number to stop after, or 0 to walk the whole
+ * message.
+ * @param verbose If non-zero, print any error messages to stdout.
+ * @param msg The table, which gets the results. msg->fld and
+ * msg->nalloc must be zero, or hold the array of an earlier table,
+ * which is reused. On success, free msg->fld when done.
+ *
+ * @return
+ * - ::G2_NO_ERROR No error.
+ * - ::G2_GETFLD_NO_GRIB Beginning characters "GRIB" not found.
+ * - ::G2_GETFLD_GRIB_VERSION GRIB message is not Edition 2.
+ * - ::G2_GETFLD_WRONG_END End string "7777" found, but not where expected.
+ * - ::G2_GETFLD_BAD_END End string "7777" not found at end of message.
+ * - ::G2_GETFLD_INVAL_SEC Unrecognized Section encountered.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_msg_walk(unsigned char *cgrib, g2int stopfld, int verbose, g2c_msg *msg)
+{
+    g2int sec1 = 0, sec2 = 0, sec3 = 0, bmap6 = 0, bmap3 = 0;
+    g2int j, ipos, lensec, isecnum, ibmap, end;
+    g2c_fldsecs *fs = NULL, *f, *fld = msg->fld;
+    g2int nalloc = msg->nalloc;
+    int ret;
+
+    memset(msg, 0, sizeof(g2c_msg));
+    msg->cgrib = cgrib;
+    msg->fld = fld;
+    msg->nalloc = nalloc;
+
+    /*  Check for beginning of GRIB message in the first 100 bytes. */
+    msg->istart = -1;
+    for (j = 0; j < 100; j++)
+    {
+        if (cgrib[j] == 'G' && cgrib[j + 1] == 'R' && cgrib[j + 2] == 'I' &&
+            cgrib[j + 3] == 'B')
+        {
+            msg->istart = j;
+            break;
+        }
+    }
+    if (msg->istart == -1)
+    {
+        if (verbose)
+            g2c_log_stdout("g2_getfld:  Beginning characters GRIB not found.\n");
+        return G2_GETFLD_NO_GRIB;
+    }
+
+    /*  Unpack Section 0 - Indicator Section. */
+    gbit(cgrib, &msg->discipline, (msg->istart + 6) * 8, 8);
+    gbit(cgrib, &msg->version, (msg->istart + 7) * 8, 8);
+    gbit(cgrib, &msg->lengrib, (msg->istart + 12) * 8, 32);
+    ipos = msg->istart + 16;
+    end = msg->istart + msg->lengrib;
+
+    /*  Currently handles only GRIB Edition 2. */
+    if (msg->version != 2)
+    {
+        if (verbose)
+            g2c_log_stdout("g2_getfld: can only decode GRIB edition 2.\n");
+        return G2_GETFLD_GRIB_VERSION;
+    }
+
+    /* Record where each section is, without unpacking any of them. */
+    for (;;)
+    {
+        /* Check to see if we are at end of GRIB message. */
+        if (cgrib[ipos] == '7' && cgrib[ipos + 1] == '7' && cgrib[ipos + 2] == '7' &&
+            cgrib[ipos + 3] == '7')
+        {
+            if (ipos + 4 != end)
+            {
+                if (verbose)
+                    g2c_log_stdout("g2_getfld: '7777' found, but not where expected.\n");
+                ret = G2_GETFLD_WRONG_END;
+                goto err;
+            }
+            break;
+        }
+
+        /* Get length of Section and Section number. */
+        gbit(cgrib, &lensec, ipos * 8, 32);
+        gbit(cgrib, &isecnum, ipos * 8 + 32, 8);
+        if (isecnum < 1 || isecnum > 7 || lensec < 5)
+        {
+            if (verbose)
+                g2c_log_stdout("g2_getfld: Unrecognized Section Encountered=%ld\n", isecnum);
+            ret = G2_GETFLD_INVAL_SEC;
+            goto err;
+        }
+
+        switch (isecnum)
+        {
+        case 1:
+            sec1 = ipos;
+            break;
+        case 2:
+            sec2 = ipos;
+            msg->numlocal++;
+            break;
+        case 3:
+            sec3 = ipos;
+            break;
+        case 4:
+            /* A new field, which uses the latest sections 1 to 3. */
+            if (msg->numfields == msg->nalloc)
+            {
+                msg->nalloc = msg->nalloc ? 2 * msg->nalloc : 16;
+                if (!(f = g2c_realloc(msg->fld, msg->nalloc * sizeof(g2c_fldsecs))))
+                {
+                    ret = G2C_ENOMEM;
+                    goto err;
+                }
+                msg->fld = f;
+            }
+            fs = &msg->fld[msg->numfields++];
+            memset(fs, 0, sizeof(g2c_fldsecs));
+            fs->sec[1] = sec1;
+            fs->sec[2] = sec2;
+            fs->sec[3] = sec3;
+            fs->sec[4] = ipos;
+            break;
+        case 6:
+            /* Keep track of the bitmap in effect. */
+            gbit(cgrib, &ibmap, ipos * 8 + 40, 8);
+            if (ibmap == 0)
+            {
+                bmap6 = ipos;
+                bmap3 = sec3;
+            }
+            else if (ibmap != 254)
+                bmap6 = bmap3 = 0;
+            if (fs)
+            {
+                fs->sec[6] = ipos;
+                fs->bmap6 = bmap6;
+                fs->bmap3 = bmap3;
+            }
+            break;
+        default:
+            if (fs)
+                fs->sec[isecnum] = ipos;
+        }
+
+        /* Check to see if we read pass the end of the GRIB message
+         * and missed the terminator string '7777'. */
+        ipos = ipos + lensec;
+        if (ipos > end)
+        {
+            if (verbose)
+                g2c_log_stdout("g2_getfld: '7777'  not found at end of GRIB message.\n");
+            ret = G2_GETFLD_BAD_END;
+            goto err;
+        }
+
+        if (isecnum == 7 && stopfld && msg->numfields == stopfld)
+            break;
+    }
+
+    return G2_NO_ERROR;
+
+err:
+    g2c_free(msg->fld);
+    msg->fld = NULL;
+    msg->numfields = msg->nalloc = 0;
+    return ret;
+}
+
+/**
+ * Build the section table of a GRIB2 message, in one pass over the
+ * section headers. Fields can then be decoded in any order with
+ * g2c_msg_getfld(), which goes straight to the sections of the field,
+ * where g2_getfld() walks and unpacks all the sections before the
+ * field on every call.
+ *
+ * The message is not copied, and must not be changed or freed until
+ * the table is closed with g2c_close_msg().
+ *
+ * @param cgrib Buffer holding the message, which must start in the
+ * first 100 bytes.
+ * @param msg Pointer that gets the table.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_NOT_GRIB Not a GRIB edition 2 message.
+ * - ::G2C_EMSG Malformed message.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_open_msg(unsigned char *cgrib, g2c_msg **msg)
+{
+    g2c_msg *m;
+    int ret;
+
+    if (!cgrib || !msg)
+        return G2C_EINVAL;
+    if (!(m = g2c_calloc(1, sizeof(g2c_msg))))
+        return G2C_ENOMEM;
+    if ((ret = g2c_msg_walk(cgrib, 0, 0, m)))
+    {
+        g2c_free(m);
+        if (ret == G2_GETFLD_NO_GRIB || ret == G2_GETFLD_GRIB_VERSION)
+            return G2C_NOT_GRIB;
+        return ret == G2C_ENOMEM ? G2C_ENOMEM : G2C_EMSG;
+    }
+    *msg = m;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Free a section table built by g2c_open_msg().
+ *
+ * @param msg The table.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ */
+int
+g2c_close_msg(g2c_msg *msg)
+{
+    if (!msg)
+        return G2C_EINVAL;
+    g2c_free(msg->fld);
+    g2c_free(msg);
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Get the number of fields and local use sections in a message, as
+ * g2_info() does.
+ *
+ * @param msg The table built by g2c_open_msg().
+ * @param numfields Pointer that gets the number of fields. May be
+ * NULL.
+ * @param numlocal Pointer that gets the number of local use
+ * sections. May be NULL.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ */
+int
+g2c_msg_info(g2c_msg *msg, g2int *numfields, g2int *numlocal)
+{
+    if (!msg)
+        return G2C_EINVAL;
+    if (numfields)
+        *numfields = msg->numfields;
+    if (numlocal)
+        *numlocal = msg->numlocal;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Decode a field of a message, like g2c_getfld(), using the section
+ * table built by g2c_open_msg(). Only the sections used by the field
+ * are read, so decoding all the fields of a message takes time in
+ * proportion to the number of fields, not its square.
+ *
+ * @param msg The table built by g2c_open_msg().
+ * @param ifldnum Specifies which field in the GRIB2 message to
+ * return. The first field is number 1, Fortran style.
+ * @param unpack Boolean value indicating whether to unpack
+ * bitmap/data field.
+ * @param expand Boolean value indicating whether the data points
+ * should be expanded to the correspond grid, if a bit-map is present.
+ * @param flags 0, or ::G2C_BMAP_UINT8 or ::G2C_BMAP_BITS to choose
+ * the bitmap format, and ::G2C_GFLD_ARENA to put the gribfield and its
+ * arrays in one block.
+ * @param gfld pointer to structure gribfield containing all decoded
+ * data for the data field. Free it with g2_free().
+ *
+ * @return As for g2_getfld().
+ */
+g2int
+g2c_msg_getfld(g2c_msg *msg, g2int ifldnum, g2int unpack, g2int expand,
+               int flags, gribfield **gfld)
+{
+    *gfld = NULL;
+    if (!msg || ifldnum <= 0)
+        return G2_GETFLD_INVAL;
+    if (ifldnum > msg->numfields)
+        return G2_GETFLD_WRONG_NFLDS;
+    return g2c_msg_field(msg, ifldnum, unpack, expand, flags, NULL, 0, NULL, gfld);
+}
@@ -220,13 +220,10 @@
  *              misllc = performs the same function for group c that
  *                       mislla and misllb do for groups b and c,
  *                       respectively.
- *            ibxx2(j) = an array that when this routine is first entered
- *                       is set to 2**j, j=0,30. ibxx2(30) = 2**30, which
- *                       is the largest value packable, because 2**31
- *                       is larger than the g2int word size.
- *              ifirst = set by data statement to 0. changed to 1 on
- *                       first
- *                       entry when ibxx2( ) is filled.
+ *            ibxx2(j) = an array that is set to 2**j, j=0,30, each
+ *                       time this routine is entered. ibxx2(30) = 2**30,
+ *                       which is the largest value packable, because
+ *                       2**31 is larger than the g2int word size.
  *               minak = keeps track of the location in ic( ) where the
  *                       minimum value in group a is located.
  *               maxak = does the same as minak, except for the maximum.
@@ -261,25 +258,27 @@ pack_gp(g2int *kfildo, g2int *ic, g2int *nxy,
     /* Initialized data */
 
     const  g2int mallow = 1073741825;   /*  MALLOW=2**30+1  */
-    static g2int ifeed = 12;
-    static g2int ifirst = 0;
+    const g2int ifeed = 12;
 
     /* System generated locals */
     g2int i__1, i__2, i__3;
 
-    /* Local variables */
-    static g2int j, k, l;
-    static g2int adda;
-    static g2int ired, kinc, mina, maxa, minb, maxb, minc, maxc, ibxx2[31];
-    static char cfeed[1];
-    static g2int nenda, nendb, ibita, ibitb, minak, minbk, maxak, maxbk,
-        minck, maxck, nouta, lmiss, itest, nount;
+    /* Local variables. These were static, which made the function
+     * unsafe to call from more than one thread. */
+    g2int j = 0, k = 0, l = 0;
+    g2int adda = 0;
+    g2int ired = 0, kinc = 0, mina = 0, maxa = 0, minb = 0, maxb = 0, minc = 0,
+        maxc = 0, ibxx2[31];
+    char cfeed[1];
+    g2int nenda = 0, nendb = 0, ibita = 0, ibitb = 0, minak = 0, minbk = 0,
+        maxak = 0, maxbk = 0, minck = 0, maxck = 0, nouta = 0, lmiss = 0,
+        itest = 0, nount = 0;
     extern /* Subroutine */ int reduce(g2int *, g2int *, g2int *,
                                        g2int *, g2int *, g2int *, g2int *, g2int *, g2int *,
                                        g2int *, g2int *, g2int *, g2int *);
-    static g2int ibitbs, mislla, misllb, misllc, iersav, lminpk, ktotal,
-        kounta, kountb, kstart, mstart, mintst, maxtst,
-        kounts, mintstk, maxtstk;
+    g2int ibitbs = 0, mislla = 0, misllb = 0, misllc = 0, iersav = 0, lminpk = 0,
+        ktotal = 0, kounta = 0, kountb = 0, kstart = 0, mstart = 0, mintst = 0,
+        maxtst = 0, kounts = 0, mintstk = 0, maxtstk = 0;
     g2int *misslx;
 
 
@@ -290,7 +289,7 @@ pack_gp(g2int *kfildo, g2int *ic, g2int *nxy,
 
 
 /*        MISSLX( ) was AN AUTOMATIC ARRAY. */
-    misslx = (g2int *)calloc(*ndg,sizeof(g2int));
+    misslx = (g2int *)g2c_calloc(*ndg,sizeof(g2int));
 
 
     /* Parameter adjustments */
@@ -328,17 +327,12 @@ L102:
     kinc = (*inc > 1) ? *inc : 1;
     lminpk = *minpk;
 
-/*         CALCULATE THE POWERS OF 2 THE FIRST TIME ENTERED. */
+/*         CALCULATE THE POWERS OF 2. */
 
-    if (ifirst == 0) {
-        ifirst = 1;
-        ibxx2[0] = 1;
-
-        for (j = 1; j <= 30; ++j) {
-            ibxx2[j] = ibxx2[j - 1] << 1;
+    ibxx2[0] = 1;
+    for (j = 1; j <= 30; ++j) {
+        ibxx2[j] = ibxx2[j - 1] << 1;
 /* L104: */
-        }
-
     }
 
 /*        THERE WILL BE A RESTART AT 105 IS NDG IS NOT LARGE ENOUGH. */
@@ -1385,7 +1379,7 @@ L209:
     }
 
     if ( misslx != 0 ) {
-        free(misslx);
+        g2c_free(misslx);
         misslx=0;
     }
 /*     CALL TIMPR(KFILDO,KFILDO,'END   PACK_GP        ') */
@@ -1397,6 +1391,6 @@ L209:
 /* 900  IF(IER.NE.0)RETURN1 */
 
 L900:
-    if ( misslx != 0 ) free(misslx);
+    if ( misslx != 0 ) g2c_free(misslx);
     return 0;
 } /* pack_gp__ */
@@ -259,6 +259,35 @@ getpdsindex(g2int number)
     return getpdsindex;
 }
 
+/**
+ * Fill in the template struct of a Product Definition Template, like
+ * getpdstemplate(), without allocating it.
+ *
+ * @param number The number of the Product Definition Template.
+ * @param tmpl The struct to fill in.
+ *
+ * @return 0 for success, -1 if the template is not defined.
+ */
+int
+g2c_pdstemplate(g2int number, gtemplate *tmpl)
+{
+    g2int index;
+
+    if ((index = getpdsindex(number)) == -1)
+    {
+        g2c_log_stdout("getpdstemplate: PDS Template 4.%d not defined.\n", (int)number);
+        return -1;
+    }
+    tmpl->type = 4;
+    tmpl->num = templatespds[index].template_num;
+    tmpl->maplen = templatespds[index].mappdslen;
+    tmpl->needext = templatespds[index].needext;
+    tmpl->map = (g2int *)templatespds[index].mappds;
+    tmpl->extlen = 0;
+    tmpl->ext = NULL;
+    return 0;
+}
+
 /**
  * This subroutine returns PDS template information for a specified
  * Product Definition Template. The number of entries in the
@@ -280,29 +309,14 @@ getpdsindex(g2int number)
 gtemplate *
 getpdstemplate(g2int number)
 {
-    g2int index;
-    gtemplate *new;
-
-    index = getpdsindex(number);
+    gtemplate tmpl, *new;
 
-    if (index != -1)
-    {
-        new = malloc(sizeof(gtemplate));
-        new->type = 4;
-        new->num = templatespds[index].template_num;
-        new->maplen = templatespds[index].mappdslen;
-        new->needext = templatespds[index].needext;
-        new->map = (g2int *)templatespds[index].mappds;
-        new->extlen = 0;
-        new->ext = NULL;
-        return new;
-    }
-    else {
-        printf("getpdstemplate: PDS Template 4.%d not defined.\n", (int)number);
+    if (g2c_pdstemplate(number, &tmpl))
         return NULL;
-    }
-
-    return NULL;
+    if (!(new = g2c_malloc(sizeof(gtemplate))))
+        return NULL;
+    *new = tmpl;
+    return new;
 }
 
 /**
@@ -343,7 +357,7 @@ extpdstemplate(g2int number, g2int *list)
     if (number == 3)
     {
         new->extlen = list[26];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 1;
@@ -352,7 +366,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 4)
     {
         new->extlen = list[25];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 1;
@@ -363,7 +377,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[21] > 1)
         {
             new->extlen = (list[21] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[21]; j++)
             {
                 l = (j - 2) * 6;
@@ -379,7 +393,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[28] > 1)
         {
             new->extlen = (list[28] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[28]; j++)
             {
                 l = (j - 2) * 6;
@@ -395,7 +409,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[22] > 1)
         {
             new->extlen = (list[22] - 1) * 6;
-            new->ext = (g2int *)malloc(sizeof(g2int)*new->extlen);
+            new->ext = (g2int *)g2c_malloc(sizeof(g2int)*new->extlen);
             for (j = 2; j <= list[22]; j++)
             {
                 l = (j - 2) * 6;
@@ -411,7 +425,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[24] > 1)
         {
             new->extlen = (list[24] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[24]; j++)
             {
                 l = (j - 2) * 6;
@@ -427,7 +441,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[23] > 1)
         {
             new->extlen = (list[23] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[23]; j++)
             {
                 l = (j - 2) * 6;
@@ -441,7 +455,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 13)
     {
         new->extlen = ((list[37] - 1) * 6) + list[26];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         if (list[37] > 1)
         {
             for (j = 2; j <= list[37]; j++)
@@ -464,7 +478,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 14)
     {
         new->extlen = ((list[36] - 1) * 6) + list[25];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         if (list[36] > 1)
         {
             for (j = 2; j <= list[36]; j++)
@@ -487,7 +501,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 30)
     {
         new->extlen = list[4] * 5;
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0;i < list[4]; i++)
         {
             l = i * 5;
@@ -501,7 +515,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 31)
     {
         new->extlen = list[4] * 5;
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < list[4]; i++)
         {
             l = i*5;
@@ -517,7 +531,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[22] > 1)
         {
             new->extlen = (list[22] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[22]; j++)
             {
                 l = (j - 2) * 6;
@@ -533,7 +547,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[25] > 1)
         {
             new->extlen = (list[25] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[25]; j++)
             {
                 l = (j - 2) * 6;
@@ -547,7 +561,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 32)
     {
         new->extlen = list[9] * 10;
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < list[9]; i++)
         {
             l = i * 5;
@@ -563,7 +577,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[27] > 1)
         {
             new->extlen = (list[27] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[27]; j++)
             {
                 l = (j - 2) * 6;
@@ -579,7 +593,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[30] > 1)
         {
             new->extlen = (list[30] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[30]; j++)
             {
                 l = (j - 2) * 6;
@@ -593,7 +607,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 51)
     {
         new->extlen = list[15]*11;
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < list[15]; i++)
         {
             l = i * 6;
@@ -608,7 +622,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 33)
     {
         new->extlen = list[9];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 1;
@@ -617,7 +631,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 34)
     {
         new->extlen = ((list[24] - 1) * 6)+list[9];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         if (list[24] > 1)
         {
             for (j = 2; j <= list[24]; j++)
@@ -640,7 +654,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 53)
     {
         new->extlen = list[3];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < new->extlen; i++)
         {
             new->ext[i] = 1;
@@ -649,7 +663,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 54)
     {
         new->extlen = list[3];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0;i<new->extlen;i++)
         {
             new->ext[i] = 1;
@@ -658,7 +672,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 91)
     {
         new->extlen = ((list[28] - 1) * 6)+list[15];
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         if (list[28] > 1)
         {
             for (j = 2; j <= list[28]; j++)
@@ -682,7 +696,7 @@ extpdstemplate(g2int number, g2int *list)
     else if (number == 57)
     {
         new->extlen = list[6] * 15;
-        new->ext = malloc(sizeof(g2int) * new->extlen);
+        new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
         for (i = 0; i < list[6]; i++)
         {
             l = i*15;
@@ -709,7 +723,7 @@ extpdstemplate(g2int number, g2int *list)
         if (list[30] > 1)
         {
             new->extlen = (list[30] - 1) * 6;
-            new->ext = malloc(sizeof(g2int) * new->extlen);
+            new->ext = g2c_malloc(sizeof(g2int) * new->extlen);
             for (j = 2; j <= list[30]; j++)
             {
                 l = (j - 2) * 6;
@@ -0,0 +1,446 @@
+/**
+ * @file
+ * @brief Decode fields of a GRIB message in a file, reading only the
+ * sections that are needed.
+ *
+ * The message is not read into memory. Section 0 and the section
+ * headers are read in small blocks, to build the table of sections,
+ * and each field is decoded from just the sections it uses. Section 7
+ * is only read when the data is unpacked, so getting the metadata of
+ * a message, or the data of one of its fields, reads a small part of
+ * it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/** Number of bytes read at a time while walking the section
+ * headers. This is enough for section 0 and the metadata sections of
+ * most fields, without reading far into sections 6 and 7. */
+#define PMSG_BLOCK_SIZE 512
+
+/** Largest number of sections used by a field: sections 1 to 7, and
+ * the sections 6 and 3 of its bitmap. */
+#define PMSG_MAX_SECS 9
+
+/** Sections of a field, with their lengths. */
+struct pmsg_fld
+{
+    g2c_fldsecs fs;  /**< Offsets of the sections in the message. */
+    g2int len[8];    /**< Length of each section in fs.sec. */
+    g2int bmap6len;  /**< Length of section fs.bmap6. */
+    g2int bmap3len;  /**< Length of section fs.bmap3. */
+};
+
+/**
+ * GRIB2 message in a file, with its table of sections.
+ */
+struct g2c_pmsg
+{
+    FILE *f;                               /**< The file. */
+    g2int offset;                          /**< Offset of the message in the file. */
+    g2int lengrib;                         /**< Length of the message. */
+    g2int discipline;                      /**< Discipline from section 0. */
+    g2int numlocal;                        /**< Number of local use sections. */
+    g2int numfields;                       /**< Number of fields. */
+    size_t nalloc;                         /**< Allocated length of fld. */
+    struct pmsg_fld *fld;                  /**< Sections of each field. */
+    unsigned char head[PMSG_BLOCK_SIZE];   /**< First block of the message. */
+    g2int head_len;                        /**< Bytes of the message in head. */
+    g2int nread;                           /**< Bytes read from the file. */
+};
+
+/**
+ * Read part of the message, from the first block if it is there.
+ *
+ * @param pmsg The message.
+ * @param off Offset in the message.
+ * @param buf Gets the bytes.
+ * @param len Number of bytes.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EFILE Error reading the file.
+ */
+static int
+pmsg_read(g2c_pmsg *pmsg, g2int off, unsigned char *buf, g2int len)
+{
+    long n;
+
+    if (off + len <= pmsg->head_len)
+    {
+        memcpy(buf, pmsg->head + off, len);
+        return G2C_NO_ERROR;
+    }
+    if ((n = g2c_pread(pmsg->f, pmsg->offset + off, buf, len)) < 0)
+        return G2C_EFILE;
+    pmsg->nread += n;
+    return n == len ? G2C_NO_ERROR : G2C_EFILE;
+}
+
+/**
+ * Open a GRIB2 message in a file, and build its table of sections by
+ * reading section 0 and the section headers. Fields can then be
+ * decoded with g2c_pmsg_getfld(), which reads only the sections the
+ * field needs.
+ *
+ * The file must stay open, and unchanged, until the message is closed
+ * with g2c_close_pmsg(). A message must not be used by more than one
+ * thread at a time, but any number of threads may open the same
+ * message.
+ *
+ * @param f The file, opened for reading in binary mode.
+ * @param offset Offset of the message in the file, as found by
+ * g2c_scan_file().
+ * @param pmsg Pointer that gets the message.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading the file.
+ * - ::G2C_NOT_GRIB No GRIB edition 2 message at the offset.
+ * - ::G2C_EMSG Malformed message.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_open_pmsg(FILE *f, g2int offset, g2c_pmsg **pmsg)
+{
+    g2c_pmsg *pm;
+    unsigned char block[PMSG_BLOCK_SIZE], *win, *p;
+    g2int win_off, win_len, ipos, lensec, isecnum, need, size;
+    g2int sec[4] = {0}, len[4] = {0};
+    g2int bmap6 = 0, bmap6len = 0, bmap3 = 0, bmap3len = 0;
+    struct pmsg_fld *fl = NULL, *newfld;
+    int edition, ret;
+    long n;
+
+    if (!f || offset < 0 || !pmsg)
+        return G2C_EINVAL;
+    if (!(pm = g2c_calloc(1, sizeof(g2c_pmsg))))
+        return G2C_ENOMEM;
+    pm->f = f;
+    pm->offset = offset;
+
+    /* The first block holds section 0, and usually the metadata of
+     * the first field. */
+    if ((n = g2c_pread(f, offset, pm->head, PMSG_BLOCK_SIZE)) < 0)
+    {
+        ret = G2C_EFILE;
+        goto err;
+    }
+    pm->nread = n;
+    if (n < G2C_MSG_HEADER_LEN || !g2c_msg_header(pm->head, &pm->lengrib, &edition) ||
+        edition != 2)
+    {
+        ret = G2C_NOT_GRIB;
+        goto err;
+    }
+    pm->head_len = n < pm->lengrib ? n : pm->lengrib;
+    pm->discipline = pm->head[6];
+    win = pm->head;
+    win_off = 0;
+    win_len = pm->head_len;
+
+    /* Walk the section headers, reading a block whenever the next
+     * header is not in the last one read. */
+    for (ipos = G2C_MSG_HEADER_LEN;; ipos += lensec)
+    {
+        need = pm->lengrib - ipos < 6 ? pm->lengrib - ipos : 6;
+        if (need < 4)
+        {
+            ret = G2C_EMSG;
+            goto err;
+        }
+        if (ipos + need > win_off + win_len)
+        {
+            size = pm->lengrib - ipos < PMSG_BLOCK_SIZE ? pm->lengrib - ipos : PMSG_BLOCK_SIZE;
+            if ((n = g2c_pread(f, offset + ipos, block, size)) < 0)
+            {
+                ret = G2C_EFILE;
+                goto err;
+            }
+            pm->nread += n;
+            if (n < need)
+            {
+                ret = G2C_EMSG;
+                goto err;
+            }
+            win = block;
+            win_off = ipos;
+            win_len = n;
+        }
+        p = win + ipos - win_off;
+
+        /* The end of the message. */
+        if (!memcmp(p, "7777", 4))
+        {
+            if (ipos + 4 != pm->lengrib)
+            {
+                ret = G2C_EMSG;
+                goto err;
+            }
+            break;
+        }
+
+        lensec = (g2int)p[0] << 24 | (g2int)p[1] << 16 | (g2int)p[2] << 8 | p[3];
+        isecnum = need > 4 ? p[4] : 0;
+        if (isecnum < 1 || isecnum > 7 || lensec < 5 || ipos + lensec > pm->lengrib - 4 ||
+            (isecnum == 6 && lensec < 6))
+        {
+            ret = G2C_EMSG;
+            goto err;
+        }
+
+        switch (isecnum)
+        {
+        case 1:
+        case 2:
+        case 3:
+            sec[isecnum] = ipos;
+            len[isecnum] = lensec;
+            if (isecnum == 2)
+                pm->numlocal++;
+            break;
+        case 4:
+            /* A new field, which uses the latest sections 1 to 3. */
+            if (pm->numfields == pm->nalloc)
+            {
+                pm->nalloc = pm->nalloc ? 2 * pm->nalloc : 16;
+                if (!(newfld = g2c_realloc(pm->fld, pm->nalloc * sizeof(struct pmsg_fld))))
+                {
+                    ret = G2C_ENOMEM;
+                    goto err;
+                }
+                pm->fld = newfld;
+            }
+            fl = &pm->fld[pm->numfields++];
+            memset(fl, 0, sizeof(struct pmsg_fld));
+            memcpy(fl->fs.sec, sec, sizeof(sec));
+            memcpy(fl->len, len, sizeof(len));
+            fl->fs.sec[4] = ipos;
+            fl->len[4] = lensec;
+            break;
+        case 6:
+            /* Keep track of the bitmap in effect, as g2c_msg_walk()
+             * does. */
+            if (p[5] == 0)
+            {
+                bmap6 = ipos;
+                bmap6len = lensec;
+                bmap3 = sec[3];
+                bmap3len = len[3];
+            }
+            else if (p[5] != 254)
+                bmap6 = bmap6len = bmap3 = bmap3len = 0;
+            if (fl)
+            {
+                fl->fs.sec[6] = ipos;
+                fl->len[6] = lensec;
+                fl->fs.bmap6 = bmap6;
+                fl->bmap6len = bmap6len;
+                fl->fs.bmap3 = bmap3;
+                fl->bmap3len = bmap3len;
+            }
+            break;
+        default:
+            if (fl)
+            {
+                fl->fs.sec[isecnum] = ipos;
+                fl->len[isecnum] = lensec;
+            }
+        }
+    }
+
+    *pmsg = pm;
+    return G2C_NO_ERROR;
+
+err:
+    g2c_free(pm->fld);
+    g2c_free(pm);
+    return ret;
+}
+
+/**
+ * Close a message opened with g2c_open_pmsg(). The file is not
+ * closed.
+ *
+ * @param pmsg The message.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ */
+int
+g2c_close_pmsg(g2c_pmsg *pmsg)
+{
+    if (!pmsg)
+        return G2C_EINVAL;
+    g2c_free(pmsg->fld);
+    g2c_free(pmsg);
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Get the number of fields and local use sections in a message, and
+ * the number of bytes read from the file for it so far.
+ *
+ * @param pmsg The message opened with g2c_open_pmsg().
+ * @param numfields Pointer that gets the number of fields. May be
+ * NULL.
+ * @param numlocal Pointer that gets the number of local use
+ * sections. May be NULL.
+ * @param nread Pointer that gets the number of bytes read from the
+ * file. May be NULL.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ */
+int
+g2c_pmsg_info(g2c_pmsg *pmsg, g2int *numfields, g2int *numlocal, g2int *nread)
+{
+    if (!pmsg)
+        return G2C_EINVAL;
+    if (numfields)
+        *numfields = pmsg->numfields;
+    if (numlocal)
+        *numlocal = pmsg->numlocal;
+    if (nread)
+        *nread = pmsg->nread;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Decode a field of a message in a file, like g2c_getfld(), reading
+ * only the sections the field uses. Sections 1 to 5 and the header of
+ * section 6 are read for the metadata. The bitmap and section 7 are
+ * only read if the field is unpacked. Sections next to each other in
+ * the file are read together.
+ *
+ * @param pmsg The message opened with g2c_open_pmsg().
+ * @param ifldnum Specifies which field in the GRIB2 message to
+ * return. The first field is number 1, Fortran style.
+ * @param unpack Boolean value indicating whether to unpack
+ * bitmap/data field.
+ * @param expand Boolean value indicating whether the data points
+ * should be expanded to the correspond grid, if a bit-map is present.
+ * @param flags 0, or ::G2C_BMAP_UINT8 or ::G2C_BMAP_BITS to choose
+ * the bitmap format, and ::G2C_GFLD_ARENA to put the gribfield and its
+ * arrays in one block.
+ * @param gfld pointer to structure gribfield containing all decoded
+ * data for the data field. Free it with g2_free().
+ *
+ * @return As for g2_getfld(), and
+ * - ::G2C_EFILE Error reading the file.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+g2int
+g2c_pmsg_getfld(g2c_pmsg *pmsg, g2int ifldnum, g2int unpack, g2int expand,
+                int flags, gribfield **gfld)
+{
+    struct pmsg_fld *fl;
+    g2c_fldsecs fs;
+    g2c_msg msg;
+    g2int *slot[PMSG_MAX_SECS], off[PMSG_MAX_SECS], len[PMSG_MAX_SECS];
+    g2int want_off[PMSG_MAX_SECS], want_len[PMSG_MAX_SECS], want_pos[PMSG_MAX_SECS];
+    g2int pos;
+    unsigned char *buf;
+    int nslot = 0, nwant = 0, i, j, k;
+    g2int ret;
+
+    *gfld = NULL;
+    if (!pmsg || ifldnum <= 0)
+        return G2_GETFLD_INVAL;
+    if (ifldnum > pmsg->numfields)
+        return G2_GETFLD_WRONG_NFLDS;
+    fl = &pmsg->fld[ifldnum - 1];
+    if (!fl->fs.sec[3] || !fl->fs.sec[5] || !fl->fs.sec[6] || (unpack && !fl->fs.sec[7]))
+        return G2_GETFLD_WRONG_NFLDS;
+
+    /* The sections to read, and where their offsets go in the table
+     * of the field. Only the header of section 6 is needed for the
+     * bitmap indicator. */
+    memset(&fs, 0, sizeof(g2c_fldsecs));
+    for (i = 1; i <= (unpack ? 7 : 6); i++)
+    {
+        slot[nslot] = &fs.sec[i];
+        off[nslot] = fl->fs.sec[i];
+        len[nslot++] = i == 6 ? 6 : fl->len[i];
+    }
+    if (unpack)
+    {
+        slot[nslot] = &fs.bmap6;
+        off[nslot] = fl->fs.bmap6;
+        len[nslot++] = fl->bmap6len;
+        slot[nslot] = &fs.bmap3;
+        off[nslot] = fl->fs.bmap3;
+        len[nslot++] = fl->bmap3len;
+    }
+
+    /* Read each section once, in file order. */
+    for (i = 0; i < nslot; i++)
+    {
+        if (!off[i])
+            continue;
+        for (j = 0; j < nwant && want_off[j] < off[i]; j++)
+            ;
+        if (j < nwant && want_off[j] == off[i])
+        {
+            if (len[i] > want_len[j])
+                want_len[j] = len[i];
+            continue;
+        }
+        for (k = nwant++; k > j; k--)
+        {
+            want_off[k] = want_off[k - 1];
+            want_len[k] = want_len[k - 1];
+        }
+        want_off[j] = off[i];
+        want_len[j] = len[i];
+    }
+    for (pos = G2C_MSG_HEADER_LEN, j = 0; j < nwant; j++)
+    {
+        want_pos[j] = pos;
+        pos += want_len[j];
+    }
+
+    /* Copy the sections into a message of their own, with section 0
+     * at the start and '7777' at the end. */
+    if (!(buf = g2c_malloc(pos + 4)))
+        return G2C_ENOMEM;
+    memcpy(buf, pmsg->head, G2C_MSG_HEADER_LEN);
+    memcpy(buf + pos, "7777", 4);
+    for (j = 0; j < nwant; j = k)
+    {
+        for (k = j + 1; k < nwant && want_off[k] == want_off[k - 1] + want_len[k - 1]; k++)
+            ;
+        if ((ret = pmsg_read(pmsg, want_off[j], buf + want_pos[j],
+                             want_pos[k - 1] + want_len[k - 1] - want_pos[j])))
+        {
+            g2c_free(buf);
+            return ret;
+        }
+    }
+    for (i = 0; i < nslot; i++)
+    {
+        if (!off[i])
+            continue;
+        for (j = 0; want_off[j] != off[i]; j++)
+            ;
+        *slot[i] = want_pos[j];
+    }
+
+    memset(&msg, 0, sizeof(g2c_msg));
+    msg.cgrib = buf;
+    msg.lengrib = pos + 4;
+    msg.discipline = pmsg->discipline;
+    msg.version = 2;
+    msg.numfields = msg.nalloc = 1;
+    msg.fld = &fs;
+    if (!(ret = g2c_msg_field(&msg, 1, unpack, expand, flags, NULL, 0, NULL, gfld)))
+        (*gfld)->ifldnum = ifldnum;
+    g2c_free(buf);
+    return ret;
+}
@@ -64,7 +64,7 @@ pngpack(g2float *fld, g2int width, g2int height, g2int *idrstmpl,
      * is the value for each point in the field and set nbits to 0. */
     if (rmin != rmax  &&  maxdif != 0)
     {
-        ifld = malloc(ndpts * sizeof(g2int));
+        ifld = g2c_malloc(ndpts * sizeof(g2int));
 
         /* Determine which algorithm to use based on user-supplied
          * binary scale factor and number of bits. */
@@ -108,15 +108,15 @@ pngpack(g2float *fld, g2int width, g2int height, g2int *idrstmpl,
             nbits = 32;
 
         nbytes = (nbits / 8) * ndpts;
-        ctemp = calloc(nbytes, 1);
+        ctemp = g2c_calloc(nbytes, 1);
         sbits(ctemp, ifld, 0, nbits, 0, ndpts);
 
         /* Encode data into PNG Format. */
         if ((*lcpack = (g2int)enc_png(ctemp, width, height, nbits,
                                       cpack)) <= 0)
-            printf("pngpack: ERROR Packing PNG = %d\n", (int)*lcpack);
+            g2c_log_stdout("pngpack: ERROR Packing PNG = %d\n", (int)*lcpack);
         
-        free(ctemp);
+        g2c_free(ctemp);
     }
     else
     {
@@ -130,5 +130,5 @@ pngpack(g2float *fld, g2int width, g2int height, g2int *idrstmpl,
     idrstmpl[4] = 0;         /* original data were reals */
     
     if (ifld)
-        free(ifld);
+        g2c_free(ifld);
 }
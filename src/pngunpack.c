@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "grib2_int.h"
 
 /**
@@ -20,7 +21,9 @@
  * @param ndpts The number of data values to unpack.
  * @param fld Contains the unpacked data values.
  *
- * @return 0 for success, 1 for memory allocation error.
+ * @return 0 for success, 1 for memory allocation error, or the
+ * error from dec_png() if the image can't be decoded, in which case
+ * each value is the scaled reference value.
  *
  * @author Stephen Gilbert @date 2003-08-27
  */
@@ -28,8 +31,36 @@ g2int
 pngunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
           g2float *fld)
 {
-    g2int *ifld;
+    return g2c_pngunpack(cpack, len, idrstmpl, ndpts, NULL, fld, NULL);
+}
+
+/**
+ * Unpack a data field that was packed with PNG compression, like
+ * pngunpack(), optionally writing each value straight to its grid
+ * point.
+ *
+ * @param cpack The packed data field.
+ * @param len length of packed field cpack.
+ * @param idrstmpl Pointer to array of values for Data Representation
+ * Template 5.41 or 5.40010.
+ * @param ndpts The number of data values to unpack.
+ * @param grid NULL to unpack ndpts values to fld, or pointer to the
+ * grid and bitmap to unpack to.
+ * @param fld Contains the unpacked data values, or the grid points
+ * if grid is not NULL.
+ * @param dec Decoder whose scratch array is used for the image, or
+ * NULL to allocate it for this call.
+ *
+ * @return 0 for success, 1 for memory allocation error, or the
+ * error from dec_png() if the image can't be decoded, in which case
+ * each value is the scaled reference value.
+ */
+g2int
+g2c_pngunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
+              g2c_grid *grid, g2float *fld, g2c_decoder *dec)
+{
     g2int j, nbits, width, height;
+    int ret = 0;
     g2float ref, bscale, dscale;
     unsigned char *ctemp;
 
@@ -39,22 +70,29 @@ pngunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
     nbits = idrstmpl[3];
 
     /* If nbits equals 0, we have a constant field where the reference
-     * value is the data value at each gridpoint. */
+     * value is the data value at each gridpoint. Otherwise the
+     * decoded image is unpacked and scaled straight into fld. */
     if (nbits != 0)
     {
-        ifld = calloc(ndpts, sizeof(g2int));
-        ctemp = calloc(ndpts * 4, 1);
-        if (!ifld || !ctemp)
+        if (!(ctemp = g2c_scratch_alloc(dec, G2C_SCRATCH_CTEMP, ndpts * 4)))
         {
-            fprintf(stderr,"Could not allocate space in jpcunpack.\n  Data field NOT upacked.\n");
+            g2c_log("Could not allocate space in jpcunpack.\n  Data field NOT upacked.\n");
             return G2_JPCUNPACK_MEM;
         }
-        dec_png(cpack, &width, &height, ctemp);
-        gbits(ctemp, ifld, 0, nbits, 0, ndpts);
-        for (j = 0; j < ndpts; j++)
-            fld[j] = (((g2float)ifld[j] * bscale) + ref) * dscale;
-        free(ctemp);
-        free(ifld);
+        /* The scratch array is not cleared, so if the image can't
+         * be decoded, zero it, giving the reference value at each
+         * point. */
+        if ((ret = dec_png(cpack, &width, &height, ctemp)))
+            memset(ctemp, 0, ndpts * 4);
+        if (grid)
+            g2c_unpack_scale_grid(ctemp, 0, nbits, ndpts, ref, bscale, dscale, grid, fld);
+        else
+            g2c_unpack_scale(ctemp, 0, nbits, ndpts, ref, bscale, dscale, fld);
+        g2c_scratch_free(dec, ctemp);
+    }
+    else if (grid)
+    {
+        g2c_unpack_scale_grid(NULL, 0, 0, ndpts, ref, bscale, dscale, grid, fld);
     }
     else
     {
@@ -62,5 +100,5 @@ pngunpack(unsigned char *cpack, g2int len, g2int *idrstmpl, g2int ndpts,
             fld[j] = ref;
     }
 
-    return 0;
+    return ret;
 }
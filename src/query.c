@@ -0,0 +1,324 @@
+/**
+ * @file
+ * @brief Select fields of a message, file or binary index by their
+ * metadata, without unpacking their bitmaps or data.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "grib2_int.h"
+
+/** Relative tolerance when comparing level values. */
+#define LEVEL_TOLERANCE 1e-6
+
+/**
+ * Metadata of a field that a query selects on.
+ */
+struct fldkey
+{
+    g2int discipline;  /**< Discipline. */
+    g2int category;    /**< Parameter category. */
+    g2int number;      /**< Parameter number. */
+    int has_surface;   /**< 1 if the template has the values below. */
+    g2int level_type;  /**< Type of first fixed surface. */
+    g2int level_scale; /**< Scale factor of first fixed surface. */
+    g2int level_value; /**< Scaled value of first fixed surface. */
+    g2int fcst_time;   /**< Forecast time. */
+    g2int ens_member;  /**< Perturbation number, or -1. */
+};
+
+/**
+ * Set up a query that selects every field. Set the members of the
+ * query to select on after this.
+ *
+ * @param query The query.
+ */
+void
+g2c_query_init(g2c_query *query)
+{
+    query->discipline = G2C_ANY;
+    query->category = G2C_ANY;
+    query->number = G2C_ANY;
+    query->level_type = G2C_ANY;
+    query->has_level_value = 0;
+    query->level_value = 0;
+    query->fcst_time = G2C_ANY;
+    query->ens_member = G2C_ANY;
+}
+
+/**
+ * Check whether a field is selected by a query.
+ *
+ * @param q The query.
+ * @param k Metadata of the field.
+ *
+ * @return 1 if the field is selected, 0 otherwise.
+ */
+static int
+match(const g2c_query *q, struct fldkey *k)
+{
+    double v;
+
+    if ((q->discipline != G2C_ANY && q->discipline != k->discipline) ||
+        (q->category != G2C_ANY && q->category != k->category) ||
+        (q->number != G2C_ANY && q->number != k->number))
+        return 0;
+
+    /* Fields whose template does not have a level and forecast time
+     * are only selected if the query does not ask for them. */
+    if (q->level_type == G2C_ANY && !q->has_level_value && q->fcst_time == G2C_ANY &&
+        q->ens_member == G2C_ANY)
+        return 1;
+    if (!k->has_surface)
+        return 0;
+    if ((q->level_type != G2C_ANY && q->level_type != k->level_type) ||
+        (q->fcst_time != G2C_ANY && q->fcst_time != k->fcst_time) ||
+        (q->ens_member != G2C_ANY && q->ens_member != k->ens_member))
+        return 0;
+    if (q->has_level_value)
+    {
+        v = g2c_scaled_value(k->level_scale, k->level_value);
+        if (fabs(v - q->level_value) > LEVEL_TOLERANCE * fmax(fabs(v), 1.0))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Add a match to a growing array.
+ *
+ * @param offset Offset of the message.
+ * @param fldnum Field number in the message.
+ * @param n Position of the field.
+ * @param matches Pointer to the array, which may be reallocated.
+ * @param nmatches Pointer to the number of matches in the array.
+ * @param nalloc Pointer to the allocated size of the array.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+add_match(g2int offset, g2int fldnum, size_t n, g2c_match **matches, size_t *nmatches,
+          size_t *nalloc)
+{
+    g2c_match *m;
+
+    if (*nmatches == *nalloc)
+    {
+        *nalloc = *nalloc ? 2 * *nalloc : 16;
+        if (!(m = g2c_realloc(*matches, *nalloc * sizeof(g2c_match))))
+            return G2C_ENOMEM;
+        *matches = m;
+    }
+    m = &(*matches)[(*nmatches)++];
+    m->offset = offset;
+    m->fldnum = fldnum;
+    m->n = n;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Find the fields of a message, whose sections have been found with
+ * g2c_msg_walk(), that are selected by a query. Only section 4 of
+ * each field is unpacked.
+ *
+ * @param msg Section table of the message.
+ * @param q The query.
+ * @param offset Offset of the message, for the matches.
+ * @param n Pointer to the position of the first field of the
+ * message. It is moved past the fields of the message.
+ * @param matches Pointer to the array of matches.
+ * @param nmatches Pointer to the number of matches.
+ * @param nalloc Pointer to the allocated size of the array.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EMSG Error unpacking section 4.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+query_fields(g2c_msg *msg, const g2c_query *q, g2int offset, size_t *n,
+             g2c_match **matches, size_t *nmatches, size_t *nalloc)
+{
+    struct fldkey k;
+    g2int f, iofst, ipdtnum, *ipdtmpl, ipdtlen, numcoord;
+    g2float *coord_list;
+    int ret = G2C_NO_ERROR;
+
+    for (f = 0; f < msg->numfields && !ret; f++, (*n)++)
+    {
+        iofst = msg->fld[f].sec[4] * 8;
+        if (g2_unpack4(msg->cgrib, &iofst, &ipdtnum, &ipdtmpl, &ipdtlen, &coord_list,
+                       &numcoord))
+            return G2C_EMSG;
+
+        /* Templates 4.0 to 4.15 share the layout of the surfaces and
+         * forecast time, and the ensemble templates 4.1 and 4.11 add
+         * the member after them. */
+        k.discipline = msg->discipline;
+        k.category = ipdtmpl[0];
+        k.number = ipdtmpl[1];
+        k.has_surface = ipdtnum <= 15 && ipdtlen >= 15;
+        if (k.has_surface)
+        {
+            k.fcst_time = ipdtmpl[8];
+            k.level_type = ipdtmpl[9];
+            k.level_scale = ipdtmpl[10];
+            k.level_value = ipdtmpl[11];
+            k.ens_member = -1;
+            if ((ipdtnum == 1 || ipdtnum == 11) && ipdtlen >= 18)
+                k.ens_member = ipdtmpl[16];
+        }
+        if (match(q, &k))
+            ret = add_match(offset, f + 1, *n, matches, nmatches, nalloc);
+        g2c_free(ipdtmpl);
+        g2c_free(coord_list);
+    }
+    return ret;
+}
+
+/**
+ * Find the fields of a message that are selected by a query. Only
+ * section 4 of each field is unpacked. Sections 6 and 7 are never
+ * read.
+ *
+ * @param msg The section table of the message, from g2c_open_msg().
+ * @param query The query.
+ * @param matches Pointer that gets an array of the selected fields,
+ * or NULL if there are none. Free it with free().
+ * @param nmatches Pointer that gets the number of selected fields.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EMSG Error unpacking section 4.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_query_msg(g2c_msg *msg, const g2c_query *query, g2c_match **matches,
+              size_t *nmatches)
+{
+    size_t n = 0, nalloc = 0;
+    int ret;
+
+    if (!msg || !query || !matches || !nmatches)
+        return G2C_EINVAL;
+    *matches = NULL;
+    *nmatches = 0;
+    if ((ret = query_fields(msg, query, msg->istart, &n, matches, nmatches, &nalloc)))
+    {
+        g2c_free(*matches);
+        *matches = NULL;
+        *nmatches = 0;
+    }
+    return ret;
+}
+
+/**
+ * Find the fields of a file that are selected by a query, in one pass
+ * over the file. Only section 4 of each field is unpacked. GRIB1
+ * messages are skipped.
+ *
+ * @param file The file, from g2c_open_file().
+ * @param query The query.
+ * @param matches Pointer that gets an array of the selected fields,
+ * or NULL if there are none. Free it with free().
+ * @param nmatches Pointer that gets the number of selected fields.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EMSG Malformed message.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_query_file(g2c_file *file, const g2c_query *query, g2c_match **matches,
+               size_t *nmatches)
+{
+    g2c_msgloc loc;
+    g2c_msg msg = {0};
+    unsigned char *cgrib;
+    size_t pos = 0, n = 0, nalloc = 0;
+    int ret;
+
+    if (!file || !query || !matches || !nmatches)
+        return G2C_EINVAL;
+    *matches = NULL;
+    *nmatches = 0;
+    while (!(ret = g2c_next_msg(file, &pos, &loc, &cgrib)))
+    {
+        if (loc.edition != 2)
+            continue;
+        if ((ret = g2c_msg_walk(cgrib, 0, 0, &msg)))
+        {
+            ret = ret == G2C_ENOMEM ? G2C_ENOMEM : G2C_EMSG;
+            break;
+        }
+        ret = query_fields(&msg, query, loc.offset, &n, matches, nmatches, &nalloc);
+        if (ret)
+            break;
+    }
+    g2c_free(msg.fld);
+
+    if (ret == G2C_ENOMSG)
+        return G2C_NO_ERROR;
+    g2c_free(*matches);
+    *matches = NULL;
+    *nmatches = 0;
+    return ret;
+}
+
+/**
+ * Find the fields in a binary index that are selected by a query.
+ * Only the index is read, not the GRIB file. The position of each
+ * match is its record number, for g2c_bidx_getdata().
+ *
+ * @param bidx The index, from g2c_open_bidx().
+ * @param query The query.
+ * @param matches Pointer that gets an array of the selected fields,
+ * or NULL if there are none. Free it with free().
+ * @param nmatches Pointer that gets the number of selected fields.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_query_bidx(g2c_bidx *bidx, const g2c_query *query, g2c_match **matches,
+               size_t *nmatches)
+{
+    const g2c_bidx_rec *recs, *r;
+    struct fldkey k;
+    size_t nrecs, i, nalloc = 0;
+    int ret = G2C_NO_ERROR;
+
+    if (!bidx || !query || !matches || !nmatches)
+        return G2C_EINVAL;
+    *matches = NULL;
+    *nmatches = 0;
+    g2c_bidx_recs(bidx, &nrecs, &recs);
+    for (i = 0; i < nrecs && !ret; i++)
+    {
+        r = &recs[i];
+        k.discipline = r->discipline;
+        k.category = r->category;
+        k.number = r->number;
+        k.has_surface = r->ipdtnum <= 15;
+        k.level_type = r->level_type1;
+        k.level_scale = r->level_scale1;
+        k.level_value = r->level_value1;
+        k.fcst_time = r->fcst_time;
+        k.ens_member = r->ens_member;
+        if (match(query, &k))
+            ret = add_match(r->msg_offset, r->fldnum, i, matches, nmatches, &nalloc);
+    }
+    if (ret)
+    {
+        g2c_free(*matches);
+        *matches = NULL;
+        *nmatches = 0;
+    }
+    return ret;
+}
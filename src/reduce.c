@@ -92,24 +92,25 @@ reduce(g2int *kfildo, g2int *jmin, g2int *jmax,
 {
     /* Initialized data */
 
-    static g2int ifeed = 12;
+    const g2int ifeed = 12;
 
     /* System generated locals */
     g2int i__1, i__2;
 
-    /* Local variables */
-    static g2int newboxtp, j, l, m, jj, lxn, left;
-    static g2float pimp;
-    static g2int move, novl;
-    static char cfeed[1];
-    /* static g2int nboxj[31]; */
-    static g2int lxnkp, iorigb, ibxx2m1, movmin,
-        ntotbt[31], ntotpr, newboxt;
+    /* Local variables. These were static, which made the function
+     * unsafe to call from more than one thread. */
+    g2int newboxtp = 0, j = 0, l = 0, m = 0, jj = 0, lxn = 0, left = 0;
+    g2float pimp = 0;
+    g2int move = 0, novl = 0;
+    char cfeed[1];
+    /* g2int nboxj[31]; */
+    g2int lxnkp = 0, iorigb = 0, ibxx2m1 = 0, movmin = 0,
+        ntotbt[31] = {0}, ntotpr = 0, newboxt = 0;
     g2int *newbox, *newboxp;
 
 /*        NEWBOX() AND NEWBOXP() were AUTOMATIC ARRAYS. */
-    newbox = (g2int *)calloc(*ndg,sizeof(g2int));
-    newboxp = (g2int *)calloc(*ndg,sizeof(g2int));
+    newbox = (g2int *)g2c_calloc(*ndg,sizeof(g2int));
+    newboxp = (g2int *)g2c_calloc(*ndg,sizeof(g2int));
 
     /* Parameter adjustments */
     --nov;
@@ -400,8 +401,8 @@ L250:
 
 L410:
     if (newbox)
-        free(newbox);
+        g2c_free(newbox);
     if (newboxp)
-        free(newboxp);
+        g2c_free(newboxp);
     return 0;
 } /* reduce_ */
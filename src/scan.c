@@ -0,0 +1,440 @@
+/**
+ * @file
+ * @brief Find all the GRIB messages in a file or a buffer, in one
+ * pass.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+#ifdef HAVE_PREAD
+#include <unistd.h>
+#endif
+
+/** Number of bytes read from the file at a time. */
+#define SCAN_BUF_SIZE (4 * 1024 * 1024)
+
+/**
+ * Check for the start of a GRIB message. The message starts with
+ * 'GRIB', and has edition 1 or 2 in its 8th byte. The length is in
+ * bytes 5-7 of an edition 1 message, and bytes 9-16 of an edition 2
+ * message.
+ *
+ * @param p Pointer to G2C_MSG_HEADER_LEN bytes that might start a message.
+ * @param bytes Pointer that gets the length of the message.
+ * @param edition Pointer that gets the GRIB edition.
+ *
+ * @return 1 if this looks like the start of a message, 0 otherwise.
+ */
+int
+g2c_msg_header(unsigned char *p, g2int *bytes, int *edition)
+{
+    int i;
+
+    if (p[0] != 'G' || p[1] != 'R' || p[2] != 'I' || p[3] != 'B')
+        return 0;
+    if (p[7] == 1)
+        *bytes = (g2int)p[4] << 16 | (g2int)p[5] << 8 | p[6];
+    else if (p[7] == 2)
+        for (*bytes = 0, i = 8; i < 16; i++)
+            *bytes = *bytes << 8 | p[i];
+    else
+        return 0;
+    *edition = p[7];
+
+    /* Not even room for '7777'. */
+    return *bytes >= G2C_MSG_HEADER_LEN;
+}
+
+/**
+ * Find the next GRIB message in a buffer that starts before an
+ * offset. Candidates are found by searching for 'G' with memchr(),
+ * which the C library does with vector instructions, and the message
+ * is accepted if it ends with '7777' inside the buffer. The message
+ * may end past the offset.
+ *
+ * @param buf Buffer to search.
+ * @param len Length of the buffer.
+ * @param start Offset in the buffer to start searching.
+ * @param stop Offset in the buffer to stop searching. Messages that
+ * start at or after it are not found.
+ * @param loc Pointer that gets the location of the message. Its
+ * offset is from the start of the buffer.
+ *
+ * @return 1 if a message was found, 0 otherwise.
+ */
+int
+g2c_find_msg_before(unsigned char *buf, size_t len, size_t start, size_t stop, g2c_msgloc *loc)
+{
+    unsigned char *p, *end;
+    g2int bytes;
+    int edition;
+
+    if (len < G2C_MSG_HEADER_LEN)
+        return 0;
+    if (stop > len - G2C_MSG_HEADER_LEN + 1)
+        stop = len - G2C_MSG_HEADER_LEN + 1;
+    end = buf + stop;
+    for (p = buf + start; p < end; p++)
+    {
+        if (!(p = memchr(p, 'G', end - p)))
+            break;
+        if (!g2c_msg_header(p, &bytes, &edition))
+            continue;
+        if ((size_t)bytes > len - (p - buf) || memcmp(p + bytes - 4, "7777", 4))
+            continue;
+        loc->offset = p - buf;
+        loc->bytes = bytes;
+        loc->edition = edition;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Find the next GRIB message in a buffer, with
+ * g2c_find_msg_before().
+ *
+ * @param buf Buffer to search.
+ * @param len Length of the buffer.
+ * @param start Offset in the buffer to start searching.
+ * @param loc Pointer that gets the location of the message. Its
+ * offset is from the start of the buffer.
+ *
+ * @return 1 if a message was found, 0 otherwise.
+ */
+int
+g2c_find_msg(unsigned char *buf, size_t len, size_t start, g2c_msgloc *loc)
+{
+    return g2c_find_msg_before(buf, len, start, len, loc);
+}
+
+/**
+ * Add a message location to a growing array.
+ *
+ * @param loc Location to add.
+ * @param msgs Pointer to the array, which may be reallocated.
+ * @param nmsgs Pointer to the number of locations in the array.
+ * @param nalloc Pointer to the allocated size of the array.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+add_msg(g2c_msgloc *loc, g2c_msgloc **msgs, size_t *nmsgs, size_t *nalloc)
+{
+    g2c_msgloc *m;
+
+    if (*nmsgs == *nalloc)
+    {
+        *nalloc = *nalloc ? 2 * *nalloc : 64;
+        if (!(m = g2c_realloc(*msgs, *nalloc * sizeof(g2c_msgloc))))
+            return G2C_ENOMEM;
+        *msgs = m;
+    }
+    (*msgs)[(*nmsgs)++] = *loc;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Find all the GRIB messages in a buffer.
+ *
+ * Messages do not overlap, so the search for the next message starts
+ * where the last one ended.
+ *
+ * @param buf Buffer to search.
+ * @param len Length of the buffer.
+ * @param msgs Pointer that gets an array of message locations, with
+ * offsets from the start of the buffer, or NULL if there are no
+ * messages. Free it with free().
+ * @param nmsgs Pointer that gets the number of messages.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_scan_buf(unsigned char *buf, size_t len, g2c_msgloc **msgs, size_t *nmsgs)
+{
+    g2c_msgloc loc;
+    size_t pos = 0, nalloc = 0;
+    int ret;
+
+    *msgs = NULL;
+    *nmsgs = 0;
+    while (g2c_find_msg(buf, len, pos, &loc))
+    {
+        if ((ret = add_msg(&loc, msgs, nmsgs, &nalloc)))
+        {
+            g2c_free(*msgs);
+            *msgs = NULL;
+            *nmsgs = 0;
+            return ret;
+        }
+        pos = loc.offset + loc.bytes;
+    }
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Read part of a file, at an offset. Where pread() is available it is
+ * used, so the file position is not changed, and threads may read the
+ * same file at once.
+ *
+ * @param f The file.
+ * @param offset Where to start reading.
+ * @param buf Gets the bytes.
+ * @param len Number of bytes to read.
+ *
+ * @return Number of bytes read, which is less than len at the end of
+ * the file, or -1 on a read or seek error.
+ */
+long
+g2c_pread(FILE *f, g2int offset, void *buf, size_t len)
+{
+#ifdef HAVE_PREAD
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < len)
+    {
+        if ((n = pread(fileno(f), (char *)buf + done, len - done, offset + done)) < 0)
+            return -1;
+        if (!n)
+            break;
+        done += n;
+    }
+    return (long)done;
+#else
+    if (fseek(f, (long)offset, SEEK_SET))
+        return -1;
+    return (long)fread(buf, 1, len, f);
+#endif
+}
+
+/**
+ * Find the GRIB messages in a file, from an offset, in one pass.
+ *
+ * The file is read in large blocks, which are searched for messages
+ * with g2c_find_msg(). When a message ends past the end of the block,
+ * only its last 4 bytes are read to check for '7777', and reading
+ * resumes at the end of the message. The bodies of large messages are
+ * never read, so a file of large messages is scanned with a few small
+ * reads per message.
+ *
+ * @param f The file, opened for reading in binary mode.
+ * @param start Offset to start at.
+ * @param tail If non-zero, stop at a message that runs past the end
+ * of the file, since the rest of it may not have been written yet.
+ * Otherwise it is skipped.
+ * @param msgs Pointer that gets an array of message locations, with
+ * offsets from the start of the file, or NULL if there are no
+ * messages. Free it with free().
+ * @param nmsgs Pointer that gets the number of messages.
+ * @param resume Pointer that gets the offset to start at to find
+ * messages added to the file after this. May be NULL.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ * - ::G2C_EFILE Error reading the file.
+ */
+static int
+scan(FILE *f, g2int start, int tail, g2c_msgloc **msgs, size_t *nmsgs, g2int *resume)
+{
+    unsigned char *buf, *p, tail4[4];
+    g2c_msgloc loc;
+    g2int pos = start, next, bytes;
+    size_t k, last, nalloc = 0;
+    long nread, ntail;
+    int edition, partial = 0, ret = G2C_NO_ERROR;
+
+    *msgs = NULL;
+    *nmsgs = 0;
+    if (!(buf = g2c_malloc(SCAN_BUF_SIZE)))
+        return G2C_ENOMEM;
+
+    /* Each pass of this loop reads a block starting at file offset
+     * pos, and finds the messages that start in it. */
+    while ((nread = g2c_pread(f, pos, buf, SCAN_BUF_SIZE)) >= G2C_MSG_HEADER_LEN)
+    {
+        last = nread - G2C_MSG_HEADER_LEN + 1;
+        next = -1;
+        for (k = 0; k < last; k++)
+        {
+            if (!(p = memchr(buf + k, 'G', last - k)))
+                break;
+            k = p - buf;
+            if (!g2c_msg_header(p, &bytes, &edition))
+                continue;
+
+            /* Check for '7777', in this block if it is there. */
+            if (k + bytes <= (size_t)nread)
+            {
+                if (memcmp(p + bytes - 4, "7777", 4))
+                    continue;
+            }
+            else if ((ntail = g2c_pread(f, pos + k + bytes - 4, tail4, 4)) != 4 ||
+                     memcmp(tail4, "7777", 4))
+            {
+                /* The end of the message may not be written yet. */
+                if (tail && ntail >= 0 && ntail < 4)
+                {
+                    partial = 1;
+                    break;
+                }
+                continue;
+            }
+
+            loc.offset = pos + k;
+            loc.bytes = bytes;
+            loc.edition = edition;
+            if ((ret = add_msg(&loc, msgs, nmsgs, &nalloc)))
+                break;
+
+            /* Carry on after the message, in the next block if it
+             * ends past this one. */
+            if (k + bytes > (size_t)nread)
+            {
+                next = pos + k + bytes;
+                break;
+            }
+            k += bytes - 1;
+        }
+        if (ret)
+            break;
+        if (partial)
+        {
+            pos += k;
+            break;
+        }
+
+        /* If no message ran past the end of this block, the next
+         * block starts where a message header could have been cut
+         * off, unless this was the end of the file. */
+        if (next < 0)
+        {
+            next = pos + (k > last ? k : last);
+            if (nread < SCAN_BUF_SIZE)
+            {
+                pos = next;
+                break;
+            }
+        }
+        pos = next;
+    }
+
+    if (nread < 0)
+        ret = G2C_EFILE;
+    g2c_free(buf);
+    if (ret)
+    {
+        g2c_free(*msgs);
+        *msgs = NULL;
+        *nmsgs = 0;
+    }
+    else if (resume)
+        *resume = pos;
+    return ret;
+}
+
+/**
+ * Find all the GRIB messages in a file, in one pass. See scan() for
+ * how the file is read.
+ *
+ * @param f The file, opened for reading in binary mode.
+ * @param msgs Pointer that gets an array of message locations, with
+ * offsets from the start of the file, or NULL if there are no
+ * messages. Free it with free().
+ * @param nmsgs Pointer that gets the number of messages.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ * - ::G2C_EFILE Error reading the file.
+ */
+int
+g2c_scan_file(FILE *f, g2c_msgloc **msgs, size_t *nmsgs)
+{
+    return scan(f, 0, 0, msgs, nmsgs, NULL);
+}
+
+/**
+ * Find the complete GRIB messages added to a file since it was last
+ * scanned, for following a file while it is written.
+ *
+ * The scan starts at *offset, which is 0 the first time, and stops
+ * at a message whose end is not yet in the file, without skipping
+ * it. *offset is then set to where to start the next scan, which is
+ * the start of that message, or where the scan reached. So each
+ * complete message is found once, however the file grows between
+ * scans.
+ *
+ * The file must only be appended to. Where pread() is available the
+ * file is read with it, so new data is seen without reopening the
+ * file.
+ *
+ * @param f The file, opened for reading in binary mode.
+ * @param offset Pointer to the offset to start at. It gets the
+ * offset to start at next time.
+ * @param msgs Pointer that gets an array of the locations of the new
+ * messages, with offsets from the start of the file, or NULL if there
+ * are none. Free it with free().
+ * @param nmsgs Pointer that gets the number of new messages.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_ENOMEM Out of memory.
+ * - ::G2C_EFILE Error reading the file.
+ */
+int
+g2c_scan_tail(FILE *f, g2int *offset, g2c_msgloc **msgs, size_t *nmsgs)
+{
+    if (!f || !offset || *offset < 0 || !msgs || !nmsgs)
+        return G2C_EINVAL;
+    return scan(f, *offset, 1, msgs, nmsgs, offset);
+}
+
+/**
+ * Read the GRIB message that starts at a known offset in a file, for
+ * example one found with g2c_scan_file() or in an index.
+ *
+ * @param f The file, opened for reading in binary mode.
+ * @param offset Offset of the message in the file.
+ * @param cgrib Pointer that gets the message. Free it with free().
+ * @param lengrib Pointer that gets the length of the message.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading the file.
+ * - ::G2C_NOT_GRIB No complete GRIB message at the offset.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_read_msg(FILE *f, g2int offset, unsigned char **cgrib, g2int *lengrib)
+{
+    unsigned char header[G2C_MSG_HEADER_LEN], *buf;
+    g2int bytes;
+    long nread;
+    int edition;
+
+    if (!f || offset < 0 || !cgrib || !lengrib)
+        return G2C_EINVAL;
+    if ((nread = g2c_pread(f, offset, header, G2C_MSG_HEADER_LEN)) < 0)
+        return G2C_EFILE;
+    if (nread < G2C_MSG_HEADER_LEN || !g2c_msg_header(header, &bytes, &edition))
+        return G2C_NOT_GRIB;
+    if (!(buf = g2c_malloc(bytes)))
+        return G2C_ENOMEM;
+    if (g2c_pread(f, offset, buf, bytes) != bytes || memcmp(buf + bytes - 4, "7777", 4))
+    {
+        g2c_free(buf);
+        return G2C_NOT_GRIB;
+    }
+    *cgrib = buf;
+    *lengrib = bytes;
+    return G2C_NO_ERROR;
+}
@@ -4,6 +4,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "grib2_int.h"
 
 /** 8 bits per byte. */
@@ -15,7 +16,8 @@
  * by lugb for mseek bytes at a time. If found, the starting position
  * and length of the message are returned in lskip and lgrib,
  * respectively. The search is terminated when an EOF or I/O error is
- * encountered.
+ * encountered. When a message is found, the file is left positioned
+ * just after it.
  *
  * ### Program History Log
  * Date | Programmer | Comments
@@ -40,10 +42,10 @@ seekgb(FILE *lugb, g2int iseek, g2int mseek, g2int *lskip, g2int *lgrib)
 {
     g2int k, k4, ipos, nread, lim, start, vers, lengrib;
     int end;
-    unsigned char *cbuf;
+    unsigned char *cbuf, *p;
 
     *lgrib = 0;
-    cbuf = (unsigned char *)malloc(mseek);
+    cbuf = (unsigned char *)g2c_malloc(mseek);
     nread = mseek;
     ipos = iseek;
 
@@ -55,9 +57,14 @@ seekgb(FILE *lugb, g2int iseek, g2int mseek, g2int *lskip, g2int *lgrib)
         nread = fread(cbuf, sizeof(unsigned char), mseek, lugb);
         lim = nread - 8;
 
-        /* Look for 'grib...' in partial section. */
+        /* Look for 'GRIB' in partial section, finding each 'G' with
+         * memchr(). */
         for (k = 0; k < lim; k++)
         {
+            if (!(p = memchr(cbuf + k, 'G', lim - k)))
+                break;
+            k = p - cbuf;
+
             /* Look at the first 4 bytes - should be 'GRIB'. */
             gbit(cbuf, &start, k * BITS_PER_BYTE, 4 * BITS_PER_BYTE);
 
@@ -74,16 +81,27 @@ seekgb(FILE *lugb, g2int iseek, g2int mseek, g2int *lskip, g2int *lgrib)
                 if (vers == 2)
                     gbit(cbuf, &lengrib, (k + 12) * BITS_PER_BYTE, 4 * BITS_PER_BYTE);
 
-                /* Read the last 4 bytesof the message. */
-                fseek(lugb, ipos + k + lengrib - 4, SEEK_SET);
-                k4 = fread(&end, 4, 1, lugb);
-                
+                /* Get the last 4 bytes of the message, from the
+                 * buffer if they are in it. */
+                if (lengrib >= 4 && k + lengrib <= nread)
+                {
+                    memcpy(&end, cbuf + k + lengrib - 4, 4);
+                    k4 = 1;
+                }
+                else
+                {
+                    fseek(lugb, ipos + k + lengrib - 4, SEEK_SET);
+                    k4 = fread(&end, 4, 1, lugb);
+                }
+
                 /* Look for '7777' at end of grib message. */
                 if (k4 == 1 && end == 926365495)
                 {
-                    /* GRIB message found. */
+                    /* GRIB message found. Leave the file just after
+                     * it, as reading its end from the file does. */
                     *lskip = ipos + k;
                     *lgrib = lengrib;
+                    fseek(lugb, ipos + k + lengrib, SEEK_SET);
                     break;
                 }
             }
@@ -91,5 +109,5 @@ seekgb(FILE *lugb, g2int iseek, g2int mseek, g2int *lskip, g2int *lgrib)
         ipos = ipos + lim;
     }
 
-    free(cbuf);
+    g2c_free(cbuf);
 }
@@ -0,0 +1,1697 @@
+/** @file
+ * @brief SIMD kernels to unpack fixed-width values from a packed bit
+ * string and to pack them into one, with the kernels chosen for the
+ * CPU when the library is loaded, and the fused unpack-and-scale used
+ * by the decoders.
+ *
+ * All unpack kernels produce results identical to g2c_gbits32(),
+ * which is the portable reference. Each kernel handles as much of the
+ * input as it can with whole vector loads that stay inside the bytes
+ * holding the requested values, and hands the rest to g2c_gbits32().
+ *
+ * The pack kernels merge neighboring values in vector registers into
+ * chunks of up to 64 bits, and hand the chunks to the bit writer, so
+ * that the writer does one step per chunk instead of one per
+ * value. Their output is identical to g2c_bw_put_n32().
+ *
+ * Bitmaps get their own 1-bit kernels, which turn each byte of the
+ * bitmap into 8 integers, or 8 integers into a byte, with a lookup
+ * table or a vector mask instead of the general bit packing loops.
+ *
+ * Kernels are built with per-function target attributes, so the
+ * library as a whole is compiled for the baseline instruction set and
+ * runs on any x86-64 CPU.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/** Number of values unpacked at a time by g2c_unpack_scale(). Small
+ * enough that the block stays in L1 cache between the unpack and the
+ * scaling. */
+#define UNPACK_BLOCK 512
+
+/** Number of merged chunks the pack kernels collect before handing
+ * them to the bit writer. */
+#define PACK_CHUNKS 64
+
+#if defined USE_SIMD && defined __GNUC__ && defined __x86_64__
+#define HAVE_X86_KERNELS 1 /**< Build the x86-64 SIMD kernels. */
+#include <immintrin.h>
+#endif
+
+/** The unpack kernel chosen for this CPU. */
+static g2c_unpack32_func unpack32_kernel = g2c_gbits32;
+
+/** The pack kernel chosen for this CPU. */
+static g2c_pack32_func pack32_kernel = g2c_bw_put_n32;
+
+/** Number of grid points expanded at a time by g2c_expand(). */
+#define EXPAND_BLOCK 512
+
+/** The SIMD level chosen for this CPU. */
+static int simd_level = G2C_SIMD_SCALAR;
+
+/** The 8 bits of byte b, most significant first, each in its own
+ * byte of a 64-bit word, first bit in the low byte. */
+#define SPREAD(b) ((uint64_t)((b) >> 7 & 1) | (uint64_t)((b) >> 6 & 1) << 8 | \
+                   (uint64_t)((b) >> 5 & 1) << 16 | (uint64_t)((b) >> 4 & 1) << 24 | \
+                   (uint64_t)((b) >> 3 & 1) << 32 | (uint64_t)((b) >> 2 & 1) << 40 | \
+                   (uint64_t)((b) >> 1 & 1) << 48 | (uint64_t)((b) & 1) << 56)
+#define SPREAD4(b) SPREAD(b), SPREAD((b) + 1), SPREAD((b) + 2), SPREAD((b) + 3) /**< 4 table entries. */
+#define SPREAD16(b) SPREAD4(b), SPREAD4((b) + 4), SPREAD4((b) + 8), SPREAD4((b) + 12) /**< 16 table entries. */
+#define SPREAD64(b) SPREAD16(b), SPREAD16((b) + 16), SPREAD16((b) + 32), SPREAD16((b) + 48) /**< 64 table entries. */
+
+/** Bits of each possible bitmap byte, spread out one per byte. */
+static const uint64_t spread_lut[256] = {SPREAD64(0), SPREAD64(64), SPREAD64(128),
+                                         SPREAD64(192)};
+
+/**
+ * Expand bitmap bytes into one integer (0 or 1) per bit, most
+ * significant bit first, using a byte lookup table. This is the
+ * portable bitmap expand kernel.
+ *
+ * @param in Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param bmap Gets 8 * nbytes values.
+ */
+static void
+bitmap_expand_scalar(unsigned char *in, g2int nbytes, g2int *bmap)
+{
+    uint64_t w;
+    g2int i;
+    int k;
+
+    for (i = 0; i < nbytes; i++, bmap += 8)
+    {
+        w = spread_lut[in[i]];
+        for (k = 0; k < 8; k++)
+            bmap[k] = (g2int)((w >> (8 * k)) & 0xff);
+    }
+}
+
+/**
+ * Compress integers into bitmap bytes, taking the low order bit of
+ * each, most significant bit first. This is the portable bitmap
+ * compress kernel.
+ *
+ * @param bmap Pointer to 8 * nbytes values.
+ * @param nbytes Number of bytes.
+ * @param out Gets the bitmap bytes.
+ */
+static void
+bitmap_compress_scalar(g2int *bmap, g2int nbytes, unsigned char *out)
+{
+    unsigned int b;
+    g2int i;
+    int k;
+
+    for (i = 0; i < nbytes; i++, bmap += 8)
+    {
+        b = 0;
+        for (k = 0; k < 8; k++)
+            b = (b << 1) | (unsigned int)(bmap[k] & 1);
+        out[i] = (unsigned char)b;
+    }
+}
+
+/** The bitmap expand kernel chosen for this CPU. */
+static g2c_bitmap_expand_func bitmap_expand_kernel = bitmap_expand_scalar;
+
+/** The bitmap compress kernel chosen for this CPU. */
+static g2c_bitmap_compress_func bitmap_compress_kernel = bitmap_compress_scalar;
+
+/** Number of set bits in bitmap byte b, from its spread out bits. */
+#define MASK_COUNT(b) ((int)((spread_lut[b] * 0x0101010101010101ULL) >> 56))
+
+/**
+ * Expand data values to grid points, one bitmap byte (8 grid points)
+ * at a time. Points whose bit is set take the next data value, the
+ * others get the fill value. This is the portable expand kernel.
+ *
+ * @param mask Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param in Pointer to the data values.
+ * @param fill Value for points that are bitmapped out.
+ * @param out Gets 8 * nbytes grid points.
+ *
+ * @return The number of data values used.
+ */
+static g2int
+expand_scalar(unsigned char *mask, g2int nbytes, g2float *in, g2float fill,
+              g2float *out)
+{
+    g2int i, m = 0;
+    int k, bit;
+
+    for (i = 0; i < nbytes; i++, out += 8)
+    {
+        for (k = 0; k < 8; k++)
+        {
+            bit = (mask[i] >> (7 - k)) & 1;
+            out[k] = bit ? in[m] : fill;
+            m += bit;
+        }
+    }
+    return m;
+}
+
+/** The expand kernel chosen for this CPU. */
+static g2c_expand_func expand_kernel = expand_scalar;
+
+/**
+ * Contract grid points to data values, one bitmap byte (8 grid
+ * points) at a time, keeping the points whose bit is set. Every
+ * point is stored, and then kept or not, so one value is written past
+ * the last data value. This is the portable contract kernel.
+ *
+ * @param mask Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param in Pointer to 8 * nbytes grid points.
+ * @param out Gets the data values. May be the same as in.
+ *
+ * @return The number of data values.
+ */
+static g2int
+contract_scalar(unsigned char *mask, g2int nbytes, g2float *in, g2float *out)
+{
+    g2int i, m = 0;
+    int k;
+
+    for (i = 0; i < nbytes; i++, in += 8)
+    {
+        for (k = 0; k < 8; k++)
+        {
+            out[m] = in[k];
+            m += (mask[i] >> (7 - k)) & 1;
+        }
+    }
+    return m;
+}
+
+/** The contract kernel chosen for this CPU. */
+static g2c_contract_func contract_kernel = contract_scalar;
+
+#ifdef HAVE_X86_KERNELS
+
+/**
+ * Fill in the byte shuffle pattern and bit shifts that extract 4
+ * values of nbits (1 to 25) bits from a 16-byte load. The load starts
+ * at the byte holding the first bit of the first value, and that bit
+ * is r bits into the byte. Each 32-bit element of the result holds
+ * the big-endian 4-byte window containing one value, so that shifting
+ * it left by the element's shift count and then right by (32 - nbits)
+ * leaves the value.
+ *
+ * @param r Bit offset of the first value within the first byte (0-7).
+ * @param nbits Number of bits in each value.
+ * @param shuf Gets 16 shuffle indexes.
+ * @param shift Gets 4 left shift counts.
+ */
+static void
+lane32_pattern(int r, int nbits, unsigned char *shuf, uint32_t *shift)
+{
+    int k, j, b;
+
+    for (k = 0; k < 4; k++)
+    {
+        b = r + k * nbits;
+        for (j = 0; j < 4; j++)
+            shuf[4 * k + j] = (unsigned char)((b >> 3) + 3 - j);
+        shift[k] = b & 7;
+    }
+}
+
+/**
+ * Fill in the byte shuffle pattern and bit shifts that extract 2
+ * values of nbits (1 to 32) bits from a 16-byte load into 64-bit
+ * elements. This is the wide-value counterpart of lane32_pattern().
+ *
+ * @param r Bit offset of the first value within the first byte (0-7).
+ * @param nbits Number of bits in each value.
+ * @param shuf Gets 16 shuffle indexes.
+ * @param shift Gets 2 left shift counts.
+ */
+static void
+lane64_pattern(int r, int nbits, unsigned char *shuf, uint64_t *shift)
+{
+    int k, j, b;
+
+    for (k = 0; k < 2; k++)
+    {
+        b = r + k * nbits;
+        for (j = 0; j < 8; j++)
+            shuf[8 * k + j] = (unsigned char)((b >> 3) + 7 - j);
+        shift[k] = b & 7;
+    }
+}
+
+/**
+ * SSE4.1 unpack kernel. Handles 8 values per iteration for widths of
+ * up to 25 bits, using a byte shuffle to gather each value's 4-byte
+ * window and a multiply by a power of two for the per-value left
+ * shift. Wider values are left to g2c_gbits32().
+ *
+ * @param in Pointer to character array input.
+ * @param iout Pointer to unpacked array output.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value, 0 to 32.
+ * @param n Number of values.
+ */
+__attribute__((target("sse4.1")))
+static void
+unpack32_sse41(unsigned char *in, uint32_t *iout, g2int iskip, g2int nbits,
+               g2int n)
+{
+    unsigned char *end = in + (iskip + nbits * n + 7) / 8;
+    unsigned char *p = in + iskip / 8;
+    unsigned char shuf[32];
+    uint32_t shift[8], mult[8];
+    __m128i mask0, mask1, mult0, mult1, cnt, v0, v1;
+    g2int i = 0;
+    int r0, off1, k;
+
+    if (nbits >= 1 && nbits <= 25)
+    {
+        /* The 8 values of an iteration span nbits whole bytes, so the
+         * patterns for both halves are the same on every iteration. */
+        r0 = iskip % 8;
+        off1 = (r0 + 4 * nbits) / 8;
+        lane32_pattern(r0, nbits, shuf, shift);
+        lane32_pattern((r0 + 4 * nbits) % 8, nbits, shuf + 16, shift + 4);
+        for (k = 0; k < 8; k++)
+            mult[k] = 1u << shift[k];
+        mask0 = _mm_loadu_si128((__m128i *)shuf);
+        mask1 = _mm_loadu_si128((__m128i *)(shuf + 16));
+        mult0 = _mm_loadu_si128((__m128i *)mult);
+        mult1 = _mm_loadu_si128((__m128i *)(mult + 4));
+        cnt = _mm_cvtsi32_si128(32 - (int)nbits);
+
+        for (; i + 8 <= n && p + off1 + 16 <= end; i += 8, p += nbits)
+        {
+            v0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)p), mask0);
+            v1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(p + off1)), mask1);
+            v0 = _mm_srl_epi32(_mm_mullo_epi32(v0, mult0), cnt);
+            v1 = _mm_srl_epi32(_mm_mullo_epi32(v1, mult1), cnt);
+            _mm_storeu_si128((__m128i *)(iout + i), v0);
+            _mm_storeu_si128((__m128i *)(iout + i + 4), v1);
+        }
+    }
+
+    g2c_gbits32(in, iout + i, iskip + i * nbits, nbits, n - i);
+}
+
+/**
+ * AVX2 unpack kernel. Handles 8 values per iteration for widths of up
+ * to 25 bits, with a byte shuffle in each 128-bit lane and variable
+ * 32-bit shifts. Widths of 26 to 32 bits, whose values can span 5
+ * bytes, are extracted from 64-bit elements, 8 values per iteration.
+ *
+ * @param in Pointer to character array input.
+ * @param iout Pointer to unpacked array output.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value, 0 to 32.
+ * @param n Number of values.
+ */
+__attribute__((target("avx2")))
+static void
+unpack32_avx2(unsigned char *in, uint32_t *iout, g2int iskip, g2int nbits,
+              g2int n)
+{
+    unsigned char *end = in + (iskip + nbits * n + 7) / 8;
+    unsigned char *p = in + iskip / 8;
+    unsigned char shuf[64];
+    uint32_t shift[8];
+    uint64_t shift64[8];
+    __m256i mask, mask1, shifts, shifts1, narrow, v, v1;
+    __m128i cnt;
+    g2int i = 0;
+    int r0, off[4], q;
+
+    r0 = iskip % 8;
+    if (nbits >= 1 && nbits <= 25)
+    {
+        off[1] = (r0 + 4 * nbits) / 8;
+        lane32_pattern(r0, nbits, shuf, shift);
+        lane32_pattern((r0 + 4 * nbits) % 8, nbits, shuf + 16, shift + 4);
+        mask = _mm256_loadu_si256((__m256i *)shuf);
+        shifts = _mm256_loadu_si256((__m256i *)shift);
+        cnt = _mm_cvtsi32_si128(32 - (int)nbits);
+
+        for (; i + 8 <= n && p + off[1] + 16 <= end; i += 8, p += nbits)
+        {
+            v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)p)),
+                _mm_loadu_si128((__m128i *)(p + off[1])), 1);
+            v = _mm256_shuffle_epi8(v, mask);
+            v = _mm256_srl_epi32(_mm256_sllv_epi32(v, shifts), cnt);
+            _mm256_storeu_si256((__m256i *)(iout + i), v);
+        }
+    }
+    else if (nbits > 25 && nbits <= 32)
+    {
+        /* Each 128-bit lane holds 2 values in 64-bit elements. The 4
+         * lanes of an iteration start 2 * nbits bits apart. */
+        for (q = 0; q < 4; q++)
+        {
+            off[q] = (r0 + 2 * q * (int)nbits) / 8;
+            lane64_pattern((r0 + 2 * q * nbits) % 8, nbits, shuf + 16 * q,
+                           shift64 + 2 * q);
+        }
+        mask = _mm256_loadu_si256((__m256i *)shuf);
+        mask1 = _mm256_loadu_si256((__m256i *)(shuf + 32));
+        shifts = _mm256_loadu_si256((__m256i *)shift64);
+        shifts1 = _mm256_loadu_si256((__m256i *)(shift64 + 4));
+        narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        cnt = _mm_cvtsi32_si128(64 - (int)nbits);
+
+        for (; i + 8 <= n && p + off[3] + 16 <= end; i += 8, p += nbits)
+        {
+            v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)(p + off[0]))),
+                _mm_loadu_si128((__m128i *)(p + off[1])), 1);
+            v1 = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)(p + off[2]))),
+                _mm_loadu_si128((__m128i *)(p + off[3])), 1);
+            v = _mm256_srl_epi64(_mm256_sllv_epi64(_mm256_shuffle_epi8(v, mask), shifts), cnt);
+            v1 = _mm256_srl_epi64(_mm256_sllv_epi64(_mm256_shuffle_epi8(v1, mask1), shifts1), cnt);
+            v = _mm256_permutevar8x32_epi32(v, narrow);
+            v1 = _mm256_permutevar8x32_epi32(v1, narrow);
+            _mm256_storeu_si256((__m256i *)(iout + i),
+                                _mm256_permute2x128_si256(v, v1, 0x20));
+        }
+    }
+
+    g2c_gbits32(in, iout + i, iskip + i * nbits, nbits, n - i);
+}
+
+/**
+ * AVX-512 unpack kernel. Handles 16 values per iteration for widths
+ * of up to 25 bits, and 8 values per iteration in 64-bit elements for
+ * widths of 26 to 32 bits. Needs AVX512F and AVX512BW.
+ *
+ * @param in Pointer to character array input.
+ * @param iout Pointer to unpacked array output.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value, 0 to 32.
+ * @param n Number of values.
+ */
+__attribute__((target("avx512f,avx512bw")))
+static void
+unpack32_avx512(unsigned char *in, uint32_t *iout, g2int iskip, g2int nbits,
+                g2int n)
+{
+    unsigned char *end = in + (iskip + nbits * n + 7) / 8;
+    unsigned char *p = in + iskip / 8;
+    unsigned char shuf[64];
+    uint32_t shift[16];
+    uint64_t shift64[8];
+    __m512i mask, shifts, v;
+    __m128i cnt;
+    g2int i = 0;
+    int r0, off[4], q;
+
+    r0 = iskip % 8;
+    if (nbits >= 1 && nbits <= 25)
+    {
+        /* 4 lanes of 4 values, starting 4 * nbits bits apart. */
+        for (q = 0; q < 4; q++)
+        {
+            off[q] = (r0 + 4 * q * (int)nbits) / 8;
+            lane32_pattern((r0 + 4 * q * nbits) % 8, nbits, shuf + 16 * q,
+                           shift + 4 * q);
+        }
+        mask = _mm512_loadu_si512(shuf);
+        shifts = _mm512_loadu_si512(shift);
+        cnt = _mm_cvtsi32_si128(32 - (int)nbits);
+
+        for (; i + 16 <= n && p + off[3] + 16 <= end; i += 16, p += 2 * nbits)
+        {
+            v = _mm512_castsi128_si512(_mm_loadu_si128((__m128i *)p));
+            v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)(p + off[1])), 1);
+            v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)(p + off[2])), 2);
+            v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)(p + off[3])), 3);
+            v = _mm512_shuffle_epi8(v, mask);
+            v = _mm512_srl_epi32(_mm512_sllv_epi32(v, shifts), cnt);
+            _mm512_storeu_si512(iout + i, v);
+        }
+    }
+    else if (nbits > 25 && nbits <= 32)
+    {
+        /* 4 lanes of 2 values, starting 2 * nbits bits apart. */
+        for (q = 0; q < 4; q++)
+        {
+            off[q] = (r0 + 2 * q * (int)nbits) / 8;
+            lane64_pattern((r0 + 2 * q * nbits) % 8, nbits, shuf + 16 * q,
+                           shift64 + 2 * q);
+        }
+        mask = _mm512_loadu_si512(shuf);
+        shifts = _mm512_loadu_si512(shift64);
+        cnt = _mm_cvtsi32_si128(64 - (int)nbits);
+
+        for (; i + 8 <= n && p + off[3] + 16 <= end; i += 8, p += nbits)
+        {
+            v = _mm512_castsi128_si512(_mm_loadu_si128((__m128i *)(p + off[0])));
+            v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)(p + off[1])), 1);
+            v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)(p + off[2])), 2);
+            v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)(p + off[3])), 3);
+            v = _mm512_shuffle_epi8(v, mask);
+            v = _mm512_srl_epi64(_mm512_sllv_epi64(v, shifts), cnt);
+            _mm256_storeu_si256((__m256i *)(iout + i), _mm512_cvtepi64_epi32(v));
+        }
+    }
+
+    g2c_gbits32(in, iout + i, iskip + i * nbits, nbits, n - i);
+}
+
+/**
+ * Pack n values of nbits bits each into a bit writer with AVX2. Each
+ * group of 8 values is merged into 4 chunks of 2 * nbits bits, or 2
+ * chunks of 4 * nbits bits for widths up to 16, or 1 chunk of 8 *
+ * nbits bits for widths up to 8.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param in Pointer to unpacked array input.
+ * @param nbits Number of bits to store for each value, 0 to 32.
+ * @param n Number of values.
+ */
+__attribute__((target("avx2")))
+static void
+pack32_avx2(g2c_bitwriter *bw, uint32_t *in, g2int nbits, g2int n)
+{
+    uint64_t chunk[PACK_CHUNKS];
+    __m256i mask, lo, p;
+    __m128i cnt, cnt2;
+    g2int i = 0, nc;
+    int w;
+
+    if (nbits >= 1 && nbits <= 32)
+    {
+        mask = _mm256_set1_epi32((int)(nbits < 32 ? ((uint32_t)1 << nbits) - 1 : 0xffffffff));
+        lo = _mm256_set1_epi64x(0xffffffff);
+        cnt = _mm_cvtsi32_si128((int)nbits);
+        cnt2 = _mm_cvtsi32_si128(2 * (int)nbits);
+        w = (int)(nbits <= 8 ? 8 * nbits : nbits <= 16 ? 4 * nbits : 2 * nbits);
+
+        while (i + 8 <= n)
+        {
+            for (nc = 0; nc + 4 <= PACK_CHUNKS && i + 8 <= n; i += 8)
+            {
+                /* Pairs of values in each 64-bit lane, first value
+                 * in the high bits. */
+                p = _mm256_and_si256(_mm256_loadu_si256((__m256i *)(in + i)), mask);
+                p = _mm256_or_si256(_mm256_sll_epi64(_mm256_and_si256(p, lo), cnt),
+                                    _mm256_srli_epi64(p, 32));
+                if (nbits <= 16)
+                {
+                    /* Merge lanes 0 and 1, and lanes 2 and 3. */
+                    p = _mm256_or_si256(_mm256_sll_epi64(_mm256_permute4x64_epi64(p, 0x08), cnt2),
+                                        _mm256_permute4x64_epi64(p, 0x0d));
+                    if (nbits <= 8)
+                    {
+                        chunk[nc++] = ((uint64_t)_mm256_extract_epi64(p, 0) << (4 * nbits)) |
+                            (uint64_t)_mm256_extract_epi64(p, 1);
+                    }
+                    else
+                    {
+                        _mm_storeu_si128((__m128i *)(chunk + nc), _mm256_castsi256_si128(p));
+                        nc += 2;
+                    }
+                }
+                else
+                {
+                    _mm256_storeu_si256((__m256i *)(chunk + nc), p);
+                    nc += 4;
+                }
+            }
+            g2c_bw_put_n64(bw, chunk, w, nc);
+        }
+    }
+
+    g2c_bw_put_n32(bw, in + i, nbits, n - i);
+}
+
+/**
+ * Pack n values of nbits bits each into a bit writer with
+ * AVX-512. Each group of 16 values is merged into 8 chunks of 2 *
+ * nbits bits, and neighboring chunks are merged again while the
+ * result still fits in 64 bits. Needs AVX512F.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param in Pointer to unpacked array input.
+ * @param nbits Number of bits to store for each value, 0 to 32.
+ * @param n Number of values.
+ */
+__attribute__((target("avx512f")))
+static void
+pack32_avx512(g2c_bitwriter *bw, uint32_t *in, g2int nbits, g2int n)
+{
+    uint64_t chunk[PACK_CHUNKS];
+    __m512i mask, lo, even, odd, p;
+    __m128i cnt[4];
+    g2int i = 0, nc;
+    int nlev, lev, nl;
+
+    if (nbits >= 1 && nbits <= 32)
+    {
+        mask = _mm512_set1_epi32((int)(nbits < 32 ? ((uint32_t)1 << nbits) - 1 : 0xffffffff));
+        lo = _mm512_set1_epi64(0xffffffff);
+        even = _mm512_set_epi64(7, 7, 7, 7, 6, 4, 2, 0);
+        odd = _mm512_set_epi64(7, 7, 7, 7, 7, 5, 3, 1);
+        nlev = nbits <= 4 ? 3 : nbits <= 8 ? 2 : nbits <= 16 ? 1 : 0;
+        nl = 8 >> nlev;
+        for (lev = 0; lev <= nlev; lev++)
+            cnt[lev] = _mm_cvtsi32_si128((int)nbits << lev);
+
+        while (i + 16 <= n)
+        {
+            for (nc = 0; nc + 8 <= PACK_CHUNKS && i + 16 <= n; i += 16, nc += nl)
+            {
+                /* Pairs of values in each 64-bit lane, first value
+                 * in the high bits. */
+                p = _mm512_and_si512(_mm512_loadu_si512(in + i), mask);
+                p = _mm512_or_si512(_mm512_sll_epi64(_mm512_and_si512(p, lo), cnt[0]),
+                                    _mm512_srli_epi64(p, 32));
+
+                /* Merge even and odd lanes while the chunks fit. */
+                for (lev = 1; lev <= nlev; lev++)
+                    p = _mm512_or_si512(_mm512_sll_epi64(_mm512_permutexvar_epi64(even, p), cnt[lev]),
+                                        _mm512_permutexvar_epi64(odd, p));
+                _mm512_storeu_si512(chunk + nc, p);
+            }
+            g2c_bw_put_n64(bw, chunk, (2 * nbits) << nlev, nc);
+        }
+    }
+
+    g2c_bw_put_n32(bw, in + i, nbits, n - i);
+}
+
+/**
+ * Expand bitmap bytes into one integer per bit with AVX2. Each byte is
+ * broadcast to 8 lanes, which are shifted right by 7 down to 0 bits.
+ *
+ * @param in Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param bmap Gets 8 * nbytes values.
+ */
+__attribute__((target("avx2")))
+static void
+bitmap_expand_avx2(unsigned char *in, g2int nbytes, g2int *bmap)
+{
+    __m256i hi = _mm256_set_epi64x(4, 5, 6, 7);
+    __m256i lo = _mm256_set_epi64x(0, 1, 2, 3);
+    __m256i one = _mm256_set1_epi64x(1);
+    __m256i b;
+    g2int i;
+
+    for (i = 0; i < nbytes; i++, bmap += 8)
+    {
+        b = _mm256_set1_epi64x(in[i]);
+        _mm256_storeu_si256((__m256i *)bmap, _mm256_and_si256(_mm256_srlv_epi64(b, hi), one));
+        _mm256_storeu_si256((__m256i *)(bmap + 4), _mm256_and_si256(_mm256_srlv_epi64(b, lo), one));
+    }
+}
+
+/**
+ * Compress integers into bitmap bytes with AVX2. The low order bit of
+ * each value is moved to the sign bit, and the sign bits of each 4
+ * values, in reverse lane order, are collected with a movemask.
+ *
+ * @param bmap Pointer to 8 * nbytes values.
+ * @param nbytes Number of bytes.
+ * @param out Gets the bitmap bytes.
+ */
+__attribute__((target("avx2")))
+static void
+bitmap_compress_avx2(g2int *bmap, g2int nbytes, unsigned char *out)
+{
+    __m256i v0, v1;
+    g2int i;
+    int m0, m1;
+
+    for (i = 0; i < nbytes; i++, bmap += 8)
+    {
+        v0 = _mm256_permute4x64_epi64(_mm256_loadu_si256((__m256i *)bmap), 0x1b);
+        v1 = _mm256_permute4x64_epi64(_mm256_loadu_si256((__m256i *)(bmap + 4)), 0x1b);
+        m0 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_slli_epi64(v0, 63)));
+        m1 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_slli_epi64(v1, 63)));
+        out[i] = (unsigned char)(m0 << 4 | m1);
+    }
+}
+
+/**
+ * Expand bitmap bytes into one integer per bit with AVX-512. Each byte
+ * becomes a lane mask, and one masked store of 8 ones writes its 8
+ * values.
+ *
+ * @param in Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param bmap Gets 8 * nbytes values.
+ */
+__attribute__((target("avx512f")))
+static void
+bitmap_expand_avx512(unsigned char *in, g2int nbytes, g2int *bmap)
+{
+    __m512i bits = _mm512_set_epi64(1, 2, 4, 8, 16, 32, 64, 128);
+    __m512i one = _mm512_set1_epi64(1);
+    __mmask8 m;
+    g2int i;
+
+    for (i = 0; i < nbytes; i++, bmap += 8)
+    {
+        m = _mm512_test_epi64_mask(_mm512_set1_epi64(in[i]), bits);
+        _mm512_storeu_si512(bmap, _mm512_maskz_mov_epi64(m, one));
+    }
+}
+
+/**
+ * Compress integers into bitmap bytes with AVX-512. The values are
+ * put in reverse lane order, and a test of the low order bit of each
+ * lane gives the byte.
+ *
+ * @param bmap Pointer to 8 * nbytes values.
+ * @param nbytes Number of bytes.
+ * @param out Gets the bitmap bytes.
+ */
+__attribute__((target("avx512f")))
+static void
+bitmap_compress_avx512(g2int *bmap, g2int nbytes, unsigned char *out)
+{
+    __m512i rev = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    __m512i one = _mm512_set1_epi64(1);
+    __m512i v;
+    g2int i;
+
+    for (i = 0; i < nbytes; i++, bmap += 8)
+    {
+        v = _mm512_permutexvar_epi64(rev, _mm512_loadu_si512(bmap));
+        out[i] = (unsigned char)_mm512_test_epi64_mask(v, one);
+    }
+}
+
+/**
+ * Expand data values to grid points with AVX2, one bitmap byte at a
+ * time. The bits of the byte, spread out one per byte, give the lane
+ * mask, and their exclusive prefix sum gives, for each set lane, the
+ * data value that goes there. One permute puts the next 8 data values
+ * in place, and a blend puts in the fill value. Up to 8 values are
+ * read beyond the last one used.
+ *
+ * @param mask Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param in Pointer to the data values.
+ * @param fill Value for points that are bitmapped out.
+ * @param out Gets 8 * nbytes grid points.
+ *
+ * @return The number of data values used.
+ */
+__attribute__((target("avx2")))
+static g2int
+expand_avx2(unsigned char *mask, g2int nbytes, g2float *in, g2float fill,
+            g2float *out)
+{
+    __m256 fillv = _mm256_set1_ps(fill);
+    __m256i idx, sel;
+    __m256 v;
+    uint64_t spread, prefix;
+    g2int i, m = 0;
+
+    for (i = 0; i < nbytes; i++, out += 8)
+    {
+        if (!mask[i])
+        {
+            _mm256_storeu_ps(out, fillv);
+            continue;
+        }
+        spread = spread_lut[mask[i]];
+        prefix = spread * 0x0101010101010101ULL;
+        idx = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)(prefix - spread)));
+        sel = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)spread)), 31);
+        v = _mm256_permutevar8x32_ps(_mm256_loadu_ps(in + m), idx);
+        _mm256_storeu_ps(out, _mm256_blendv_ps(fillv, v, _mm256_castsi256_ps(sel)));
+        m += (g2int)(prefix >> 56);
+    }
+    return m;
+}
+
+/**
+ * Expand data values to grid points with AVX-512, two bitmap bytes
+ * (16 grid points) at a time, with one masked expanding load. Only
+ * the data values that are used are read.
+ *
+ * @param mask Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param in Pointer to the data values.
+ * @param fill Value for points that are bitmapped out.
+ * @param out Gets 8 * nbytes grid points.
+ *
+ * @return The number of data values used.
+ */
+__attribute__((target("avx512f")))
+static g2int
+expand_avx512(unsigned char *mask, g2int nbytes, g2float *in, g2float fill,
+              g2float *out)
+{
+    __m512i bits = _mm512_set_epi32(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024,
+                                    2048, 4096, 8192, 16384, 32768);
+    __m512 fillv = _mm512_set1_ps(fill);
+    __mmask16 k;
+    unsigned int b;
+    g2int i, m = 0;
+
+    for (i = 0; i + 2 <= nbytes; i += 2, out += 16)
+    {
+        b = (unsigned int)mask[i] << 8 | mask[i + 1];
+        k = _mm512_test_epi32_mask(_mm512_set1_epi32((int)b), bits);
+        _mm512_storeu_ps(out, _mm512_mask_expandloadu_ps(fillv, k, in + m));
+        m += __builtin_popcount(b);
+    }
+    if (i < nbytes)
+    {
+        b = (unsigned int)mask[i] << 8;
+        k = _mm512_test_epi32_mask(_mm512_set1_epi32((int)b), bits);
+        _mm256_storeu_ps(out, _mm512_castps512_ps256(_mm512_mask_expandloadu_ps(fillv, k, in + m)));
+        m += __builtin_popcount(b);
+    }
+    return m;
+}
+
+/** For each bitmap byte, the lanes of its set bits, packed to the
+ * front, one per byte. Filled in by simd_init(). */
+static uint64_t compress_idx[256];
+
+/**
+ * Contract grid points to data values with AVX2, one bitmap byte at a
+ * time. A permute packs the set lanes to the front, and all 8 lanes
+ * are stored, so up to 7 values are written past the last data value.
+ *
+ * @param mask Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param in Pointer to 8 * nbytes grid points.
+ * @param out Gets the data values. May be the same as in.
+ *
+ * @return The number of data values.
+ */
+__attribute__((target("avx2")))
+static g2int
+contract_avx2(unsigned char *mask, g2int nbytes, g2float *in, g2float *out)
+{
+    __m256i idx;
+    g2int i, m = 0;
+
+    for (i = 0; i < nbytes; i++, in += 8)
+    {
+        if (!mask[i])
+            continue;
+        idx = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)compress_idx[mask[i]]));
+        _mm256_storeu_ps(out + m, _mm256_permutevar8x32_ps(_mm256_loadu_ps(in), idx));
+        m += MASK_COUNT(mask[i]);
+    }
+    return m;
+}
+
+/**
+ * Contract grid points to data values with AVX-512, two bitmap bytes
+ * (16 grid points) at a time, with one compressing store. Only the
+ * data values are written.
+ *
+ * @param mask Pointer to the bitmap bytes.
+ * @param nbytes Number of bytes.
+ * @param in Pointer to 8 * nbytes grid points.
+ * @param out Gets the data values. May be the same as in.
+ *
+ * @return The number of data values.
+ */
+__attribute__((target("avx512f")))
+static g2int
+contract_avx512(unsigned char *mask, g2int nbytes, g2float *in, g2float *out)
+{
+    __m512i bits = _mm512_set_epi32(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024,
+                                    2048, 4096, 8192, 16384, 32768);
+    __mmask16 k;
+    unsigned int b;
+    g2int i, m = 0;
+
+    for (i = 0; i + 2 <= nbytes; i += 2, in += 16)
+    {
+        b = (unsigned int)mask[i] << 8 | mask[i + 1];
+        k = _mm512_test_epi32_mask(_mm512_set1_epi32((int)b), bits);
+        _mm512_mask_compressstoreu_ps(out + m, k, _mm512_loadu_ps(in));
+        m += __builtin_popcount(b);
+    }
+    if (i < nbytes)
+    {
+        b = (unsigned int)mask[i] << 8;
+        k = _mm512_test_epi32_mask(_mm512_set1_epi32((int)b), bits);
+        _mm512_mask_compressstoreu_ps(out + m, k, _mm512_castps256_ps512(_mm256_loadu_ps(in)));
+        m += __builtin_popcount(b);
+    }
+    return m;
+}
+
+/**
+ * Choose the best kernels for this CPU. This runs when the library is
+ * loaded, before main(), so the choice is made once and never
+ * changes while threads are running.
+ */
+__attribute__((constructor))
+static void
+simd_init(void)
+{
+    int b, k, n;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        simd_level = G2C_SIMD_AVX512;
+    else if (__builtin_cpu_supports("avx2"))
+        simd_level = G2C_SIMD_AVX2;
+    else if (__builtin_cpu_supports("sse4.1"))
+        simd_level = G2C_SIMD_SSE41;
+    unpack32_kernel = g2c_unpack32_kernel(simd_level);
+    pack32_kernel = g2c_pack32_kernel(simd_level);
+    bitmap_expand_kernel = g2c_bitmap_expand_kernel(simd_level);
+    bitmap_compress_kernel = g2c_bitmap_compress_kernel(simd_level);
+    expand_kernel = g2c_expand_kernel(simd_level);
+    contract_kernel = g2c_contract_kernel(simd_level);
+
+    /* Permutes for contract_avx2(). */
+    for (b = 0; b < 256; b++)
+        for (k = 0, n = 0; k < 8; k++)
+            if ((b >> (7 - k)) & 1)
+                compress_idx[b] |= (uint64_t)k << (8 * n++);
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+/**
+ * Return the unpack kernel for a SIMD level, so that tests and
+ * benchmarks can compare kernels.
+ *
+ * @param level One of ::G2C_SIMD_SCALAR, ::G2C_SIMD_SSE41,
+ * ::G2C_SIMD_AVX2, ::G2C_SIMD_AVX512.
+ *
+ * @return The kernel, or NULL if it was not built or the CPU cannot
+ * run it.
+ */
+g2c_unpack32_func
+g2c_unpack32_kernel(int level)
+{
+    if (level > simd_level)
+        return NULL;
+    switch (level)
+    {
+    case G2C_SIMD_SCALAR:
+        return g2c_gbits32;
+#ifdef HAVE_X86_KERNELS
+    case G2C_SIMD_SSE41:
+        return unpack32_sse41;
+    case G2C_SIMD_AVX2:
+        return unpack32_avx2;
+    case G2C_SIMD_AVX512:
+        return unpack32_avx512;
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * Return the pack kernel for a SIMD level, so that tests and
+ * benchmarks can compare kernels. There is no SSE4.1 pack kernel, so
+ * that level uses the portable one.
+ *
+ * @param level One of ::G2C_SIMD_SCALAR, ::G2C_SIMD_SSE41,
+ * ::G2C_SIMD_AVX2, ::G2C_SIMD_AVX512.
+ *
+ * @return The kernel, or NULL if it was not built or the CPU cannot
+ * run it.
+ */
+g2c_pack32_func
+g2c_pack32_kernel(int level)
+{
+    if (level > simd_level)
+        return NULL;
+    switch (level)
+    {
+    case G2C_SIMD_SCALAR:
+        return g2c_bw_put_n32;
+#ifdef HAVE_X86_KERNELS
+    case G2C_SIMD_SSE41:
+        return g2c_bw_put_n32;
+    case G2C_SIMD_AVX2:
+        return pack32_avx2;
+    case G2C_SIMD_AVX512:
+        return pack32_avx512;
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * Return the bitmap expand kernel for a SIMD level, so that tests and
+ * benchmarks can compare kernels. There is no SSE4.1 bitmap kernel, so
+ * that level uses the portable one.
+ *
+ * @param level One of ::G2C_SIMD_SCALAR, ::G2C_SIMD_SSE41,
+ * ::G2C_SIMD_AVX2, ::G2C_SIMD_AVX512.
+ *
+ * @return The kernel, or NULL if it was not built or the CPU cannot
+ * run it.
+ */
+g2c_bitmap_expand_func
+g2c_bitmap_expand_kernel(int level)
+{
+    if (level > simd_level)
+        return NULL;
+    switch (level)
+    {
+    case G2C_SIMD_SCALAR:
+        return bitmap_expand_scalar;
+#ifdef HAVE_X86_KERNELS
+    case G2C_SIMD_SSE41:
+        return bitmap_expand_scalar;
+    case G2C_SIMD_AVX2:
+        return bitmap_expand_avx2;
+    case G2C_SIMD_AVX512:
+        return bitmap_expand_avx512;
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * Return the bitmap compress kernel for a SIMD level, so that tests
+ * and benchmarks can compare kernels. There is no SSE4.1 bitmap
+ * kernel, so that level uses the portable one.
+ *
+ * @param level One of ::G2C_SIMD_SCALAR, ::G2C_SIMD_SSE41,
+ * ::G2C_SIMD_AVX2, ::G2C_SIMD_AVX512.
+ *
+ * @return The kernel, or NULL if it was not built or the CPU cannot
+ * run it.
+ */
+g2c_bitmap_compress_func
+g2c_bitmap_compress_kernel(int level)
+{
+    if (level > simd_level)
+        return NULL;
+    switch (level)
+    {
+    case G2C_SIMD_SCALAR:
+        return bitmap_compress_scalar;
+#ifdef HAVE_X86_KERNELS
+    case G2C_SIMD_SSE41:
+        return bitmap_compress_scalar;
+    case G2C_SIMD_AVX2:
+        return bitmap_compress_avx2;
+    case G2C_SIMD_AVX512:
+        return bitmap_compress_avx512;
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * Return the bitmap expand kernel for data values for a SIMD level,
+ * so that tests and benchmarks can compare kernels.
+ *
+ * @param level One of ::G2C_SIMD_SCALAR, ::G2C_SIMD_SSE41,
+ * ::G2C_SIMD_AVX2, ::G2C_SIMD_AVX512.
+ *
+ * @return The kernel, or NULL if it was not built or the CPU cannot
+ * run it.
+ */
+g2c_expand_func
+g2c_expand_kernel(int level)
+{
+    if (level > simd_level)
+        return NULL;
+    switch (level)
+    {
+    case G2C_SIMD_SCALAR:
+        return expand_scalar;
+#ifdef HAVE_X86_KERNELS
+    case G2C_SIMD_SSE41:
+        return expand_scalar;
+    case G2C_SIMD_AVX2:
+        return expand_avx2;
+    case G2C_SIMD_AVX512:
+        return expand_avx512;
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * Return the bitmap contract kernel for a SIMD level, so that tests
+ * and benchmarks can compare kernels.
+ *
+ * @param level One of ::G2C_SIMD_SCALAR, ::G2C_SIMD_SSE41,
+ * ::G2C_SIMD_AVX2, ::G2C_SIMD_AVX512.
+ *
+ * @return The kernel, or NULL if it was not built or the CPU cannot
+ * run it.
+ */
+g2c_contract_func
+g2c_contract_kernel(int level)
+{
+    if (level > simd_level)
+        return NULL;
+    switch (level)
+    {
+    case G2C_SIMD_SCALAR:
+        return contract_scalar;
+#ifdef HAVE_X86_KERNELS
+    case G2C_SIMD_SSE41:
+        return contract_scalar;
+    case G2C_SIMD_AVX2:
+        return contract_avx2;
+    case G2C_SIMD_AVX512:
+        return contract_avx512;
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * Return the SIMD level chosen for this CPU.
+ *
+ * @return One of ::G2C_SIMD_SCALAR, ::G2C_SIMD_SSE41,
+ * ::G2C_SIMD_AVX2, ::G2C_SIMD_AVX512.
+ */
+int
+g2c_simd_level(void)
+{
+    return simd_level;
+}
+
+/**
+ * Extract n contiguous values of 0 to 32 bits each from a packed bit
+ * string into an array of 32-bit unsigned integers, using the fastest
+ * kernel this CPU supports. Results are identical to gbits().
+ *
+ * @param in Pointer to character array input.
+ * @param iout Pointer to unpacked array output.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value, 0 to 32.
+ * @param n Number of values.
+ */
+void
+g2c_unpack32(unsigned char *in, uint32_t *iout, g2int iskip, g2int nbits,
+             g2int n)
+{
+    unpack32_kernel(in, iout, iskip, nbits, n);
+}
+
+/**
+ * Add n contiguous values of 0 to 32 bits each to a bit writer, taking
+ * the low order nbits bits of each value, using the fastest kernel
+ * this CPU supports. Output is identical to sbits().
+ *
+ * @param bw Pointer to the bit writer.
+ * @param in Pointer to unpacked array input.
+ * @param nbits Number of bits to store for each value, 0 to 32.
+ * @param n Number of values.
+ */
+void
+g2c_pack32(g2c_bitwriter *bw, uint32_t *in, g2int nbits, g2int n)
+{
+    pack32_kernel(bw, in, nbits, n);
+}
+
+/**
+ * Unpack a bitmap of n bits into one integer (0 or 1) per bit. Whole
+ * bytes of a byte-aligned bitmap go through the bitmap kernel for this
+ * CPU. Results are identical to gbits() with nbits of 1.
+ *
+ * @param in Pointer to character array input.
+ * @param iskip Initial number of bits to skip.
+ * @param n Number of bits in the bitmap.
+ * @param bmap Gets n values.
+ */
+void
+g2c_bitmap_expand(unsigned char *in, g2int iskip, g2int n, g2int *bmap)
+{
+    g2int nbytes = 0;
+
+    if (iskip % 8 == 0)
+    {
+        nbytes = n / 8;
+        bitmap_expand_kernel(in + iskip / 8, nbytes, bmap);
+    }
+    gbits(in, bmap + 8 * nbytes, iskip + 8 * nbytes, 1, 0, n - 8 * nbytes);
+}
+
+/**
+ * Add a bitmap of n values to a bit writer, taking the low order bit
+ * of each value. Single bits are written until the writer reaches a
+ * byte boundary, then whole bytes go through the bitmap kernel for
+ * this CPU. Output is identical to sbits() with nbits of 1.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param bmap Pointer to the bitmap values.
+ * @param n Number of values.
+ */
+void
+g2c_bitmap_compress(g2c_bitwriter *bw, g2int *bmap, g2int n)
+{
+    g2int i, nbytes;
+
+    for (i = 0; i < n && bw->nacc % 8; i++)
+        g2c_bw_put(bw, bmap[i], 1);
+    if (i == n)
+        return;
+
+    /* The writer is on a byte boundary, so once it is flushed its
+     * next byte is the next bitmap byte. */
+    g2c_bw_flush(bw);
+    nbytes = (n - i) / 8;
+    bitmap_compress_kernel(bmap + i, nbytes, bw->out);
+    bw->out += nbytes;
+    for (i += 8 * nbytes; i < n; i++)
+        g2c_bw_put(bw, bmap[i], 1);
+}
+
+/**
+ * Unpack a bitmap of n bits into one byte (0 or 1) per bit. Whole
+ * bytes of a byte-aligned bitmap are spread out with a lookup table,
+ * 8 bits at a time.
+ *
+ * @param in Pointer to character array input.
+ * @param iskip Initial number of bits to skip.
+ * @param n Number of bits in the bitmap.
+ * @param bmap Gets n bytes.
+ */
+void
+g2c_bitmap_expand8(unsigned char *in, g2int iskip, g2int n, unsigned char *bmap)
+{
+    g2int i = 0, ival;
+    uint64_t w;
+    int k;
+
+    if (iskip % 8 == 0)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            w = spread_lut[in[(iskip + i) / 8]];
+            for (k = 0; k < 8; k++)
+                bmap[i + k] = (unsigned char)(w >> (8 * k));
+        }
+    }
+    for (; i < n; i++)
+    {
+        gbit(in, &ival, iskip + i, 1);
+        bmap[i] = (unsigned char)ival;
+    }
+}
+
+/**
+ * Copy a bitmap of n bits into (n + 7) / 8 bytes, first bit in the
+ * high bit of the first byte. Unused bits of the last byte are set
+ * to 0. A byte-aligned bitmap is copied directly.
+ *
+ * @param in Pointer to character array input.
+ * @param iskip Initial number of bits to skip.
+ * @param n Number of bits in the bitmap.
+ * @param out Gets (n + 7) / 8 bytes.
+ */
+void
+g2c_bitmap_copy(unsigned char *in, g2int iskip, g2int n, unsigned char *out)
+{
+    g2int i, nbytes = n / 8, ival;
+
+    if (iskip % 8 == 0)
+        memcpy(out, in + iskip / 8, nbytes);
+    else
+        for (i = 0; i < nbytes; i++)
+        {
+            gbit(in, &ival, iskip + 8 * i, 8);
+            out[i] = (unsigned char)ival;
+        }
+    if (n % 8)
+    {
+        gbit(in, &ival, iskip + 8 * nbytes, n % 8);
+        out[nbytes] = (unsigned char)(ival << (8 - n % 8));
+    }
+}
+
+/**
+ * Get one point of a bitmap in any format.
+ *
+ * @param fmt Bitmap format.
+ * @param bmap Pointer to the bitmap.
+ * @param i Index of the point.
+ *
+ * @return The bit, 0 or 1.
+ */
+static int
+mask_bit(int fmt, void *bmap, g2int i)
+{
+    if (fmt == G2C_BMAP_BITS)
+        return (((unsigned char *)bmap)[i / 8] >> (7 - i % 8)) & 1;
+    if (fmt == G2C_BMAP_UINT8)
+        return ((unsigned char *)bmap)[i] != 0;
+    return ((g2int *)bmap)[i] & 1;
+}
+
+/**
+ * Get a block of a bitmap in any format as bitmap bytes.
+ *
+ * @param fmt Bitmap format.
+ * @param bmap Pointer to the bitmap.
+ * @param first First point of the block, a multiple of 8.
+ * @param nbytes Number of bytes in the block.
+ * @param buf Buffer of at least nbytes bytes, for formats that must
+ * be converted.
+ *
+ * @return Pointer to the bitmap bytes of the block.
+ */
+static unsigned char *
+mask_block(int fmt, void *bmap, g2int first, g2int nbytes, unsigned char *buf)
+{
+    unsigned char *b8;
+    g2int i;
+    int k;
+
+    if (fmt == G2C_BMAP_BITS)
+        return (unsigned char *)bmap + first / 8;
+    if (fmt == G2C_BMAP_UINT8)
+    {
+        b8 = (unsigned char *)bmap + first;
+        for (i = 0; i < nbytes; i++, b8 += 8)
+        {
+            buf[i] = 0;
+            for (k = 0; k < 8; k++)
+                buf[i] = (unsigned char)(buf[i] << 1 | (b8[k] != 0));
+        }
+        return buf;
+    }
+    bitmap_compress_kernel((g2int *)bmap + first, nbytes, buf);
+    return buf;
+}
+
+/**
+ * Expand data values to grid points, using a bitmap in any format.
+ * Points whose bitmap value is set take the next data value, the
+ * others get the fill value. Whole bitmap bytes go through the expand
+ * kernel for this CPU, a block at a time.
+ *
+ * The expansion may be done in place, with out equal to in, if the
+ * buffer holds npts values. The grid is then filled from the end, so
+ * that data values are moved before they are overwritten. The data
+ * values may also be the last nin values of out, in which case the
+ * grid is filled from the start. No grid point is written before the
+ * data values it would overwrite have been read, because there are
+ * never more points bitmapped out ahead of a point than the
+ * npts - nin that separate the arrays.
+ *
+ * If the bitmap has more points set than there are data values, the
+ * extra points get the fill value.
+ *
+ * @param fmt Bitmap format, one of ::G2C_BMAP_G2INT,
+ * ::G2C_BMAP_UINT8, ::G2C_BMAP_BITS. A g2int bitmap value is set if
+ * its low order bit is 1, the bit written to Section 6. A byte bitmap
+ * value is set if it is not 0.
+ * @param bmap Pointer to the bitmap.
+ * @param npts Number of grid points.
+ * @param in Pointer to the data values.
+ * @param nin Number of data values. For an expansion in place, this
+ * must not be more than npts.
+ * @param fill Value for points that are bitmapped out.
+ * @param out Gets npts grid points.
+ */
+void
+g2c_expand(int fmt, void *bmap, g2int npts, g2float *in, g2int nin,
+           g2float fill, g2float *out)
+{
+    unsigned char buf[EXPAND_BLOCK / 8], *mask;
+    g2float tmp[EXPAND_BLOCK + 8];
+    g2int nfull = npts / 8 * 8, nblocks = (nfull + EXPAND_BLOCK - 1) / EXPAND_BLOCK;
+    g2int blk, first, nbytes, c, ncopy, i, j, m;
+
+    if (out != in)
+    {
+        m = 0;
+        for (blk = 0; blk < nblocks; blk++)
+        {
+            first = blk * EXPAND_BLOCK;
+            nbytes = (nfull - first < EXPAND_BLOCK ? nfull - first : EXPAND_BLOCK) / 8;
+            mask = mask_block(fmt, bmap, first, nbytes, buf);
+
+            /* Kernels may read up to 8 values past the last one they
+             * use, so near the end of the data, go through tmp. */
+            if (m + 8 * nbytes + 8 <= nin)
+            {
+                m += expand_kernel(mask, nbytes, in + m, fill, out + first);
+                continue;
+            }
+            for (c = 0, i = 0; i < nbytes; i++)
+                c += MASK_COUNT(mask[i]);
+            ncopy = c < nin - m ? c : nin - m;
+            for (j = 0; j < c + 8; j++)
+                tmp[j] = j < ncopy ? in[m + j] : fill;
+            expand_kernel(mask, nbytes, tmp, fill, out + first);
+            m += ncopy;
+        }
+        for (i = nfull; i < npts; i++)
+            out[i] = mask_bit(fmt, bmap, i) && m < nin ? in[m++] : fill;
+        return;
+    }
+
+    /* In place, from the end. */
+    m = nin;
+    for (i = npts - 1; i >= nfull; i--)
+        out[i] = mask_bit(fmt, bmap, i) && m > 0 ? in[--m] : fill;
+    for (blk = nblocks - 1; blk >= 0; blk--)
+    {
+        first = blk * EXPAND_BLOCK;
+        nbytes = (nfull - first < EXPAND_BLOCK ? nfull - first : EXPAND_BLOCK) / 8;
+        mask = mask_block(fmt, bmap, first, nbytes, buf);
+        for (c = 0, i = 0; i < nbytes; i++)
+            c += MASK_COUNT(mask[i]);
+
+        /* The data values of this block are copied out before any
+         * of its grid points are written. */
+        ncopy = c < m ? c : m;
+        for (j = 0; j < c + 8; j++)
+            tmp[j] = j >= c - ncopy && j < c ? in[m - c + j] : fill;
+        expand_kernel(mask, nbytes, tmp, fill, out + first);
+        m -= ncopy;
+    }
+}
+
+/**
+ * Contract grid points to data values, using a bitmap in any format.
+ * Points whose bitmap value is set are kept, in order. Whole bitmap
+ * bytes go through the contract kernel for this CPU, a block at a
+ * time.
+ *
+ * The contraction may be done in place, with out equal to in.
+ *
+ * @param fmt Bitmap format, one of ::G2C_BMAP_G2INT,
+ * ::G2C_BMAP_UINT8, ::G2C_BMAP_BITS. A g2int bitmap value is set if
+ * its low order bit is 1, the bit written to Section 6. A byte bitmap
+ * value is set if it is not 0.
+ * @param bmap Pointer to the bitmap.
+ * @param npts Number of grid points.
+ * @param in Pointer to the grid points.
+ * @param out Gets the data values. Must have room for npts values,
+ * since kernels may write past the last data value.
+ *
+ * @return The number of data values.
+ */
+g2int
+g2c_contract(int fmt, void *bmap, g2int npts, g2float *in, g2float *out)
+{
+    unsigned char buf[EXPAND_BLOCK / 8], *mask;
+    g2float tmp[EXPAND_BLOCK + 8];
+    g2int nfull = npts / 8 * 8;
+    g2int first, nbytes, c, i, m = 0;
+
+    for (first = 0; first < nfull; first += EXPAND_BLOCK)
+    {
+        nbytes = (nfull - first < EXPAND_BLOCK ? nfull - first : EXPAND_BLOCK) / 8;
+        mask = mask_block(fmt, bmap, first, nbytes, buf);
+
+        /* Kernels may write up to 7 values past the last one, which
+         * is only safe while they land on grid points of this block
+         * or later blocks. Near the end, go through tmp. */
+        if (m + 8 * nbytes + 8 <= npts)
+        {
+            m += contract_kernel(mask, nbytes, in + first, out + m);
+            continue;
+        }
+        c = contract_kernel(mask, nbytes, in + first, tmp);
+        for (i = 0; i < c; i++)
+            out[m++] = tmp[i];
+    }
+    for (i = nfull; i < npts; i++)
+        if (mask_bit(fmt, bmap, i))
+            out[m++] = in[i];
+    return m;
+}
+
+/**
+ * Add a bitmap of n points, in any format, to a bit writer. Whole
+ * bitmap bytes are written a block at a time, copied directly when the
+ * writer is on a byte boundary.
+ *
+ * @param bw Pointer to the bit writer.
+ * @param fmt Bitmap format, one of ::G2C_BMAP_G2INT,
+ * ::G2C_BMAP_UINT8, ::G2C_BMAP_BITS.
+ * @param bmap Pointer to the bitmap.
+ * @param n Number of points.
+ */
+void
+g2c_bw_put_bitmap(g2c_bitwriter *bw, int fmt, void *bmap, g2int n)
+{
+    unsigned char buf[EXPAND_BLOCK / 8], *mask;
+    g2int nfull = n / 8 * 8;
+    g2int first, nbytes, i;
+
+    if (fmt == G2C_BMAP_G2INT)
+    {
+        g2c_bitmap_compress(bw, bmap, n);
+        return;
+    }
+    for (first = 0; first < nfull; first += EXPAND_BLOCK)
+    {
+        nbytes = (nfull - first < EXPAND_BLOCK ? nfull - first : EXPAND_BLOCK) / 8;
+        mask = mask_block(fmt, bmap, first, nbytes, buf);
+        if (bw->nacc % 8)
+        {
+            for (i = 0; i < nbytes; i++)
+                g2c_bw_put(bw, mask[i], 8);
+            continue;
+        }
+        g2c_bw_flush(bw);
+        memcpy(bw->out, mask, nbytes);
+        bw->out += nbytes;
+    }
+    for (i = nfull; i < n; i++)
+        g2c_bw_put(bw, mask_bit(fmt, bmap, i), 1);
+}
+
+/**
+ * Unpack n values of nbits bits each from a packed bit string and
+ * scale them to floating point, as ((value * bscale) + ref) * dscale.
+ *
+ * Values are unpacked a block at a time into a small buffer that
+ * stays in cache, and scaled from there, so no integer array the size
+ * of the field is needed and the output is written in a single
+ * pass. Results are identical to unpacking the whole field with
+ * gbits() and then scaling it.
+ *
+ * @param in Pointer to character array input.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value. If 0, every value is the
+ * reference value.
+ * @param n Number of values.
+ * @param ref Reference value.
+ * @param bscale Binary scale factor, 2^E.
+ * @param dscale Decimal scale factor, 10^-D.
+ * @param fld Array that gets the n scaled values.
+ */
+void
+g2c_unpack_scale(unsigned char *in, g2int iskip, g2int nbits, g2int n,
+                 g2float ref, g2float bscale, g2float dscale, g2float *fld)
+{
+    uint32_t blk[UNPACK_BLOCK];
+    g2int wide[UNPACK_BLOCK];
+    g2int i, j, nblk;
+
+    if (nbits == 0)
+    {
+        for (j = 0; j < n; j++)
+            fld[j] = ref;
+        return;
+    }
+
+    for (i = 0; i < n; i += nblk)
+    {
+        nblk = n - i < UNPACK_BLOCK ? n - i : UNPACK_BLOCK;
+        if (nbits <= 32)
+        {
+            unpack32_kernel(in, blk, iskip + i * nbits, nbits, nblk);
+            for (j = 0; j < nblk; j++)
+                fld[i + j] = (((g2float)blk[j] * bscale) + ref) * dscale;
+        }
+        else
+        {
+            gbits(in, wide, iskip + i * nbits, nbits, 0, nblk);
+            for (j = 0; j < nblk; j++)
+                fld[i + j] = (((g2float)wide[j] * bscale) + ref) * dscale;
+        }
+    }
+}
+
+/** Function that puts data values first to first + n - 1 in out, for
+ * expand_from(). */
+typedef void (*produce_func)(void *ctx, g2int first, g2int n, g2float *out);
+
+/**
+ * Put data values straight onto the grid, a block of grid points at
+ * a time. For each block, the data values it needs are produced into
+ * a small buffer that stays in cache, and expanded from there with
+ * the expand kernel for this CPU. No array of all the data values is
+ * needed.
+ *
+ * @param grid Pointer to the grid and its bitmap.
+ * @param nin Number of data values. If the bitmap has more points
+ * set, the extra points get the fill value.
+ * @param produce Function that produces data values, called for
+ * increasing values of first.
+ * @param ctx Passed to produce.
+ * @param fld Gets the grid->npts grid points.
+ */
+static void
+expand_from(g2c_grid *grid, g2int nin, produce_func produce, void *ctx,
+            g2float *fld)
+{
+    unsigned char buf[EXPAND_BLOCK / 8], *mask;
+    g2float tmp[EXPAND_BLOCK + 8];
+    g2int nfull = grid->npts / 8 * 8;
+    g2int first, nbytes, cnt, c, i, m = 0;
+
+    for (first = 0; first < nfull; first += EXPAND_BLOCK)
+    {
+        nbytes = (nfull - first < EXPAND_BLOCK ? nfull - first : EXPAND_BLOCK) / 8;
+        mask = mask_block(grid->fmt, grid->bmap, first, nbytes, buf);
+        for (cnt = 0, i = 0; i < nbytes; i++)
+            cnt += MASK_COUNT(mask[i]);
+        c = cnt < nin - m ? cnt : nin - m;
+        if (c > 0)
+            produce(ctx, m, c, tmp);
+        for (i = c; i < cnt + 8; i++)
+            tmp[i] = grid->fill;
+        expand_kernel(mask, nbytes, tmp, grid->fill, fld + first);
+        m += c;
+    }
+    for (i = nfull; i < grid->npts; i++)
+    {
+        if (mask_bit(grid->fmt, grid->bmap, i) && m < nin)
+            produce(ctx, m++, 1, fld + i);
+        else
+            fld[i] = grid->fill;
+    }
+}
+
+/** Packed values to unpack and scale, for produce_unpack_scale(). */
+struct unpack_scale_ctx
+{
+    unsigned char *in; /**< Packed values. */
+    g2int iskip;       /**< Bits to skip before the first value. */
+    g2int nbits;       /**< Bits per value. */
+    g2float ref;       /**< Reference value. */
+    g2float bscale;    /**< Binary scale factor. */
+    g2float dscale;    /**< Decimal scale factor. */
+};
+
+/**
+ * Produce data values by unpacking and scaling them.
+ *
+ * @param ctx Pointer to a struct unpack_scale_ctx.
+ * @param first First data value.
+ * @param n Number of data values.
+ * @param out Gets the data values.
+ */
+static void
+produce_unpack_scale(void *ctx, g2int first, g2int n, g2float *out)
+{
+    struct unpack_scale_ctx *u = ctx;
+
+    g2c_unpack_scale(u->in, u->iskip + first * u->nbits, u->nbits, n, u->ref,
+                     u->bscale, u->dscale, out);
+}
+
+/**
+ * Unpack n values of nbits bits each and scale them, like
+ * g2c_unpack_scale(), writing each one straight to its grid point.
+ * Grid points that are bitmapped out get the fill value.
+ *
+ * @param in Pointer to character array input.
+ * @param iskip Initial number of bits to skip.
+ * @param nbits Number of bits in each value. If 0, every value is the
+ * reference value.
+ * @param n Number of values.
+ * @param ref Reference value.
+ * @param bscale Binary scale factor, 2^E.
+ * @param dscale Decimal scale factor, 10^-D.
+ * @param grid Pointer to the grid and its bitmap.
+ * @param fld Array that gets the grid->npts grid points.
+ */
+void
+g2c_unpack_scale_grid(unsigned char *in, g2int iskip, g2int nbits, g2int n,
+                      g2float ref, g2float bscale, g2float dscale,
+                      g2c_grid *grid, g2float *fld)
+{
+    struct unpack_scale_ctx u = {in, iskip, nbits, ref, bscale, dscale};
+
+    expand_from(grid, n, produce_unpack_scale, &u, fld);
+}
+
+/** Integer values to scale, for produce_scale(). */
+struct scale_ctx
+{
+    g2int *ifld;    /**< Integer values. */
+    g2float ref;    /**< Reference value. */
+    g2float bscale; /**< Binary scale factor. */
+    g2float dscale; /**< Decimal scale factor. */
+};
+
+/**
+ * Produce data values by scaling integer values.
+ *
+ * @param ctx Pointer to a struct scale_ctx.
+ * @param first First data value.
+ * @param n Number of data values.
+ * @param out Gets the data values.
+ */
+static void
+produce_scale(void *ctx, g2int first, g2int n, g2float *out)
+{
+    struct scale_ctx *sc = ctx;
+    g2int j;
+
+    for (j = 0; j < n; j++)
+        out[j] = (((g2float)sc->ifld[first + j] * sc->bscale) + sc->ref) * sc->dscale;
+}
+
+/**
+ * Scale n integer values, as ((value * bscale) + ref) * dscale,
+ * writing each one straight to its grid point. Grid points that are
+ * bitmapped out get the fill value.
+ *
+ * @param ifld The integer values.
+ * @param n Number of values.
+ * @param ref Reference value.
+ * @param bscale Binary scale factor, 2^E.
+ * @param dscale Decimal scale factor, 10^-D.
+ * @param grid Pointer to the grid and its bitmap.
+ * @param fld Array that gets the grid->npts grid points.
+ */
+void
+g2c_scale_grid(g2int *ifld, g2int n, g2float ref, g2float bscale,
+               g2float dscale, g2c_grid *grid, g2float *fld)
+{
+    struct scale_ctx sc = {ifld, ref, bscale, dscale};
+
+    expand_from(grid, n, produce_scale, &sc, fld);
+}
+
+/**
+ * Expand n data values, which are at the end of a grid array, to
+ * their grid points, in the same array. This is for unpackers that
+ * must produce all the data values before any can be placed. Grid
+ * points that are bitmapped out get the fill value.
+ *
+ * @param grid Pointer to the grid and its bitmap.
+ * @param n Number of data values. Must not be more than grid->npts.
+ * @param fld Array of grid->npts values, with the data values in the
+ * last n. Gets the grid points.
+ */
+void
+g2c_expand_tail(g2c_grid *grid, g2int n, g2float *fld)
+{
+    g2c_expand(grid->fmt, grid->bmap, grid->npts, fld + grid->npts - n, n,
+               grid->fill, fld);
+}
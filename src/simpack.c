@@ -34,9 +34,9 @@ void
 simpack(g2float *fld, g2int ndpts, g2int *idrstmpl, 
 	unsigned char *cpack, g2int *lcpack)
 {
-    static g2int zero = 0;
     g2int *ifld;
     g2int j, nbits, imin, imax, maxdif, nbittot, left;
+    g2c_bitwriter bw;
     g2float bscale, dscale, rmax, rmin, temp;
     double maxnum;
     static g2float alog2 = ALOG2;       /*  ln(2.0) */
@@ -58,7 +58,7 @@ simpack(g2float *fld, g2int ndpts, g2int *idrstmpl,
 	    rmin = fld[j];
     }
 
-    ifld = calloc(ndpts, sizeof(g2int));
+    ifld = g2c_calloc(ndpts, sizeof(g2int));
 
     /* If max and min values are not equal, pack up field. If they are
      * equal, we have a constant field, and the reference value (rmin)
@@ -122,13 +122,15 @@ simpack(g2float *fld, g2int ndpts, g2int *idrstmpl,
 
         /* Pack data, Pad last octet with Zeros, if necessary, and
 	 * calculate the length of the packed data in bytes. */
-        sbits(cpack, ifld, 0, nbits, 0, ndpts);
+        g2c_bw_init(&bw, cpack, 0);
+        g2c_bw_put_n(&bw, ifld, nbits, ndpts);
         nbittot = nbits * ndpts;
         left = 8 - (nbittot % 8);
         if (left != 8) {
-            sbit(cpack, &zero, nbittot, left);   /* Pad with zeros to fill Octet. */
+            g2c_bw_put(&bw, 0, left);   /* Pad with zeros to fill Octet. */
             nbittot = nbittot + left;
         }
+        g2c_bw_flush(&bw);
         *lcpack = nbittot / 8;
     }
     else {
@@ -141,5 +143,5 @@ simpack(g2float *fld, g2int ndpts, g2int *idrstmpl,
     idrstmpl[3] = nbits;
     idrstmpl[4] = 0;         /* original data were reals. */
 
-    free(ifld);
+    g2c_free(ifld);
 }
@@ -1,7 +1,6 @@
 /** @file
  * @author Stephen Gilbert @date 2002-10-29
  */
-#include <stdio.h>
 #include <stdlib.h>
 #include "grib2_int.h"
 
@@ -26,8 +25,30 @@ g2int
 simunpack(unsigned char *cpack, g2int *idrstmpl, g2int ndpts,
           g2float *fld)
 {
-    g2int *ifld;
-    g2int j, nbits;
+    return g2c_simunpack(cpack, idrstmpl, ndpts, NULL, fld);
+}
+
+/**
+ * Unpack a data field that was packed using simple packing, like
+ * simunpack(), optionally writing each value straight to its grid
+ * point.
+ *
+ * @param cpack pointer to the packed data field.
+ * @param idrstmpl pointer to the array of values for Data
+ * Representation Template 5.0.
+ * @param ndpts The number of data values to unpack.
+ * @param grid NULL to unpack ndpts values to fld, or pointer to the
+ * grid and bitmap to unpack to.
+ * @param fld Contains the unpacked data values, or the grid points
+ * if grid is not NULL.
+ *
+ * @return 0 for success, error code otherwise.
+ */
+g2int
+g2c_simunpack(unsigned char *cpack, g2int *idrstmpl, g2int ndpts,
+              g2c_grid *grid, g2float *fld)
+{
+    g2int nbits;
     g2float ref, bscale, dscale;
 
     rdieee(idrstmpl, &ref, 1);
@@ -35,27 +56,13 @@ simunpack(unsigned char *cpack, g2int *idrstmpl, g2int ndpts,
     dscale = int_power(10.0, -idrstmpl[2]);
     nbits = idrstmpl[3];
 
-    if (!(ifld = calloc(ndpts, sizeof(g2int))))
-    {
-        fprintf(stderr, "Could not allocate space in simunpack.\n  "
-		"Data field NOT upacked.\n");
-        return G2_JPCUNPACK_MEM;
-    }
-
-    /* If nbits equals 0, we have a constant field where the reference
-     * value is the data value at each gridpoint. */
-    if (nbits != 0)
-    {
-        gbits(cpack, ifld, 0, nbits, 0, ndpts);
-        for (j = 0; j < ndpts; j++)
-            fld[j] = (((g2float)ifld[j] * bscale) + ref) * dscale;
-    }
+    /* Unpack and scale in one pass. If nbits equals 0, we have a
+     * constant field where the reference value is the data value at
+     * each gridpoint. */
+    if (grid)
+        g2c_unpack_scale_grid(cpack, 0, nbits, ndpts, ref, bscale, dscale, grid, fld);
     else
-    {
-        for (j = 0; j < ndpts; j++)
-            fld[j] = ref;
-    }
+        g2c_unpack_scale(cpack, 0, nbits, ndpts, ref, bscale, dscale, fld);
 
-    free(ifld);
     return G2_NO_ERROR;
 }
@@ -46,7 +46,7 @@ specpack(g2float *fld, g2int ndpts, g2int JJ, g2int KK, g2int MM,
 
     /* Calculate Laplacian scaling factors for each possible wave
      * number. */
-    pscale = malloc((JJ + MM + 1) * sizeof(g2float));
+    pscale = g2c_malloc((JJ + MM + 1) * sizeof(g2float));
     tscale = (g2float)idrstmpl[4] * 1E-6;
     for (n = Js; n <= JJ + MM; n++)
         pscale[n] = pow((g2float)(n * (n + 1)), tscale);
@@ -54,9 +54,9 @@ specpack(g2float *fld, g2int ndpts, g2int JJ, g2int KK, g2int MM,
     /* Separate spectral coeffs into two lists; one to contain
      * unpacked values within the sub-spectrum Js, Ks, Ms, and the
      * other with values outside of the sub-spectrum to be packed. */
-    tfld = malloc(ndpts * sizeof(g2float));
-    unpk = malloc(ndpts * sizeof(g2float));
-    ifld = malloc(ndpts * sizeof(g2int));
+    tfld = g2c_malloc(ndpts * sizeof(g2float));
+    unpk = g2c_malloc(ndpts * sizeof(g2float));
+    ifld = g2c_malloc(ndpts * sizeof(g2int));
     inc = 0;
     incu = 0;
     incp = 0;
@@ -82,12 +82,12 @@ specpack(g2float *fld, g2int ndpts, g2int JJ, g2int KK, g2int MM,
             }
         }
     }
-    free(pscale);
+    g2c_free(pscale);
 
     if (incu != Ts)
     {
-        printf("specpack: Incorrect number of unpacked values %d given:\n", (int)Ts);
-        printf("specpack: Resetting idrstmpl[8] to %d\n", (int)incu);
+        g2c_log_stdout("specpack: Incorrect number of unpacked values %d given:\n", (int)Ts);
+        g2c_log_stdout("specpack: Resetting idrstmpl[8] to %d\n", (int)incu);
         Ts = incu;
     }
 
@@ -111,9 +111,9 @@ specpack(g2float *fld, g2int ndpts, g2int JJ, g2int KK, g2int MM,
     idrstmpl[8] = Ts;
     idrstmpl[9] = 1; /* Unpacked spectral data is 32-bit IEEE */
 
-    free(tfld);
-    free(unpk);
-    free(ifld);
+    g2c_free(tfld);
+    g2c_free(unpk);
+    g2c_free(ifld);
 
     return;
 }
@@ -53,8 +53,8 @@ specunpack(unsigned char *cpack, g2int *idrstmpl, g2int ndpts, g2int JJ,
     if (idrstmpl[9] == 1)
     {           /* unpacked floats are 32-bit IEEE */
 
-        unpk = malloc(ndpts * sizeof(g2float));
-        ifld = malloc(ndpts * sizeof(g2int));
+        unpk = g2c_malloc(ndpts * sizeof(g2float));
+        ifld = g2c_malloc(ndpts * sizeof(g2int));
 
         gbits(cpack, ifld, 0, 32, 0, Ts);
         iofst = 32 * Ts;
@@ -63,7 +63,7 @@ specunpack(unsigned char *cpack, g2int *idrstmpl, g2int ndpts, g2int JJ,
 
         /* Calculate Laplacian scaling factors for each possible wave
          * number. */
-        pscale = malloc((JJ + MM + 1) * sizeof(g2float));
+        pscale = g2c_malloc((JJ + MM + 1) * sizeof(g2float));
         tscale = idrstmpl[4] * 1E-6;
         for (n = Js; n <= JJ + MM; n++)
             pscale[n] = pow((g2float)(n * (n+1)), -tscale);
@@ -97,13 +97,13 @@ specunpack(unsigned char *cpack, g2int *idrstmpl, g2int ndpts, g2int JJ,
             }
         }
 
-        free(pscale);
-        free(unpk);
-        free(ifld);
+        g2c_free(pscale);
+        g2c_free(unpk);
+        g2c_free(ifld);
     }
     else
     {
-        printf("specunpack: Cannot handle 64 or 128-bit floats.\n");
+        g2c_log_stdout("specunpack: Cannot handle 64 or 128-bit floats.\n");
         for (j = 0; j < ndpts; j++)
             fld[j] = 0.0;
         return G2_SPECUNPACK_TYPE;
@@ -0,0 +1,382 @@
+/**
+ * @file
+ * @brief Split a stream of bytes, which may not be seekable, into GRIB2
+ * messages.
+ *
+ * The caller feeds the stream chunks of any size, as they are read
+ * from a pipe, socket or decompressor, and a function is called with
+ * each GRIB2 message. A message that is all in one chunk is passed
+ * where it is. Only a message that runs over the end of a chunk is
+ * copied, into a buffer that is kept for the next one. GRIB1 messages
+ * and anything between messages are skipped.
+ *
+ * The messages found are the same as those g2c_scan_buf() finds in
+ * the whole stream. In particular, when something that looks like a
+ * message header is not followed by '7777' where the message should
+ * end, the bytes after it are searched again.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+/** Number of bytes read from a file at a time by g2c_scan_stream(). */
+#define STREAM_BUF_SIZE (1024 * 1024)
+
+/**
+ * Splitter of a stream into messages.
+ */
+struct g2c_stream
+{
+    g2c_stream_cb cb;    /**< Called with each message. */
+    void *arg;           /**< Passed to cb. */
+    g2int offset;        /**< Offset in the stream of the next byte fed. */
+    unsigned char carry[G2C_MSG_HEADER_LEN]; /**< End of the last chunk, which may start a header. */
+    size_t ncarry;       /**< Number of bytes in carry. */
+    unsigned char *buf;  /**< Start of a message that runs over chunks. */
+    size_t have;         /**< Number of bytes in buf. */
+    size_t alloc;        /**< Allocated size of buf. */
+    g2int msglen;        /**< Length of the message in buf, 0 if there is none. */
+    g2int msgoff;        /**< Offset of the message in the stream. */
+    int edition;         /**< GRIB edition of the message. */
+};
+
+static int process(g2c_stream *s, unsigned char *data, size_t len);
+
+/**
+ * Make room in the message buffer. It grows as the message arrives,
+ * so a false header with a large length does not allocate much.
+ *
+ * @param s The stream.
+ * @param need Number of bytes needed.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+grow(g2c_stream *s, size_t need)
+{
+    unsigned char *buf;
+    size_t alloc;
+
+    if (need <= s->alloc)
+        return G2C_NO_ERROR;
+    alloc = 2 * s->alloc > need ? 2 * s->alloc : need;
+    if (alloc > (size_t)s->msglen)
+        alloc = s->msglen;
+    if (!(buf = g2c_realloc(s->buf, alloc)))
+        return G2C_ENOMEM;
+    s->buf = buf;
+    s->alloc = alloc;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Start copying a message that runs over the end of a chunk.
+ *
+ * @param s The stream.
+ * @param p The start of the message.
+ * @param n Number of bytes of the message at p.
+ * @param bytes Length of the message.
+ * @param edition GRIB edition of the message.
+ * @param offset Offset of the message in the stream.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+static int
+start_msg(g2c_stream *s, unsigned char *p, size_t n, g2int bytes, int edition,
+          g2int offset)
+{
+    int ret;
+
+    s->msglen = bytes;
+    s->msgoff = offset;
+    s->edition = edition;
+    s->have = 0;
+    if ((ret = grow(s, n)))
+        return ret;
+    memcpy(s->buf, p, n);
+    s->have = n;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Give up on the message in the buffer, whose header was not the
+ * start of a message, and search the bytes after the 'G' of the
+ * header again.
+ *
+ * @param s The stream.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ * - The value returned by the callback, if it stopped.
+ */
+static int
+redo(g2c_stream *s)
+{
+    unsigned char *buf = s->buf;
+    size_t have = s->have;
+    int ret;
+
+    s->buf = NULL;
+    s->alloc = s->have = 0;
+    s->msglen = 0;
+    s->offset = s->msgoff + 1;
+    ret = process(s, buf + 1, have - 1);
+    g2c_free(buf);
+    return ret;
+}
+
+/**
+ * Finish the message in the buffer, once all of it is there.
+ *
+ * @param s The stream.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ * - The value returned by the callback, if it stopped.
+ */
+static int
+end_msg(g2c_stream *s)
+{
+    if (memcmp(s->buf + s->msglen - 4, "7777", 4))
+        return redo(s);
+    s->msglen = 0;
+    if (s->edition != 2)
+        return G2C_NO_ERROR;
+    return s->cb(s->buf, s->have, s->msgoff, s->arg);
+}
+
+/**
+ * Split a chunk of the stream into messages.
+ *
+ * @param s The stream.
+ * @param data The chunk.
+ * @param len Length of the chunk.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_ENOMEM Out of memory.
+ * - The value returned by the callback, if it stopped.
+ */
+static int
+process(g2c_stream *s, unsigned char *data, size_t len)
+{
+    unsigned char tmp[2 * G2C_MSG_HEADER_LEN], *p, *q, *end;
+    size_t n, ntmp, i;
+    g2int bytes;
+    int edition, ret;
+
+    while (len)
+    {
+        /* Carry on copying a message that runs over chunks. */
+        if (s->msglen)
+        {
+            n = (size_t)s->msglen - s->have;
+            if (n > len)
+                n = len;
+            if ((ret = grow(s, s->have + n)))
+                return ret;
+            memcpy(s->buf + s->have, data, n);
+            s->have += n;
+            s->offset += n;
+            data += n;
+            len -= n;
+            if (s->have == (size_t)s->msglen && (ret = end_msg(s)))
+                return ret;
+            continue;
+        }
+
+        /* Look for a header that starts in the bytes carried over
+         * from the last chunk. */
+        if (s->ncarry)
+        {
+            n = len < G2C_MSG_HEADER_LEN - 1 ? len : G2C_MSG_HEADER_LEN - 1;
+            memcpy(tmp, s->carry, s->ncarry);
+            memcpy(tmp + s->ncarry, data, n);
+            ntmp = s->ncarry + n;
+            for (i = 0; i < s->ncarry; i++)
+                if (tmp[i] == 'G' && (i + G2C_MSG_HEADER_LEN > ntmp ||
+                                      g2c_msg_header(tmp + i, &bytes, &edition)))
+                    break;
+            if (i < s->ncarry && i + G2C_MSG_HEADER_LEN > ntmp)
+            {
+                /* The chunk is too short to tell. */
+                memmove(s->carry, tmp + i, ntmp - i);
+                s->ncarry = ntmp - i;
+                s->offset += len;
+                return G2C_NO_ERROR;
+            }
+            if (i < s->ncarry)
+            {
+                ret = start_msg(s, tmp + i, s->ncarry - i, bytes, edition,
+                                s->offset - (s->ncarry - i));
+                s->ncarry = 0;
+                if (ret)
+                    return ret;
+                continue;
+            }
+            s->ncarry = 0;
+        }
+
+        /* Pass on the messages that are all in the chunk. */
+        end = data + len;
+        for (p = data; (q = memchr(p, 'G', end - p)) && end - q >= G2C_MSG_HEADER_LEN;
+             p = q + 1)
+        {
+            if (!g2c_msg_header(q, &bytes, &edition))
+                continue;
+            if (bytes > end - q)
+                break;
+            if (memcmp(q + bytes - 4, "7777", 4))
+                continue;
+            if (edition == 2 && (ret = s->cb(q, bytes, s->offset + (q - data), s->arg)))
+            {
+                s->offset += q + bytes - data;
+                return ret;
+            }
+            q += bytes - 1;
+        }
+
+        /* Keep what may be the start of a message. */
+        ret = G2C_NO_ERROR;
+        if (q && end - q < G2C_MSG_HEADER_LEN)
+        {
+            memcpy(s->carry, q, end - q);
+            s->ncarry = end - q;
+        }
+        else if (q)
+            ret = start_msg(s, q, end - q, bytes, edition, s->offset + (q - data));
+        s->offset += len;
+        return ret;
+    }
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Start splitting a stream into GRIB2 messages. Feed it with
+ * g2c_stream_feed().
+ *
+ * @param cb Function called with each GRIB2 message.
+ * @param arg Passed to cb.
+ * @param stream Pointer that gets the stream. Close it with
+ * g2c_close_stream().
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_ENOMEM Out of memory.
+ */
+int
+g2c_open_stream(g2c_stream_cb cb, void *arg, g2c_stream **stream)
+{
+    if (!cb || !stream)
+        return G2C_EINVAL;
+    if (!(*stream = g2c_calloc(1, sizeof(g2c_stream))))
+        return G2C_ENOMEM;
+    (*stream)->cb = cb;
+    (*stream)->arg = arg;
+    return G2C_NO_ERROR;
+}
+
+/**
+ * Feed the next chunk of a stream to the splitter. The callback is
+ * called with each GRIB2 message that ends in the chunk. Messages
+ * that are all in the chunk are passed without being copied, so the
+ * chunk is not const.
+ *
+ * If the callback returns non-zero, no more of the chunk is looked at,
+ * and that value is returned. The stream should then be closed.
+ *
+ * @param stream The stream.
+ * @param buf The chunk.
+ * @param len Length of the chunk, which may be anything.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_ENOMEM Out of memory.
+ * - The value returned by the callback, if it stopped.
+ */
+int
+g2c_stream_feed(g2c_stream *stream, unsigned char *buf, size_t len)
+{
+    if (!stream || (len && !buf))
+        return G2C_EINVAL;
+    return process(stream, buf, len);
+}
+
+/**
+ * Close a stream. If it ended part way through something that looked
+ * like a message, the bytes after its header are searched for
+ * messages, as g2c_scan_buf() does, so the callback may be called.
+ *
+ * @param stream The stream.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_ENOMEM Out of memory.
+ * - The value returned by the callback, if it stopped.
+ */
+int
+g2c_close_stream(g2c_stream *stream)
+{
+    int ret = G2C_NO_ERROR;
+
+    if (!stream)
+        return G2C_EINVAL;
+    while (!ret && stream->msglen)
+        ret = redo(stream);
+    g2c_free(stream->buf);
+    g2c_free(stream);
+    return ret;
+}
+
+/**
+ * Read GRIB2 messages from a file that may not be seekable, like a
+ * pipe or standard input, and call a function with each one.
+ *
+ * @param f The file, opened for reading in binary mode.
+ * @param cb Function called with each GRIB2 message.
+ * @param arg Passed to cb.
+ *
+ * @return
+ * - ::G2C_NO_ERROR No error.
+ * - ::G2C_EINVAL Invalid input.
+ * - ::G2C_EFILE Error reading the file.
+ * - ::G2C_ENOMEM Out of memory.
+ * - The value returned by the callback, if it stopped.
+ */
+int
+g2c_scan_stream(FILE *f, g2c_stream_cb cb, void *arg)
+{
+    g2c_stream *stream;
+    unsigned char *buf;
+    size_t n;
+    int ret, cret;
+
+    if (!f || !cb)
+        return G2C_EINVAL;
+    if (!(buf = g2c_malloc(STREAM_BUF_SIZE)))
+        return G2C_ENOMEM;
+    if ((ret = g2c_open_stream(cb, arg, &stream)))
+    {
+        g2c_free(buf);
+        return ret;
+    }
+    while (!ret && (n = fread(buf, 1, STREAM_BUF_SIZE, f)))
+        ret = g2c_stream_feed(stream, buf, n);
+    if (!ret && ferror(f))
+        ret = G2C_EFILE;
+    if (ret)
+        stream->msglen = 0;
+    cret = g2c_close_stream(stream);
+    g2c_free(buf);
+    return ret ? ret : cret;
+}
@@ -36,8 +36,8 @@ g2c_check_msg(unsigned char *cgrib, g2int *lencurr, int verbose)
     if (cgrib[0] != G || cgrib[1] != R || cgrib[2] != I || cgrib[3] != B)
     {
         if (verbose)
-            printf("GRIB not found in given message. A call to routine g2_create() "
-                   "is required to to initialize GRIB messge.\n");
+            g2c_log_stdout("GRIB not found in given message. A call to routine g2_create() "
+                           "is required to to initialize GRIB messge.\n");
         return G2C_NOT_GRIB;
     }
 
@@ -49,9 +49,30 @@ g2c_check_msg(unsigned char *cgrib, g2int *lencurr, int verbose)
         cgrib[*lencurr - 2] == seven && cgrib[*lencurr - 1] == seven)
     {
         if (verbose)
-            printf("GRIB message already complete.  Cannot add new section.\n");
+            g2c_log_stdout("GRIB message already complete.  Cannot add new section.\n");
         return G2C_MSG_COMPLETE;
     }
 
     return G2C_NO_ERROR;
 }
+
+/**
+ * Get the value of a scaled value and its scale factor, as used for
+ * the fixed surfaces of product definition templates.
+ *
+ * @param scale Scale factor.
+ * @param value Scaled value.
+ *
+ * @return value * 10^(-scale).
+ */
+double
+g2c_scaled_value(g2int scale, g2int value)
+{
+    double v = value;
+
+    for (; scale > 0; scale--)
+        v /= 10;
+    for (; scale < 0; scale++)
+        v *= 10;
+    return v;
+}
@@ -0,0 +1,303 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * alloc.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define TEST_GRIB2_FILE "tst_alloc.grib2"
+#define MAGIC 0x6732630a
+#define HDR 16
+#define NPTS 400
+#define NFLDS 3
+#define MSG_LEN 20000
+
+/* What the allocator has seen. */
+struct counts
+{
+    long nalloc;    /* Number of allocations. */
+    long nlive;     /* Number not yet freed. */
+    long fail_at;   /* Fail this allocation, if not 0. */
+    int bad;        /* Set if memory was freed that we did not allocate. */
+};
+
+static struct counts counts;
+
+/* Each allocation has a header, to check that it is ours. */
+static void *
+get(size_t size, int zero, void *ctx)
+{
+    struct counts *c = ctx;
+    unsigned char *p;
+
+    if (c->fail_at && ++c->nalloc == c->fail_at)
+        return NULL;
+    if (!c->fail_at)
+        c->nalloc++;
+    if (!(p = zero ? calloc(1, size + HDR) : malloc(size + HDR)))
+        return NULL;
+    *(int *)p = MAGIC;
+    c->nlive++;
+    return p + HDR;
+}
+
+static void *
+test_malloc(size_t size, void *ctx)
+{
+    return get(size, 0, ctx);
+}
+
+static void *
+test_calloc(size_t nmemb, size_t size, void *ctx)
+{
+    return get(nmemb * size, 1, ctx);
+}
+
+static void
+test_free(void *ptr, void *ctx)
+{
+    struct counts *c = ctx;
+    unsigned char *p = ptr;
+
+    if (!p)
+        return;
+    p -= HDR;
+    if (*(int *)p != MAGIC)
+    {
+        c->bad = 1;
+        return;
+    }
+    *(int *)p = 0;
+    c->nlive--;
+    free(p);
+}
+
+static void *
+test_realloc(void *ptr, size_t size, void *ctx)
+{
+    struct counts *c = ctx;
+    unsigned char *p = ptr, *newp;
+
+    if (!p)
+        return get(size, 0, ctx);
+    p -= HDR;
+    if (*(int *)p != MAGIC)
+    {
+        c->bad = 1;
+        return NULL;
+    }
+    if (c->fail_at && ++c->nalloc == c->fail_at)
+        return NULL;
+    if (!c->fail_at)
+        c->nalloc++;
+    if (!(newp = realloc(p, size + HDR)))
+        return NULL;
+    return newp + HDR;
+}
+
+int
+main()
+{
+    unsigned char cgrib[MSG_LEN];
+    g2int msglen;
+
+    printf("Testing the allocator.\n");
+    printf("Testing g2c_set_allocator() with bad arguments...");
+    {
+        if (g2c_set_allocator(test_malloc, NULL, NULL, NULL, &counts) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_set_allocator(test_malloc, test_calloc, test_realloc, NULL, &counts) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_set_allocator(NULL, NULL, NULL, NULL, NULL))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing that packing uses the allocator...");
+    {
+        g2int listsec0[2] = {0, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, 20, 20, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+        /* Simple packing, complex packing, and complex packing with
+         * spatial differences. */
+        g2int idrstmpl[NFLDS][18] = {
+            {0, 0, 2, 0, 0},
+            {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+            {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2}};
+        g2int idrtnum[NFLDS] = {0, 2, 3};
+        g2int bmap[NPTS];
+        g2float fld[NPTS];
+        int i, f;
+
+        memset(&counts, 0, sizeof(counts));
+        if (g2c_set_allocator(test_malloc, test_calloc, test_realloc, test_free, &counts))
+            return G2C_ERROR;
+
+        /* A message with a field of each packing, all with a
+         * bitmap. The later tests unpack it. */
+        for (i = 0; i < NPTS; i++)
+        {
+            bmap[i] = i % 7 != 0;
+            fld[i] = (i % 37) * 0.25 + (i / 50);
+        }
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        for (f = 0; f < NFLDS; f++)
+            if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, idrtnum[f], idrstmpl[f], fld, NPTS,
+                            0, bmap) < 0)
+                return G2C_ERROR;
+        if ((msglen = g2_gribend(cgrib)) < 0)
+            return G2C_ERROR;
+        if (!counts.nalloc || counts.nlive || counts.bad)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing that unpacking uses the allocator...");
+    {
+        gribfield *gfld;
+        g2c_msg *msg;
+        g2float *fld;
+        g2int nfld;
+        int f, flags[3] = {0, G2C_BMAP_BITS, G2C_GFLD_ARENA};
+        int fl;
+
+        memset(&counts, 0, sizeof(counts));
+        for (f = 1; f <= NFLDS; f++)
+        {
+            if (g2_getfld(cgrib, f, 1, 1, &gfld))
+                return G2C_ERROR;
+            g2_free(gfld);
+            for (fl = 0; fl < 3; fl++)
+            {
+                if (g2c_getfld(cgrib, f, 1, 0, flags[fl], &gfld))
+                    return G2C_ERROR;
+                g2_free(gfld);
+            }
+            if (g2c_open_msg(cgrib, &msg))
+                return G2C_ERROR;
+            if (g2c_msg_getfld(msg, f, 1, 1, 0, &gfld))
+                return G2C_ERROR;
+            g2_free(gfld);
+            if (g2c_close_msg(msg))
+                return G2C_ERROR;
+        }
+
+        /* Decoding into the caller's array. */
+        if (g2c_getfld_size(cgrib, 2, 1, &nfld))
+            return G2C_ERROR;
+        if (!(fld = malloc(nfld * sizeof(g2float))))
+            return G2C_ERROR;
+        if (g2c_getfld_into(cgrib, 2, 1, 0, fld, nfld, &gfld))
+            return G2C_ERROR;
+        g2_free(gfld);
+        free(fld);
+        if (!counts.nalloc || counts.nlive || counts.bad)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing that scanning and indexing use the allocator...");
+    {
+        g2c_msgloc *msgs;
+        size_t nmsgs;
+        g2c_idx *idx;
+        gribfield *gfld;
+        unsigned char *msg;
+        g2int lengrib;
+        FILE *f;
+
+        memset(&counts, 0, sizeof(counts));
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_scan_file(f, &msgs, &nmsgs))
+            return G2C_ERROR;
+        if (g2c_read_msg(f, msgs[1].offset, &msg, &lengrib))
+            return G2C_ERROR;
+        if (g2_getfld(msg, 1, 0, 0, &gfld))
+            return G2C_ERROR;
+        g2_free(gfld);
+        test_free(msg, &counts);
+        test_free(msgs, &counts);
+        fclose(f);
+        if (g2c_make_idx(GRIB2_FILE, &idx))
+            return G2C_ERROR;
+        if (g2c_free_idx(idx))
+            return G2C_ERROR;
+        if (!counts.nalloc || counts.nlive || counts.bad)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing that failed allocations are handled...");
+    {
+        gribfield *gfld;
+        long n, total;
+        int f;
+
+        /* Count the allocations, then fail each one in turn. */
+        for (f = 1; f <= NFLDS; f++)
+        {
+            memset(&counts, 0, sizeof(counts));
+            if (g2_getfld(cgrib, f, 1, 1, &gfld))
+                return G2C_ERROR;
+            g2_free(gfld);
+            total = counts.nalloc;
+            for (n = 1; n <= total; n++)
+            {
+                memset(&counts, 0, sizeof(counts));
+                counts.fail_at = n;
+                gfld = NULL;
+                if (!g2_getfld(cgrib, f, 1, 1, &gfld))
+                    return G2C_ERROR;
+                if (gfld)
+                    g2_free(gfld);
+                if (counts.nlive || counts.bad)
+                    return G2C_ERROR;
+            }
+        }
+    }
+    printf("ok!\n");
+    printf("Testing that failed allocations stop g2c_make_idx()...");
+    {
+        g2c_idx *idx;
+        long n, total;
+        FILE *f;
+
+        /* A file of the message with several fields, so an
+         * allocation may fail on a field before the last. */
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        if (fwrite(cgrib, 1, msglen, f) != msglen)
+            return G2C_ERROR;
+        fclose(f);
+
+        memset(&counts, 0, sizeof(counts));
+        if (g2c_make_idx(TEST_GRIB2_FILE, &idx))
+            return G2C_ERROR;
+        if (idx->nrecs != NFLDS)
+            return G2C_ERROR;
+        g2c_free_idx(idx);
+        total = counts.nalloc;
+        for (n = 1; n <= total; n++)
+        {
+            memset(&counts, 0, sizeof(counts));
+            counts.fail_at = n;
+            if (g2c_make_idx(TEST_GRIB2_FILE, &idx) != G2C_ENOMEM)
+                return G2C_ERROR;
+            if (counts.nlive || counts.bad)
+                return G2C_ERROR;
+        }
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    if (g2c_set_allocator(NULL, NULL, NULL, NULL, NULL))
+        return G2C_ERROR;
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,324 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * bidx.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define GRIB2_INDEX_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2.idx"
+#define TEST_BIDX_FILE "tst_bidx.bidx"
+#define TEST_GRIB2_FILE "tst_bidx.grib2"
+#define NUM_MSGS 19
+#define NPTS 1003
+#define NFLDS 4
+#define MSG_LEN 20000
+#define REF_BIDX_FILE "tst_bidx_ref.bidx"
+#define MAX_FILE_LEN 400000
+
+int
+main()
+{
+    printf("Testing binary index.\n");
+    printf("Testing g2c_write_bidx() on test data file...");
+    {
+        g2c_bidx *bidx;
+        g2c_idx *idx;
+        const g2c_bidx_rec *recs;
+        size_t nrecs, i;
+        FILE *f;
+
+        if (g2c_write_bidx(GRIB2_FILE, TEST_BIDX_FILE))
+            return G2C_ERROR;
+        if (g2c_open_bidx(TEST_BIDX_FILE, &bidx))
+            return G2C_ERROR;
+        if (g2c_bidx_recs(bidx, &nrecs, &recs))
+            return G2C_ERROR;
+        if (nrecs != NUM_MSGS)
+            return G2C_ERROR;
+
+        /* Check the records against the wgrib2 inventory. */
+        if (!(f = fopen(GRIB2_INDEX_FILE, "r")))
+            return G2C_ERROR;
+        if (g2c_read_idx(f, &idx))
+            return G2C_ERROR;
+        fclose(f);
+        for (i = 0; i < nrecs; i++)
+        {
+            if (recs[i].msg_offset != idx->recs[i].offset ||
+                recs[i].msgnum != idx->recs[i].msgnum || recs[i].fldnum != 1)
+                return G2C_ERROR;
+            if (i + 1 < nrecs && recs[i].msg_offset + recs[i].msg_len != recs[i + 1].msg_offset)
+                return G2C_ERROR;
+            if (recs[i].refyear != 2021 || recs[i].refmonth != 11 || recs[i].refday != 30 ||
+                recs[i].refhour != 0 || recs[i].fcst_time != 0 || recs[i].ens_member != -1)
+                return G2C_ERROR;
+            if (!strcmp(idx->recs[i].level, "surface") != (recs[i].level_type1 == 1))
+                return G2C_ERROR;
+            if (recs[i].idrtnum != 40 || recs[i].ndpts > recs[i].ngrdpts)
+                return G2C_ERROR;
+            if (recs[i].sec_offset[7] + recs[i].sec_len[7] + 4 != recs[i].msg_len)
+                return G2C_ERROR;
+        }
+        if (recs[0].discipline != 0 || recs[0].category != 2 || recs[0].number != 1)
+            return G2C_ERROR;
+        if (recs[9].discipline != 10 || recs[9].number != 8 ||
+            recs[9].level_type1 != 241 || recs[9].level_value1 != 2)
+            return G2C_ERROR;
+        g2c_free_idx(idx);
+        if (g2c_close_bidx(bidx))
+            return G2C_ERROR;
+        remove(TEST_BIDX_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_open_bidx() errors...");
+    {
+        g2c_bidx *bidx;
+
+        if (g2c_open_bidx(GRIB2_FILE, &bidx) != G2C_EBADIDX)
+            return G2C_ERROR;
+        if (g2c_open_bidx("no_such_file", &bidx) != G2C_EFILE)
+            return G2C_ERROR;
+        if (g2c_write_bidx("no_such_file", TEST_BIDX_FILE) != G2C_EFILE)
+            return G2C_ERROR;
+        if (g2c_close_bidx(NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_bidx_getdata() against g2_getfld()...");
+    {
+        unsigned char cgrib[MSG_LEN], *msg;
+        g2int listsec0[2] = {0, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, NPTS, 1, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        g2int ipdstmpl[18] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0, 3, 7, 20};
+        g2int idrstmpl[18];
+        /* Template, bitmap indicator and packing of each field. */
+        g2int ipdtnum[NFLDS] = {0, 1, 0, 0};
+        g2int ibmap[NFLDS] = {0, 254, 255, 0};
+        g2int idrtnum[NFLDS] = {0, 2, 3, 3};
+        g2float fld[NPTS], *data;
+        g2int bmap[NPTS], msglen, nfld, lengrib, expand;
+        const g2c_bidx_rec *recs;
+        gribfield *gfld;
+        g2c_bidx *bidx;
+        size_t nrecs;
+        FILE *f;
+        int i, r;
+
+        for (i = 0; i < NPTS; i++)
+        {
+            bmap[i] = (i % 3 != 0 && i % 7 != 0);
+            fld[i] = (i % 100) * 0.5f;
+        }
+
+        /* A message with four fields, written after some junk. */
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        for (r = 0; r < NFLDS; r++)
+        {
+            memset(idrstmpl, 0, sizeof(idrstmpl));
+            idrstmpl[2] = 1;
+            ipdstmpl[1] = r;
+            if (g2_addfield(cgrib, ipdtnum[r], ipdstmpl, NULL, 0, idrtnum[r], idrstmpl,
+                            fld, NPTS, ibmap[r], bmap) < 0)
+                return G2C_ERROR;
+        }
+        if ((msglen = g2_gribend(cgrib)) < 0)
+            return G2C_ERROR;
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        if (fwrite("junk", 1, 4, f) != 4 || fwrite(cgrib, 1, msglen, f) != msglen)
+            return G2C_ERROR;
+        fclose(f);
+
+        if (g2c_write_bidx(TEST_GRIB2_FILE, TEST_BIDX_FILE))
+            return G2C_ERROR;
+        if (g2c_open_bidx(TEST_BIDX_FILE, &bidx))
+            return G2C_ERROR;
+        if (g2c_bidx_recs(bidx, &nrecs, &recs))
+            return G2C_ERROR;
+        if (nrecs != NFLDS)
+            return G2C_ERROR;
+        if (recs[1].ens_type != 3 || recs[1].ens_member != 7 || recs[0].ens_member != -1)
+            return G2C_ERROR;
+        if (recs[0].hash == recs[3].hash || recs[1].bmap_offset != recs[0].sec_offset[6])
+            return G2C_ERROR;
+
+        if (!(f = fopen(TEST_GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_read_msg(f, recs[0].msg_offset, &msg, &lengrib))
+            return G2C_ERROR;
+        for (r = 0; r < NFLDS; r++)
+        {
+            if (recs[r].msg_offset != 4 || recs[r].msg_len != msglen || recs[r].fldnum != r + 1)
+                return G2C_ERROR;
+            for (expand = 0; expand <= 1; expand++)
+            {
+                if (g2_getfld(msg, r + 1, 1, expand, &gfld))
+                    return G2C_ERROR;
+                if (g2c_bidx_getdata(bidx, r, f, expand, &data, &nfld))
+                    return G2C_ERROR;
+                if (nfld != (gfld->expanded ? gfld->ngrdpts : gfld->ndpts))
+                    return G2C_ERROR;
+                for (i = 0; i < nfld; i++)
+                    if (data[i] != gfld->fld[i])
+                        return G2C_ERROR;
+                free(data);
+                g2_free(gfld);
+            }
+        }
+        if (g2c_bidx_getdata(bidx, NFLDS, f, 1, &data, &nfld) != G2C_EINVAL)
+            return G2C_ERROR;
+        free(msg);
+        fclose(f);
+        if (g2c_close_bidx(bidx))
+            return G2C_ERROR;
+        remove(TEST_BIDX_FILE);
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_write_bidx() with a satellite product template...");
+    {
+        unsigned char cgrib[MSG_LEN];
+        g2int listsec0[2] = {3, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, NPTS, 1, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        /* Template 4.31 with one spectral band. */
+        g2int ipdstmpl31[10] = {0, 7, 0, 0, 1, 333, 16, 617, 0, 1500};
+        g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+        g2int idrstmpl[5] = {0, 0, 1, 0, 0};
+        g2float fld[NPTS];
+        g2int msglen;
+        const g2c_bidx_rec *recs;
+        g2c_bidx *bidx;
+        size_t nrecs;
+        FILE *f;
+        int i;
+
+        for (i = 0; i < NPTS; i++)
+            fld[i] = (i % 100) * 0.5f;
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        if (g2_addfield(cgrib, 31, ipdstmpl31, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+            return G2C_ERROR;
+        if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+            return G2C_ERROR;
+        if ((msglen = g2_gribend(cgrib)) < 0)
+            return G2C_ERROR;
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        if (fwrite(cgrib, 1, msglen, f) != msglen)
+            return G2C_ERROR;
+        fclose(f);
+
+        /* Both fields are indexed. The satellite field has no level
+         * or forecast time. */
+        if (g2c_write_bidx(TEST_GRIB2_FILE, TEST_BIDX_FILE))
+            return G2C_ERROR;
+        if (g2c_open_bidx(TEST_BIDX_FILE, &bidx))
+            return G2C_ERROR;
+        if (g2c_bidx_recs(bidx, &nrecs, &recs))
+            return G2C_ERROR;
+        if (nrecs != 2)
+            return G2C_ERROR;
+        if (recs[0].ipdtnum != 31 || recs[0].discipline != 3 || recs[0].category != 0 ||
+            recs[0].number != 7 || recs[0].level_type1 || recs[0].fcst_time ||
+            recs[0].ens_member != -1)
+            return G2C_ERROR;
+        if (recs[1].ipdtnum != 0 || recs[1].fldnum != 2 || recs[1].level_type1 != 100 ||
+            recs[1].level_value1 != 50000 || recs[1].fcst_time != 6)
+            return G2C_ERROR;
+        if (g2c_close_bidx(bidx))
+            return G2C_ERROR;
+        remove(TEST_BIDX_FILE);
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_update_bidx() on a file as it is written...");
+    {
+        unsigned char *buf, *ref, *idx;
+        const g2c_bidx_rec *recs;
+        g2c_bidx *bidx;
+        size_t len, written = 0, step, nnew, total = 0, nrecs, reflen, idxlen;
+        FILE *f, *out;
+
+        if (!(buf = malloc(MAX_FILE_LEN)) || !(ref = malloc(MAX_FILE_LEN)) ||
+            !(idx = malloc(MAX_FILE_LEN)))
+            return G2C_ERROR;
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        len = fread(buf, 1, MAX_FILE_LEN, f);
+        fclose(f);
+
+        /* Write the file in pieces that end inside messages, and
+         * bring the index up to date after each one. */
+        remove(TEST_BIDX_FILE);
+        if (!(out = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        for (step = 9000; written < len; written += step)
+        {
+            if (step > len - written)
+                step = len - written;
+            if (fwrite(buf + written, 1, step, out) != step || fflush(out))
+                return G2C_ERROR;
+            if (g2c_update_bidx(TEST_GRIB2_FILE, TEST_BIDX_FILE, &nnew))
+                return G2C_ERROR;
+            total += nnew;
+
+            /* The index can be read at any time. */
+            if (g2c_open_bidx(TEST_BIDX_FILE, &bidx))
+                return G2C_ERROR;
+            if (g2c_bidx_recs(bidx, &nrecs, &recs) || nrecs != total)
+                return G2C_ERROR;
+            if (nrecs && recs[nrecs - 1].msg_offset + recs[nrecs - 1].msg_len > written + step)
+                return G2C_ERROR;
+            if (g2c_close_bidx(bidx))
+                return G2C_ERROR;
+        }
+        fclose(out);
+        if (total != NUM_MSGS)
+            return G2C_ERROR;
+        if (g2c_update_bidx(TEST_GRIB2_FILE, TEST_BIDX_FILE, &nnew) || nnew)
+            return G2C_ERROR;
+
+        /* It is the same as the index of the whole file. */
+        if (g2c_write_bidx(GRIB2_FILE, REF_BIDX_FILE))
+            return G2C_ERROR;
+        if (!(f = fopen(REF_BIDX_FILE, "rb")))
+            return G2C_ERROR;
+        reflen = fread(ref, 1, MAX_FILE_LEN, f);
+        fclose(f);
+        if (!(f = fopen(TEST_BIDX_FILE, "rb")))
+            return G2C_ERROR;
+        idxlen = fread(idx, 1, MAX_FILE_LEN, f);
+        fclose(f);
+        if (reflen != idxlen || memcmp(ref, idx, reflen))
+            return G2C_ERROR;
+
+        /* A GRIB file is not an index. */
+        if (g2c_update_bidx(GRIB2_FILE, TEST_GRIB2_FILE, NULL) != G2C_EBADIDX)
+            return G2C_ERROR;
+        if (g2c_update_bidx("no_such_file", TEST_BIDX_FILE, NULL) != G2C_EFILE)
+            return G2C_ERROR;
+        free(buf);
+        free(ref);
+        free(idx);
+        remove(REF_BIDX_FILE);
+        remove(TEST_BIDX_FILE);
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
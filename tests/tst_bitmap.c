@@ -0,0 +1,252 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * the compact bitmap formats of g2c_getfld(), and bitmap.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "grib2.h"
+
+#define G2C_ERROR 2
+#define NPTS 1003
+#define MSG_LEN 4000
+
+int
+main()
+{
+    unsigned char cgrib[MSG_LEN];
+    g2int listsec0[2] = {1, 2};
+    g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+    g2int igds[5] = {0, NPTS, 0, 0, 0};
+    g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, NPTS, 1, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+    g2int ipdstmpl[15] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+    g2int idrstmpl[5] = {0, 0, 0, 0, 0};
+    g2float fld[NPTS];
+    g2int bmap[NPTS];
+    g2int nset = 0, msglen;
+    int i;
+
+    printf("Testing compact bitmap formats.\n");
+
+    /* Create a message with two fields. The first has a bitmap, the
+     * second uses the same bitmap again. */
+    for (i = 0; i < NPTS; i++)
+    {
+        bmap[i] = (i % 3 != 0 && i % 7 != 0);
+        nset += bmap[i];
+        fld[i] = i % 100;
+    }
+    if (g2_create(cgrib, listsec0, listsec1) < 0)
+        return G2C_ERROR;
+    if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+        return G2C_ERROR;
+    if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, NPTS, 0, bmap) < 0)
+        return G2C_ERROR;
+    if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, NPTS, 254, bmap) < 0)
+        return G2C_ERROR;
+    if ((msglen = g2_gribend(cgrib)) < 0)
+        return G2C_ERROR;
+
+    printf("Testing g2c_getfld() against g2_getfld()...");
+    {
+        int flags[3] = {0, G2C_BMAP_UINT8, G2C_BMAP_BITS};
+        gribfield *gfld, *cgfld;
+        g2int ifldnum, expand;
+        int f;
+
+        for (ifldnum = 1; ifldnum <= 2; ifldnum++)
+        {
+            for (expand = 0; expand <= 1; expand++)
+            {
+                if (g2_getfld(cgrib, ifldnum, 1, expand, &gfld))
+                    return G2C_ERROR;
+                if (!gfld->bmap || gfld->cbmap || gfld->bmap_fmt != G2C_BMAP_G2INT)
+                    return G2C_ERROR;
+                if (gfld->ndpts != nset || gfld->expanded != expand)
+                    return G2C_ERROR;
+                if (g2c_bmap_count(gfld) != nset)
+                    return G2C_ERROR;
+                for (i = 0; i < NPTS; i++)
+                    if (gfld->bmap[i] != bmap[i] || g2c_bmap_get(gfld, i) != bmap[i])
+                        return G2C_ERROR;
+                if (expand)
+                    for (i = 0; i < NPTS; i++)
+                        if (gfld->fld[i] != (bmap[i] ? fld[i] : 0))
+                            return G2C_ERROR;
+
+                for (f = 0; f < 3; f++)
+                {
+                    if (g2c_getfld(cgrib, ifldnum, 1, expand, flags[f], &cgfld))
+                        return G2C_ERROR;
+                    if (cgfld->bmap_fmt != flags[f] || cgfld->expanded != expand)
+                        return G2C_ERROR;
+                    if (flags[f] && (cgfld->bmap || !cgfld->cbmap))
+                        return G2C_ERROR;
+                    if (g2c_bmap_count(cgfld) != nset)
+                        return G2C_ERROR;
+                    for (i = 0; i < NPTS; i++)
+                        if (g2c_bmap_get(cgfld, i) != bmap[i])
+                            return G2C_ERROR;
+                    for (i = 0; i < (expand ? NPTS : nset); i++)
+                        if (cgfld->fld[i] != gfld->fld[i])
+                            return G2C_ERROR;
+                    g2_free(cgfld);
+                }
+                g2_free(gfld);
+            }
+        }
+
+        /* With both flags, the bitmap is bits. */
+        if (g2c_getfld(cgrib, 1, 1, 1, G2C_BMAP_UINT8 | G2C_BMAP_BITS, &cgfld))
+            return G2C_ERROR;
+        if (cgfld->bmap_fmt != G2C_BMAP_BITS)
+            return G2C_ERROR;
+        for (i = 0; i < NPTS / 8; i++)
+        {
+            g2int b = 0, k;
+
+            for (k = 0; k < 8; k++)
+                b = (b << 1) | bmap[8 * i + k];
+            if (cgfld->cbmap[i] != b)
+                return G2C_ERROR;
+        }
+        g2_free(cgfld);
+    }
+    printf("ok!\n");
+
+    printf("Testing g2c_bmap_expand() with a fill value...");
+    {
+        int flags[3] = {0, G2C_BMAP_UINT8, G2C_BMAP_BITS};
+        gribfield *gfld;
+        g2float grid[NPTS];
+        int f;
+
+        for (f = 0; f < 3; f++)
+        {
+            if (g2c_getfld(cgrib, 1, 1, 0, flags[f], &gfld))
+                return G2C_ERROR;
+            g2c_bmap_expand(gfld, gfld->fld, 9999, grid);
+            for (i = 0; i < NPTS; i++)
+                if (grid[i] != (bmap[i] ? fld[i] : 9999))
+                    return G2C_ERROR;
+            g2_free(gfld);
+        }
+    }
+    printf("ok!\n");
+
+    printf("Testing g2c_addfield() with each bitmap format and scratch space...");
+    {
+        unsigned char cgrib2[MSG_LEN], b8[NPTS], bits[(NPTS + 7) / 8] = {0};
+        g2float scratch[NPTS], fldcopy[NPTS];
+        int fmt, s;
+
+        for (i = 0; i < NPTS; i++)
+        {
+            b8[i] = (unsigned char)bmap[i];
+            bits[i / 8] |= (unsigned char)(bmap[i] << (7 - i % 8));
+        }
+        for (fmt = G2C_BMAP_G2INT; fmt <= G2C_BMAP_BITS; fmt++)
+        {
+            void *bm = fmt == G2C_BMAP_BITS ? (void *)bits :
+                fmt == G2C_BMAP_UINT8 ? (void *)b8 : (void *)bmap;
+
+            /* No scratch, separate scratch, and the field itself. */
+            for (s = 0; s < 3; s++)
+            {
+                g2float *sp = s == 0 ? NULL : s == 1 ? scratch : fldcopy;
+                g2int drs[5] = {0, 0, 0, 0, 0};
+                int f;
+
+                if (g2_create(cgrib2, listsec0, listsec1) < 0)
+                    return G2C_ERROR;
+                if (g2_addgrid(cgrib2, igds, igdstmpl, NULL, 0) < 0)
+                    return G2C_ERROR;
+                for (f = 0; f < 2; f++)
+                {
+                    for (i = 0; i < NPTS; i++)
+                        fldcopy[i] = fld[i];
+                    if (g2c_addfield(cgrib2, 0, ipdstmpl, NULL, 0, 0, drs, fldcopy, NPTS,
+                                     f ? 254 : 0, bm, fmt, sp) < 0)
+                        return G2C_ERROR;
+                }
+                if (g2_gribend(cgrib2) != msglen)
+                    return G2C_ERROR;
+                for (i = 0; i < msglen; i++)
+                    if (cgrib2[i] != cgrib[i])
+                        return G2C_ERROR;
+            }
+        }
+    }
+    printf("ok!\n");
+
+    printf("Testing unpacking straight to the grid with simple and complex packing...");
+    {
+        unsigned char cgrib3[MSG_LEN];
+        g2int drs[4][18] = {
+            {0, 0, 2, 0, 0},
+            {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+            {0, 0, 2, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+            {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2}};
+        g2int drsnum[4] = {0, 2, 2, 3};
+        g2float wave[NPTS];
+        int f, flags[2] = {0, G2C_BMAP_BITS};
+        int fl;
+
+        for (i = 0; i < NPTS; i++)
+            wave[i] = (i % 37) * 0.25 + (i / 50);
+        if (g2_create(cgrib3, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib3, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        for (f = 0; f < 4; f++)
+            if (g2_addfield(cgrib3, 0, ipdstmpl, NULL, 0, drsnum[f], drs[f], wave, NPTS,
+                            f ? 254 : 0, bmap) < 0)
+                return G2C_ERROR;
+        if (g2_gribend(cgrib3) < 0)
+            return G2C_ERROR;
+
+        /* Each field expanded while unpacking must match the field
+         * unpacked and then expanded. */
+        for (f = 0; f < 4; f++)
+        {
+            for (fl = 0; fl < 2; fl++)
+            {
+                gribfield *gfld, *efld;
+                g2int m = 0;
+
+                if (g2c_getfld(cgrib3, f + 1, 1, 0, flags[fl], &gfld))
+                    return G2C_ERROR;
+                if (g2c_getfld(cgrib3, f + 1, 1, 1, flags[fl], &efld))
+                    return G2C_ERROR;
+                if (gfld->expanded || !efld->expanded || gfld->ndpts != nset)
+                    return G2C_ERROR;
+                for (i = 0; i < NPTS; i++)
+                {
+                    if (efld->fld[i] != (bmap[i] ? gfld->fld[m++] : 0))
+                        return G2C_ERROR;
+                    if (bmap[i] && fabs(efld->fld[i] - wave[i]) > 0.01)
+                        return G2C_ERROR;
+                }
+                g2_free(gfld);
+                g2_free(efld);
+            }
+        }
+    }
+    printf("ok!\n");
+
+    printf("Testing g2c_bmap_get() with no bitmap...");
+    {
+        gribfield *gfld;
+
+        if (g2c_getfld(cgrib, 1, 0, 0, G2C_BMAP_BITS, &gfld))
+            return G2C_ERROR;
+        if (gfld->cbmap || gfld->bmap || g2c_bmap_get(gfld, 5) != 1)
+            return G2C_ERROR;
+        if (g2c_bmap_count(gfld) != NPTS)
+            return G2C_ERROR;
+        g2_free(gfld);
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * catalog.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define TEST_GRIB2_FILE "tst_catalog.grib2"
+#define REF_BIDX_FILE "tst_catalog_ref.bidx"
+#define REF_BIDX_FILE2 "tst_catalog_ref2.bidx"
+#define TEST_BIDX_FILE "tst_catalog.bidx"
+#define TEST_BIDX_FILE2 "tst_catalog2.bidx"
+#define TEST_CATALOG_FILE "tst_catalog.cat"
+#define NUM_RECS 19
+#define NUM_THREADS 4
+#define NPTS 4
+#define MSG_LEN 2000
+#define MAX_FILE_LEN 20000
+
+/* Check that two (small) files are the same. */
+static int
+same_file(const char *path1, const char *path2)
+{
+    char buf1[MAX_FILE_LEN], buf2[MAX_FILE_LEN];
+    size_t len1, len2;
+    FILE *f;
+
+    if (!(f = fopen(path1, "rb")))
+        return 0;
+    len1 = fread(buf1, 1, MAX_FILE_LEN, f);
+    fclose(f);
+    if (!(f = fopen(path2, "rb")))
+        return 0;
+    len2 = fread(buf2, 1, MAX_FILE_LEN, f);
+    fclose(f);
+    return len1 == len2 && !memcmp(buf1, buf2, len1);
+}
+
+int
+main()
+{
+    printf("Testing catalogs.\n");
+    printf("Testing g2c_write_bidxs() on test data file...");
+    {
+        const char *paths[2] = {GRIB2_FILE, GRIB2_FILE};
+        const char *idxpaths[2] = {TEST_BIDX_FILE, TEST_BIDX_FILE2};
+        size_t chunk_size[] = {16, 1000, 15254, 100000, 1 << 20};
+        int c, nthreads;
+
+        if (g2c_write_bidx(GRIB2_FILE, REF_BIDX_FILE))
+            return G2C_ERROR;
+        for (nthreads = 1; nthreads <= NUM_THREADS; nthreads += 3)
+        {
+            if (g2c_write_bidxs(2, paths, idxpaths, nthreads))
+                return G2C_ERROR;
+            if (!same_file(REF_BIDX_FILE, TEST_BIDX_FILE) ||
+                !same_file(REF_BIDX_FILE, TEST_BIDX_FILE2))
+                return G2C_ERROR;
+
+            /* Large files are cut into chunks. */
+            for (c = 0; c < sizeof(chunk_size) / sizeof(size_t); c++)
+            {
+                if (g2c_build_bidx(1, paths, idxpaths, NULL, nthreads, chunk_size[c]))
+                    return G2C_ERROR;
+                if (!same_file(REF_BIDX_FILE, TEST_BIDX_FILE))
+                    return G2C_ERROR;
+            }
+        }
+        remove(TEST_BIDX_FILE);
+        remove(TEST_BIDX_FILE2);
+    }
+    printf("ok!\n");
+    printf("Testing chunks that start inside a message...");
+    {
+        unsigned char cgrib[3][MSG_LEN], *p;
+        /* The header of a message, and a byte so the section does not
+         * end in '7777'. */
+        unsigned char local[17] = "GRIB\0\0\0\2";
+        const char *paths[1] = {TEST_GRIB2_FILE};
+        const char *idxpaths[1] = {TEST_BIDX_FILE};
+        g2int listsec0[2] = {0, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, 2, 2, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+        g2int idrstmpl[5] = {0};
+        g2float fld[NPTS] = {1, 2, 3, 4};
+        const g2c_bidx_rec *recs;
+        g2c_bidx *bidx;
+        g2int len[3], file_len, fake, i;
+        size_t nrecs, chunk_size;
+        FILE *f;
+
+        /* Junk, a message, a message with the header of a message in
+         * its local use section, a GRIB1 header, and a message. The
+         * length in the header in the local use section is set to
+         * reach the '7777' at the end of the file, so a chunk that
+         * starts before it is out of step. */
+        for (i = 0; i < 3; i++)
+        {
+            ipdstmpl[1] = i + 1;
+            if (g2_create(cgrib[i], listsec0, listsec1) < 0)
+                return G2C_ERROR;
+            if (i == 1 && g2_addlocal(cgrib[i], local, sizeof(local)) < 0)
+                return G2C_ERROR;
+            if (g2_addgrid(cgrib[i], igds, igdstmpl, NULL, 0) < 0)
+                return G2C_ERROR;
+            if (g2_addfield(cgrib[i], 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, NPTS, 255,
+                            NULL) < 0)
+                return G2C_ERROR;
+            if ((len[i] = g2_gribend(cgrib[i])) < 0)
+                return G2C_ERROR;
+        }
+        file_len = 8 + len[0] + len[1] + 8 + len[2];
+        for (p = cgrib[1] + 4; memcmp(p, local, 8); p++)
+            ;
+        fake = 8 + len[0] + (p - cgrib[1]);
+        for (i = 0; i < 8; i++)
+            p[8 + i] = (file_len - fake) >> (8 * (7 - i));
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        fwrite("junkGRIB", 1, 8, f);
+        fwrite(cgrib[0], 1, len[0], f);
+        fwrite(cgrib[1], 1, len[1], f);
+        fwrite("GRIB\0\0\0\1", 1, 8, f);
+        fwrite(cgrib[2], 1, len[2], f);
+        fclose(f);
+
+        if (g2c_write_bidx(TEST_GRIB2_FILE, REF_BIDX_FILE))
+            return G2C_ERROR;
+        if (g2c_open_bidx(REF_BIDX_FILE, &bidx))
+            return G2C_ERROR;
+        if (g2c_bidx_recs(bidx, &nrecs, &recs) || nrecs != 3)
+            return G2C_ERROR;
+        if (recs[0].number != 1 || recs[1].number != 2 || recs[2].number != 3)
+            return G2C_ERROR;
+        if (g2c_close_bidx(bidx))
+            return G2C_ERROR;
+
+        /* Every way of cutting the file gives the same index. */
+        for (chunk_size = 1; chunk_size <= file_len; chunk_size++)
+        {
+            if (g2c_build_bidx(1, paths, idxpaths, NULL, NUM_THREADS, chunk_size))
+                return G2C_ERROR;
+            if (!same_file(REF_BIDX_FILE, TEST_BIDX_FILE))
+                return G2C_ERROR;
+        }
+        remove(TEST_BIDX_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_write_catalog()...");
+    {
+        const char *paths[3] = {GRIB2_FILE, TEST_GRIB2_FILE, GRIB2_FILE};
+        const char **cpaths;
+        const g2c_bidx_rec *recs, *ref, *ref2;
+        g2c_bidx *bidx, *rbidx, *rbidx2;
+        g2c_query q;
+        g2c_match *m;
+        size_t nrecs, nref, nref2, nm, i;
+        int nfiles;
+
+        if (g2c_write_catalog(3, paths, TEST_CATALOG_FILE, NUM_THREADS))
+            return G2C_ERROR;
+        if (g2c_write_bidx(GRIB2_FILE, REF_BIDX_FILE2))
+            return G2C_ERROR;
+        if (g2c_open_bidx(TEST_CATALOG_FILE, &bidx))
+            return G2C_ERROR;
+        if (g2c_open_bidx(REF_BIDX_FILE2, &rbidx) || g2c_open_bidx(REF_BIDX_FILE, &rbidx2))
+            return G2C_ERROR;
+        if (g2c_bidx_files(bidx, &nfiles, &cpaths) || nfiles != 3)
+            return G2C_ERROR;
+        for (i = 0; i < 3; i++)
+            if (strcmp(cpaths[i], paths[i]))
+                return G2C_ERROR;
+
+        /* The records of each file, one after another. */
+        g2c_bidx_recs(bidx, &nrecs, &recs);
+        g2c_bidx_recs(rbidx, &nref, &ref);
+        g2c_bidx_recs(rbidx2, &nref2, &ref2);
+        if (nrecs != 2 * nref + nref2 || nref != NUM_RECS)
+            return G2C_ERROR;
+        for (i = 0; i < nrecs; i++)
+        {
+            g2c_bidx_rec r = recs[i];
+            const g2c_bidx_rec *e;
+
+            if (i < nref)
+                e = &ref[i];
+            else if (i < nref + nref2)
+                e = &ref2[i - nref];
+            else
+                e = &ref[i - nref - nref2];
+            if (r.filenum != (i < nref ? 0 : i < nref + nref2 ? 1 : 2))
+                return G2C_ERROR;
+            r.filenum = 0;
+            if (memcmp(&r, e, sizeof(r)))
+                return G2C_ERROR;
+        }
+
+        /* Queries work on a catalog. */
+        g2c_query_init(&q);
+        q.number = 8;
+        q.discipline = 10;
+        if (g2c_query_bidx(bidx, &q, &m, &nm) || nm != 6)
+            return G2C_ERROR;
+        if (recs[m[0].n].filenum != 0 || recs[m[5].n].filenum != 2 ||
+            m[5].offset != m[2].offset)
+            return G2C_ERROR;
+        free(m);
+
+        /* The index of one file has no file names. */
+        if (g2c_bidx_files(rbidx, &nfiles, &cpaths) || nfiles || cpaths)
+            return G2C_ERROR;
+        if (g2c_close_bidx(bidx) || g2c_close_bidx(rbidx) || g2c_close_bidx(rbidx2))
+            return G2C_ERROR;
+
+        /* An empty catalog. */
+        if (g2c_write_catalog(0, NULL, TEST_CATALOG_FILE, 0))
+            return G2C_ERROR;
+        if (g2c_open_bidx(TEST_CATALOG_FILE, &bidx))
+            return G2C_ERROR;
+        if (g2c_bidx_recs(bidx, &nrecs, NULL) || nrecs || g2c_close_bidx(bidx))
+            return G2C_ERROR;
+        remove(TEST_CATALOG_FILE);
+        remove(REF_BIDX_FILE);
+        remove(REF_BIDX_FILE2);
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing errors...");
+    {
+        const char *paths[2] = {GRIB2_FILE, "no_such_file"};
+        const char *idxpaths[2] = {TEST_BIDX_FILE, TEST_BIDX_FILE2};
+
+        if (g2c_write_bidxs(2, paths, idxpaths, 2) != G2C_EFILE)
+            return G2C_ERROR;
+        if (g2c_write_catalog(2, paths, TEST_CATALOG_FILE, 2) != G2C_EFILE)
+            return G2C_ERROR;
+        if (g2c_write_bidxs(1, paths, NULL, 2) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_write_catalog(1, paths, NULL, 2) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_write_catalog(1, paths, TEST_CATALOG_FILE, -1) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_bidx_files(NULL, NULL, NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+        remove(TEST_BIDX_FILE);
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
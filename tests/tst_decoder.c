@@ -0,0 +1,189 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * decoder.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+
+#define NPTS 400
+#define NFLDS 5
+#define MSG_LEN 20000
+
+/* Number of allocations. */
+static long nalloc;
+
+static void *
+count_malloc(size_t size, void *ctx)
+{
+    (*(long *)ctx)++;
+    return malloc(size);
+}
+
+static void *
+count_calloc(size_t nmemb, size_t size, void *ctx)
+{
+    (*(long *)ctx)++;
+    return calloc(nmemb, size);
+}
+
+static void *
+count_realloc(void *ptr, size_t size, void *ctx)
+{
+    (*(long *)ctx)++;
+    return realloc(ptr, size);
+}
+
+static void
+count_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+int
+main()
+{
+    unsigned char cgrib[MSG_LEN];
+
+    printf("Testing the decoder.\n");
+    printf("Testing g2c_decoder_getfld() against g2c_getfld()...");
+    {
+        g2int listsec0[2] = {0, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, 20, 20, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+        /* Simple and complex packing, with and without spatial
+         * differences and missing values. */
+        g2int idrstmpl[NFLDS][18] = {
+            {0, 0, 2, 0, 0},
+            {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+            {0, 0, 2, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+            {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2},
+            {0, 0, 2, 0, 0, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2}};
+        g2int idrtnum[NFLDS] = {0, 2, 2, 3, 3};
+        g2int bmap[NPTS];
+        g2float fld[NPTS];
+        gribfield *gfld, *gfld2;
+        g2c_decoder *dec;
+        g2float out[NPTS];
+        int f, i, expand, pass;
+
+        /* A message with a field of each packing, all with a bitmap. */
+        for (i = 0; i < NPTS; i++)
+        {
+            bmap[i] = i % 7 != 0;
+            fld[i] = (i % 37) * 0.25 + (i / 50);
+        }
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        for (f = 0; f < NFLDS; f++)
+            if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, idrtnum[f], idrstmpl[f], fld, NPTS,
+                            0, bmap) < 0)
+                return G2C_ERROR;
+        if (g2_gribend(cgrib) < 0)
+            return G2C_ERROR;
+
+        if (g2c_open_decoder(&dec))
+            return G2C_ERROR;
+
+        /* Twice, so the second pass uses the scratch arrays of the
+         * first. */
+        for (pass = 0; pass < 2; pass++)
+        {
+            for (f = 1; f <= NFLDS; f++)
+            {
+                for (expand = 0; expand < 2; expand++)
+                {
+                    if (g2c_getfld(cgrib, f, 1, expand, 0, &gfld))
+                        return G2C_ERROR;
+                    if (g2c_decoder_getfld(dec, cgrib, f, 1, expand, 0, NULL, 0, &gfld2))
+                        return G2C_ERROR;
+                    if (gfld2->ndpts != gfld->ndpts || gfld2->expanded != gfld->expanded)
+                        return G2C_ERROR;
+                    if (memcmp(gfld2->fld, gfld->fld,
+                               (expand ? gfld->ngrdpts : gfld->ndpts) * sizeof(g2float)))
+                        return G2C_ERROR;
+                    g2_free(gfld2);
+
+                    if (g2c_decoder_getfld(dec, cgrib, f, 1, expand, G2C_GFLD_ARENA, out,
+                                           NPTS, &gfld2))
+                        return G2C_ERROR;
+                    if (gfld2->fld)
+                        return G2C_ERROR;
+                    for (i = 0; i < (expand ? gfld->ngrdpts : gfld->ndpts); i++)
+                        if (out[i] != gfld->fld[i])
+                            return G2C_ERROR;
+                    g2_free(gfld2);
+                    g2_free(gfld);
+                }
+            }
+        }
+
+        /* Only the metadata. */
+        if (g2c_decoder_getfld(dec, cgrib, 2, 0, 0, 0, NULL, 0, &gfld))
+            return G2C_ERROR;
+        if (gfld->fld || gfld->idrtnum != 2)
+            return G2C_ERROR;
+        g2_free(gfld);
+
+        /* Bad arguments. */
+        if (g2c_decoder_getfld(NULL, cgrib, 1, 1, 0, 0, NULL, 0, &gfld) != G2_GETFLD_INVAL)
+            return G2C_ERROR;
+        if (g2c_decoder_getfld(dec, cgrib, 0, 1, 0, 0, NULL, 0, &gfld) != G2_GETFLD_INVAL)
+            return G2C_ERROR;
+        if (g2c_decoder_getfld(dec, cgrib, 1, 0, 0, 0, out, NPTS, &gfld) != G2_GETFLD_INVAL)
+            return G2C_ERROR;
+        if (g2c_decoder_getfld(dec, cgrib, 1, 1, 1, 0, out, 10, &gfld) != G2C_ESIZE)
+            return G2C_ERROR;
+        if (g2c_decoder_getfld(dec, cgrib, NFLDS + 1, 1, 0, 0, NULL, 0, &gfld) !=
+            G2_GETFLD_WRONG_NFLDS)
+            return G2C_ERROR;
+        if (g2c_close_decoder(dec))
+            return G2C_ERROR;
+        if (g2c_open_decoder(NULL) != G2C_EINVAL || g2c_close_decoder(NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing that a warm decoder allocates only the gribfield...");
+    {
+        gribfield *gfld;
+        g2c_decoder *dec;
+        g2float out[NPTS];
+        int f;
+
+        if (g2c_open_decoder(&dec))
+            return G2C_ERROR;
+        for (f = 1; f <= NFLDS; f++)
+        {
+            if (g2c_decoder_getfld(dec, cgrib, f, 1, 1, G2C_GFLD_ARENA, out, NPTS, &gfld))
+                return G2C_ERROR;
+            g2_free(gfld);
+        }
+
+        if (g2c_set_allocator(count_malloc, count_calloc, count_realloc, count_free, &nalloc))
+            return G2C_ERROR;
+        for (f = 1; f <= NFLDS; f++)
+        {
+            nalloc = 0;
+            if (g2c_decoder_getfld(dec, cgrib, f, 1, 1, G2C_GFLD_ARENA, out, NPTS, &gfld))
+                return G2C_ERROR;
+            g2_free(gfld);
+            if (nalloc != 1)
+                return G2C_ERROR;
+        }
+        if (g2c_set_allocator(NULL, NULL, NULL, NULL, NULL))
+            return G2C_ERROR;
+        if (g2c_close_decoder(dec))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
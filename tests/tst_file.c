@@ -0,0 +1,169 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * file.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define GRIB2_INDEX_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2.idx"
+#define EMPTY_FILE "tst_file_empty.grib2"
+#define NUM_MSGS 19
+
+int
+main()
+{
+    printf("Testing file.\n");
+    printf("Testing g2c_open_file() errors...");
+    {
+        g2c_file *file;
+
+        if (g2c_open_file("no_such_file", G2C_ACCESS_SEQUENTIAL, &file) != G2C_EFILE)
+            return G2C_ERROR;
+        if (g2c_open_file(GRIB2_FILE, 42, &file) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_open_file(NULL, G2C_ACCESS_SEQUENTIAL, &file) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_close_file(NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing message iterator...");
+    {
+        FILE *f;
+        g2c_file *file;
+        g2c_msgloc *msgs, loc;
+        size_t nmsgs, pos = 0;
+        unsigned char *cgrib;
+        int m;
+
+        /* Find the messages with the scanner, to check against. */
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_scan_file(f, &msgs, &nmsgs) || nmsgs != NUM_MSGS)
+            return G2C_ERROR;
+        fclose(f);
+
+        if (g2c_open_file(GRIB2_FILE, G2C_ACCESS_SEQUENTIAL, &file))
+            return G2C_ERROR;
+        for (m = 0; !g2c_next_msg(file, &pos, &loc, &cgrib); m++)
+        {
+            if (m >= NUM_MSGS || loc.offset != msgs[m].offset ||
+                loc.bytes != msgs[m].bytes || loc.edition != 2)
+                return G2C_ERROR;
+            if (memcmp(cgrib, "GRIB", 4) || memcmp(cgrib + loc.bytes - 4, "7777", 4))
+                return G2C_ERROR;
+        }
+        if (m != NUM_MSGS)
+            return G2C_ERROR;
+        if (g2c_next_msg(file, &pos, &loc, &cgrib) != G2C_ENOMSG)
+            return G2C_ERROR;
+
+        /* Random access by location. */
+        if (g2c_file_advise(file, G2C_ACCESS_RANDOM))
+            return G2C_ERROR;
+        if (g2c_file_advise(file, 42) != G2C_EINVAL)
+            return G2C_ERROR;
+        for (m = NUM_MSGS - 1; m >= 0; m--)
+        {
+            if (g2c_file_msg(file, &msgs[m], &cgrib))
+                return G2C_ERROR;
+            if (memcmp(cgrib, "GRIB", 4))
+                return G2C_ERROR;
+        }
+        loc = msgs[NUM_MSGS - 1];
+        loc.bytes++;
+        if (g2c_file_msg(file, &loc, &cgrib) != G2C_EINVAL)
+            return G2C_ERROR;
+
+        if (g2c_close_file(file))
+            return G2C_ERROR;
+        free(msgs);
+    }
+    printf("ok!\n");
+    printf("Testing decoding from the mapped file...");
+    {
+        FILE *f;
+        g2c_file *file;
+        g2c_msgloc loc;
+        size_t pos = 0;
+        unsigned char *cgrib, *copy;
+        g2int listsec0[3], listsec1[13], numfields, numlocal;
+        g2int clistsec0[3], clistsec1[13], cnumfields, cnumlocal;
+        gribfield *gfld, *cgfld;
+        int i;
+
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_open_file(GRIB2_FILE, G2C_ACCESS_SEQUENTIAL, &file))
+            return G2C_ERROR;
+        while (!g2c_next_msg(file, &pos, &loc, &cgrib))
+        {
+            /* Decode a copy of the message read the old way. */
+            if (!(copy = malloc(loc.bytes)))
+                return G2C_ERROR;
+            fseek(f, loc.offset, SEEK_SET);
+            if (fread(copy, 1, loc.bytes, f) != loc.bytes)
+                return G2C_ERROR;
+
+            if (g2_info(cgrib, listsec0, listsec1, &numfields, &numlocal))
+                return G2C_ERROR;
+            if (g2_info(copy, clistsec0, clistsec1, &cnumfields, &cnumlocal))
+                return G2C_ERROR;
+            if (memcmp(listsec0, clistsec0, sizeof(listsec0)) ||
+                memcmp(listsec1, clistsec1, sizeof(listsec1)) ||
+                numfields != cnumfields || numlocal != cnumlocal || numfields != 1)
+                return G2C_ERROR;
+
+            if (g2_getfld(cgrib, 1, 0, 0, &gfld))
+                return G2C_ERROR;
+            if (g2_getfld(copy, 1, 0, 0, &cgfld))
+                return G2C_ERROR;
+            if (gfld->ngrdpts != cgfld->ngrdpts || gfld->ipdtnum != cgfld->ipdtnum ||
+                gfld->igdtlen != cgfld->igdtlen || gfld->idrtnum != cgfld->idrtnum)
+                return G2C_ERROR;
+            for (i = 0; i < gfld->ipdtlen; i++)
+                if (gfld->ipdtmpl[i] != cgfld->ipdtmpl[i])
+                    return G2C_ERROR;
+            g2_free(gfld);
+            g2_free(cgfld);
+            free(copy);
+        }
+        if (g2c_close_file(file))
+            return G2C_ERROR;
+        fclose(f);
+    }
+    printf("ok!\n");
+    printf("Testing files with no messages...");
+    {
+        FILE *f;
+        g2c_file *file;
+        size_t pos = 0;
+        unsigned char *cgrib;
+
+        if (g2c_open_file(GRIB2_INDEX_FILE, G2C_ACCESS_SEQUENTIAL, &file))
+            return G2C_ERROR;
+        if (g2c_next_msg(file, &pos, NULL, &cgrib) != G2C_ENOMSG)
+            return G2C_ERROR;
+        if (g2c_close_file(file))
+            return G2C_ERROR;
+
+        if (!(f = fopen(EMPTY_FILE, "wb")))
+            return G2C_ERROR;
+        fclose(f);
+        if (g2c_open_file(EMPTY_FILE, G2C_ACCESS_RANDOM, &file))
+            return G2C_ERROR;
+        if (g2c_next_msg(file, &pos, NULL, &cgrib) != G2C_ENOMSG)
+            return G2C_ERROR;
+        if (g2c_close_file(file))
+            return G2C_ERROR;
+        remove(EMPTY_FILE);
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
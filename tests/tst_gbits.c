@@ -5,9 +5,92 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "grib2_int.h"
 
 #define G2C_ERROR 2
+#define NUM_BYTES 1024
+
+/* This is the original byte-at-a-time gbits() algorithm, used to
+ * check the results of the word-at-a-time reader. */
+static void
+gbits_ref(unsigned char *in, g2int *iout, g2int iskip, g2int nbits,
+          g2int nskip, g2int n)
+{
+    g2int i, tbit, bitcnt, ibit, itmp;
+    g2int nbit, index;
+    static g2int ones[]={1, 3, 7, 15, 31, 63, 127, 255};
+
+    nbit = iskip;
+    for (i = 0; i < n; i++)
+    {
+        bitcnt = nbits;
+        index = nbit / 8;
+        ibit = nbit % 8;
+        nbit = nbit + nbits + nskip;
+        tbit = (bitcnt < (8 - ibit)) ? bitcnt : 8 - ibit;
+        itmp = (int)*(in + index) & ones[7 - ibit];
+        if (tbit != 8 - ibit) itmp >>= (8 - ibit - tbit);
+        index++;
+        bitcnt = bitcnt - tbit;
+        while (bitcnt >= 8)
+        {
+            itmp = itmp << 8 | (int)*(in + index);
+            bitcnt = bitcnt - 8;
+            index++;
+        }
+        if (bitcnt > 0)
+            itmp = ( itmp << bitcnt ) |
+                (((int)*(in + index) >> (8 - bitcnt)) & ones[bitcnt - 1]);
+        *(iout + i) = itmp;
+    }
+}
+
+/* This is the original read-modify-write sbits() algorithm, used to
+ * check the results of the bit writer. */
+static void
+sbits_ref(unsigned char *out, g2int *in, g2int iskip, g2int nbits,
+          g2int nskip, g2int n)
+{
+    g2int i, bitcnt, tbit, ibit, itmp, imask, itmp2, itmp3;
+    g2int nbit, index;
+    static g2int ones[]={1, 3, 7, 15, 31, 63, 127, 255};
+
+    nbit = iskip + nbits - 1;
+    for (i = 0; i < n; i++)
+    {
+        itmp = *(in + i);
+        bitcnt = nbits;
+        index = nbit / 8;
+        ibit = nbit % 8;
+        nbit = nbit + nbits + nskip;
+        if (ibit != 7)
+        {
+            tbit = (bitcnt < (ibit+1)) ? bitcnt : ibit + 1;
+            imask = ones[tbit - 1] << (7 - ibit);
+            itmp2 = (itmp & ones[tbit - 1]) << (7 - ibit);
+            itmp3 = (int)*(out + index) & (255 - imask);
+            out[index] = (unsigned char)(itmp2 | itmp3);
+            bitcnt = bitcnt - tbit;
+            itmp = itmp >> tbit;
+            index--;
+        }
+        while (bitcnt >= 8)
+        {
+            out[index] = (unsigned char)(itmp & 255);
+            itmp = itmp >> 8;
+            bitcnt = bitcnt - 8;
+            index--;
+        }
+        if (bitcnt > 0)
+        {
+            itmp2 = itmp & ones[bitcnt - 1];
+            itmp3 = (int)*(out + index) & (255 - ones[bitcnt - 1]);
+            out[index] = (unsigned char)(itmp2 | itmp3);
+        }
+    }
+}
 
 int
 main()
@@ -124,6 +207,127 @@ main()
 
     }
     printf("ok!\n");
+    printf("Testing gbits() against byte-at-a-time reference...");
+    {
+        unsigned char in[NUM_BYTES];
+        g2int out[NUM_BYTES * 8], ref[NUM_BYTES * 8];
+        g2int nbits, iskip, n, i;
+
+        srand(42);
+        for (i = 0; i < NUM_BYTES; i++)
+            in[i] = (unsigned char)(rand() & 0xff);
+
+        /* Try every width, all starting bit positions within a
+         * byte, and lengths that end both on and off word
+         * boundaries. The last value always ends in the last byte of
+         * the input, so any read past the end would be caught by
+         * address sanitizer or valgrind. */
+        for (nbits = 1; nbits <= 32; nbits++)
+        {
+            for (iskip = 0; iskip < 16; iskip++)
+            {
+                n = (NUM_BYTES * 8 - iskip) / nbits;
+                for (; n > 0; n = n * 2 / 3)
+                {
+                    g2int skip = NUM_BYTES * 8 - n * nbits;
+
+                    gbits(in, out, skip, nbits, 0, n);
+                    gbits_ref(in, ref, skip, nbits, 0, n);
+                    for (i = 0; i < n; i++)
+                        if (out[i] != ref[i])
+                            return G2C_ERROR;
+
+                    gbits(in, out, iskip, nbits, 0, n);
+                    gbits_ref(in, ref, iskip, nbits, 0, n);
+                    for (i = 0; i < n; i++)
+                        if (out[i] != ref[i])
+                            return G2C_ERROR;
+                }
+            }
+        }
+
+        /* Widths over 32 bits and nskip != 0 still work. */
+        gbits(in, out, 3, 40, 0, 100);
+        gbits_ref(in, ref, 3, 40, 0, 100);
+        for (i = 0; i < 100; i++)
+            if (out[i] != ref[i])
+                return G2C_ERROR;
+        gbits(in, out, 5, 12, 7, 200);
+        gbits_ref(in, ref, 5, 12, 7, 200);
+        for (i = 0; i < 200; i++)
+            if (out[i] != ref[i])
+                return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing sbits() and the bit writer against read-modify-write reference...");
+    {
+        unsigned char out[NUM_BYTES], ref[NUM_BYTES], fill[NUM_BYTES];
+        g2int in[NUM_BYTES * 8];
+        g2int nbits, iskip, n, i;
+        g2c_bitwriter bw;
+
+        srand(43);
+        for (i = 0; i < NUM_BYTES; i++)
+            fill[i] = (unsigned char)(rand() & 0xff);
+        for (i = 0; i < NUM_BYTES * 8; i++)
+            in[i] = ((g2int)rand() << 31) ^ rand();
+
+        /* Output starts out full of random bits, so that bits around
+         * the packed values must be left alone. Values are wider than
+         * nbits, so only their low order bits may be used. */
+        for (nbits = 1; nbits <= 63; nbits++)
+        {
+            for (iskip = 0; iskip < 16; iskip++)
+            {
+                for (n = (NUM_BYTES * 8 - iskip) / nbits; n > 0; n = n * 2 / 3)
+                {
+                    g2int skip = NUM_BYTES * 8 - n * nbits;
+
+                    memcpy(out, fill, NUM_BYTES);
+                    memcpy(ref, fill, NUM_BYTES);
+                    sbits(out, in, iskip, nbits, 0, n);
+                    sbits_ref(ref, in, iskip, nbits, 0, n);
+                    if (memcmp(out, ref, NUM_BYTES))
+                        return G2C_ERROR;
+
+                    memcpy(out, fill, NUM_BYTES);
+                    memcpy(ref, fill, NUM_BYTES);
+                    sbits(out, in, skip, nbits, 0, n);
+                    sbits_ref(ref, in, skip, nbits, 0, n);
+                    if (memcmp(out, ref, NUM_BYTES))
+                        return G2C_ERROR;
+                }
+            }
+        }
+
+        /* Values of mixed widths written one at a time, with a flush
+         * in the middle, match separate sbit() calls. */
+        memcpy(out, fill, NUM_BYTES);
+        memcpy(ref, fill, NUM_BYTES);
+        g2c_bw_init(&bw, out, 5);
+        iskip = 5;
+        for (i = 0; i < 300; i++)
+        {
+            nbits = 1 + (i * 7) % 40;
+            g2c_bw_put(&bw, in[i], nbits);
+            sbits_ref(ref, &in[i], iskip, nbits, 0, 1);
+            iskip += nbits;
+            if (i == 150)
+                g2c_bw_flush(&bw);
+        }
+        g2c_bw_flush(&bw);
+        if (memcmp(out, ref, NUM_BYTES))
+            return G2C_ERROR;
+
+        /* A stride between values still works. */
+        memcpy(out, fill, NUM_BYTES);
+        memcpy(ref, fill, NUM_BYTES);
+        sbits(out, in, 3, 11, 5, 400);
+        sbits_ref(ref, in, 3, 11, 5, 400);
+        if (memcmp(out, ref, NUM_BYTES))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
     printf("SUCCESS!\n");
     return 0;
 }
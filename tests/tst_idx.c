@@ -0,0 +1,301 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * idx.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define GRIB2_INDEX_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2.idx"
+#define TEST_INDEX_FILE "tst_idx.idx"
+#define TEST_GRIB2_FILE "tst_idx.grib2"
+#define NUM_MSGS 19
+#define MAX_FILE_LEN 4096
+#define NPTS 4
+#define MSG_LEN 2000
+
+/* Read a whole (small) file into a buffer. */
+static long
+read_file(const char *path, char *buf)
+{
+    FILE *f;
+    long len;
+
+    if (!(f = fopen(path, "rb")))
+        return -1;
+    len = fread(buf, 1, MAX_FILE_LEN, f);
+    fclose(f);
+    return len;
+}
+
+int
+main()
+{
+    printf("Testing inventories.\n");
+    printf("Testing g2c_make_idx() matches wgrib2...");
+    {
+        g2c_idx *idx;
+        FILE *f;
+        char buf[MAX_FILE_LEN], expected[MAX_FILE_LEN];
+        long len, elen;
+
+        if (g2c_make_idx(GRIB2_FILE, &idx))
+            return G2C_ERROR;
+        if (idx->nrecs != NUM_MSGS)
+            return G2C_ERROR;
+        if (!(f = fopen(TEST_INDEX_FILE, "w")))
+            return G2C_ERROR;
+        if (g2c_write_idx(idx, f))
+            return G2C_ERROR;
+        fclose(f);
+        g2c_free_idx(idx);
+
+        /* The index is the same as the one written by wgrib2. */
+        if ((len = read_file(TEST_INDEX_FILE, buf)) <= 0)
+            return G2C_ERROR;
+        if ((elen = read_file(GRIB2_INDEX_FILE, expected)) <= 0)
+            return G2C_ERROR;
+        if (len != elen || memcmp(buf, expected, len))
+            return G2C_ERROR;
+        remove(TEST_INDEX_FILE);
+
+        if (g2c_make_idx("no_such_file", &idx) != G2C_EFILE)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_read_idx()...");
+    {
+        g2c_idx *idx, *midx;
+        FILE *f;
+        size_t i;
+
+        if (g2c_make_idx(GRIB2_FILE, &midx))
+            return G2C_ERROR;
+        if (!(f = fopen(GRIB2_INDEX_FILE, "r")))
+            return G2C_ERROR;
+        if (g2c_read_idx(f, &idx))
+            return G2C_ERROR;
+        fclose(f);
+
+        if (idx->nrecs != midx->nrecs)
+            return G2C_ERROR;
+        for (i = 0; i < idx->nrecs; i++)
+            if (idx->recs[i].msgnum != midx->recs[i].msgnum ||
+                idx->recs[i].fldnum != midx->recs[i].fldnum ||
+                idx->recs[i].offset != midx->recs[i].offset ||
+                strcmp(idx->recs[i].date, midx->recs[i].date) ||
+                strcmp(idx->recs[i].var, midx->recs[i].var) ||
+                strcmp(idx->recs[i].level, midx->recs[i].level) ||
+                strcmp(idx->recs[i].fcst, midx->recs[i].fcst))
+                return G2C_ERROR;
+        g2c_free_idx(idx);
+        g2c_free_idx(midx);
+
+        /* A GRIB file is not an index. */
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_read_idx(f, &idx) != G2C_EBADIDX)
+            return G2C_ERROR;
+        fclose(f);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_idx_find() and g2c_read_msg()...");
+    {
+        g2c_idx *idx;
+        g2c_idx_rec *rec;
+        FILE *f;
+        unsigned char *cgrib;
+        gribfield *gfld;
+        g2int lengrib;
+        size_t start;
+        int n;
+
+        if (!(f = fopen(GRIB2_INDEX_FILE, "r")))
+            return G2C_ERROR;
+        if (g2c_read_idx(f, &idx))
+            return G2C_ERROR;
+        fclose(f);
+
+        if (g2c_idx_find(idx, 0, "SWELL", "2 in sequence", "anl", &rec))
+            return G2C_ERROR;
+        if (rec->msgnum != 10 || rec->offset != 128832 || strcmp(rec->date, "2021113000"))
+            return G2C_ERROR;
+
+        /* Go straight to the message, and check it is the field. */
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_read_msg(f, rec->offset, &cgrib, &lengrib))
+            return G2C_ERROR;
+        if (lengrib != 140848 - 128832)
+            return G2C_ERROR;
+        if (g2_getfld(cgrib, rec->fldnum, 0, 0, &gfld))
+            return G2C_ERROR;
+        if (gfld->discipline != 10 || gfld->ipdtmpl[0] != 0 || gfld->ipdtmpl[1] != 8 ||
+            gfld->ipdtmpl[9] != 241 || gfld->ipdtmpl[11] != 2)
+            return G2C_ERROR;
+        g2_free(gfld);
+        free(cgrib);
+        if (g2c_read_msg(f, rec->offset + 1, &cgrib, &lengrib) != G2C_NOT_GRIB)
+            return G2C_ERROR;
+        fclose(f);
+
+        /* Find all the swell fields. */
+        for (n = 0, start = 0; !g2c_idx_find(idx, start, "SWELL", NULL, NULL, &rec); n++)
+            start = rec - idx->recs + 1;
+        if (n != 3)
+            return G2C_ERROR;
+        if (g2c_idx_find(idx, 0, "TMP", NULL, NULL, &rec) != G2C_ENOTFOUND)
+            return G2C_ERROR;
+        g2c_free_idx(idx);
+    }
+    printf("ok!\n");
+    printf("Testing inventory of messages with more than one field...");
+    {
+        unsigned char cgrib[MSG_LEN];
+        g2int listsec0[2] = {0, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, 2, 2, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        /* Temperature at 500 mb, 6 hour forecast. */
+        g2int ipdstmpl0[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+        /* Precipitation accumulated from 0 to 6 hours. */
+        g2int ipdstmpl8[29] = {1, 8, 2, 0, 96, 0, 0, 1, 0, 1, 0, 0, 255, 0, 0,
+                               2021, 10, 24, 12, 0, 0, 1, 0, 1, 2, 1, 6, 255, 0};
+        /* Relative humidity between 2 and 10 m above ground. */
+        g2int ipdstmpl0b[15] = {1, 1, 2, 0, 96, 0, 0, 1, 12, 103, 0, 2, 103, 0, 10};
+        g2int idrstmpl[5];
+        g2float fld[NPTS] = {1, 2, 3, 4};
+        const char *expected =
+            "1.1:0:d=2021102406:TMP:500 mb:6 hour fcst:\n"
+            "1.2:0:d=2021102406:APCP:surface:0-6 hour acc fcst:\n"
+            "2:%ld:d=2021102406:RH:2-10 m above ground:12 hour fcst:\n";
+        char buf[MAX_FILE_LEN], line[MAX_FILE_LEN];
+        g2c_idx *idx;
+        g2int msglen, msglen2;
+        FILE *f;
+
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+
+        /* A message with two fields. */
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        memset(idrstmpl, 0, sizeof(idrstmpl));
+        if (g2_addfield(cgrib, 0, ipdstmpl0, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+            return G2C_ERROR;
+        memset(idrstmpl, 0, sizeof(idrstmpl));
+        if (g2_addfield(cgrib, 8, ipdstmpl8, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+            return G2C_ERROR;
+        if ((msglen = g2_gribend(cgrib)) < 0)
+            return G2C_ERROR;
+        if (fwrite(cgrib, 1, msglen, f) != msglen)
+            return G2C_ERROR;
+
+        /* A message with one field. */
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        memset(idrstmpl, 0, sizeof(idrstmpl));
+        if (g2_addfield(cgrib, 0, ipdstmpl0b, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+            return G2C_ERROR;
+        if ((msglen2 = g2_gribend(cgrib)) < 0)
+            return G2C_ERROR;
+        if (fwrite(cgrib, 1, msglen2, f) != msglen2)
+            return G2C_ERROR;
+        fclose(f);
+
+        /* Make and write the inventory. */
+        if (g2c_make_idx(TEST_GRIB2_FILE, &idx))
+            return G2C_ERROR;
+        if (idx->nrecs != 3)
+            return G2C_ERROR;
+        if (!(f = fopen(TEST_INDEX_FILE, "w")))
+            return G2C_ERROR;
+        if (g2c_write_idx(idx, f))
+            return G2C_ERROR;
+        fclose(f);
+        g2c_free_idx(idx);
+        memset(buf, 0, MAX_FILE_LEN);
+        if (read_file(TEST_INDEX_FILE, buf) <= 0)
+            return G2C_ERROR;
+        snprintf(line, MAX_FILE_LEN, expected, msglen);
+        if (strcmp(buf, line))
+            return G2C_ERROR;
+
+        /* Read it back. */
+        if (!(f = fopen(TEST_INDEX_FILE, "r")))
+            return G2C_ERROR;
+        if (g2c_read_idx(f, &idx))
+            return G2C_ERROR;
+        fclose(f);
+        if (idx->nrecs != 3 || idx->recs[1].msgnum != 1 || idx->recs[1].fldnum != 2 ||
+            idx->recs[2].msgnum != 2 || idx->recs[2].fldnum != 1 ||
+            idx->recs[2].offset != msglen)
+            return G2C_ERROR;
+        g2c_free_idx(idx);
+        remove(TEST_INDEX_FILE);
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing inventory of a file with a bad message...");
+    {
+        unsigned char cgrib[MSG_LEN];
+        g2int listsec0[2] = {0, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, 2, 2, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+        g2int idrstmpl[5] = {0};
+        g2float fld[NPTS] = {1, 2, 3, 4};
+        g2int msglen, pos, seclen;
+        g2c_idx *idx;
+        FILE *f;
+        int m;
+
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+            return G2C_ERROR;
+        if ((msglen = g2_gribend(cgrib)) < 0)
+            return G2C_ERROR;
+
+        /* The second of three copies has a product template number
+         * that is not known, so its section 4 can't be unpacked. */
+        for (pos = 16; cgrib[pos + 4] != 4; pos += seclen)
+            seclen = (g2int)cgrib[pos] << 24 | cgrib[pos + 1] << 16 |
+                cgrib[pos + 2] << 8 | cgrib[pos + 3];
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        for (m = 0; m < 3; m++)
+        {
+            cgrib[pos + 7] = m == 1 ? 0xfe : 0;
+            if (fwrite(cgrib, 1, msglen, f) != msglen)
+                return G2C_ERROR;
+        }
+        fclose(f);
+
+        /* The bad message is left out, and the others keep their
+         * numbers. */
+        if (g2c_make_idx(TEST_GRIB2_FILE, &idx))
+            return G2C_ERROR;
+        if (idx->nrecs != 2 || idx->nbad != 1)
+            return G2C_ERROR;
+        if (idx->recs[0].msgnum != 1 || idx->recs[1].msgnum != 3 ||
+            idx->recs[1].offset != 2 * msglen || strcmp(idx->recs[1].var, "TMP"))
+            return G2C_ERROR;
+        g2c_free_idx(idx);
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
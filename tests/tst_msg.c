@@ -0,0 +1,348 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * msg.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2.h"
+
+#define G2C_ERROR 2
+#define NPTS 1003
+#define NPTS2 517
+#define NFLDS 5
+#define MSG_LEN 20000
+
+int
+main()
+{
+    unsigned char cgrib[MSG_LEN];
+    unsigned char local1[5] = {1, 2, 3, 4, 5}, local2[3] = {9, 8, 7};
+    g2int listsec0[2] = {1, 2};
+    g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+    g2int igds[5] = {0, NPTS, 0, 0, 0};
+    g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, NPTS, 1, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+    g2int igds2[5] = {0, NPTS2, 0, 0, 0};
+    g2int igdstmpl2[19] = {0, 1, 2, 3, 4, 5, 6, NPTS2, 1, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+    g2int ipdstmpl[15] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+    g2int idrstmpl[5];
+    g2float fld[NPTS];
+    g2int bmap[NPTS], bmap2[NPTS2];
+    /* Expected grid size, bitmap indicator and local section length
+     * of each field. */
+    g2int ngrdpts[NFLDS] = {NPTS, NPTS, NPTS, NPTS2, NPTS2};
+    g2int ibmap[NFLDS] = {0, 254, 255, 0, 254};
+    g2int locallen[NFLDS] = {5, 5, 5, 3, 3};
+    g2int *bmaps[NFLDS] = {bmap, bmap, NULL, bmap2, bmap2};
+    int i, f;
+
+    printf("Testing message section table.\n");
+
+    /* Create a message with a local section and a grid, with fields
+     * that define, reuse and have no bitmap, then another local
+     * section and grid, with a new bitmap that is reused. */
+    for (i = 0; i < NPTS; i++)
+    {
+        bmap[i] = (i % 3 != 0 && i % 7 != 0);
+        fld[i] = i % 100;
+    }
+    for (i = 0; i < NPTS2; i++)
+        bmap2[i] = (i % 5 != 0);
+    if (g2_create(cgrib, listsec0, listsec1) < 0)
+        return G2C_ERROR;
+    if (g2_addlocal(cgrib, local1, 5) < 0)
+        return G2C_ERROR;
+    if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+        return G2C_ERROR;
+    for (f = 0; f < NFLDS; f++)
+    {
+        if (f == 3)
+        {
+            if (g2_addlocal(cgrib, local2, 3) < 0)
+                return G2C_ERROR;
+            if (g2_addgrid(cgrib, igds2, igdstmpl2, NULL, 0) < 0)
+                return G2C_ERROR;
+        }
+        memset(idrstmpl, 0, sizeof(idrstmpl));
+        ipdstmpl[0] = f;
+        if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, ngrdpts[f],
+                        ibmap[f], bmaps[f] ? bmaps[f] : bmap) < 0)
+            return G2C_ERROR;
+    }
+    if (g2_gribend(cgrib) < 0)
+        return G2C_ERROR;
+
+    printf("Testing g2c_open_msg() errors...");
+    {
+        unsigned char junk[200];
+        g2c_msg *msg;
+        gribfield *gfld;
+
+        memset(junk, 'x', sizeof(junk));
+        if (g2c_open_msg(junk, &msg) != G2C_NOT_GRIB)
+            return G2C_ERROR;
+        if (g2c_open_msg(NULL, &msg) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_close_msg(NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+
+        if (g2c_open_msg(cgrib, &msg))
+            return G2C_ERROR;
+        if (g2c_msg_getfld(msg, 0, 1, 1, 0, &gfld) != G2_GETFLD_INVAL)
+            return G2C_ERROR;
+        if (g2c_msg_getfld(msg, NFLDS + 1, 1, 1, 0, &gfld) != G2_GETFLD_WRONG_NFLDS)
+            return G2C_ERROR;
+        if (g2c_close_msg(msg))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_msg_info()...");
+    {
+        g2c_msg *msg;
+        g2int listsec0[3], listsec1[13], numfields, numlocal;
+        g2int mnumfields, mnumlocal;
+
+        if (g2_info(cgrib, listsec0, listsec1, &numfields, &numlocal))
+            return G2C_ERROR;
+        if (g2c_open_msg(cgrib, &msg))
+            return G2C_ERROR;
+        if (g2c_msg_info(msg, &mnumfields, &mnumlocal))
+            return G2C_ERROR;
+        if (mnumfields != numfields || mnumlocal != numlocal ||
+            mnumfields != NFLDS || mnumlocal != 2)
+            return G2C_ERROR;
+        if (g2c_close_msg(msg))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_msg_getfld() in reverse order...");
+    {
+        g2c_msg *msg;
+        gribfield *gfld, *cgfld;
+        g2int unpack, expand, n;
+
+        if (g2c_open_msg(cgrib, &msg))
+            return G2C_ERROR;
+        for (unpack = 0; unpack <= 1; unpack++)
+        {
+            for (expand = 0; expand <= 1; expand++)
+            {
+                for (f = NFLDS - 1; f >= 0; f--)
+                {
+                    if (g2c_msg_getfld(msg, f + 1, unpack, expand, 0, &gfld))
+                        return G2C_ERROR;
+
+                    /* Check the field against what was written. */
+                    if (gfld->ifldnum != f + 1 || gfld->ipdtmpl[0] != f ||
+                        gfld->ngrdpts != ngrdpts[f] || gfld->ibmap != ibmap[f] ||
+                        gfld->locallen != locallen[f] || gfld->idsect[5] != 2021)
+                        return G2C_ERROR;
+                    if (unpack)
+                    {
+                        if (!bmaps[f] != !gfld->bmap)
+                            return G2C_ERROR;
+                        for (n = 0, i = 0; i < ngrdpts[f]; i++)
+                        {
+                            if (bmaps[f] && gfld->bmap[i] != bmaps[f][i])
+                                return G2C_ERROR;
+                            if (bmaps[f] && !bmaps[f][i])
+                            {
+                                if (expand && gfld->fld[i])
+                                    return G2C_ERROR;
+                                continue;
+                            }
+                            if (gfld->fld[expand ? i : n] != fld[i])
+                                return G2C_ERROR;
+                            n++;
+                        }
+                        if (gfld->ndpts != n)
+                            return G2C_ERROR;
+                    }
+
+                    /* Check the field against g2_getfld(). */
+                    if (g2_getfld(cgrib, f + 1, unpack, expand, &cgfld))
+                        return G2C_ERROR;
+                    if (gfld->ndpts != cgfld->ndpts || gfld->expanded != cgfld->expanded ||
+                        gfld->ibmap != cgfld->ibmap || gfld->ngrdpts != cgfld->ngrdpts ||
+                        gfld->locallen != cgfld->locallen ||
+                        (gfld->locallen && memcmp(gfld->local, cgfld->local, gfld->locallen)))
+                        return G2C_ERROR;
+                    if (unpack)
+                        for (i = 0; i < (gfld->expanded ? gfld->ngrdpts : gfld->ndpts); i++)
+                            if (gfld->fld[i] != cgfld->fld[i])
+                                return G2C_ERROR;
+                    g2_free(cgfld);
+                    g2_free(gfld);
+                }
+            }
+        }
+        if (g2c_close_msg(msg))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_msg_getfld() with compact bitmaps...");
+    {
+        g2c_msg *msg;
+        gribfield *gfld;
+
+        if (g2c_open_msg(cgrib, &msg))
+            return G2C_ERROR;
+        for (f = 0; f < NFLDS; f++)
+        {
+            if (g2c_msg_getfld(msg, f + 1, 1, 1, G2C_BMAP_BITS, &gfld))
+                return G2C_ERROR;
+            if (gfld->bmap || !bmaps[f] != !gfld->cbmap || gfld->bmap_fmt != G2C_BMAP_BITS)
+                return G2C_ERROR;
+            if (bmaps[f])
+                for (i = 0; i < ngrdpts[f]; i++)
+                    if (g2c_bmap_get(gfld, i) != bmaps[f][i])
+                        return G2C_ERROR;
+            g2_free(gfld);
+        }
+        if (g2c_close_msg(msg))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_getfld_into() with one buffer for every field...");
+    {
+        gribfield *gfld, *cgfld;
+        g2float buf[NPTS];
+        g2int expand, nfld;
+
+        for (expand = 0; expand <= 1; expand++)
+        {
+            for (f = 0; f < NFLDS; f++)
+            {
+                if (g2c_getfld_size(cgrib, f + 1, expand, &nfld))
+                    return G2C_ERROR;
+                if (g2_getfld(cgrib, f + 1, 1, expand, &cgfld))
+                    return G2C_ERROR;
+                if (nfld != (cgfld->expanded ? cgfld->ngrdpts : cgfld->ndpts))
+                    return G2C_ERROR;
+
+                /* The buffer must have room for the data. */
+                if (g2c_getfld_into(cgrib, f + 1, expand, 0, buf, nfld - 1, &gfld) != G2C_ESIZE ||
+                    gfld)
+                    return G2C_ERROR;
+
+                for (i = 0; i < NPTS; i++)
+                    buf[i] = -1;
+                if (g2c_getfld_into(cgrib, f + 1, expand, 0, buf, nfld, &gfld))
+                    return G2C_ERROR;
+                if (gfld->fld || !gfld->unpacked || gfld->expanded != cgfld->expanded ||
+                    gfld->ndpts != cgfld->ndpts || gfld->ibmap != cgfld->ibmap ||
+                    !gfld->bmap != !cgfld->bmap)
+                    return G2C_ERROR;
+                for (i = 0; i < nfld; i++)
+                    if (buf[i] != cgfld->fld[i])
+                        return G2C_ERROR;
+                for (; i < NPTS; i++)
+                    if (buf[i] != -1)
+                        return G2C_ERROR;
+                g2_free(cgfld);
+                g2_free(gfld);
+            }
+        }
+        if (g2c_getfld_size(cgrib, NFLDS + 1, 1, &nfld) != G2_GETFLD_WRONG_NFLDS)
+            return G2C_ERROR;
+        if (g2c_getfld_size(cgrib, 0, 1, &nfld) != G2_GETFLD_INVAL)
+            return G2C_ERROR;
+        if (g2c_getfld_into(cgrib, 1, 1, 0, NULL, NPTS, &gfld) != G2_GETFLD_INVAL)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_getfld() with G2C_GFLD_ARENA...");
+    {
+        unsigned char cgrib2[MSG_LEN];
+        /* A template that is extended, and a list of coordinates. */
+        g2int ipdstmpl8[29] = {1, 8, 2, 0, 96, 0, 0, 1, 0, 1, 0, 0, 255, 0, 0,
+                               2021, 10, 24, 12, 0, 0, 1, 0, 1, 2, 1, 6, 255, 0};
+        g2float coord[2] = {1.5, 2.5}, out[NPTS2];
+        unsigned char *msgs[2] = {cgrib, cgrib2};
+        int nflds[2] = {NFLDS, 1};
+        int flags[3] = {0, G2C_BMAP_UINT8, G2C_BMAP_BITS};
+        gribfield *gfld, *cgfld;
+        g2int unpack, expand, nfld;
+        int m, fl;
+
+        memset(idrstmpl, 0, sizeof(idrstmpl));
+        if (g2_create(cgrib2, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib2, igds2, igdstmpl2, NULL, 0) < 0)
+            return G2C_ERROR;
+        if (g2_addfield(cgrib2, 8, ipdstmpl8, coord, 2, 0, idrstmpl, fld, NPTS2, 255, NULL) < 0)
+            return G2C_ERROR;
+        if (g2_gribend(cgrib2) < 0)
+            return G2C_ERROR;
+
+        for (m = 0; m < 2; m++)
+        {
+            for (unpack = 0; unpack <= 1; unpack++)
+            {
+                for (expand = 0; expand <= 1; expand++)
+                {
+                    for (fl = 0; fl < 3; fl++)
+                    {
+                        for (f = 1; f <= nflds[m]; f++)
+                        {
+                            if (g2c_getfld(msgs[m], f, unpack, expand, flags[fl] | G2C_GFLD_ARENA,
+                                           &gfld))
+                                return G2C_ERROR;
+                            if (g2c_getfld(msgs[m], f, unpack, expand, flags[fl], &cgfld))
+                                return G2C_ERROR;
+                            if (!gfld->arena || cgfld->arena)
+                                return G2C_ERROR;
+                            if (gfld->idsectlen != cgfld->idsectlen || gfld->locallen != cgfld->locallen ||
+                                gfld->igdtlen != cgfld->igdtlen || gfld->ipdtlen != cgfld->ipdtlen ||
+                                gfld->idrtlen != cgfld->idrtlen || gfld->num_coord != cgfld->num_coord ||
+                                gfld->ndpts != cgfld->ndpts || gfld->expanded != cgfld->expanded ||
+                                gfld->ibmap != cgfld->ibmap || gfld->bmap_fmt != cgfld->bmap_fmt)
+                                return G2C_ERROR;
+                            /* Arrays of length 0 may be NULL, so are not
+                             * passed to memcmp(). */
+                            if ((gfld->idsectlen &&
+                                 memcmp(gfld->idsect, cgfld->idsect, gfld->idsectlen * sizeof(g2int))) ||
+                                (gfld->locallen && memcmp(gfld->local, cgfld->local, gfld->locallen)) ||
+                                (gfld->igdtlen &&
+                                 memcmp(gfld->igdtmpl, cgfld->igdtmpl, gfld->igdtlen * sizeof(g2int))) ||
+                                (gfld->ipdtlen &&
+                                 memcmp(gfld->ipdtmpl, cgfld->ipdtmpl, gfld->ipdtlen * sizeof(g2int))) ||
+                                (gfld->idrtlen &&
+                                 memcmp(gfld->idrtmpl, cgfld->idrtmpl, gfld->idrtlen * sizeof(g2int))) ||
+                                (gfld->num_coord &&
+                                 memcmp(gfld->coord_list, cgfld->coord_list,
+                                        gfld->num_coord * sizeof(g2float))))
+                                return G2C_ERROR;
+                            if (unpack)
+                            {
+                                nfld = gfld->expanded ? gfld->ngrdpts : gfld->ndpts;
+                                if (nfld && memcmp(gfld->fld, cgfld->fld, nfld * sizeof(g2float)))
+                                    return G2C_ERROR;
+                                if (!gfld->bmap != !cgfld->bmap || !gfld->cbmap != !cgfld->cbmap)
+                                    return G2C_ERROR;
+                                for (i = 0; (gfld->bmap || gfld->cbmap) && i < gfld->ngrdpts; i++)
+                                    if (g2c_bmap_get(gfld, i) != g2c_bmap_get(cgfld, i))
+                                        return G2C_ERROR;
+                            }
+                            g2_free(cgfld);
+                            g2_free(gfld);
+                        }
+                    }
+                }
+            }
+        }
+
+        /* With the data in the caller's array. */
+        if (g2c_getfld_size(cgrib2, 1, 1, &nfld) || nfld != NPTS2)
+            return G2C_ERROR;
+        if (g2c_getfld_into(cgrib2, 1, 1, G2C_GFLD_ARENA, out, nfld, &gfld))
+            return G2C_ERROR;
+        if (!gfld->arena || gfld->fld || gfld->ipdtlen != 29 || gfld->num_coord != 2 ||
+            gfld->coord_list[1] != 2.5 || out[3] != 3)
+            return G2C_ERROR;
+        g2_free(gfld);
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
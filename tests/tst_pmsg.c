@@ -0,0 +1,319 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * pmsg.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define TEST_GRIB2_FILE "tst_pmsg.grib2"
+#define NUM_MSGS 19
+#define NPTS 20011
+#define NPTS2 517
+#define NFLDS 5
+#define MSG_LEN 200000
+#define JUNK_LEN 100
+
+/* Check that two fields are the same. */
+static int
+same_fld(gribfield *g1, gribfield *g2)
+{
+    g2int i, n;
+
+    if (g1->version != g2->version || g1->discipline != g2->discipline ||
+        g1->ifldnum != g2->ifldnum || g1->idsectlen != g2->idsectlen ||
+        g1->locallen != g2->locallen || g1->griddef != g2->griddef ||
+        g1->ngrdpts != g2->ngrdpts || g1->igdtnum != g2->igdtnum ||
+        g1->igdtlen != g2->igdtlen || g1->ipdtnum != g2->ipdtnum ||
+        g1->ipdtlen != g2->ipdtlen || g1->ndpts != g2->ndpts ||
+        g1->idrtnum != g2->idrtnum || g1->idrtlen != g2->idrtlen ||
+        g1->unpacked != g2->unpacked || g1->expanded != g2->expanded ||
+        g1->ibmap != g2->ibmap || !g1->bmap != !g2->bmap || !g1->fld != !g2->fld)
+        return 0;
+    for (i = 0; i < g1->idsectlen; i++)
+        if (g1->idsect[i] != g2->idsect[i])
+            return 0;
+    if (g1->locallen && memcmp(g1->local, g2->local, g1->locallen))
+        return 0;
+    for (i = 0; i < g1->igdtlen; i++)
+        if (g1->igdtmpl[i] != g2->igdtmpl[i])
+            return 0;
+    for (i = 0; i < g1->ipdtlen; i++)
+        if (g1->ipdtmpl[i] != g2->ipdtmpl[i])
+            return 0;
+    for (i = 0; i < g1->idrtlen; i++)
+        if (g1->idrtmpl[i] != g2->idrtmpl[i])
+            return 0;
+    if (g1->bmap)
+        for (i = 0; i < g1->ngrdpts; i++)
+            if (g1->bmap[i] != g2->bmap[i])
+                return 0;
+    if (g1->fld)
+        for (n = g1->expanded ? g1->ngrdpts : g1->ndpts, i = 0; i < n; i++)
+            if (g1->fld[i] != g2->fld[i])
+                return 0;
+    return 1;
+}
+
+int
+main()
+{
+    unsigned char *cgrib;
+    unsigned char local1[5] = {1, 2, 3, 4, 5}, local2[3] = {9, 8, 7};
+    g2int listsec0[2] = {1, 2};
+    g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+    g2int igds[5] = {0, NPTS, 0, 0, 0};
+    g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, NPTS, 1, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+    g2int igds2[5] = {0, NPTS2, 0, 0, 0};
+    g2int igdstmpl2[19] = {0, 1, 2, 3, 4, 5, 6, NPTS2, 1, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+    g2int ipdstmpl[15] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+    g2int idrstmpl[5];
+    g2float *fld;
+    g2int *bmap, bmap2[NPTS2];
+    g2int ngrdpts[NFLDS] = {NPTS, NPTS, NPTS, NPTS2, NPTS2};
+    g2int ibmap[NFLDS] = {0, 254, 255, 0, 254};
+    g2int lengrib;
+    unsigned char junk[JUNK_LEN];
+    FILE *f;
+    int i, fn;
+
+    printf("Testing partial reads of messages.\n");
+
+    /* Write a message with two local sections and grids, and fields
+     * that define, reuse and have no bitmap, after some junk. */
+    if (!(cgrib = malloc(MSG_LEN)) || !(fld = malloc(NPTS * sizeof(g2float))) ||
+        !(bmap = malloc(NPTS * sizeof(g2int))))
+        return G2C_ERROR;
+    for (i = 0; i < NPTS; i++)
+    {
+        bmap[i] = (i % 3 != 0 && i % 7 != 0);
+        fld[i] = i % 100;
+    }
+    for (i = 0; i < NPTS2; i++)
+        bmap2[i] = (i % 5 != 0);
+    if (g2_create(cgrib, listsec0, listsec1) < 0)
+        return G2C_ERROR;
+    if (g2_addlocal(cgrib, local1, 5) < 0)
+        return G2C_ERROR;
+    if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+        return G2C_ERROR;
+    for (fn = 0; fn < NFLDS; fn++)
+    {
+        if (fn == 3)
+        {
+            if (g2_addlocal(cgrib, local2, 3) < 0)
+                return G2C_ERROR;
+            if (g2_addgrid(cgrib, igds2, igdstmpl2, NULL, 0) < 0)
+                return G2C_ERROR;
+        }
+        memset(idrstmpl, 0, sizeof(idrstmpl));
+        ipdstmpl[0] = fn;
+        if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, ngrdpts[fn],
+                        ibmap[fn], fn < 3 ? bmap : bmap2) < 0)
+            return G2C_ERROR;
+    }
+    if ((lengrib = g2_gribend(cgrib)) < 0)
+        return G2C_ERROR;
+    memset(junk, 'x', JUNK_LEN);
+    if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+        return G2C_ERROR;
+    fwrite(junk, 1, JUNK_LEN, f);
+    fwrite(cgrib, 1, lengrib, f);
+    fclose(f);
+
+    printf("Testing g2c_open_pmsg() errors...");
+    {
+        g2c_pmsg *pmsg;
+        gribfield *gfld;
+
+        if (!(f = fopen(TEST_GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_open_pmsg(f, 0, &pmsg) != G2C_NOT_GRIB)
+            return G2C_ERROR;
+        if (g2c_open_pmsg(f, JUNK_LEN + lengrib, &pmsg) != G2C_NOT_GRIB)
+            return G2C_ERROR;
+        if (g2c_open_pmsg(NULL, 0, &pmsg) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_open_pmsg(f, -1, &pmsg) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_close_pmsg(NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_pmsg_info(NULL, NULL, NULL, NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+
+        if (g2c_open_pmsg(f, JUNK_LEN, &pmsg))
+            return G2C_ERROR;
+        if (g2c_pmsg_getfld(pmsg, 0, 1, 1, 0, &gfld) != G2_GETFLD_INVAL)
+            return G2C_ERROR;
+        if (g2c_pmsg_getfld(pmsg, NFLDS + 1, 1, 1, 0, &gfld) != G2_GETFLD_WRONG_NFLDS)
+            return G2C_ERROR;
+        if (g2c_close_pmsg(pmsg))
+            return G2C_ERROR;
+        fclose(f);
+
+        /* A message cut short. */
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        fwrite(cgrib, 1, lengrib / 2, f);
+        fclose(f);
+        if (!(f = fopen(TEST_GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_open_pmsg(f, 0, &pmsg) != G2C_EMSG)
+            return G2C_ERROR;
+        fclose(f);
+
+        if (!(f = fopen(TEST_GRIB2_FILE, "wb")))
+            return G2C_ERROR;
+        fwrite(junk, 1, JUNK_LEN, f);
+        fwrite(cgrib, 1, lengrib, f);
+        fclose(f);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_pmsg_getfld() against g2_getfld()...");
+    {
+        g2c_pmsg *pmsg;
+        gribfield *gfld, *cgfld;
+        g2int listsec0[3], listsec1[13], numfields, numlocal, pnumfields, pnumlocal;
+        g2int unpack, expand;
+        int flags[3] = {0, G2C_BMAP_UINT8, G2C_BMAP_BITS}, fl;
+
+        if (g2_info(cgrib, listsec0, listsec1, &numfields, &numlocal))
+            return G2C_ERROR;
+        if (!(f = fopen(TEST_GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_open_pmsg(f, JUNK_LEN, &pmsg))
+            return G2C_ERROR;
+        if (g2c_pmsg_info(pmsg, &pnumfields, &pnumlocal, NULL))
+            return G2C_ERROR;
+        if (pnumfields != numfields || pnumlocal != numlocal || pnumfields != NFLDS)
+            return G2C_ERROR;
+        for (unpack = 0; unpack <= 1; unpack++)
+        {
+            for (expand = 0; expand <= 1; expand++)
+            {
+                for (fn = NFLDS; fn >= 1; fn--)
+                {
+                    if (g2c_pmsg_getfld(pmsg, fn, unpack, expand, 0, &gfld))
+                        return G2C_ERROR;
+                    if (g2_getfld(cgrib, fn, unpack, expand, &cgfld))
+                        return G2C_ERROR;
+                    if (!same_fld(gfld, cgfld))
+                        return G2C_ERROR;
+                    g2_free(cgfld);
+                    g2_free(gfld);
+                }
+            }
+        }
+
+        /* Compact bitmaps. */
+        for (fl = 1; fl < 3; fl++)
+        {
+            for (fn = 1; fn <= NFLDS; fn++)
+            {
+                if (g2c_pmsg_getfld(pmsg, fn, 1, 1, flags[fl], &gfld))
+                    return G2C_ERROR;
+                if (g2c_getfld(cgrib, fn, 1, 1, flags[fl], &cgfld))
+                    return G2C_ERROR;
+                if (!gfld->cbmap != !cgfld->cbmap || gfld->bmap_fmt != cgfld->bmap_fmt ||
+                    g2c_bmap_count(gfld) != g2c_bmap_count(cgfld))
+                    return G2C_ERROR;
+                for (i = 0; gfld->cbmap && i < gfld->ngrdpts; i++)
+                    if (g2c_bmap_get(gfld, i) != g2c_bmap_get(cgfld, i))
+                        return G2C_ERROR;
+                g2_free(cgfld);
+                g2_free(gfld);
+            }
+        }
+        if (g2c_close_pmsg(pmsg))
+            return G2C_ERROR;
+        fclose(f);
+    }
+    printf("ok!\n");
+    printf("Testing that only the needed sections are read...");
+    {
+        g2c_pmsg *pmsg;
+        gribfield *gfld;
+        g2int nopen, nmeta, ndata;
+
+        if (!(f = fopen(TEST_GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_open_pmsg(f, JUNK_LEN, &pmsg))
+            return G2C_ERROR;
+        g2c_pmsg_info(pmsg, NULL, NULL, &nopen);
+
+        /* The metadata of every field is a small part of the
+         * message. */
+        for (fn = 1; fn <= NFLDS; fn++)
+        {
+            if (g2c_pmsg_getfld(pmsg, fn, 0, 0, 0, &gfld))
+                return G2C_ERROR;
+            g2_free(gfld);
+        }
+        g2c_pmsg_info(pmsg, NULL, NULL, &nmeta);
+        if (nmeta * 10 > lengrib)
+            return G2C_ERROR;
+
+        /* The data of the second field needs its section 7, and the
+         * bitmap of the first field, but nothing from the others. */
+        if (g2c_pmsg_getfld(pmsg, 2, 1, 1, 0, &gfld))
+            return G2C_ERROR;
+        g2_free(gfld);
+        g2c_pmsg_info(pmsg, NULL, NULL, &ndata);
+        if ((ndata - nmeta) * 2 > lengrib)
+            return G2C_ERROR;
+        if (g2c_close_pmsg(pmsg))
+            return G2C_ERROR;
+        fclose(f);
+        remove(TEST_GRIB2_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing metadata of test data file...");
+    {
+        g2c_msgloc *msgs;
+        g2c_pmsg *pmsg;
+        gribfield *gfld, *cgfld;
+        unsigned char *msg;
+        size_t nmsgs, m;
+        g2int len, nread, total_read = 0, total_len = 0;
+
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_scan_file(f, &msgs, &nmsgs) || nmsgs != NUM_MSGS)
+            return G2C_ERROR;
+        for (m = 0; m < nmsgs; m++)
+        {
+            if (g2c_open_pmsg(f, msgs[m].offset, &pmsg))
+                return G2C_ERROR;
+            if (g2c_pmsg_getfld(pmsg, 1, 0, 0, 0, &gfld))
+                return G2C_ERROR;
+            if (g2c_read_msg(f, msgs[m].offset, &msg, &len))
+                return G2C_ERROR;
+            if (g2_getfld(msg, 1, 0, 0, &cgfld))
+                return G2C_ERROR;
+            if (!same_fld(gfld, cgfld))
+                return G2C_ERROR;
+            g2c_pmsg_info(pmsg, NULL, NULL, &nread);
+            total_read += nread;
+            total_len += len;
+            g2_free(cgfld);
+            g2_free(gfld);
+            free(msg);
+            if (g2c_close_pmsg(pmsg))
+                return G2C_ERROR;
+        }
+        if (total_read * 10 > total_len)
+            return G2C_ERROR;
+        free(msgs);
+        fclose(f);
+    }
+    printf("ok!\n");
+    free(bmap);
+    free(fld);
+    free(cgrib);
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -141,6 +141,28 @@ main()
 	}
     }
     printf("ok!\n");
+    printf("Testing pngunpack() call with a corrupt image...");
+    {
+	g2int height = 2, width = 2, ndpts = DATA_LEN, len = PACKED_LEN;
+	g2float fld[DATA_LEN] = {1.0, 2.0, 3.0, 4.0};
+	g2float fld_in[DATA_LEN];
+	unsigned char cpack[PACKED_LEN];
+	g2int lcpack;
+        g2int idrstmpl[5] = {0, 0, 1, 24, 0};
+	int i;
+
+	pngpack(fld, width, height, idrstmpl, cpack, &lcpack);
+
+	/* Spoil the PNG signature. The error is returned, and each
+	 * value is the reference value, the minimum. */
+	cpack[1] = 0;
+	if (!pngunpack(cpack, len, idrstmpl, ndpts, fld_in))
+	    return G2C_ERROR;
+	for (i = 0; i < DATA_LEN; i++)
+	    if (fld_in[i] < 0.999 || fld_in[i] > 1.001)
+		return G2C_ERROR;
+    }
+    printf("ok!\n");
     printf("SUCCESS!\n");
     return 0;
 }
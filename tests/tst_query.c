@@ -0,0 +1,157 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * query.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define TEST_BIDX_FILE "tst_query.bidx"
+#define NPTS 4
+#define NFLDS 4
+#define MSG_LEN 4000
+
+int
+main()
+{
+    printf("Testing queries.\n");
+    printf("Testing g2c_query_file() and g2c_query_bidx()...");
+    {
+        g2c_file *file;
+        g2c_bidx *bidx;
+        g2c_query q;
+        g2c_match *m, *bm;
+        size_t nm, nbm, i;
+
+        if (g2c_open_file(GRIB2_FILE, G2C_ACCESS_SEQUENTIAL, &file))
+            return G2C_ERROR;
+        if (g2c_write_bidx(GRIB2_FILE, TEST_BIDX_FILE))
+            return G2C_ERROR;
+        if (g2c_open_bidx(TEST_BIDX_FILE, &bidx))
+            return G2C_ERROR;
+
+        /* Everything. */
+        g2c_query_init(&q);
+        if (g2c_query_file(file, &q, &m, &nm) || nm != 19)
+            return G2C_ERROR;
+        free(m);
+
+        /* The swell fields (SWELL is 10.0.8). */
+        q.discipline = 10;
+        q.category = 0;
+        q.number = 8;
+        if (g2c_query_file(file, &q, &m, &nm) || nm != 3)
+            return G2C_ERROR;
+        if (m[0].offset != 116716 || m[0].fldnum != 1 || m[0].n != 8 ||
+            m[2].offset != 140848 || m[2].n != 10)
+            return G2C_ERROR;
+        if (g2c_query_bidx(bidx, &q, &bm, &nbm) || nbm != nm)
+            return G2C_ERROR;
+        for (i = 0; i < nm; i++)
+            if (bm[i].offset != m[i].offset || bm[i].fldnum != m[i].fldnum || bm[i].n != m[i].n)
+                return G2C_ERROR;
+        free(m);
+        free(bm);
+
+        /* The second swell partition. */
+        q.level_type = 241;
+        q.has_level_value = 1;
+        q.level_value = 2;
+        q.fcst_time = 0;
+        if (g2c_query_file(file, &q, &m, &nm) || nm != 1 || m[0].offset != 128832)
+            return G2C_ERROR;
+        if (g2c_query_bidx(bidx, &q, &bm, &nbm) || nbm != 1 || bm[0].offset != 128832)
+            return G2C_ERROR;
+        free(m);
+        free(bm);
+
+        /* No 6 hour forecasts, and no ensemble members. */
+        q.fcst_time = 6;
+        if (g2c_query_file(file, &q, &m, &nm) || nm || m)
+            return G2C_ERROR;
+        g2c_query_init(&q);
+        q.ens_member = 1;
+        if (g2c_query_bidx(bidx, &q, &bm, &nbm) || nbm || bm)
+            return G2C_ERROR;
+
+        /* Surface fields of discipline 0. */
+        g2c_query_init(&q);
+        q.discipline = 0;
+        q.level_type = 1;
+        if (g2c_query_bidx(bidx, &q, &bm, &nbm) || nbm != 4)
+            return G2C_ERROR;
+        free(bm);
+
+        if (g2c_query_file(NULL, &q, &m, &nm) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_close_bidx(bidx) || g2c_close_file(file))
+            return G2C_ERROR;
+        remove(TEST_BIDX_FILE);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_query_msg()...");
+    {
+        unsigned char cgrib[MSG_LEN];
+        g2int listsec0[2] = {0, 2};
+        g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+        g2int igds[5] = {0, NPTS, 0, 0, 0};
+        g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, 2, 2, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+        g2int ipdstmpl[18] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0, 3, 0, 20};
+        /* Temperature at 500 and 850 mb, for ensemble members 0 and 1. */
+        g2int level[NFLDS] = {50000, 850, 50000, 850}, scale[NFLDS] = {0, -2, 0, -2};
+        g2int member[NFLDS] = {0, 0, 1, 1};
+        g2int idrstmpl[5];
+        g2float fld[NPTS] = {1, 2, 3, 4};
+        g2c_msg *msg;
+        g2c_query q;
+        g2c_match *m;
+        size_t nm;
+        int f;
+
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        for (f = 0; f < NFLDS; f++)
+        {
+            ipdstmpl[10] = scale[f];
+            ipdstmpl[11] = level[f];
+            ipdstmpl[16] = member[f];
+            memset(idrstmpl, 0, sizeof(idrstmpl));
+            if (g2_addfield(cgrib, 1, ipdstmpl, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+                return G2C_ERROR;
+        }
+        if (g2_gribend(cgrib) < 0)
+            return G2C_ERROR;
+        if (g2c_open_msg(cgrib, &msg))
+            return G2C_ERROR;
+
+        /* 850 mb is stored as 850 * 10^2 Pa. */
+        g2c_query_init(&q);
+        q.level_type = 100;
+        q.has_level_value = 1;
+        q.level_value = 85000;
+        if (g2c_query_msg(msg, &q, &m, &nm) || nm != 2 || m[0].fldnum != 2 ||
+            m[1].fldnum != 4 || m[0].offset != 0 || m[1].n != 3)
+            return G2C_ERROR;
+        free(m);
+
+        q.ens_member = 1;
+        if (g2c_query_msg(msg, &q, &m, &nm) || nm != 1 || m[0].fldnum != 4)
+            return G2C_ERROR;
+        free(m);
+
+        q.number = 1;
+        if (g2c_query_msg(msg, &q, &m, &nm) || nm)
+            return G2C_ERROR;
+        if (g2c_close_msg(msg))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
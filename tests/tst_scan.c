@@ -0,0 +1,201 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * scan.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define GRIB2_INDEX_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2.idx"
+#define NUM_MSGS 19
+#define JUNK_LEN 37
+#define TAIL_FILE "tst_scan_tail.grib2"
+#define MAX_FILE_LEN 400000
+
+/* Find the messages with seekgb(), to check the scanner against. */
+static int
+seekgb_msgs(FILE *f, g2int *lskip, g2int *lgrib)
+{
+    g2int iseek = 0;
+    int n;
+
+    for (n = 0; n < NUM_MSGS + 1; n++)
+    {
+        seekgb(f, iseek, 32000, &lskip[n], &lgrib[n]);
+        if (!lgrib[n])
+            break;
+        iseek = lskip[n] + lgrib[n];
+    }
+    return n;
+}
+
+int
+main()
+{
+    g2int lskip[NUM_MSGS + 1], lgrib[NUM_MSGS + 1];
+
+    printf("Testing scan.\n");
+    printf("Testing g2c_scan_file()...");
+    {
+        FILE *f;
+        g2c_msgloc *msgs;
+        size_t nmsgs;
+        int m;
+
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        if (seekgb_msgs(f, lskip, lgrib) != NUM_MSGS)
+            return G2C_ERROR;
+        if (g2c_scan_file(f, &msgs, &nmsgs))
+            return G2C_ERROR;
+        fclose(f);
+
+        /* Check results against seekgb(). */
+        if (nmsgs != NUM_MSGS || msgs[0].offset || msgs[0].bytes != 15254)
+            return G2C_ERROR;
+        for (m = 0; m < NUM_MSGS; m++)
+            if (msgs[m].offset != lskip[m] || msgs[m].bytes != lgrib[m] ||
+                msgs[m].edition != 2)
+                return G2C_ERROR;
+        free(msgs);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_scan_file() on non-data file...");
+    {
+        FILE *f;
+        g2c_msgloc *msgs;
+        size_t nmsgs;
+
+        if (!(f = fopen(GRIB2_INDEX_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_scan_file(f, &msgs, &nmsgs))
+            return G2C_ERROR;
+        fclose(f);
+        if (nmsgs || msgs)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_scan_buf() with junk between messages...");
+    {
+        FILE *f;
+        unsigned char *buf, *p;
+        g2c_msgloc *msgs, loc;
+        size_t nmsgs, len;
+        int m;
+
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        fseek(f, 0, SEEK_END);
+        len = ftell(f);
+        rewind(f);
+
+        /* Put some junk, including a false start of a message, in
+         * front of each message. */
+        if (!(buf = malloc(len + NUM_MSGS * JUNK_LEN)))
+            return G2C_ERROR;
+        for (p = buf, m = 0; m < NUM_MSGS; m++)
+        {
+            memset(p, 'G', JUNK_LEN);
+            memcpy(p + 5, "GRIB\0\0\0\2", 8);
+            p += JUNK_LEN;
+            fseek(f, lskip[m], SEEK_SET);
+            if (fread(p, 1, lgrib[m], f) != lgrib[m])
+                return G2C_ERROR;
+            p += lgrib[m];
+        }
+        fclose(f);
+        len = p - buf;
+
+        if (g2c_scan_buf(buf, len, &msgs, &nmsgs))
+            return G2C_ERROR;
+        if (nmsgs != NUM_MSGS)
+            return G2C_ERROR;
+        for (p = buf, m = 0; m < NUM_MSGS; m++)
+        {
+            p += JUNK_LEN;
+            if (msgs[m].offset != p - buf || msgs[m].bytes != lgrib[m] ||
+                msgs[m].edition != 2)
+                return G2C_ERROR;
+            p += lgrib[m];
+        }
+        free(msgs);
+
+        /* A message cut off at the end of the buffer is not found. */
+        if (g2c_find_msg(buf, JUNK_LEN + lgrib[0] - 1, 0, &loc))
+            return G2C_ERROR;
+        if (!g2c_find_msg(buf, JUNK_LEN + lgrib[0], 0, &loc) ||
+            loc.offset != JUNK_LEN)
+            return G2C_ERROR;
+        free(buf);
+    }
+    printf("ok!\n");
+    printf("Testing g2c_scan_tail() on a file as it is written...");
+    {
+        unsigned char *buf;
+        g2c_msgloc *msgs, *all;
+        FILE *f, *in, *out;
+        g2int offset = 0;
+        size_t len, written = 0, step, nmsgs, nall, n = 0, m;
+        int pass;
+
+        /* The whole file, and where its messages are. */
+        if (!(buf = malloc(MAX_FILE_LEN)))
+            return G2C_ERROR;
+        if (!(f = fopen(GRIB2_FILE, "rb")))
+            return G2C_ERROR;
+        len = fread(buf, 1, MAX_FILE_LEN, f);
+        if (g2c_scan_file(f, &all, &nall) || nall != NUM_MSGS)
+            return G2C_ERROR;
+        fclose(f);
+
+        /* Write the file a piece at a time, with junk at the start,
+         * and scan it after each piece. Pieces end inside headers,
+         * inside messages, and just before the '7777'. */
+        if (!(out = fopen(TAIL_FILE, "wb")))
+            return G2C_ERROR;
+        if (!(in = fopen(TAIL_FILE, "rb")))
+            return G2C_ERROR;
+        if (fwrite("junk", 1, 4, out) != 4)
+            return G2C_ERROR;
+        for (pass = 0; written < len; pass++)
+        {
+            step = pass % 3 ? 7001 : all[n < nall ? n : 0].bytes - 3;
+            if (step > len - written)
+                step = len - written;
+            if (fwrite(buf + written, 1, step, out) != step || fflush(out))
+                return G2C_ERROR;
+            written += step;
+            if (g2c_scan_tail(in, &offset, &msgs, &nmsgs))
+                return G2C_ERROR;
+
+            /* Only complete messages are found, and each only once. */
+            for (m = 0; m < nmsgs; m++, n++)
+                if (msgs[m].offset != all[n].offset + 4 || msgs[m].bytes != all[n].bytes ||
+                    msgs[m].offset + msgs[m].bytes > written + 4)
+                    return G2C_ERROR;
+            if (offset > written + 4)
+                return G2C_ERROR;
+            free(msgs);
+        }
+        if (n != NUM_MSGS || offset != len + 4)
+            return G2C_ERROR;
+
+        /* Nothing new. */
+        if (g2c_scan_tail(in, &offset, &msgs, &nmsgs) || nmsgs || msgs)
+            return G2C_ERROR;
+        if (g2c_scan_tail(in, NULL, &msgs, &nmsgs) != G2C_EINVAL)
+            return G2C_ERROR;
+        fclose(in);
+        fclose(out);
+        free(all);
+        free(buf);
+        remove(TAIL_FILE);
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -32,6 +32,14 @@ main()
         if (lgrib != 15254 || lskip)
             return G2C_ERROR;
 
+        /* The file is left just after the message, whether its end
+         * was in the buffer or not. */
+        if (ftell(f) != lskip + lgrib)
+            return G2C_ERROR;
+        seekgb(f, 0, 32000, &lskip, &lgrib);
+        if (lgrib != 15254 || lskip || ftell(f) != lskip + lgrib)
+            return G2C_ERROR;
+
         /* Close test data file. */
         fclose(f);
     }
@@ -0,0 +1,477 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * simd_bits.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+#define NUM_BYTES 1031
+#define MAX_VALS (NUM_BYTES * 8)
+
+int
+main()
+{
+    unsigned char *in;
+    g2int *ref;
+    uint32_t *out;
+    int i;
+
+    printf("Testing SIMD bit unpacking kernels.\n");
+    printf("CPU supports SIMD level %d.\n", g2c_simd_level());
+
+    /* Allocate exactly NUM_BYTES, so that reading past the end of the
+     * input would be caught by address sanitizer or valgrind. */
+    if (!(in = malloc(NUM_BYTES)))
+        return G2C_ERROR;
+    if (!(ref = malloc(MAX_VALS * sizeof(g2int))))
+        return G2C_ERROR;
+    if (!(out = malloc(MAX_VALS * sizeof(uint32_t))))
+        return G2C_ERROR;
+    srand(7);
+    for (i = 0; i < NUM_BYTES; i++)
+        in[i] = (unsigned char)(rand() & 0xff);
+
+    for (i = G2C_SIMD_SCALAR; i <= G2C_SIMD_AVX512; i++)
+    {
+        g2c_unpack32_func kernel;
+        g2int nbits, iskip, n, j;
+
+        if (!(kernel = g2c_unpack32_kernel(i)))
+            continue;
+        printf("Testing unpack kernel for SIMD level %d against gbits()...", i);
+
+        /* Every width, every starting bit within a byte, and a range
+         * of lengths, both starting near the beginning of the buffer
+         * and ending on its last byte. */
+        for (nbits = 1; nbits <= 32; nbits++)
+        {
+            for (iskip = 0; iskip < 16; iskip++)
+            {
+                for (n = (MAX_VALS - iskip) / nbits; n > 0; n = n * 3 / 4)
+                {
+                    g2int tail = NUM_BYTES * 8 - n * nbits;
+
+                    gbits(in, ref, iskip, nbits, 0, n);
+                    kernel(in, out, iskip, nbits, n);
+                    for (j = 0; j < n; j++)
+                        if (out[j] != (uint32_t)ref[j])
+                            return G2C_ERROR;
+
+                    gbits(in, ref, tail, nbits, 0, n);
+                    kernel(in, out, tail, nbits, n);
+                    for (j = 0; j < n; j++)
+                        if (out[j] != (uint32_t)ref[j])
+                            return G2C_ERROR;
+                }
+            }
+        }
+
+        /* Zero-width values are all zero. */
+        for (j = 0; j < 100; j++)
+            out[j] = 1;
+        kernel(in, out, 3, 0, 100);
+        for (j = 0; j < 100; j++)
+            if (out[j])
+                return G2C_ERROR;
+        printf("ok!\n");
+    }
+
+    printf("Testing g2c_unpack32() dispatch...");
+    {
+        g2int j;
+
+        gbits(in, ref, 5, 13, 0, 500);
+        g2c_unpack32(in, out, 5, 13, 500);
+        for (j = 0; j < 500; j++)
+            if (out[j] != (uint32_t)ref[j])
+                return G2C_ERROR;
+    }
+    printf("ok!\n");
+
+    for (i = G2C_SIMD_SCALAR; i <= G2C_SIMD_AVX512; i++)
+    {
+        g2c_pack32_func kernel;
+        unsigned char *pk, *pref;
+        g2c_bitwriter bw, bwref;
+        g2int nbits, iskip, n, j;
+
+        if (!(kernel = g2c_pack32_kernel(i)))
+            continue;
+        printf("Testing pack kernel for SIMD level %d against g2c_bw_put_n32()...", i);
+        if (!(pk = malloc(NUM_BYTES)) || !(pref = malloc(NUM_BYTES)))
+            return G2C_ERROR;
+
+        /* Values are random 32-bit words, so only their low order
+         * bits may be used. The output starts out holding the input
+         * bytes, which must be left alone around the packed values. */
+        for (j = 0; j < MAX_VALS / 4; j++)
+            out[j] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        for (nbits = 0; nbits <= 32; nbits++)
+        {
+            for (iskip = 0; iskip < 16; iskip++)
+            {
+                for (n = nbits ? (MAX_VALS - iskip) / nbits : 100; n > 0; n = n * 3 / 4)
+                {
+                    if (n > MAX_VALS / 4)
+                        continue;
+                    memcpy(pk, in, NUM_BYTES);
+                    memcpy(pref, in, NUM_BYTES);
+                    g2c_bw_init(&bw, pk, iskip);
+                    kernel(&bw, out, nbits, n);
+                    g2c_bw_flush(&bw);
+                    g2c_bw_init(&bwref, pref, iskip);
+                    g2c_bw_put_n32(&bwref, out, nbits, n);
+                    g2c_bw_flush(&bwref);
+                    if (memcmp(pk, pref, NUM_BYTES))
+                        return G2C_ERROR;
+                }
+            }
+        }
+        free(pk);
+        free(pref);
+        printf("ok!\n");
+    }
+
+    for (i = G2C_SIMD_SCALAR; i <= G2C_SIMD_AVX512; i++)
+    {
+        g2c_bitmap_expand_func expand;
+        g2c_bitmap_compress_func compress;
+        unsigned char *pk;
+        g2int *bmap, j;
+
+        if (!(expand = g2c_bitmap_expand_kernel(i)) || !(compress = g2c_bitmap_compress_kernel(i)))
+            continue;
+        printf("Testing bitmap kernels for SIMD level %d...", i);
+        if (!(pk = malloc(NUM_BYTES)) || !(bmap = malloc(MAX_VALS * sizeof(g2int))))
+            return G2C_ERROR;
+
+        /* Expand the whole input, and compare with gbits(). */
+        expand(in, NUM_BYTES, bmap);
+        gbits(in, ref, 0, 1, 0, MAX_VALS);
+        for (j = 0; j < MAX_VALS; j++)
+            if (bmap[j] != ref[j])
+                return G2C_ERROR;
+
+        /* Compress it back, with stray high bits that must be
+         * ignored. */
+        for (j = 0; j < MAX_VALS; j++)
+            bmap[j] += j & ~(g2int)1;
+        compress(bmap, NUM_BYTES, pk);
+        if (memcmp(pk, in, NUM_BYTES))
+            return G2C_ERROR;
+        free(pk);
+        free(bmap);
+        printf("ok!\n");
+    }
+
+    printf("Testing g2c_bitmap_expand() and g2c_bitmap_compress() at any bit offset...");
+    {
+        unsigned char *pk, *pref;
+        g2int *bmap, iskip, n, j;
+        g2c_bitwriter bw;
+
+        if (!(pk = malloc(NUM_BYTES)) || !(pref = malloc(NUM_BYTES)) ||
+            !(bmap = malloc(MAX_VALS * sizeof(g2int))))
+            return G2C_ERROR;
+        for (iskip = 0; iskip < 16; iskip++)
+        {
+            for (n = MAX_VALS - iskip; n > 0; n = n * 2 / 3)
+            {
+                g2c_bitmap_expand(in, iskip, n, bmap);
+                gbits(in, ref, iskip, 1, 0, n);
+                for (j = 0; j < n; j++)
+                    if (bmap[j] != ref[j])
+                        return G2C_ERROR;
+
+                memset(pk, 0xa5, NUM_BYTES);
+                memset(pref, 0xa5, NUM_BYTES);
+                g2c_bw_init(&bw, pk, iskip);
+                g2c_bitmap_compress(&bw, bmap, n);
+                g2c_bw_flush(&bw);
+                g2c_bw_init(&bw, pref, iskip);
+                for (j = 0; j < n; j++)
+                    g2c_bw_put(&bw, bmap[j], 1);
+                g2c_bw_flush(&bw);
+                if (memcmp(pk, pref, NUM_BYTES))
+                    return G2C_ERROR;
+            }
+        }
+        free(pk);
+        free(pref);
+        free(bmap);
+    }
+    printf("ok!\n");
+
+    printf("Testing g2c_bitmap_expand8() and g2c_bitmap_copy() at any bit offset...");
+    {
+        unsigned char *b8, *bits;
+        g2int iskip, n, j;
+
+        if (!(b8 = malloc(MAX_VALS)) || !(bits = malloc(NUM_BYTES)))
+            return G2C_ERROR;
+        for (iskip = 0; iskip < 16; iskip++)
+        {
+            for (n = MAX_VALS - iskip; n > 0; n = n * 2 / 3)
+            {
+                gbits(in, ref, iskip, 1, 0, n);
+                g2c_bitmap_expand8(in, iskip, n, b8);
+                g2c_bitmap_copy(in, iskip, n, bits);
+                for (j = 0; j < n; j++)
+                    if (b8[j] != ref[j] || ((bits[j / 8] >> (7 - j % 8)) & 1) != ref[j])
+                        return G2C_ERROR;
+                if (n % 8 && (bits[n / 8] & (0xff >> (n % 8))))
+                    return G2C_ERROR;
+            }
+        }
+        free(b8);
+        free(bits);
+    }
+    printf("ok!\n");
+
+    for (i = G2C_SIMD_SCALAR; i <= G2C_SIMD_AVX512; i++)
+    {
+        g2c_expand_func kernel;
+        g2float *dat, *grid;
+        g2int nbytes, j, m, c;
+
+        if (!(kernel = g2c_expand_kernel(i)))
+            continue;
+        printf("Testing expand kernel for SIMD level %d...", i);
+        if (!(dat = malloc((MAX_VALS + 8) * sizeof(g2float))) ||
+            !(grid = malloc(MAX_VALS * sizeof(g2float))))
+            return G2C_ERROR;
+        for (j = 0; j < MAX_VALS + 8; j++)
+            dat[j] = j + 0.5;
+        for (nbytes = NUM_BYTES; nbytes > 0; nbytes = nbytes * 2 / 3)
+        {
+            gbits(in, ref, 0, 1, 0, nbytes * 8);
+            c = kernel(in, nbytes, dat, -1, grid);
+            for (j = 0, m = 0; j < nbytes * 8; j++)
+                if (grid[j] != (ref[j] ? dat[m++] : -1))
+                    return G2C_ERROR;
+            if (c != m)
+                return G2C_ERROR;
+        }
+        free(dat);
+        free(grid);
+        printf("ok!\n");
+    }
+
+    printf("Testing g2c_expand() with each bitmap format, in place and not...");
+    {
+        g2float *dat, *grid;
+        unsigned char *b8, *bits;
+        g2int n, j, m, nset;
+        int fmt, inplace;
+
+        if (!(dat = malloc(MAX_VALS * sizeof(g2float))) ||
+            !(grid = malloc(MAX_VALS * sizeof(g2float))) ||
+            !(b8 = malloc(MAX_VALS)) || !(bits = malloc(NUM_BYTES)))
+            return G2C_ERROR;
+        for (n = MAX_VALS; n > 0; n = n * 2 / 3)
+        {
+            gbits(in, ref, 0, 1, 0, n);
+            g2c_bitmap_expand8(in, 0, n, b8);
+            g2c_bitmap_copy(in, 0, n, bits);
+            for (j = 0, nset = 0; j < n; j++)
+                nset += ref[j];
+            for (fmt = G2C_BMAP_G2INT; fmt <= G2C_BMAP_BITS; fmt++)
+            {
+                void *bmap = fmt == G2C_BMAP_BITS ? (void *)bits :
+                    fmt == G2C_BMAP_UINT8 ? (void *)b8 : (void *)ref;
+
+                for (inplace = 0; inplace < 2; inplace++)
+                {
+                    /* Exactly nset data values, and the rest of the
+                     * buffer holds junk that must not be used. */
+                    for (j = 0; j < n; j++)
+                        dat[j] = j < nset ? j * 2.0 : 1e30;
+                    g2c_expand(fmt, bmap, n, dat, nset, 7, inplace ? dat : grid);
+                    for (j = 0, m = 0; j < n; j++)
+                    {
+                        g2float v = inplace ? dat[j] : grid[j];
+
+                        if (v != (ref[j] ? (m++) * 2.0 : 7))
+                            return G2C_ERROR;
+                    }
+                }
+            }
+        }
+
+        /* Too few data values for the bitmap. */
+        for (j = 0; j < 10; j++)
+            dat[j] = 1;
+        g2c_expand(G2C_BMAP_G2INT, ref, 1000, dat, 10, 7, grid);
+        for (j = 0, m = 0; j < 1000; j++)
+            if (grid[j] != (ref[j] && m++ < 10 ? 1 : 7))
+                return G2C_ERROR;
+        free(dat);
+        free(grid);
+        free(b8);
+        free(bits);
+    }
+    printf("ok!\n");
+
+    for (i = G2C_SIMD_SCALAR; i <= G2C_SIMD_AVX512; i++)
+    {
+        g2c_contract_func kernel;
+        g2float *grid, *dat;
+        g2int nbytes, j, m, c;
+
+        if (!(kernel = g2c_contract_kernel(i)))
+            continue;
+        printf("Testing contract kernel for SIMD level %d...", i);
+        if (!(grid = malloc(MAX_VALS * sizeof(g2float))) ||
+            !(dat = malloc((MAX_VALS + 8) * sizeof(g2float))))
+            return G2C_ERROR;
+        for (j = 0; j < MAX_VALS; j++)
+            grid[j] = j + 0.5;
+        for (nbytes = NUM_BYTES; nbytes > 0; nbytes = nbytes * 2 / 3)
+        {
+            gbits(in, ref, 0, 1, 0, nbytes * 8);
+            c = kernel(in, nbytes, grid, dat);
+            for (j = 0, m = 0; j < nbytes * 8; j++)
+                if (ref[j] && dat[m++] != grid[j])
+                    return G2C_ERROR;
+            if (c != m)
+                return G2C_ERROR;
+        }
+        free(grid);
+        free(dat);
+        printf("ok!\n");
+    }
+
+    printf("Testing g2c_contract() and g2c_bw_put_bitmap() with each bitmap format...");
+    {
+        g2float *grid, *dat;
+        unsigned char *b8, *bits, *pk, *pref;
+        g2c_bitwriter bw;
+        g2int n, j, m, c;
+        int fmt, inplace;
+
+        if (!(grid = malloc(MAX_VALS * sizeof(g2float))) ||
+            !(dat = malloc(MAX_VALS * sizeof(g2float))) ||
+            !(b8 = malloc(MAX_VALS)) || !(bits = malloc(NUM_BYTES)) ||
+            !(pk = malloc(NUM_BYTES + 1)) || !(pref = malloc(NUM_BYTES + 1)))
+            return G2C_ERROR;
+        for (n = MAX_VALS; n > 0; n = n * 2 / 3)
+        {
+            gbits(in, ref, 0, 1, 0, n);
+            g2c_bitmap_expand8(in, 0, n, b8);
+            g2c_bitmap_copy(in, 0, n, bits);
+            for (fmt = G2C_BMAP_G2INT; fmt <= G2C_BMAP_BITS; fmt++)
+            {
+                void *bmap = fmt == G2C_BMAP_BITS ? (void *)bits :
+                    fmt == G2C_BMAP_UINT8 ? (void *)b8 : (void *)ref;
+
+                for (inplace = 0; inplace < 2; inplace++)
+                {
+                    for (j = 0; j < n; j++)
+                        grid[j] = j * 2.0;
+                    c = g2c_contract(fmt, bmap, n, grid, inplace ? grid : dat);
+                    for (j = 0, m = 0; j < n; j++)
+                        if (ref[j] && (inplace ? grid : dat)[m++] != j * 2.0)
+                            return G2C_ERROR;
+                    if (c != m)
+                        return G2C_ERROR;
+                }
+
+                /* Write the bitmap 3 bits into a byte, and on a byte
+                 * boundary. */
+                for (j = 0; j < 8; j += 5)
+                {
+                    memset(pk, 0xa5, NUM_BYTES + 1);
+                    memset(pref, 0xa5, NUM_BYTES + 1);
+                    g2c_bw_init(&bw, pk, j);
+                    g2c_bw_put_bitmap(&bw, fmt, bmap, n);
+                    g2c_bw_flush(&bw);
+                    g2c_bw_init(&bw, pref, j);
+                    g2c_bitmap_compress(&bw, ref, n);
+                    g2c_bw_flush(&bw);
+                    if (memcmp(pk, pref, NUM_BYTES + 1))
+                        return G2C_ERROR;
+                }
+            }
+        }
+        free(grid);
+        free(dat);
+        free(b8);
+        free(bits);
+        free(pk);
+        free(pref);
+    }
+    printf("ok!\n");
+
+    printf("Testing g2c_contract() with g2int bitmap values other than 0 and 1...");
+    {
+        g2int vals[6] = {2, 3, -1, 0, 5, 4};
+        g2int bmap[100], nset;
+        g2float grid[100], dat[100];
+        unsigned char pk[16];
+        g2c_bitwriter bw;
+        g2int n, j, c, m;
+
+        /* Only the low order bit, which goes into Section 6, counts,
+         * in whole bitmap bytes and in the points after them. */
+        for (n = 1; n <= 100; n++)
+        {
+            for (j = 0, nset = 0; j < n; j++)
+            {
+                bmap[j] = n == 9 ? 2 : vals[(j + n) % 6];
+                grid[j] = j;
+                nset += bmap[j] & 1;
+            }
+            c = g2c_contract(G2C_BMAP_G2INT, bmap, n, grid, dat);
+            if (c != nset)
+                return G2C_ERROR;
+            for (j = 0, m = 0; j < n; j++)
+                if (bmap[j] & 1 && dat[m++] != j)
+                    return G2C_ERROR;
+
+            /* The points kept match the bitmap written. */
+            memset(pk, 0, sizeof(pk));
+            g2c_bw_init(&bw, pk, 0);
+            g2c_bw_put_bitmap(&bw, G2C_BMAP_G2INT, bmap, n);
+            g2c_bw_flush(&bw);
+            for (j = 0, m = 0; j < n; j++)
+                m += (pk[j / 8] >> (7 - j % 8)) & 1;
+            if (m != c)
+                return G2C_ERROR;
+        }
+    }
+    printf("ok!\n");
+
+    printf("Testing g2c_unpack_scale() against unpacking then scaling...");
+    {
+        g2float *fld;
+        g2float bscale = 0.25, dscale = 0.1, refval = -3.5;
+        g2int nbits, n, j;
+
+        if (!(fld = malloc(MAX_VALS * sizeof(g2float))))
+            return G2C_ERROR;
+        for (nbits = 0; nbits <= 40; nbits++)
+        {
+            n = nbits ? (NUM_BYTES * 8 - 3) / nbits : 1000;
+            g2c_unpack_scale(in, 3, nbits, n, refval, bscale, dscale, fld);
+            if (nbits)
+                gbits(in, ref, 3, nbits, 0, n);
+            for (j = 0; j < n; j++)
+            {
+                g2float expect = nbits ? (((g2float)ref[j] * bscale) + refval) * dscale : refval;
+                if (fld[j] != expect)
+                    return G2C_ERROR;
+            }
+        }
+        free(fld);
+    }
+    printf("ok!\n");
+
+    free(in);
+    free(ref);
+    free(out);
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,248 @@
+/* This is a test for the NCEPLIBS-g2c project. This test is for
+ * stream.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+
+#define GRIB2_FILE "gdaswave.t00z.wcoast.0p16.f000.grib2"
+#define TEST_STREAM_FILE "tst_stream.grib2"
+#define NUM_MSGS 19
+#define MAX_MSGS 40
+#define MAX_LEN 400000
+#define NPTS 4
+#define MSG_LEN 2000
+
+/* What the callback saw. */
+struct seen
+{
+    unsigned char *stream;      /* The whole stream, to check against. */
+    unsigned char *chunk;       /* The chunk being fed. */
+    size_t chunk_len;           /* Its length. */
+    g2c_msgloc msgs[MAX_MSGS];  /* The messages. */
+    int nmsgs;                  /* Number of messages. */
+    int ncopied;                /* Number not passed in the chunk. */
+    int stop;                   /* Stop after this many messages. */
+    int bad;                    /* Set if a message was wrong. */
+};
+
+static int
+callback(unsigned char *cgrib, g2int lengrib, g2int offset, void *arg)
+{
+    struct seen *s = arg;
+
+    if (s->nmsgs == MAX_MSGS || memcmp(cgrib, s->stream + offset, lengrib))
+        s->bad = 1;
+    else
+    {
+        s->msgs[s->nmsgs].offset = offset;
+        s->msgs[s->nmsgs].bytes = lengrib;
+        s->nmsgs++;
+    }
+    if (cgrib < s->chunk || cgrib + lengrib > s->chunk + s->chunk_len)
+        s->ncopied++;
+    return s->stop && s->nmsgs == s->stop ? 42 : 0;
+}
+
+int
+main()
+{
+    unsigned char *buf, cgrib[MSG_LEN];
+    /* The header of a message longer than the whole stream. */
+    unsigned char local[17] = "GRIB\0\0\0\2\0\0\0\0\0\x10\0\0";
+    /* A header with no '7777' at the end of its message. */
+    unsigned char nomsg[40] = "GRIB\0\0\0\2\0\0\0\0\0\0\0\x28";
+    /* A GRIB1 message. */
+    unsigned char grib1[24] = "GRIB\0\0\x18\1";
+    g2int listsec0[2] = {0, 2};
+    g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+    g2int igds[5] = {0, NPTS, 0, 0, 0};
+    g2int igdstmpl[19] = {0, 1, 2, 3, 4, 5, 6, 2, 2, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+    g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+    g2int idrstmpl[5] = {0};
+    g2float fld[NPTS] = {1, 2, 3, 4};
+    g2c_msgloc *ref;
+    size_t len = 0, nref = 0, data_start, data_len, i;
+    g2int n;
+    FILE *f;
+    int m;
+
+    /* A stream of junk, a GRIB1 message, a header with no message, a
+     * message, a message with a header in its local use section, the
+     * same header, whose message would run past the end of the stream,
+     * the test data file, and the start of a header. */
+    if (!(buf = malloc(MAX_LEN)))
+        return G2C_ERROR;
+    memcpy(buf, "junkGRIBjunkGG", 14);
+    len = 14;
+    memcpy(grib1 + 20, "7777", 4);
+    memcpy(buf + len, grib1, sizeof(grib1));
+    len += sizeof(grib1);
+    memcpy(buf + len, nomsg, sizeof(nomsg));
+    len += sizeof(nomsg);
+    for (m = 0; m < 2; m++)
+    {
+        if (g2_create(cgrib, listsec0, listsec1) < 0)
+            return G2C_ERROR;
+        if (m == 1 && g2_addlocal(cgrib, local, sizeof(local)) < 0)
+            return G2C_ERROR;
+        if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+            return G2C_ERROR;
+        if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, 0, idrstmpl, fld, NPTS, 255, NULL) < 0)
+            return G2C_ERROR;
+        if ((n = g2_gribend(cgrib)) < 0)
+            return G2C_ERROR;
+        memcpy(buf + len, cgrib, n);
+        len += n;
+    }
+    memcpy(buf + len, local, G2C_MSG_HEADER_LEN);
+    len += G2C_MSG_HEADER_LEN;
+    if (!(f = fopen(GRIB2_FILE, "rb")))
+        return G2C_ERROR;
+    data_start = len;
+    data_len = fread(buf + len, 1, MAX_LEN - len - 3, f);
+    len += data_len;
+    fclose(f);
+    memcpy(buf + len, "GRI", 3);
+    len += 3;
+
+    /* The GRIB2 messages that g2c_scan_buf() finds. */
+    {
+        g2c_msgloc *all;
+        size_t nall;
+
+        if (g2c_scan_buf(buf, len, &all, &nall))
+            return G2C_ERROR;
+        if (!(ref = malloc(nall * sizeof(g2c_msgloc))))
+            return G2C_ERROR;
+        for (i = 0; i < nall; i++)
+            if (all[i].edition == 2)
+                ref[nref++] = all[i];
+        if (nall != NUM_MSGS + 3 || nref != NUM_MSGS + 2)
+            return G2C_ERROR;
+        free(all);
+    }
+
+    printf("Testing streams.\n");
+    printf("Testing g2c_stream_feed() with chunks of any size...");
+    {
+        size_t chunk_size[] = {1, 2, 3, 7, 15, 16, 17, 100, 1000, 4096, 65536, MAX_LEN};
+        struct seen s;
+        g2c_stream *stream;
+        size_t c, pos;
+
+        for (c = 0; c < sizeof(chunk_size) / sizeof(size_t); c++)
+        {
+            memset(&s, 0, sizeof(s));
+            s.stream = buf;
+            if (g2c_open_stream(callback, &s, &stream))
+                return G2C_ERROR;
+            for (pos = 0; pos < len; pos += s.chunk_len)
+            {
+                s.chunk = buf + pos;
+                s.chunk_len = len - pos < chunk_size[c] ? len - pos : chunk_size[c];
+                if (g2c_stream_feed(stream, s.chunk, s.chunk_len))
+                    return G2C_ERROR;
+            }
+            if (g2c_close_stream(stream))
+                return G2C_ERROR;
+            if (s.bad || s.nmsgs != nref)
+                return G2C_ERROR;
+            for (i = 0; i < nref; i++)
+                if (s.msgs[i].offset != ref[i].offset || s.msgs[i].bytes != ref[i].bytes)
+                    return G2C_ERROR;
+        }
+    }
+    printf("ok!\n");
+    printf("Testing that only messages across chunks are copied...");
+    {
+        size_t chunk_size[] = {65536, MAX_LEN};
+        struct seen s;
+        g2c_stream *stream;
+        size_t c, pos;
+
+        for (c = 0; c < sizeof(chunk_size) / sizeof(size_t); c++)
+        {
+            memset(&s, 0, sizeof(s));
+            s.stream = buf + data_start;
+            if (g2c_open_stream(callback, &s, &stream))
+                return G2C_ERROR;
+            for (pos = data_start; pos < data_start + data_len; pos += s.chunk_len)
+            {
+                s.chunk = buf + pos;
+                s.chunk_len = data_start + data_len - pos;
+                if (s.chunk_len > chunk_size[c])
+                    s.chunk_len = chunk_size[c];
+                if (g2c_stream_feed(stream, s.chunk, s.chunk_len))
+                    return G2C_ERROR;
+            }
+            if (g2c_close_stream(stream))
+                return G2C_ERROR;
+
+            /* Offsets are from the start of what was fed. */
+            if (s.bad || s.nmsgs != NUM_MSGS || s.msgs[0].offset)
+                return G2C_ERROR;
+            if (s.ncopied > (data_len + chunk_size[c] - 1) / chunk_size[c] - 1)
+                return G2C_ERROR;
+        }
+    }
+    printf("ok!\n");
+    printf("Testing stopping in the callback...");
+    {
+        struct seen s;
+        g2c_stream *stream;
+
+        memset(&s, 0, sizeof(s));
+        s.stream = buf;
+        s.stop = 2;
+        if (g2c_open_stream(callback, &s, &stream))
+            return G2C_ERROR;
+        if (g2c_stream_feed(stream, buf, len) != 42)
+            return G2C_ERROR;
+        if (g2c_close_stream(stream))
+            return G2C_ERROR;
+        if (s.bad || s.nmsgs != 2)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_scan_stream()...");
+    {
+        struct seen s;
+
+        if (!(f = fopen(TEST_STREAM_FILE, "wb")))
+            return G2C_ERROR;
+        if (fwrite(buf, 1, len, f) != len)
+            return G2C_ERROR;
+        fclose(f);
+
+        memset(&s, 0, sizeof(s));
+        s.stream = buf;
+        if (!(f = fopen(TEST_STREAM_FILE, "rb")))
+            return G2C_ERROR;
+        if (g2c_scan_stream(f, callback, &s))
+            return G2C_ERROR;
+        fclose(f);
+        if (s.bad || s.nmsgs != nref)
+            return G2C_ERROR;
+        for (i = 0; i < nref; i++)
+            if (s.msgs[i].offset != ref[i].offset || s.msgs[i].bytes != ref[i].bytes)
+                return G2C_ERROR;
+        remove(TEST_STREAM_FILE);
+
+        if (g2c_scan_stream(NULL, callback, &s) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_open_stream(NULL, &s, NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_close_stream(NULL) != G2C_EINVAL)
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    free(ref);
+    free(buf);
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+/* This is a test for the NCEPLIBS-g2c project. This test encodes
+ * and decodes messages from many threads at once, to check that the
+ * library is reentrant.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "grib2_int.h"
+
+#define G2C_ERROR 2
+
+#define NTHREADS 8
+#define NITER 20
+#define NX 50
+#define NY 40
+#define NPTS (NX * NY)
+#define NFLDS 5
+#define MSG_LEN 100000
+
+/* The work of one thread. */
+struct work
+{
+    int id;                         /* Thread number, which sets the data. */
+    unsigned char ref[MSG_LEN];     /* Message encoded before the threads start. */
+    g2int ref_len;                  /* Its length. */
+    g2float ref_fld[NFLDS][NPTS];   /* Its fields, decoded and expanded. */
+    int bad;                        /* Set if the thread got a different result. */
+};
+
+static struct work work[NTHREADS];
+
+/* Write a message whose data depends on id, with fields packed with
+ * simple and complex packing, with and without spatial differences
+ * and missing values, all with a bitmap. */
+static g2int
+make_msg(int id, unsigned char *cgrib)
+{
+    g2int listsec0[2] = {0, 2};
+    g2int listsec1[13] = {7, 4, 24, 0, 0, 2021, 10, 24, 6, 54, 59, 7, 192};
+    g2int igds[5] = {0, NPTS, 0, 0, 0};
+    g2int igdstmpl[19] = {6, 0, 0, 0, 0, 0, 0, NX, NY, 0, 0, 20000000, 0, 48,
+                          -20000000, 250000, 250000, 250000, 0};
+    g2int ipdstmpl[15] = {0, 0, 2, 0, 96, 0, 0, 1, 6, 100, 0, 50000, 255, 0, 0};
+    g2int drs[NFLDS][18] = {
+        {0, 0, 2, 0, 0},
+        {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+        {0, 0, 2, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+        {0, 0, 2, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2},
+        {0, 0, 2, 0, 0, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2}};
+    g2int drsnum[NFLDS] = {0, 2, 2, 3, 3};
+    g2int bmap[NPTS];
+    g2float fld[NPTS];
+    int i, f;
+
+    for (i = 0; i < NPTS; i++)
+    {
+        bmap[i] = (i + id) % 11 != 0;
+        fld[i] = 280 + 15 * sin((i % NX + id) * 0.2) * cos((i / NX) * 0.15) +
+            (i * (id + 3) % 17) * 0.1;
+    }
+    if (g2_create(cgrib, listsec0, listsec1) < 0)
+        return -1;
+    if (g2_addgrid(cgrib, igds, igdstmpl, NULL, 0) < 0)
+        return -1;
+    for (f = 0; f < NFLDS; f++)
+        if (g2_addfield(cgrib, 0, ipdstmpl, NULL, 0, drsnum[f], drs[f], fld, NPTS,
+                        0, bmap) < 0)
+            return -1;
+    return g2_gribend(cgrib);
+}
+
+/* Encode and decode the thread's message again and again, checking
+ * each result against the one from before the threads started. */
+static void *
+run(void *arg)
+{
+    struct work *w = arg;
+    unsigned char *cgrib;
+    g2float out[NPTS];
+    gribfield *gfld;
+    g2c_decoder *dec;
+    int i, f;
+
+    if (!(cgrib = malloc(MSG_LEN)) || g2c_open_decoder(&dec))
+    {
+        w->bad = 1;
+        return NULL;
+    }
+    for (i = 0; i < NITER && !w->bad; i++)
+    {
+        if (make_msg(w->id, cgrib) != w->ref_len || memcmp(cgrib, w->ref, w->ref_len))
+            w->bad = 1;
+        for (f = 1; f <= NFLDS && !w->bad; f++)
+        {
+            if (g2c_getfld(cgrib, f, 1, 1, 0, &gfld))
+            {
+                w->bad = 1;
+                break;
+            }
+            if (memcmp(gfld->fld, w->ref_fld[f - 1], NPTS * sizeof(g2float)))
+                w->bad = 1;
+            g2_free(gfld);
+            if (g2c_decoder_getfld(dec, cgrib, f, 1, 1, G2C_GFLD_ARENA, out, NPTS, &gfld))
+            {
+                w->bad = 1;
+                break;
+            }
+            if (memcmp(out, w->ref_fld[f - 1], NPTS * sizeof(g2float)))
+                w->bad = 1;
+            g2_free(gfld);
+        }
+    }
+    g2c_close_decoder(dec);
+    free(cgrib);
+    return NULL;
+}
+
+int
+main()
+{
+    printf("Testing the library from many threads.\n");
+    printf("Testing encoding and decoding from %d threads at once...", NTHREADS);
+    {
+        pthread_t thread[NTHREADS];
+        gribfield *gfld;
+        int t, f;
+
+        /* The results from one thread. */
+        for (t = 0; t < NTHREADS; t++)
+        {
+            work[t].id = t;
+            if ((work[t].ref_len = make_msg(t, work[t].ref)) < 0)
+                return G2C_ERROR;
+            for (f = 1; f <= NFLDS; f++)
+            {
+                if (g2c_getfld(work[t].ref, f, 1, 1, 0, &gfld))
+                    return G2C_ERROR;
+                if (gfld->ngrdpts != NPTS)
+                    return G2C_ERROR;
+                memcpy(work[t].ref_fld[f - 1], gfld->fld, NPTS * sizeof(g2float));
+                g2_free(gfld);
+            }
+        }
+
+        /* The threads must get the same results. */
+        for (t = 0; t < NTHREADS; t++)
+            if (pthread_create(&thread[t], NULL, run, &work[t]))
+                return G2C_ERROR;
+        for (t = 0; t < NTHREADS; t++)
+            if (pthread_join(thread[t], NULL))
+                return G2C_ERROR;
+        for (t = 0; t < NTHREADS; t++)
+            if (work[t].bad)
+                return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("Testing g2c_set_log_level()...");
+    {
+        if (g2c_set_log_level(-1) != G2C_EINVAL)
+            return G2C_ERROR;
+        if (g2c_set_log_level(0) || g2c_set_log_level(1))
+            return G2C_ERROR;
+    }
+    printf("ok!\n");
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,62 @@
+/* This is a utility for the NCEPLIBS-g2c project. It writes binary
+ * indexes of GRIB2 files, or a catalog of them, with several threads.
+ *
+ * Usage: g2c_catalog [-t nthreads] [-o catalog] file.grib2 ...
+ *
+ * Without -o, the index of each file is written next to it, with
+ * .bidx added to its name. The default is one thread per processor.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "grib2.h"
+
+int
+main(int argc, char **argv)
+{
+    const char *catpath = NULL;
+    char **idxpaths = NULL;
+    int nthreads = 0, a = 1, i, nfiles, ret;
+
+    for (; a + 1 < argc && argv[a][0] == '-'; a += 2)
+    {
+        if (!strcmp(argv[a], "-t"))
+            nthreads = atoi(argv[a + 1]);
+        else if (!strcmp(argv[a], "-o"))
+            catpath = argv[a + 1];
+        else
+            break;
+    }
+    if (a >= argc || argv[a][0] == '-' || nthreads < 0)
+    {
+        fprintf(stderr, "usage: %s [-t nthreads] [-o catalog] file.grib2 ...\n", argv[0]);
+        return 1;
+    }
+    nfiles = argc - a;
+
+    if (catpath)
+        ret = g2c_write_catalog(nfiles, (const char **)&argv[a], catpath, nthreads);
+    else
+    {
+        if (!(idxpaths = calloc(nfiles, sizeof(char *))))
+            return 1;
+        for (i = 0; i < nfiles; i++)
+        {
+            if (!(idxpaths[i] = malloc(strlen(argv[a + i]) + sizeof(".bidx"))))
+                return 1;
+            sprintf(idxpaths[i], "%s.bidx", argv[a + i]);
+        }
+        ret = g2c_write_bidxs(nfiles, (const char **)&argv[a], (const char **)idxpaths,
+                              nthreads);
+        for (i = 0; i < nfiles; i++)
+            free(idxpaths[i]);
+        free(idxpaths);
+    }
+    if (ret)
+    {
+        fprintf(stderr, "%s: error %d indexing files\n", argv[0], ret);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+/* This is a utility for the NCEPLIBS-g2c project. It writes an
+ * inventory of a GRIB2 file, in the .idx format of wgrib2.
+ *
+ * Usage: g2c_index file.grib2 [file.grib2.idx]
+ *
+ * The inventory goes to standard output if no index file is given.
+ */
+
+#include <stdio.h>
+#include "grib2.h"
+
+int
+main(int argc, char **argv)
+{
+    FILE *out = stdout;
+    g2c_idx *idx;
+    int ret;
+
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "usage: %s file.grib2 [file.grib2.idx]\n", argv[0]);
+        return 1;
+    }
+
+    if ((ret = g2c_make_idx(argv[1], &idx)))
+    {
+        fprintf(stderr, "%s: error %d making inventory of %s\n", argv[0], ret, argv[1]);
+        return 1;
+    }
+    if (argc == 3 && !(out = fopen(argv[2], "w")))
+    {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[2]);
+        g2c_free_idx(idx);
+        return 1;
+    }
+    ret = g2c_write_idx(idx, out);
+    if (out != stdout && fclose(out))
+        ret = G2C_EFILE;
+    g2c_free_idx(idx);
+    if (ret)
+    {
+        fprintf(stderr, "%s: error %d writing inventory\n", argv[0], ret);
+        return 1;
+    }
+    return 0;
+}